@@ -0,0 +1,65 @@
+#ifndef APP_H
+#define APP_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "command.h"
+#include "event_writer.h"
+#include "outbound_buffer.h"
+
+// Task layout
+// - network: WiFi/MQTT connection handling, MQTT loop and all publishes
+// - sesame:  owns the SesameClient, executes commands and BLE callbacks
+// - rxb6:    wakes on RF interrupts and turns them into commands
+#define NETWORK_TASK_STACK 6144
+#define SESAME_TASK_STACK 8192
+#define RXB6_TASK_STACK 3072
+
+#define NETWORK_TASK_PRIORITY 1
+#define SESAME_TASK_PRIORITY 2
+#define RXB6_TASK_PRIORITY 3
+
+#define APP_TASK_CORE 1
+
+#define SESAME_QUEUE_LENGTH 16        // commands and settings from the other tasks
+#define SESAME_BLE_QUEUE_LENGTH 32    // BLE callbacks, separate so commands cannot crowd them out
+#define SESAME_BLE_QUEUE_RESERVE 8    // last slots, kept for state and status events
+#define PUBLISH_QUEUE_LENGTH 8
+
+// Snapshot of the last status notification reported by the lock
+struct LockStatus {
+    bool valid;
+    bool locked;
+    bool unlocked;
+    int16_t position;
+    float voltage;
+    float batteryPct;
+};
+
+// Outbound MQTT message, copied by value through the publish queue
+struct OutboundMessage {
+    uint32_t queuedMs;   // millis() when it was queued, for age_ms on replay
+    uint16_t length;     // payload bytes; JSON payloads are also NUL-terminated
+    char topic[OUTBOUND_TOPIC_SIZE];
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+};
+
+// Connection flags, written by their owning task and read everywhere
+extern std::atomic<bool> wifiConnected;
+extern std::atomic<bool> mqttConnected;
+
+// network_task.cpp
+void startNetworkTask();
+bool queuePublish(const char* topic, const uint8_t* payload, size_t length);
+bool queuePublish(const char* topic, const EventWriter& event);
+
+// sesame_task.cpp
+void startSesameTask();
+bool queueSesameCommand(const SesameCommand& command);
+bool queueConfigChanged();
+
+// rxb6_task.cpp
+void startRXB6Task();
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <stdint.h>
+
+// Exponential retry backoff with jitter. The delay doubles with every
+// consecutive failure from minMs up to maxMs and is spread by +/- jitterPct
+// so several locks (or controllers) that dropped together do not retry in
+// lockstep. reset() after a success makes the next retry fast again.
+class Backoff {
+public:
+    Backoff(uint32_t minMs, uint32_t maxMs, uint8_t jitterPct);
+
+    // Delay before the next attempt; random is any 32-bit random value
+    uint32_t nextDelayMs(uint32_t random);
+
+    void reset() { failures = 0; }
+    uint8_t attempts() const { return failures; }
+
+private:
+    uint32_t minMs;
+    uint32_t maxMs;
+    uint8_t jitterPct;
+    uint8_t failures;
+};
+
+#endif
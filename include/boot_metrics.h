@@ -0,0 +1,26 @@
+#ifndef BOOT_METRICS_H
+#define BOOT_METRICS_H
+
+#include <stdint.h>
+
+// First-time milestones after a boot, in the order they usually happen.
+// Each is stamped once, by whichever task reaches it.
+enum class BootStage : uint8_t {
+    ble,        // NimBLE initialized
+    wifi,       // first IP address
+    mqtt,       // first broker connection
+    state,      // first lock state reported by a lock (not the cache)
+    session,    // first authenticated session
+    command,    // first command confirmed
+    count
+};
+
+void markBootStage(BootStage stage);
+
+// Milliseconds from boot to the stage, or 0 if not reached yet
+uint32_t bootStageMs(BootStage stage);
+
+// Why the chip last reset ("poweron", "brownout", "task_wdt", ...)
+const char* resetReasonName();
+
+#endif
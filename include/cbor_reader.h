@@ -0,0 +1,64 @@
+#ifndef CBOR_READER_H
+#define CBOR_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "event_writer.h"
+
+// In-place reader for flat CBOR maps such as MQTT command payloads - the
+// binary counterpart of JsonObjectScanner. Keys may be text or FieldId
+// numbers; nested arrays/maps are skipped as opaque values. Nothing is
+// allocated: text values point into the caller's buffer.
+
+enum class CborValueType : uint8_t {
+    unsignedInt,
+    negativeInt,
+    bytes,
+    text,
+    array,
+    map,
+    simple,    // false, true, null, undefined
+    floating
+};
+
+struct CborField {
+    bool keyIsId;           // numeric key: keyId is set, key/keyLength are not
+    uint64_t keyId;
+    const char* key;
+    size_t keyLength;
+
+    CborValueType type;
+    const uint8_t* value;   // text/byte string contents
+    size_t valueLength;
+    uint64_t number;        // integer argument, or the simple value
+
+    // Matches the numeric id or the JSON name of the field
+    bool keyEquals(FieldId id) const;
+
+    // Copy a text value as a C string; false if not text or truncated
+    bool copyText(char* out, size_t size) const;
+};
+
+class CborMapScanner {
+public:
+    CborMapScanner(const uint8_t* data, size_t length);
+
+    // Advance to the next entry; false at the end of the map or on malformed input
+    bool next(CborField& field);
+
+    bool failed() const { return error; }
+
+private:
+    bool readHead(uint8_t& major, uint64_t& argument, bool& indefinite);
+    bool skipItem(int depth);
+
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool started;
+    bool finished;
+    bool error;
+    bool indefiniteMap;
+    uint64_t remaining;
+};
+
+#endif
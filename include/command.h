@@ -0,0 +1,62 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define COMMAND_TARGET_SIZE 16
+#define COMMAND_REQUEST_ID_SIZE 32
+#define COMMAND_MAX_DELAY_S 604800         // "delay_s" / "relock_s" limit: 7 days
+#define COMMAND_RELOCK_NEVER UINT32_MAX    // "relock_s": 0 - no auto-relock for this unlock
+
+// Commands accepted by the sesame task
+enum class CommandAction : uint8_t {
+    none,
+    lock,
+    unlock,
+    toggle,
+    status
+};
+
+enum class CommandSource : uint8_t {
+    mqtt,
+    rxb6,
+    autotest,
+    lan,
+    timer     // auto-relock
+};
+
+// Fixed-size command record, copied by value through the sesame queue
+struct SesameCommand {
+    CommandAction action;
+    CommandSource source;
+    uint32_t ingressUs;                          // micros() when the trigger entered the firmware
+    uint32_t dispatchUs;                         // micros() when it was written to the lock over BLE
+    char target[COMMAND_TARGET_SIZE];            // optional lock id, empty for the default lock
+    char requestId[COMMAND_REQUEST_ID_SIZE];     // optional client-supplied id, empty if none
+    uint32_t delayS;                             // run this long after it arrived, 0 = now
+    uint32_t relockS;                            // unlocks: lock again this long after confirmation,
+                                                 // 0 = AUTO_RELOCK_S, COMMAND_RELOCK_NEVER = off
+};
+
+enum class CommandParseResult : uint8_t {
+    ok,
+    malformed,
+    missingAction,
+    unknownAction,
+    fieldTooLong,
+    invalidValue
+};
+
+// Decode a command payload ({"action":..,"target":..,"request_id":..,
+// "delay_s":..,"relock_s":..}, as JSON or as a CBOR map - told apart by the
+// first byte) in place into command. Fills the command fields only (not
+// source or timestamps); no allocation.
+CommandParseResult parseCommandPayload(const char* payload, size_t length, SesameCommand& command);
+const char* commandParseResultName(CommandParseResult result);
+
+CommandAction parseCommandAction(const char* text, size_t length);
+const char* commandActionName(CommandAction action);
+const char* commandSourceName(CommandSource source);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "command.h"
+
+#define COMMAND_RESULT_SLOTS 4
+
+// How a lock/unlock command ended
+enum class CommandOutcome : uint8_t {
+    confirmed,   // the lock reported the requested state
+    timeout,     // sent, but no matching status within the confirm timeout
+    superseded,  // replaced by a newer command before it was sent
+    duplicate,   // same action already queued, in flight or just confirmed
+    expired      // waited too long for a session and was never sent
+};
+
+struct CommandResult {
+    SesameCommand command;
+    CommandOutcome outcome;
+    uint32_t elapsedMs;   // since the command was queued
+    uint32_t confirmUs;   // micros() of the confirming status, 0 unless confirmed
+};
+
+// Per-lock queue of lock/unlock commands. At most one command is in flight
+// (sent, waiting for statusUpdate() to confirm it) and at most one waits
+// behind it: a newer command always supersedes the waiting one, so
+// lock -> unlock -> lock collapses to a single lock and the depth stays
+// bounded at two however fast commands arrive. Toggles must be resolved
+// to lock/unlock before they are queued.
+//
+// Every command that leaves the queue produces one CommandResult, collected
+// with takeResult().
+class CommandQueue {
+public:
+    CommandQueue(uint32_t dedupWindowMs, uint32_t confirmTimeoutMs, uint32_t maxQueuedMs);
+
+    // Queue a command; false when it was dropped as a duplicate
+    bool push(const SesameCommand& command, uint32_t nowMs);
+
+    // Move the waiting command in flight when nothing else is; the caller sends it
+    bool next(uint32_t nowMs, uint32_t nowUs, SesameCommand& out);
+
+    // Match a status notification (received at statusUs) against the in-flight command
+    void statusUpdate(bool locked, bool unlocked, uint32_t nowMs, uint32_t statusUs);
+
+    // Time out commands whose confirm or queue deadline has passed
+    void expire(uint32_t nowMs);
+
+    // Milliseconds until the earliest deadline, or UINT32_MAX if idle
+    uint32_t msUntilNextDeadline(uint32_t nowMs) const;
+
+    // Collect one finished command
+    bool takeResult(CommandResult& out);
+
+    bool hasQueued() const { return queued.active; }
+    size_t depth() const { return (queued.active ? 1 : 0) + (inFlight.active ? 1 : 0); }
+    uint32_t droppedResults() const { return resultOverflows; }
+
+private:
+    struct Slot {
+        bool active;
+        SesameCommand command;
+        uint32_t queuedMs;
+        uint32_t sentMs;
+    };
+
+    void finish(Slot& slot, CommandOutcome outcome, uint32_t nowMs, uint32_t confirmUs = 0);
+    void addResult(const SesameCommand& command, CommandOutcome outcome, uint32_t elapsedMs,
+                   uint32_t confirmUs = 0);
+
+    uint32_t dedupWindowMs;
+    uint32_t confirmTimeoutMs;
+    uint32_t maxQueuedMs;
+
+    Slot queued;
+    Slot inFlight;
+
+    CommandAction lastConfirmed;
+    uint32_t lastConfirmedMs;
+
+    CommandResult results[COMMAND_RESULT_SLOTS];
+    size_t resultCount;
+    uint32_t resultOverflows;
+};
+
+const char* commandOutcomeName(CommandOutcome outcome);
+
+#endif
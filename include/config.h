@@ -11,45 +11,207 @@
 #define MQTT_USERNAME "cuongtq-sesame-1"
 #define MQTT_PASSWORD "cuongtq-sesame-1"
 
+// Network reconnects (non-blocking, exponential backoff with jitter)
+#define WIFI_CONNECT_TIMEOUT_MS 15000  // Association + DHCP before an attempt counts as failed
+#define MQTT_CONNECT_TIMEOUT_MS 2000   // TCP connect to the broker
+#define MQTT_SOCKET_TIMEOUT_S 2        // CONNACK wait (PubSubClient, whole seconds)
+#define NETWORK_RETRY_MIN_MS 1000
+#define NETWORK_RETRY_MAX_MS 60000
+#define NETWORK_RETRY_JITTER_PCT 25
+#define NETWORK_IDLE_POLL_MS 100       // Longest sleep while the network is down
+
+// Offline outbound buffer: RAM ring, then a LittleFS log, replayed in order on reconnect
+#define OUTBOUND_BUFFER_BYTES 8192        // RAM ring (power of two)
+#define OUTBOUND_SPILL_PATH "/outbox.log"
+#define OUTBOUND_SPILL_TEMP_PATH "/outbox.tmp"  // Compaction writes here, then renames
+#define OUTBOUND_SPILL_MAX_BYTES 65536    // Flash log cap; newer messages are dropped beyond it
+#define OUTBOUND_REPLAY_BURST 4           // Buffered messages per replay slot...
+#define OUTBOUND_REPLAY_INTERVAL_MS 50    // ...so live traffic is never starved
+#define OUTBOUND_REPLAY_MAX_ATTEMPTS 3    // Publishes refused while connected before a message is skipped
+#define MQTT_TOPIC_OUTBOUND_METRICS "sesame/metrics/outbound"
+
 // MQTT Topics
-#define MQTT_TOPIC_COMMAND "sesame/command"
-#define MQTT_TOPIC_STATUS "sesame/status"
+#define MQTT_TOPIC_COMMAND "sesame/command"  // Legacy command topic, routed by "target" (default: first lock)
+#define MQTT_TOPIC_STATUS "sesame/status"    // Legacy: the first lock's status, also on sesame/<id>/status
+#define MQTT_TOPIC_STATUS_REPLY "sesame/status/reply"  // Legacy: the first lock's status replies
 #define MQTT_TOPIC_BATTERY "sesame/battery"
+#define MQTT_TOPIC_METRICS "sesame/metrics"  // Command latency histograms
+#define METRICS_PUBLISH_INTERVAL_MS 60000    // Histogram window; nothing is published for idle windows
+
+// Encoding of every published event: PayloadFormat::json (default, keys by
+// name) or PayloadFormat::cbor (RFC 8949, keys are the numeric FieldIds from
+// include/event_writer.h). Commands are accepted in either format.
+#define MQTT_PAYLOAD_FORMAT PayloadFormat::json
+
+// Boot report: time from reset to each bring-up milestone, published once per boot
+#define MQTT_TOPIC_BOOT "sesame/metrics/boot"
+#define BOOT_REPORT_DELAY_MS 60000   // Published at the first confirmed command, or after this
+
+// LAN command API: HMAC-signed UDP datagrams straight to the sesame task,
+// bypassing the broker (see include/lan_api.h for the frame format)
+#define LAN_API_ENABLED true
+#define LAN_API_PORT 4210
+#define LAN_API_KEY ""                    // Shared secret; the API stays off until it is set
+#define LAN_API_MIN_KEY_LENGTH 16
+#define LAN_API_MAX_CLIENTS 4             // Sessions; the least recently seen is evicted
+#define LAN_API_CLIENT_TIMEOUT_MS 120000  // Sessions not heard from are dropped (send hello again)
+#define LAN_API_HELLO_TIMEOUT_MS 5000     // Challenge cookies older than this are refused
+
+// Diagnostics: per-section timing of the task loops and callbacks
+#define MQTT_TOPIC_DIAGNOSTICS "sesame/diagnostics"
+#define MQTT_TOPIC_MEMORY "sesame/metrics/memory"  // Heap and task stack headroom, same interval
+#define DIAGNOSTICS_INTERVAL_MS 60000
+#define DIAGNOSTICS_SECTIONS_PER_MESSAGE 3
+#define STALL_THRESHOLD_US 50000       // Sections running this long are logged and counted as stalls
+#define TASK_WATCHDOG_TIMEOUT_S 60     // Network/sesame task not looping for this long -> panic and reboot
+
+// NVS namespace of the state cache (last lock state, WiFi channel/BSSID)
+#define STATE_CACHE_NAMESPACE "sesame"
+
+// Runtime configuration: a JSON/CBOR object of settings on .../set changes
+// them (null restores the default) and is persisted in NVS; anything on
+// .../get asks for the current values, which are published on MQTT_TOPIC_CONFIG.
+// The settings are listed in include/config_store.h.
+#define MQTT_TOPIC_CONFIG "sesame/config"
+#define MQTT_TOPIC_CONFIG_SET "sesame/config/set"
+#define MQTT_TOPIC_CONFIG_GET "sesame/config/get"
+#define CONFIG_STORE_NAMESPACE "sesamecfg"
+
+// Per-lock MQTT topics: <prefix>/<lock id>/<suffix>
+#define MQTT_TOPIC_PREFIX "sesame"
+#define MQTT_LOCK_TOPIC_COMMAND "command"
+#define MQTT_LOCK_TOPIC_STATUS "status"
+#define MQTT_LOCK_TOPIC_STATUS_REPLY "status/reply"  // Replies to status commands carrying a request_id
+#define MQTT_LOCK_TOPIC_RESULT "result"  // Outcome of every lock/unlock/toggle command
+#define MQTT_LOCK_TOPIC_HISTORY "history"  // Batches of lock history entries
+
+// Status Request Configuration
+#define STATUS_REQUEST_TIMEOUT_MS 3000  // Reply "timeout" if the lock has not answered by then
 
 // Sesame Device Configuration
 #define SESAME_DEVICE_NAME "セサミ4"
 
-// Fixed Sesame Device Address (discovered and working)
-#define SESAME_DEVICE_ADDRESS "************************************************"
+// Fixed Sesame Device Address ("xx:xx:xx:xx:xx:xx", from tools/scan_sesame.cpp);
+// a lock left at 00:00:00:00:00:00 stays disabled
+#define SESAME_DEVICE_ADDRESS "00:00:00:00:00:00"
 
 // ⚠️ IMPORTANT: Get these keys from SESAME app QR code
 // You MUST register your device via SESAME app first and scan the QR code
 // to get both PUBLIC KEY and SECRET KEY
 
+// Both are checked at compile time: a wrong length or a non-hex character
+// fails the build (include/lock_config.h)
+
 // SESAME Secret Key (32 hex characters - 16 bytes)
-#define SESAME_SECRET "************************************************"
+#define SESAME_SECRET "00000000000000000000000000000000"
 
-// SESAME Public Key (128 hex characters - 64 bytes) 
-#define SESAME_PUBLIC_KEY "************************************************"
+// SESAME Public Key (128 hex characters - 64 bytes)
+#define SESAME_PUBLIC_KEY "00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
 
 // Sesame Device Model
 #define SESAME_MODEL_TYPE 4  // 4 = sesame_4
 
+// Locks driven by this controller: { id, name, address, secret, public key, model }
+// Each lock gets its own sesame/<id>/command and sesame/<id>/status topics.
+// The first entry is the default for the legacy command topic and RF remotes.
+#define SESAME_LOCKS { \
+    { "door", SESAME_DEVICE_NAME, SESAME_DEVICE_ADDRESS, SESAME_SECRET, SESAME_PUBLIC_KEY, SESAME_MODEL_TYPE }, \
+}
+
+// BLE session sharing between locks
+#define SESAME_MAX_SESSIONS 3              // Concurrent BLE sessions (NimBLE connection limit)
+#define SESAME_SESSION_SLICE_MS 60000      // Session time a lock keeps while others wait for the radio
+#define SESAME_PENDING_COMMAND_TIMEOUT_MS 30000  // Drop commands still waiting for a session after this
+
+// Session keepalive and reconnect
+#define SESAME_CONNECT_TIMEOUT_MS 10000     // BLE connection attempt timeout
+#define SESAME_CONNECT_TIMEOUT_MAX_MS 12000 // Highest conn_timeout sesame/config/set accepts (watchdog bound)
+#define SESAME_CONNECT_RETRIES 1            // Retries inside one attempt; backoff handles the rest
+#define SESAME_RETRY_MIN_MS 1000            // First retry after a failure or drop
+#define SESAME_RETRY_MAX_MS 60000           // Retry delay doubles up to this
+#define SESAME_RETRY_JITTER_PCT 25          // Random spread of each retry delay
+#define SESAME_KEEPALIVE_INTERVAL_MS 120000 // Poll status on quiet sessions to keep them warm
+
+// BLE session parameters; the connection parameters default to NimBLE's own
+// and are only sent to the lock once overridden over MQTT_TOPIC_CONFIG_SET
+#define BLE_MTU 517
+#define BLE_CONN_INTERVAL_MIN 24      // 1.25 ms units (30 ms)
+#define BLE_CONN_INTERVAL_MAX 40      // 50 ms
+#define BLE_CONN_LATENCY 0            // Connection events the lock may skip
+#define BLE_SUPERVISION_TIMEOUT 256   // 10 ms units (2.56 s)
+
+// Passive monitoring: track the locks' presence and signal from advertisements
+// and connect only when a command or a status request needs a session.
+// Off by default: a session dropped after SESAME_IDLE_DISCONNECT_MS has to be
+// opened again before the next command, which adds the connect and
+// authentication time (typically 1-3 s) to every unlock after a quiet spell.
+// Turn it on when radio time or the lock's battery matter more than that.
+#define SESAME_PASSIVE_MONITOR false
+#define SESAME_IDLE_DISCONNECT_MS 15000        // Passive monitoring: drop a session with nothing left to do after this
+#define SESAME_ADVERT_REFRESH_MS 10000         // Forward unchanged advertisements at most this often
+#define SESAME_SCAN_INTERVAL_MS 100
+#define SESAME_SCAN_WINDOW_MS 30               // Radio time per interval left to WiFi and sessions
+
+// Lock/unlock command queue
+#define COMMAND_DEDUP_WINDOW_MS 2000      // Repeats of a just-confirmed action within this are dropped
+#define COMMAND_CONFIRM_TIMEOUT_MS 10000  // Sent commands not confirmed by a status update time out
+
+// Lock history: fetched after each lock/unlock, stored in RAM + LittleFS, published in batches
+#define HISTORY_FILE_PATH "/history.log"
+#define HISTORY_FILE_TEMP_PATH "/history.tmp"
+#define HISTORY_FILE_MAX_BYTES 16384     // Compacted to the RAM ring beyond this
+#define HISTORY_FETCH_MAX 8              // Entries fetched per round, stops early at a known entry
+#define HISTORY_FETCH_TIMEOUT_MS 5000
+#define HISTORY_BATCH_SIZE 6             // Entries per MQTT message
+#define HISTORY_PUBLISH_DELAY_MS 2000    // Wait this long for a batch to fill up
+
 // Auto-test Configuration
-#define AUTO_TEST_ENABLED true
+#define AUTO_TEST_ENABLED true   // Unlock and relock each lock once, on its first session after boot
 #define AUTO_TEST_DELAY_MS 5000  // 5 seconds after authentication
+#define AUTO_TEST_RELOCK_S 10    // The test unlock is locked again by the relock timer
+
+// Auto-relock: run on the device, so relocking keeps working without the broker
+#define AUTO_RELOCK_S 0                 // Default for unlocks without "relock_s" (0 = off)
+#define AUTO_RELOCK_RETRY_MS 30000      // Next attempt after a relock that was not confirmed
+
+// Power management: WiFi modem sleep, automatic light sleep (RXB6 wakes the
+// CPU), adaptive BLE TX power and a slower scan while idle
+#define POWER_PROFILE PowerProfile::balanced  // performance, balanced or lowPower
+#define POWER_LATENCY_BUDGET_MS 300           // Worst-case delay the savings may add to a command
+#define POWER_ACTIVE_HOLD_MS 30000            // Full responsiveness this long after activity
+#define POWER_BLE_RSSI_TARGET -70             // TX power steps down while the furthest lock is heard above this
+#define POWER_RSSI_MAX_AGE_MS 60000           // Adverts older than this leave the TX power at maximum
 
 // Debug Configuration
-#define DEBUG_LEVEL 1
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 4              // 0 none, 1 errors, 2 warnings, 3 info, 4 per-event debug (see log.h)
+#endif
 #define SERIAL_BAUD 115200
 
 // RXB6 433MHz Receiver Configuration
 #define RXB6_DATA_PIN 32         // GPIO pin connected to RXB6 DATA output
-#define RXB6_SIGNAL_TIMEOUT 500  // Minimum time between RF signals (ms)
-#define RXB6_SIGNAL_MIN_WIDTH 50 // Minimum signal width to consider valid (ms)
+#define RXB6_SIGNAL_TIMEOUT 500  // Minimum time between presses of the same code (ms)
 #define RXB6_ENABLED true        // Enable/disable RXB6 functionality
 
+// RXB6 pulse decoder (EV1527/PT2262 fixed-code remotes)
+#define RXB6_EDGE_BUFFER_SIZE 512  // Edge timestamps buffered for the decoder (power of two)
+#define RXB6_PULSE_MIN_US 100      // Shorter pulses are treated as noise (us)
+#define RXB6_PULSE_TOLERANCE 35    // Allowed pulse length deviation (% of base pulse)
+#define RXB6_REPEAT_FRAMES 2       // Identical frames required before a code is accepted
+
+// Whitelisted remote codes: { code, bits, protocol, action (toggle/lock/unlock), lock id ("" = first lock) }
+// Empty by default, so no remote operates a lock until it is enrolled.
+// Unknown codes are logged and published on sesame/rxb6 with "accepted": false;
+// copy code, bits and protocol from there (see "433MHz RF Remote" in README.md), e.g.
+//   #define RXB6_REMOTE_CODES { { 0x3A9C51, 24, "EV1527/PT2262", CommandAction::toggle, "" } }
+#define RXB6_REMOTE_CODES { }
+
 // MQTT Topics for RXB6
 #define MQTT_TOPIC_RXB6 "sesame/rxb6"
 
+// Host simulation ([env:native], test/support/sim)
+#ifdef SESAME_SIM
+#include "sim_config.h"
+#endif
+
 #endif 
\ No newline at end of file
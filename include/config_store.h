@@ -0,0 +1,55 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "event_writer.h"
+
+// Tuning settings that can be changed at runtime over MQTT_TOPIC_CONFIG_SET.
+// Defaults are compiled in from config.h; NVS holds only the values that
+// differ from them, so a reflash with new defaults still takes effect for
+// everything not overridden. Settings are read from any task; only the
+// network task changes them.
+enum class ConfigKey : uint8_t {
+    rxb6SignalTimeoutMs,
+    connectTimeoutMs,       // next connection attempt
+    keepaliveMs,
+    idleDisconnectMs,
+    bleMtu,                 // next connection
+    connIntervalMin,        // 1.25 ms units; connection parameters apply to open sessions too
+    connIntervalMax,
+    connLatency,            // connection events the lock may skip
+    supervisionTimeout,     // 10 ms units
+    latencyBudgetMs,        // POWER_LATENCY_BUDGET_MS
+    activeHoldMs,           // POWER_ACTIVE_HOLD_MS
+    count
+};
+
+enum class ConfigSetResult : uint8_t {
+    ok,
+    malformed,
+    unknownKey,
+    invalidValue,
+    storageFailed
+};
+
+// Load the NVS overlay (from setup(), before the tasks start)
+void beginConfigStore();
+
+uint32_t configValue(ConfigKey key);
+
+// True when the value comes from NVS rather than the compiled-in default
+bool configOverridden(ConfigKey key);
+
+// Apply a payload such as {"keepalive_ms": 60000, "ble_mtu": null} (JSON, or
+// a CBOR map keyed by FieldId). null restores the default. All fields are
+// checked before any is applied; on failure rejected names the offending
+// setting (FieldId::last if the key is unknown).
+ConfigSetResult applyConfigPayload(const uint8_t* payload, size_t length, FieldId& rejected);
+
+// Add every setting to an event
+void writeConfig(EventWriter& event);
+
+const char* configSetResultName(ConfigSetResult result);
+
+#endif
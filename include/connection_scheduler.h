@@ -0,0 +1,45 @@
+#ifndef CONNECTION_SCHEDULER_H
+#define CONNECTION_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What the scheduler needs to know about one lock
+struct LockSchedule {
+    bool connected;            // session up or being set up
+    bool disabled;             // never connect (e.g. unusable keys)
+    bool pendingWork;          // a command is waiting for this lock
+    bool onDemand;             // connect only while pendingWork is set
+    uint32_t retryAtMs;        // earliest time a new connection attempt may start
+    uint32_t sessionStartedMs; // when the current session was established
+    uint32_t lastUsedMs;       // last command sent over the current session
+};
+
+// Shares the BLE radio between locks. At most maxSessions sessions are
+// open at once; locks waiting with commands are connected first, then the
+// rest in round-robin order. When every session slot is taken, an idle
+// session is released for a lock with work, and sessions older than the
+// time slice are rotated out so no lock is starved. On-demand locks are
+// left alone until they have work.
+class ConnectionScheduler {
+public:
+    ConnectionScheduler(size_t maxSessions, uint32_t sliceMs);
+
+    // Lock that should start connecting now, or -1
+    int nextToConnect(const LockSchedule* locks, size_t count, uint32_t nowMs);
+
+    // Connected lock that should give up its session, or -1
+    int sessionToRelease(const LockSchedule* locks, size_t count, uint32_t nowMs) const;
+
+    // Milliseconds until the scheduler may want to act again, or UINT32_MAX
+    uint32_t msUntilNextDecision(const LockSchedule* locks, size_t count, uint32_t nowMs) const;
+
+private:
+    bool waiting(const LockSchedule& lock, uint32_t nowMs) const;
+
+    size_t maxSessions;
+    uint32_t sliceMs;
+    size_t cursor;
+};
+
+#endif
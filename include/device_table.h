@@ -0,0 +1,80 @@
+#ifndef DEVICE_TABLE_H
+#define DEVICE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEVICE_TABLE_CAPACITY 512   // slots, power of two (~40 KB)
+#define DEVICE_TABLE_MAX_DEVICES (DEVICE_TABLE_CAPACITY * 3 / 4)
+#define DEVICE_NAME_MAX 20
+#define DEVICE_MANUFACTURER_MAX 24
+#define DEVICE_RSSI_SHIFT 4         // rssiAvg is dBm in this many fraction bits
+
+// One device heard by the scanner
+struct DeviceEntry {
+    bool used;
+    uint64_t address;
+    uint8_t addressType;
+    int8_t lastRssi;
+    int16_t rssiAvg;          // dBm << DEVICE_RSSI_SHIFT
+    uint32_t count;
+    uint32_t firstSeenMs;
+    uint32_t lastSeenMs;
+    uint32_t reportedMs;
+    bool sesame;
+    uint8_t model;
+    char name[DEVICE_NAME_MAX + 1];
+    uint8_t manufacturerLength;
+    uint8_t manufacturer[DEVICE_MANUFACTURER_MAX];
+};
+
+// Open-addressed device table keyed by the 48-bit address, with linear
+// probing and backward-shift deletion, so aging needs no tombstones. Filled
+// to at most three quarters so probe runs stay short.
+class DeviceTable {
+public:
+    DeviceTable();
+
+    DeviceEntry* find(uint64_t address);
+
+    // Existing entry or a fresh one; nullptr when the table is full
+    DeviceEntry* insert(uint64_t address, bool& created);
+
+    void remove(size_t slot);
+
+    // Drop every device not heard for maxAgeMs, calling lost(entry) on
+    // each before it goes; returns the count
+    template <typename Lost>
+    size_t age(uint32_t nowMs, uint32_t maxAgeMs, Lost lost) {
+        size_t removed = 0;
+        for (size_t slot = 0; slot < DEVICE_TABLE_CAPACITY;) {
+            DeviceEntry& entry = entries[slot];
+            if (entry.used && nowMs - entry.lastSeenMs >= maxAgeMs) {
+                lost(entry);
+                remove(slot);
+                removed++;
+                // The backward shift may have moved another entry into this slot
+                continue;
+            }
+            slot++;
+        }
+        return removed;
+    }
+
+    DeviceEntry& at(size_t slot) { return entries[slot]; }
+    size_t size() const { return used; }
+
+private:
+    static size_t slotFor(uint64_t address);
+
+    DeviceEntry entries[DEVICE_TABLE_CAPACITY];
+    size_t used;
+};
+
+// Fold one raw advertisement payload into a device: RSSI moving average
+// (avg += (sample - avg) / 4), local name, manufacturer data and whether it
+// looks like a Sesame (service UUID 0xFD81 or CANDY HOUSE manufacturer data)
+void updateDevice(DeviceEntry& entry, const uint8_t* payload, size_t length, uint8_t addressType,
+                  int8_t rssi, uint32_t nowMs);
+
+#endif
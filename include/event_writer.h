@@ -0,0 +1,187 @@
+#ifndef EVENT_WRITER_H
+#define EVENT_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Outbound MQTT payload encoding. JSON is the default; CBOR (RFC 8949)
+// carries the same events with each key replaced by its numeric FieldId,
+// so a status message shrinks to roughly a third.
+enum class PayloadFormat : uint8_t {
+    json,
+    cbor
+};
+
+// Static field ids: the CBOR key of each field. Ids are part of the wire
+// format - append new ones, never renumber.
+enum class FieldId : uint8_t {
+    lock = 1,
+    device,
+    address,
+    wifiConnected,
+    mqttConnected,
+    sesameConnected,
+    sesameAuthenticated,
+    batteryPct,
+    voltage,
+    position,
+    locked,          // 11
+    unlocked,
+    rssi,
+    advertAgeMs,
+    requestId,
+    result,
+    elapsedMs,
+    action,
+    source,
+    trigger,
+    reason,          // 21
+    timestamp,
+    windowMs,
+    count,
+    p50Us,
+    p95Us,
+    p99Us,
+    maxUs,
+    queue,
+    ble,
+    total,           // 31
+    reconnect,
+    entries,
+    time,
+    type,
+    tag,
+    signal,
+    code,
+    bits,
+    protocol,
+    accepted,        // 41
+    target,
+    pin,
+    ageMs,
+    live,
+    replayed,
+    buffered,
+    spilled,
+    dropped,
+    backlog,
+    ramHighWater,    // 51
+    spillHighWater,
+    queueHighWater,
+    resetReason,
+    bleMs,           // 55
+    wifiMs,
+    mqttMs,
+    stateMs,
+    sessionMs,
+    firstCommandMs,  // 60
+    stateRestored,
+    delayS,
+    relockS,
+    relockInMs,
+    sections,        // 65
+    section,
+    meanUs,
+    stalls,
+    worstSection,
+    worstUs,         // 70
+    feedGapTask,
+    maxFeedGapMs,
+    freeHeap,
+    minFreeHeap,
+    largestFreeBlock,  // 75
+    fragmentationPct,
+    stacks,
+    task,
+    stackFree,
+    predicted,       // 80
+    stateMismatch,
+    mismatches,
+    rxb6SignalTimeoutMs,
+    connectTimeoutMs,
+    keepaliveMs,       // 85
+    idleDisconnectMs,
+    bleMtu,
+    connIntervalMin,
+    connIntervalMax,
+    connLatency,       // 90
+    supervisionTimeout,
+    latencyBudgetMs,
+    activeHoldMs,
+    bleEventDrops,
+    skipped,           // 95
+    last
+};
+
+// JSON key of a field ("lock", "battery_pct", ...)
+const char* fieldName(FieldId id);
+
+#define EVENT_WRITER_MAX_DEPTH 4
+
+// Writes one event object into a caller-supplied buffer in either format.
+// The root object is opened by the constructor and closed by finish();
+// nested objects and arrays are opened and closed explicitly. Running out
+// of room marks the writer as overflowed instead of truncating silently.
+class EventWriter {
+public:
+    EventWriter(PayloadFormat format, uint8_t* buffer, size_t size);
+
+    void add(FieldId id, const char* value);
+    void add(FieldId id, bool value);
+    void add(FieldId id, double value);
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    void add(FieldId id, T value) {
+        key(id);
+        if (std::is_signed<T>::value) {
+            writeSigned(static_cast<int64_t>(value));
+        } else {
+            writeUnsigned(static_cast<uint64_t>(value));
+        }
+    }
+
+    void beginObject(FieldId id);
+    void beginArray(FieldId id);
+    void beginArrayObject();   // object element of the current array
+    void endObject();
+    void endArray();
+
+    // Close the root object; false if anything did not fit
+    bool finish();
+
+    PayloadFormat format() const { return encoding; }
+    const uint8_t* data() const { return buffer; }
+    size_t length() const { return used; }
+    bool overflowed() const { return overflow; }
+
+private:
+    void key(FieldId id);
+    void separator();
+    void open(uint8_t jsonBracket, uint8_t cborHeader);
+    void close(uint8_t jsonBracket);
+    void writeSigned(int64_t value);
+    void writeUnsigned(uint64_t value);
+    void writeCborHead(uint8_t major, uint64_t value);
+    void writeJsonString(const char* value);
+    void put(uint8_t byte);
+    void put(const void* data, size_t length);
+
+    PayloadFormat encoding;
+    uint8_t* buffer;
+    size_t size;
+    size_t used;
+    bool overflow;
+    size_t depth;
+    bool firstInLevel[EVENT_WRITER_MAX_DEPTH + 1];
+};
+
+// Format of an encoded payload, told apart by its first byte
+PayloadFormat detectPayloadFormat(const uint8_t* payload, size_t length);
+
+// Add an "age_ms" field to the end of an encoded root object in place, for
+// replayed messages; returns the new length (unchanged if it does not fit
+// or the payload is not an object)
+size_t appendAgeMs(uint8_t* payload, size_t length, size_t size, uint32_t ageMs);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef HISTORY_FILE_H
+#define HISTORY_FILE_H
+
+#include <stddef.h>
+#include "history_log.h"
+
+// Append-only LittleFS copy of the history log. Entries are written as
+// fixed-size records; when the file reaches maxBytes it is rewritten with
+// just the entries still in the RAM ring.
+class HistoryFile {
+public:
+    HistoryFile(const char* path, const char* tempPath, size_t maxBytes);
+
+    // Mount the filesystem and load the newest stored entries into log
+    bool begin(HistoryLog& log);
+
+    // Persist an entry that was just added to log
+    bool append(const HistoryEntry& entry, const HistoryLog& log);
+
+private:
+    bool compact(const HistoryLog& log);
+
+    const char* path;
+    const char* tempPath;
+    size_t maxBytes;
+    bool mounted;
+    size_t fileSize;
+};
+
+#endif
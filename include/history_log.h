@@ -0,0 +1,52 @@
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HISTORY_LOG_SLOTS 64
+#define HISTORY_TAG_SIZE 22
+
+// One lock history record, fixed size so it can be written to flash as is
+struct HistoryEntry {
+    uint32_t time;        // seconds since epoch, as reported by the lock
+    uint8_t lock;         // index into lockConfigs
+    uint8_t type;         // Sesame::history_type_t
+    uint8_t published;    // already sent over MQTT
+    uint8_t reserved;
+    char tag[HISTORY_TAG_SIZE];
+};
+
+// Ring of the most recent history entries across all locks. Entries are
+// de-duplicated on (lock, time, type), so fetching the same record twice is
+// harmless, and kept oldest first so batches go out in order.
+class HistoryLog {
+public:
+    HistoryLog();
+
+    // Store an entry; false if it is already in the log
+    bool add(const HistoryEntry& entry);
+
+    bool contains(uint8_t lock, uint32_t time, uint8_t type) const;
+
+    // Newest timestamp stored for a lock, 0 if none
+    uint32_t newestTime(uint8_t lock) const;
+
+    // Copy up to max unpublished entries of a single lock (the lock of the
+    // oldest unpublished entry), oldest first, and mark them published
+    size_t takeUnpublished(HistoryEntry* out, size_t max);
+
+    // Entry i in age order (0 = oldest)
+    const HistoryEntry& at(size_t i) const;
+
+    size_t size() const { return count; }
+    size_t unpublished() const { return unpublishedCount; }
+
+private:
+    HistoryEntry entries[HISTORY_LOG_SLOTS];
+    size_t start;   // oldest entry
+    size_t count;
+    size_t unpublishedCount;
+};
+
+#endif
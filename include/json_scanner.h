@@ -0,0 +1,59 @@
+#ifndef JSON_SCANNER_H
+#define JSON_SCANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// In-place scanner for flat JSON objects such as MQTT command payloads.
+// Keys and values are reported as pointers into the caller's buffer, so
+// walking a payload never allocates. Nested objects/arrays are skipped
+// as opaque values.
+
+enum class JsonValueType : uint8_t {
+    string,
+    number,
+    boolean,
+    null,
+    object,
+    array
+};
+
+struct JsonField {
+    const char* key;        // key text without quotes (still escaped)
+    size_t keyLength;
+    const char* value;      // string contents without quotes, or the raw token
+    size_t valueLength;
+    JsonValueType type;
+
+    bool keyEquals(const char* name) const;
+    bool valueEquals(const char* text) const;
+
+    // Unescape a string value into out; false if not a string, invalid or truncated
+    bool copyString(char* out, size_t size) const;
+    bool toLong(long& out) const;
+    bool toBool(bool& out) const;
+};
+
+class JsonObjectScanner {
+public:
+    JsonObjectScanner(const char* data, size_t length);
+
+    // Advance to the next field; false at the closing brace or on malformed input
+    bool next(JsonField& field);
+
+    // True once the scanner has rejected the input
+    bool failed() const { return error; }
+
+private:
+    bool skipWhitespace();
+    bool scanString(const char*& start, size_t& length);
+    bool scanValue(JsonField& field);
+
+    const char* pos;
+    const char* end;
+    bool started;
+    bool finished;
+    bool error;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef LAN_API_H
+#define LAN_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "event_writer.h"
+#include "lan_frame.h"
+
+// Direct UDP command API on the local network, so lock/unlock does not
+// depend on the broker. Datagrams are laid out and signed as in
+// lan_frame.h, keyed with LAN_API_KEY.
+//
+// Opening a session takes two round trips, so a recorded hello cannot be
+// replayed to reset or evict sessions:
+//   1. hello     body: client nonce (8 random bytes)
+//   2. challenge body: client nonce, cookie (20) - issued ms (4) and a MAC
+//                over it, the client's IP and port, the client nonce and a
+//                per-boot secret; the firmware keeps no state for it
+//   3. hello     body: client nonce, cookie, sent from the same IP and port
+//                within LAN_API_HELLO_TIMEOUT_MS; each client nonce is
+//                accepted once
+//   4. welcome   body: client nonce; the header carries a fresh session
+//                nonce (new on every hello and every boot)
+// Commands carry the same body as on MQTT (JSON or CBOR) and are only
+// accepted from the IP and port the session was opened from. Each one gets
+// an ack, and every subscribed session receives the status/result/reply
+// events the firmware publishes, in MQTT_PAYLOAD_FORMAT, signed the same
+// way. Sessions end after LAN_API_CLIENT_TIMEOUT_MS without a datagram;
+// clients open a new one to stay subscribed. If the MAC cannot be computed
+// the datagram is dropped, never accepted.
+
+// Start listening (no-op when LAN_API_ENABLED is false or no key is set)
+void startLanApi();
+
+// Send an event to every subscribed session; safe to call from any task
+void lanPublish(LanFrameType type, const EventWriter& event);
+
+#endif
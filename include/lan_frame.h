@@ -0,0 +1,68 @@
+#ifndef LAN_FRAME_H
+#define LAN_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Datagram layout of the LAN command API (integers little endian):
+//
+//   0       magic 0x53 ('S')
+//   1       type, see LanFrameType
+//   2-9     session nonce: 0 in hello/challenge, else the one from the welcome
+//   10-13   sequence number; commands must strictly increase it per session
+//   14..    body
+//   last 32 HMAC-SHA256 over all preceding bytes, keyed with the shared key
+//
+// Encoding and signing only; the session rules are in lan_api.h. Shared by
+// the firmware and host-side clients, so both sign the same bytes.
+
+enum class LanFrameType : uint8_t {
+    hello = 0x01,
+    command = 0x02,
+    welcome = 0x81,
+    ack = 0x82,
+    status = 0x83,
+    result = 0x84,
+    statusReply = 0x85,
+    challenge = 0x86
+};
+
+#define LAN_FRAME_MAGIC 0x53
+#define LAN_FRAME_HEADER_SIZE 14
+#define LAN_FRAME_MAC_SIZE 32
+#define LAN_CLIENT_NONCE_SIZE 8
+#define LAN_COOKIE_SIZE 20
+
+// Header fields and body of a received datagram; body points into it
+struct LanFrame {
+    LanFrameType type;
+    uint64_t nonce;
+    uint32_t seq;
+    const uint8_t* body;
+    size_t bodyLength;
+};
+
+void lanPutLe(uint8_t* out, uint64_t value, size_t bytes);
+uint64_t lanGetLe(const uint8_t* in, size_t bytes);
+
+// HMAC-SHA256 of data keyed with key; false if mbedtls failed, in which
+// case the datagram must be dropped
+bool lanMac(const char* key, const uint8_t* data, size_t length, uint8_t* mac);
+
+// Constant time, so the comparison does not leak how much of a forged MAC matched
+bool lanMacMatches(const uint8_t* a, const uint8_t* b, size_t length);
+
+// Header + body + MAC into out, which holds at least
+// LAN_FRAME_HEADER_SIZE + bodyLength + LAN_FRAME_MAC_SIZE bytes; returns
+// the frame length, 0 if it cannot be signed
+size_t lanBuildFrame(const char* key, uint8_t* out, LanFrameType type, uint64_t nonce, uint32_t seq,
+                     const uint8_t* body, size_t bodyLength);
+
+// Splits a datagram of at least header + MAC bytes with the right magic;
+// does not check the MAC
+bool lanParseFrame(const uint8_t* data, size_t length, LanFrame& frame);
+
+// The trailing MAC matches the rest of the datagram
+bool lanFrameAuthentic(const char* key, const uint8_t* data, size_t length);
+
+#endif
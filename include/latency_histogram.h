@@ -0,0 +1,36 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bucket upper bounds in microseconds, roughly 1-2-5 per decade from
+// 100us to 20s; the last bucket catches everything slower
+#define LATENCY_BUCKET_COUNT 19
+
+// Fixed-bucket latency histogram. Recording is a short scan over constant
+// bounds with no allocation; percentiles are reported as the upper bound of
+// the bucket they fall in, so they are conservative by at most one bucket.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint32_t latencyUs);
+    void reset();
+
+    // Upper bound (us) of the bucket holding the given percentile (0-100);
+    // 0 when empty, the recorded maximum for the overflow bucket
+    uint32_t percentileUs(uint8_t percentile) const;
+
+    uint32_t count() const { return samples; }
+    uint32_t maxUs() const { return maximum; }
+
+    static uint32_t bucketBoundUs(size_t bucket);
+
+private:
+    uint32_t buckets[LATENCY_BUCKET_COUNT];
+    uint32_t samples;
+    uint32_t maximum;
+};
+
+#endif
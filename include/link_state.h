@@ -0,0 +1,48 @@
+#ifndef LINK_STATE_H
+#define LINK_STATE_H
+
+#include <stdint.h>
+#include "backoff.h"
+
+enum class LinkPhase : uint8_t {
+    down,        // waiting for the next attempt
+    connecting,  // attempt in progress
+    up
+};
+
+// Connection state for one network link (WiFi, MQTT). It never blocks:
+// the owner polls it, starts an attempt when one is due and reports the
+// outcome. Failed attempts and lost links back off exponentially.
+class LinkState {
+public:
+    LinkState(uint32_t attemptTimeoutMs, uint32_t retryMinMs, uint32_t retryMaxMs, uint8_t jitterPct);
+
+    // True when down and the retry delay has passed
+    bool attemptDue(uint32_t nowMs) const;
+    bool attemptTimedOut(uint32_t nowMs) const;
+
+    void attemptStarted(uint32_t nowMs);
+    void attemptFailed(uint32_t nowMs, uint32_t random);
+    void connected(uint32_t nowMs);
+    void lost(uint32_t nowMs, uint32_t random);
+
+    // Back to down with the next attempt due immediately
+    void reset(uint32_t nowMs);
+
+    // Milliseconds until an attempt is due or times out, or UINT32_MAX when up
+    uint32_t msUntilNextAction(uint32_t nowMs) const;
+
+    LinkPhase phase() const { return currentPhase; }
+    uint8_t failures() const { return backoff.attempts(); }
+    uint32_t lastRetryDelayMs() const { return retryDelayMs; }
+
+private:
+    uint32_t attemptTimeoutMs;
+    Backoff backoff;
+    LinkPhase currentPhase;
+    uint32_t phaseStartedMs;
+    uint32_t retryAtMs;
+    uint32_t retryDelayMs;
+};
+
+#endif
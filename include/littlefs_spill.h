@@ -0,0 +1,42 @@
+#ifndef LITTLEFS_SPILL_H
+#define LITTLEFS_SPILL_H
+
+#include "outbound_buffer.h"
+
+// Spill log as a LittleFS file: a small header holding the read position,
+// then [length][record] entries appended at the end. The read position is
+// written back to the header on every pop, so records replayed before a
+// reboot are not sent again after it. Delivered records are compacted away
+// (via tempPath) when they would push the file past maxBytes, so the cap
+// applies to undelivered records only. The file is deleted once drained.
+class LittleFsSpill : public OutboundSpill {
+public:
+    LittleFsSpill(const char* path, const char* tempPath, size_t maxBytes);
+
+    // Mount the filesystem and index the undelivered records left by the previous boot
+    bool begin();
+
+    bool append(const uint8_t* data, size_t length) override;
+    bool readFront(uint8_t* data, size_t capacity, size_t& length) override;
+    void popFront() override;
+
+    size_t records() const override { return recordCount; }
+    size_t bytes() const override { return fileSize - readOffset; }
+
+private:
+    bool create();
+    bool compact();
+    void persistReadOffset();
+    void clear();
+
+    const char* path;
+    const char* tempPath;
+    size_t maxBytes;
+    bool mounted;
+    size_t fileSize;      // header and records, 0 when there is no file
+    size_t readOffset;    // file offset of the oldest undelivered record
+    size_t frontLength;   // length of the record at readOffset, once read
+    size_t recordCount;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef LOCK_CONFIG_H
+#define LOCK_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <cstddef>
+#include "command.h"
+#include "config.h"
+
+// Static description of one lock, from SESAME_LOCKS in config.h
+struct LockConfig {
+    const char* id;          // short id used in topics and "target" fields
+    const char* name;
+    const char* address;     // BLE address "xx:xx:xx:xx:xx:xx"
+    const char* secret;      // 32 hex characters
+    const char* publicKey;   // 128 hex characters
+    uint8_t model;           // Sesame::model_t value
+};
+
+inline constexpr LockConfig lockConfigs[] = SESAME_LOCKS;
+inline constexpr size_t lockCount = sizeof(lockConfigs) / sizeof(lockConfigs[0]);
+
+static_assert(lockCount > 0, "SESAME_LOCKS must list at least one lock");
+static_assert(lockCount <= 255, "SESAME_LOCKS supports at most 255 locks");
+
+#define LOCK_SECRET_SIZE 16       // Sesame::SECRET_SIZE
+#define LOCK_PUBLIC_KEY_SIZE 64   // Sesame::PK_SIZE
+#define LOCK_TOPIC_SIZE 48
+
+// Compile-time parsing of SESAME_LOCKS: keys and addresses are checked and
+// converted to binary by the compiler, so a typo fails the build instead of
+// disabling the lock at runtime, and connecting never parses text.
+namespace lock_config_detail {
+
+constexpr size_t length(const char* text) {
+    size_t n = 0;
+    while (text[n] != '\0') n++;
+    return n;
+}
+
+constexpr bool equal(const char* a, const char* b) {
+    size_t i = 0;
+    while (a[i] != '\0' && a[i] == b[i]) i++;
+    return a[i] == b[i];
+}
+
+constexpr int hexDigit(char c) {
+    return c >= '0' && c <= '9' ? c - '0'
+         : c >= 'a' && c <= 'f' ? c - 'a' + 10
+         : c >= 'A' && c <= 'F' ? c - 'A' + 10
+         : -1;
+}
+
+}  // namespace lock_config_detail
+
+// Exactly 2 * size hex digits, either case
+constexpr bool isHexKey(const char* hex, size_t size) {
+    if (lock_config_detail::length(hex) != size * 2) return false;
+    for (size_t i = 0; i < size * 2; i++) {
+        if (lock_config_detail::hexDigit(hex[i]) < 0) return false;
+    }
+    return true;
+}
+
+template <size_t N>
+constexpr std::array<std::byte, N> parseHexKey(const char* hex) {
+    std::array<std::byte, N> out{};
+    for (size_t i = 0; i < N; i++) {
+        out[i] = static_cast<std::byte>(lock_config_detail::hexDigit(hex[i * 2]) * 16 +
+                                        lock_config_detail::hexDigit(hex[i * 2 + 1]));
+    }
+    return out;
+}
+
+// "xx:xx:xx:xx:xx:xx"
+constexpr bool isMacAddress(const char* text) {
+    if (lock_config_detail::length(text) != 17) return false;
+    for (size_t i = 0; i < 17; i++) {
+        bool separator = i % 3 == 2;
+        if (separator ? text[i] != ':' : lock_config_detail::hexDigit(text[i]) < 0) return false;
+    }
+    return true;
+}
+
+// First octet in the most significant byte, as NimBLEAddress(uint64_t) expects
+constexpr uint64_t parseMacAddress(const char* text) {
+    uint64_t address = 0;
+    for (size_t i = 0; i < 17; i += 3) {
+        address = (address << 8) | static_cast<uint64_t>(lock_config_detail::hexDigit(text[i]) * 16 +
+                                                          lock_config_detail::hexDigit(text[i + 1]));
+    }
+    return address;
+}
+
+// Binary form of one lock's credentials
+struct LockSecrets {
+    uint64_t address;
+    std::array<std::byte, LOCK_SECRET_SIZE> secret;
+    std::array<std::byte, LOCK_PUBLIC_KEY_SIZE> publicKey;
+};
+
+// Per-lock topics, "<prefix>/<lock id>/<suffix>"
+struct LockTopics {
+    char command[LOCK_TOPIC_SIZE];
+    char status[LOCK_TOPIC_SIZE];
+    char statusReply[LOCK_TOPIC_SIZE];
+    char result[LOCK_TOPIC_SIZE];
+    char history[LOCK_TOPIC_SIZE];
+};
+
+namespace lock_config_detail {
+
+constexpr bool keysValid() {
+    for (const LockConfig& lock : lockConfigs) {
+        if (!isHexKey(lock.secret, LOCK_SECRET_SIZE) || !isHexKey(lock.publicKey, LOCK_PUBLIC_KEY_SIZE)) return false;
+    }
+    return true;
+}
+
+constexpr bool addressesValid() {
+    for (const LockConfig& lock : lockConfigs) {
+        if (!isMacAddress(lock.address)) return false;
+    }
+    return true;
+}
+
+// Ids are matched in topics and "target" fields (COMMAND_TARGET_SIZE)
+constexpr bool idsValid() {
+    for (size_t i = 0; i < lockCount; i++) {
+        size_t n = length(lockConfigs[i].id);
+        if (n == 0 || n >= COMMAND_TARGET_SIZE) return false;
+        for (size_t c = 0; c < n; c++) {
+            char ch = lockConfigs[i].id[c];
+            if (ch == '/' || ch == '+' || ch == '#') return false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (equal(lockConfigs[i].id, lockConfigs[j].id)) return false;
+        }
+    }
+    return true;
+}
+
+constexpr const char* lockTopicSuffixes[] = {
+    MQTT_LOCK_TOPIC_COMMAND, MQTT_LOCK_TOPIC_STATUS, MQTT_LOCK_TOPIC_STATUS_REPLY,
+    MQTT_LOCK_TOPIC_RESULT, MQTT_LOCK_TOPIC_HISTORY,
+};
+
+constexpr bool topicsFit() {
+    for (const LockConfig& lock : lockConfigs) {
+        for (const char* suffix : lockTopicSuffixes) {
+            if (length(MQTT_TOPIC_PREFIX) + length(lock.id) + length(suffix) + 3 > LOCK_TOPIC_SIZE) return false;
+        }
+    }
+    return true;
+}
+
+constexpr void composeTopic(char* out, const char* id, const char* suffix) {
+    size_t n = 0;
+    for (const char* part : {MQTT_TOPIC_PREFIX, "/", id, "/", suffix}) {
+        for (size_t i = 0; part[i] != '\0'; i++) out[n++] = part[i];
+    }
+    out[n] = '\0';
+}
+
+constexpr std::array<LockSecrets, lockCount> makeSecrets() {
+    std::array<LockSecrets, lockCount> all{};
+    // Invalid entries are left zero; the static_asserts below report them
+    if (!keysValid() || !addressesValid()) return all;
+    for (size_t i = 0; i < lockCount; i++) {
+        all[i].address = parseMacAddress(lockConfigs[i].address);
+        all[i].secret = parseHexKey<LOCK_SECRET_SIZE>(lockConfigs[i].secret);
+        all[i].publicKey = parseHexKey<LOCK_PUBLIC_KEY_SIZE>(lockConfigs[i].publicKey);
+    }
+    return all;
+}
+
+constexpr std::array<LockTopics, lockCount> makeTopics() {
+    std::array<LockTopics, lockCount> all{};
+    if (!topicsFit()) return all;
+    for (size_t i = 0; i < lockCount; i++) {
+        composeTopic(all[i].command, lockConfigs[i].id, MQTT_LOCK_TOPIC_COMMAND);
+        composeTopic(all[i].status, lockConfigs[i].id, MQTT_LOCK_TOPIC_STATUS);
+        composeTopic(all[i].statusReply, lockConfigs[i].id, MQTT_LOCK_TOPIC_STATUS_REPLY);
+        composeTopic(all[i].result, lockConfigs[i].id, MQTT_LOCK_TOPIC_RESULT);
+        composeTopic(all[i].history, lockConfigs[i].id, MQTT_LOCK_TOPIC_HISTORY);
+    }
+    return all;
+}
+
+}  // namespace lock_config_detail
+
+static_assert(lock_config_detail::keysValid(),
+              "SESAME_LOCKS: secret must be 32 and public key 128 hex characters (from the SESAME app QR code)");
+static_assert(lock_config_detail::addressesValid(), "SESAME_LOCKS: address must look like \"xx:xx:xx:xx:xx:xx\"");
+static_assert(lock_config_detail::idsValid(),
+              "SESAME_LOCKS: ids must be unique, 1-15 characters, without '/', '+' or '#'");
+static_assert(lock_config_detail::topicsFit(), "SESAME_LOCKS: lock id too long for LOCK_TOPIC_SIZE");
+
+// Indexed like lockConfigs
+inline constexpr std::array<LockSecrets, lockCount> lockSecrets = lock_config_detail::makeSecrets();
+inline constexpr std::array<LockTopics, lockCount> lockTopics = lock_config_detail::makeTopics();
+
+// Index of the lock with this id; an empty id selects the first lock; -1 if unknown
+int findLockIndex(const char* id);
+int findLockIndex(const char* id, size_t length);
+
+// Index of the lock whose command topic this is, else -1
+int matchLockCommandTopic(const char* topic);
+
+#endif
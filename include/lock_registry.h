@@ -0,0 +1,68 @@
+#ifndef LOCK_REGISTRY_H
+#define LOCK_REGISTRY_H
+
+#include <SesameClient.h>
+#include "app.h"
+#include "backoff.h"
+#include "command_queue.h"
+#include "lock_config.h"
+#include "lock_state_model.h"
+#include "status_requests.h"
+
+// Runtime state of one lock, owned by the sesame task
+struct SesameLock {
+    const LockConfig* config;
+    libsesame3bt::SesameClient client;
+    libsesame3bt::SesameClient::state_t state;
+
+    bool connected;
+    bool authenticated;
+    bool disabled;           // keys or address failed to parse; never connected
+    bool releasing;          // session dropped on purpose to free the radio
+    bool reconnecting;       // session dropped unexpectedly, measuring time to active
+    bool autoTestCompleted;  // once per boot: reconnects never unlock the door again
+    unsigned long lastAutoTest;
+    unsigned long retryAtMs;  // earliest next connection attempt
+    unsigned long sessionStartedMs;
+    unsigned long lastUsedMs;
+    unsigned long lastTrafficMs;  // last command, status or keepalive on this session
+    unsigned long droppedAtMs;
+
+    // Incremental history fetch: one request_history() at a time, repeated
+    // while the lock keeps returning entries we have not stored yet
+    bool historyInFlight;
+    uint8_t historyFetchBudget;
+    unsigned long historyRequestedMs;
+    Backoff backoff{SESAME_RETRY_MIN_MS, SESAME_RETRY_MAX_MS, SESAME_RETRY_JITTER_PCT};
+
+    LockStatus status;
+    LockStateModel model;           // predicted state, for toggles
+    bool statusRestored;            // status comes from the state cache, not yet confirmed
+    StatusRequestTracker statusRequests;
+
+    // Passive monitoring: last advertisement heard from the lock
+    bool advertSeen;
+    bool advertRegistered;
+    int8_t advertRssi;
+    unsigned long advertSeenMs;
+
+    // Lock/unlock commands waiting for a session or for confirmation
+    CommandQueue commands{COMMAND_DEDUP_WINDOW_MS, COMMAND_CONFIRM_TIMEOUT_MS,
+                          SESAME_PENDING_COMMAND_TIMEOUT_MS};
+
+    const LockTopics* topics;   // built by the compiler, see lock_config.h
+};
+
+extern SesameLock sesameLocks[lockCount];
+
+// Fill in config and topic pointers for every lock
+void initLockRegistry();
+
+// Lock owning this client (BLE callbacks only get the client), or nullptr
+SesameLock* lockForClient(const libsesame3bt::SesameClient& client);
+
+inline size_t lockIndex(const SesameLock& lock) {
+    return static_cast<size_t>(&lock - sesameLocks);
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef LOCK_STATE_MODEL_H
+#define LOCK_STATE_MODEL_H
+
+#include <stdint.h>
+#include "command.h"
+#include "command_queue.h"
+
+enum class LockState : uint8_t {
+    unknown,
+    locked,
+    unlocked
+};
+
+// Predicted state of one lock, so a toggle can be resolved the moment it
+// arrives instead of after a status round trip. The prediction is, in order:
+//   1. the target of the newest lock/unlock still being carried out
+//   2. the last settled state the lock reported
+//   3. while the thumbturn is between positions, the end it is moving
+//      towards, from position() and the end positions seen so far
+// Every command leaves the model through finished(), which also catches
+// locks that did not do what they were told.
+class LockStateModel {
+public:
+    LockStateModel();
+
+    // A lock/unlock was queued (toggles already resolved)
+    void commanded(CommandAction action);
+
+    // A status notification; position is only known from a session
+    void observed(bool locked, bool unlocked, int16_t position, bool positionValid);
+
+    // A command left the queue; true when it timed out and the lock is
+    // known to be in the opposite state - a mismatch
+    bool finished(CommandAction action, CommandOutcome outcome);
+
+    LockState predicted() const;
+
+    // Direction for a toggle: away from the predicted state, unlock if unknown
+    CommandAction toggleAction() const;
+
+    uint32_t mismatches() const { return mismatchCount; }
+
+private:
+    LockState movingTowards() const;
+
+    CommandAction target;      // none once confirmed, failed or given up
+    LockState reported;        // last settled state
+    bool haveLockPosition;
+    bool haveUnlockPosition;
+    int16_t lockPosition;      // positions seen while settled
+    int16_t unlockPosition;
+    bool havePosition;
+    int16_t position;
+    int16_t previousPosition;
+    bool settled;              // the last status was locked or unlocked
+    uint32_t mismatchCount;
+};
+
+const char* lockStateName(LockState state);
+
+#endif
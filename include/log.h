@@ -0,0 +1,30 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Serial logging with a compile-time level (LOG_LEVEL in config.h, or
+// -DLOG_LEVEL=... from platformio.ini). Messages above the level sit in an
+// if (false) branch: the compiler still checks the format arguments, but
+// drops the call and its string, so a release build neither formats nor
+// stores them.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4   // per-event detail: every status, advert, payload
+
+#define LOG_AT(level, ...)                \
+    do {                                  \
+        if ((level) <= LOG_LEVEL) {       \
+            Serial.printf(__VA_ARGS__);   \
+        }                                 \
+    } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MEMORY_TELEMETRY_H
+#define MEMORY_TELEMETRY_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MEMORY_TRACKED_TASKS 4
+
+struct TaskStackUsage {
+    const char* name;
+    uint32_t freeBytes;   // least free stack the task has had since it started
+};
+
+// Heap state for spotting fragmentation over long uptimes: free heap alone
+// stays flat while the largest free block shrinks
+struct MemoryReport {
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;        // lowest since boot
+    uint32_t largestFreeBlock;
+    uint8_t fragmentationPct;    // share of the free heap not in the largest block
+    size_t taskCount;
+    TaskStackUsage tasks[MEMORY_TRACKED_TASKS];
+};
+
+// Add a task to the stack high-water report (from its start function)
+void trackTaskStack(TaskHandle_t handle, const char* name);
+
+void takeMemoryReport(MemoryReport& out);
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef OUTBOUND_BUFFER_H
+#define OUTBOUND_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define OUTBOUND_TOPIC_SIZE 48
+#define OUTBOUND_PAYLOAD_SIZE 512
+
+// Largest encoded record: header plus topic and payload without terminators
+#define OUTBOUND_RECORD_MAX (8 + OUTBOUND_TOPIC_SIZE + OUTBOUND_PAYLOAD_SIZE)
+
+// Where the outbound buffer overflows to once RAM is full. Records are
+// opaque byte strings, read back oldest first.
+class OutboundSpill {
+public:
+    virtual ~OutboundSpill() = default;
+
+    // Append one record; false when the log is full or unwritable
+    virtual bool append(const uint8_t* data, size_t length) = 0;
+
+    // Copy the oldest record without consuming it
+    virtual bool readFront(uint8_t* data, size_t capacity, size_t& length) = 0;
+    virtual void popFront() = 0;
+
+    virtual size_t records() const = 0;
+    virtual size_t bytes() const = 0;
+};
+
+struct OutboundBufferStats {
+    uint32_t buffered;        // messages accepted while offline
+    uint32_t spilled;         // of those, written to the spill log
+    uint32_t dropped;         // RAM and spill log both full, or message too large
+    uint32_t skipped;         // given up on by replay, see frontFailed()
+    size_t ramHighWater;      // peak RAM bytes in use
+    size_t spillHighWater;    // peak spill log bytes
+};
+
+// FIFO of MQTT messages kept while the broker is unreachable. Messages are
+// packed back to back into a caller-supplied byte ring, so short payloads
+// cost only their length. When the ring is full new messages go to the
+// spill log, and keep going there until it has drained, so the combined
+// order is always oldest first. The storage size must be a power of two.
+class OutboundBuffer {
+public:
+    OutboundBuffer(uint8_t* storage, size_t size, OutboundSpill* spill);
+
+    // Payloads are byte strings (JSON or CBOR) of payloadLength bytes
+    bool push(const char* topic, const uint8_t* payload, size_t payloadLength, uint32_t queuedMs);
+
+    // Oldest message, left in place until pop() (so a failed publish can retry).
+    // The payload is also NUL-terminated, so payloadSize needs one spare byte.
+    bool peek(char* topic, size_t topicSize, uint8_t* payload, size_t payloadSize, size_t& payloadLength,
+              uint32_t& queuedMs);
+    void pop();
+
+    // The oldest message was refused although the broker is connected. After
+    // maxAttempts refusals in a row it is dropped (counted as skipped) so a
+    // message the broker never takes cannot hold up the ones behind it;
+    // true when that happened.
+    bool frontFailed(uint8_t maxAttempts);
+
+    bool empty() const { return ramRecords == 0 && (spill == nullptr || spill->records() == 0); }
+    size_t count() const { return ramRecords + (spill != nullptr ? spill->records() : 0); }
+    size_t ramBytes() const { return head - tail; }
+
+    const OutboundBufferStats& stats() const { return counters; }
+    void resetHighWater();
+
+private:
+    struct RecordHeader {
+        uint32_t queuedMs;
+        uint16_t topicLength;
+        uint16_t payloadLength;
+    };
+
+    bool encode(const char* topic, const uint8_t* payload, size_t payloadLength, uint32_t queuedMs, uint8_t* out,
+                size_t capacity, size_t& length) const;
+    bool decode(const uint8_t* data, size_t length, char* topic, size_t topicSize, uint8_t* payload,
+                size_t payloadSize, size_t& payloadLength, uint32_t& queuedMs) const;
+    void write(const uint8_t* data, size_t length);
+    void read(size_t offset, uint8_t* data, size_t length) const;
+
+    uint8_t* storage;
+    size_t size;
+    OutboundSpill* spill;
+
+    uint32_t head;   // write position (monotonic, wraps modulo size)
+    uint32_t tail;   // oldest record
+    size_t ramRecords;
+    uint8_t frontAttempts;   // refused publishes of the oldest message
+
+    OutboundBufferStats counters;
+};
+
+#endif
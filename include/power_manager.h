@@ -0,0 +1,28 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+#include "power_policy.h"
+
+// Applies the power policy (power_policy.h) to the hardware: WiFi modem
+// sleep, automatic light sleep with the RXB6 pin as a wake source, BLE TX
+// power and the advertisement scan duty cycle
+
+// Configure frequency scaling and wake sources (from setup(), after BLE init)
+void startPowerManager();
+
+// Something happened that is likely to be followed up; safe to call from any task
+void notePowerActivity();
+
+// Re-evaluate the policy and apply what changed. Called from the sesame
+// task, which owns the scan: a running scan is stopped when its duty cycle
+// changes and restarted by the caller with the new one.
+void servicePower(bool rssiKnown, int8_t weakestRssi);
+
+// Milliseconds until servicePower() would choose different settings, or UINT32_MAX
+uint32_t msUntilPowerChange();
+
+// MQTT socket service interval for the network task
+uint32_t powerMqttPollMs();
+
+#endif
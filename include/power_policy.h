@@ -0,0 +1,71 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <stdint.h>
+
+// Energy/latency trade-off, POWER_PROFILE in config.h
+enum class PowerProfile : uint8_t {
+    performance,   // radios and CPU always on; lowest latency
+    balanced,      // modem sleep and light sleep, full speed right after activity
+    lowPower       // deepest sleep the latency budget allows
+};
+
+enum class WifiSleep : uint8_t {
+    none,
+    minModem,      // wakes for every DTIM beacon
+    maxModem       // wakes every listen interval (3 beacons by default)
+};
+
+// Assumed costs of each saving, for the latency estimate
+#define POWER_BEACON_INTERVAL_MS 103      // 100 TU
+#define POWER_LISTEN_INTERVAL_BEACONS 3   // ESP-IDF default station listen interval
+#define POWER_LIGHT_SLEEP_WAKE_MS 5       // GPIO wake plus clock ramp-up
+#define POWER_MQTT_POLL_MIN_MS 10
+#define POWER_MQTT_POLL_MAX_MS 200
+
+// BLE TX power range (dBm) and step
+#define POWER_BLE_TX_MIN_DBM -12
+#define POWER_BLE_TX_MAX_DBM 9
+#define POWER_BLE_TX_STEP_DBM 3
+#define POWER_BLE_TX_STEP_DOWN_MS 60000   // at most one step down per interval; up at once
+
+struct PowerInputs {
+    uint32_t msSinceActivity;   // since the last command, RF press or lock state change
+    bool rssiKnown;             // every lock advertised recently
+    int8_t weakestRssi;         // RSSI of the furthest lock
+};
+
+struct PowerSettings {
+    WifiSleep wifiSleep;
+    bool lightSleep;
+    uint16_t mqttPollMs;        // MQTT socket service interval
+    int8_t bleTxDbm;
+    uint16_t scanIntervalMs;    // passive advertisement scan duty cycle
+    uint16_t scanWindowMs;
+    uint32_t worstLatencyMs;    // latency the settings may add to a command
+};
+
+struct PowerPolicyConfig {
+    PowerProfile profile;
+    uint32_t latencyBudgetMs;   // upper bound for worstLatencyMs
+    uint32_t activeHoldMs;      // full responsiveness this long after activity
+    int8_t rssiTarget;          // adaptive TX power aims the weakest lock at this RSSI
+    uint16_t scanIntervalMs;    // duty cycle while active (and always with performance)
+    uint16_t scanWindowMs;
+    bool wifiMustSleep;         // WiFi/BLE coexistence requires modem sleep
+};
+
+// Pure decision: the most economical settings for the profile whose
+// worst-case added latency fits the budget. Savings are given back in
+// order (MQTT poll, WiFi sleep depth, light sleep) until it fits.
+PowerSettings choosePowerSettings(const PowerPolicyConfig& config, const PowerInputs& inputs);
+
+// Milliseconds until the settings change by themselves (the active hold ends), or UINT32_MAX
+uint32_t msUntilPowerChange(const PowerPolicyConfig& config, const PowerInputs& inputs);
+
+// Added latency of a set of settings
+uint32_t powerLatencyMs(const PowerSettings& settings);
+
+const char* powerProfileName(PowerProfile profile);
+
+#endif
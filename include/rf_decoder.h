@@ -0,0 +1,91 @@
+#ifndef RF_DECODER_H
+#define RF_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pulse-timing decoder for fixed-code 433MHz remotes (EV1527 / PT2262 and
+// compatibles). Each frame is a run of high/low pulse pairs followed by a
+// short sync high and a long sync low:
+//
+//   bit 0: 1T high, 3T low     bit 1: 3T high, 1T low
+//   sync:  1T high, 31T low (protocol 1) or 1T high, 10T low (protocol 2)
+//
+// The base pulse T is measured from the frame itself, so remotes with
+// drifting oscillators still decode. Only edges are needed (no levels):
+// the decoder works on the durations between consecutive edges.
+
+#define RF_MIN_BITS 12
+#define RF_MAX_BITS 32
+#define RF_MAX_DURATIONS (2 * RF_MAX_BITS + 1)
+
+// Any pulse longer than this closes the current frame (sync low)
+#define RF_SYNC_GAP_MIN_US 4000
+
+// Repeats of one frame further apart than this start a new press
+#define RF_REPEAT_WINDOW_US 200000
+
+struct RfProtocol {
+    const char* name;
+    uint8_t syncHigh;   // in units of T
+    uint8_t syncLow;
+    uint8_t zeroHigh;
+    uint8_t zeroLow;
+    uint8_t oneHigh;
+    uint8_t oneLow;
+};
+
+struct RfCode {
+    uint32_t code;
+    uint8_t bits;
+    uint8_t protocol;   // 1-based, as in rfProtocolName()
+    uint16_t pulseUs;   // measured base pulse T
+    uint32_t endUs;     // timestamp of the edge that completed the frame
+};
+
+struct RfDecoderStats {
+    uint32_t edges;     // edges fed to the decoder
+    uint32_t frames;    // frames that decoded cleanly
+    uint32_t codes;     // codes confirmed by repeats
+    uint32_t rejected;  // pulse runs ending in a sync gap that failed to decode
+};
+
+class RfDecoder {
+public:
+    RfDecoder(uint32_t minPulseUs, uint8_t tolerancePct, uint8_t repeatFrames);
+
+    // Feed one edge timestamp (micros()); true when a code was confirmed
+    bool feedEdge(uint32_t timestampUs, RfCode& out);
+
+    const RfDecoderStats& stats() const { return counters; }
+    void reset();
+
+private:
+    bool decodeFrame(uint32_t syncGapUs, uint32_t endUs, RfCode& out) const;
+    bool matches(uint32_t durationUs, uint32_t units, uint32_t pulseUs) const;
+
+    uint32_t minPulseUs;
+    uint8_t tolerancePct;
+    uint8_t repeatFrames;
+
+    uint32_t durations[RF_MAX_DURATIONS];
+    size_t durationCount;
+    bool haveLastEdge;
+    bool frameDiscarded;   // noise seen since the last sync gap
+    uint32_t lastEdgeUs;
+
+    uint32_t lastFrameCode;
+    uint8_t lastFrameBits;
+    uint8_t lastFrameProtocol;
+    uint32_t lastFrameUs;
+    uint8_t repeatCount;
+
+    RfDecoderStats counters;
+};
+
+const char* rfProtocolName(uint8_t protocol);
+
+// Inverse of rfProtocolName(); 0 if the name is unknown
+uint8_t rfProtocolId(const char* name);
+
+#endif
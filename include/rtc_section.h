@@ -0,0 +1,32 @@
+#ifndef RTC_SECTION_H
+#define RTC_SECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// FNV-1a over a block of memory
+uint32_t sectionChecksum(const void* data, size_t length);
+
+// A block of RTC_NOINIT memory that survives resets. After power-on it
+// holds garbage, so contents only count once sealed: the magic (which also
+// versions the layout) and the checksum must both match.
+template <typename T>
+struct RtcSection {
+    uint32_t magic;
+    uint32_t checksum;
+    T data;
+
+    bool valid(uint32_t expectedMagic) const {
+        return magic == expectedMagic && checksum == sectionChecksum(&data, sizeof(data));
+    }
+
+    // Call after every change to data
+    void seal(uint32_t sectionMagic) {
+        magic = sectionMagic;
+        checksum = sectionChecksum(&data, sizeof(data));
+    }
+
+    void invalidate() { magic = 0; }
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SESAME_ADVERT_H
+#define SESAME_ADVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Decoder for the manufacturer-specific data Sesame locks put in their BLE
+// advertisements (company id 0x055A, CANDY HOUSE). Only the documented
+// fields are read, offsets into the manufacturer data:
+//
+//   0-1  company id, little endian (5A 05)
+//   2    model (Sesame::model_t)
+//   3    reserved
+//   4    flags: bit 0 registered
+//
+// Anything after byte 4 is vendor-internal and differs between models and
+// firmware versions, so it is ignored: the lock state is never taken from
+// an advert. The RSSI comes from the radio, not from the payload.
+
+#define SESAME_ADVERT_COMPANY_ID 0x055A
+
+struct SesameAdvert {
+    uint8_t model;
+    bool registered;
+};
+
+// Find and decode the Sesame manufacturer data in a raw advertisement
+// payload (a sequence of length/type/data AD structures); false if the
+// payload is malformed or carries no Sesame data
+bool decodeSesameAdvert(const uint8_t* payload, size_t length, SesameAdvert& out);
+
+// Decode the manufacturer data itself, company id included
+bool decodeSesameManufacturerData(const uint8_t* data, size_t length, SesameAdvert& out);
+
+#endif
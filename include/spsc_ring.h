@@ -0,0 +1,59 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Forced inline so push() lands inside IRAM_ATTR interrupt handlers
+#define SPSC_INLINE inline __attribute__((always_inline))
+
+// Lock-free single-producer/single-consumer ring buffer. The producer
+// (typically an ISR) only writes head, the consumer only writes tail, so
+// neither side ever blocks or disables interrupts.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    // Producer side; false (and counted) when the consumer has fallen behind
+    SPSC_INLINE bool push(const T& value) {
+        uint32_t head = headIndex.load(std::memory_order_relaxed);
+        uint32_t tail = tailIndex.load(std::memory_order_acquire);
+        if (head - tail >= N) {
+            overflowCount.store(overflowCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[head & (N - 1)] = value;
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& out) {
+        uint32_t tail = tailIndex.load(std::memory_order_relaxed);
+        uint32_t head = headIndex.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        out = buffer[tail & (N - 1)];
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    SPSC_INLINE size_t size() const {
+        return headIndex.load(std::memory_order_acquire) - tailIndex.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+    uint32_t overflows() const { return overflowCount.load(std::memory_order_relaxed); }
+
+private:
+    T buffer[N];
+    std::atomic<uint32_t> headIndex{0};
+    std::atomic<uint32_t> tailIndex{0};
+    std::atomic<uint32_t> overflowCount{0};
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef STALL_PROFILER_H
+#define STALL_PROFILER_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Instrumented sections: task loop stages and the callbacks that run on
+// library tasks. Each section is only ever entered from one task.
+enum class ProfileSection : uint8_t {
+    wifi,             // network: WiFi state machine
+    mqttConnect,      // network: MQTT state machine, including a connect attempt
+    mqttLoop,         // network: PubSubClient::loop(), including mqttCallback
+    mqttCallback,
+    publish,          // network: publishing or buffering queued messages
+    replay,           // network: replaying the offline backlog
+    sesameEvent,      // sesame: handling one queued event
+    sesameService,    // sesame: timers, command dispatch and per-lock upkeep
+    connect,          // sesame: connection scheduling, including BLE connect()
+    statusUpdate,     // BLE host callbacks
+    stateUpdate,
+    historyReceived,
+    advert,
+    rxb6,             // rxb6: decoding buffered edges
+    lanPacket,        // AsyncUDP callback
+    count
+};
+
+// Tasks fed to the ESP-IDF task watchdog
+enum class WatchedTask : uint8_t {
+    network,
+    sesame,
+    count
+};
+
+struct SectionStats {
+    uint32_t count;
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint32_t stalls;     // runs of at least STALL_THRESHOLD_US
+};
+
+// One reporting window, taken (and reset) by takeStallReport()
+struct StallReport {
+    SectionStats sections[static_cast<size_t>(ProfileSection::count)];
+    ProfileSection worstSection;
+    uint32_t worstUs;
+    WatchedTask gapTask;        // task that went longest without feeding the watchdog
+    uint32_t maxFeedGapMs;
+};
+
+// Add one run of a section; costs two micros() reads and a short critical section
+void recordSection(ProfileSection section, uint32_t elapsedUs);
+
+void takeStallReport(StallReport& out);
+
+// Set the watchdog timeout (from setup(), before the tasks start); each
+// task then subscribes itself and feeds the watchdog once per loop
+void watchdogBegin();
+void watchdogSubscribe(WatchedTask task);
+void watchdogFeed(WatchedTask task);
+
+const char* profileSectionName(ProfileSection section);
+const char* watchedTaskName(WatchedTask task);
+
+// Times the enclosing block: ProfileScope scope(ProfileSection::wifi);
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileSection section) : section(section), startUs(micros()) {}
+    ~ProfileScope() { recordSection(section, micros() - startUs); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileSection section;
+    uint32_t startUs;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef STATE_CACHE_H
+#define STATE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "app.h"
+
+// Runtime state kept across reboots, so a watchdog reset or brownout does
+// not start from "unknown". Each section lives in RTC memory (survives any
+// reset short of power loss, rewritten freely) and in NVS (survives power
+// loss, rewritten only when the value that matters changes, to spare the
+// flash). A checksum tells valid RTC contents from power-on garbage.
+
+// Last WiFi association, for connecting without a channel scan
+struct CachedNetwork {
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+// Restore/save the last status of a lock. NVS is only written when the
+// locked/unlocked position changes; battery and voltage stay in RTC memory.
+bool restoreLockStatus(size_t lock, LockStatus& out);
+void saveLockStatus(size_t lock, const LockStatus& status);
+
+bool restoreNetwork(CachedNetwork& out);
+void saveNetwork(const CachedNetwork& network);
+void clearNetwork();
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef STATUS_REQUESTS_H
+#define STATUS_REQUESTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "command.h"
+
+#define STATUS_REQUEST_SLOTS 8
+
+// A "status" command waiting for the lock to answer request_status()
+struct PendingStatusRequest {
+    bool active;
+    CommandSource source;
+    uint32_t startedMs;
+    uint32_t deadlineMs;
+    char requestId[COMMAND_REQUEST_ID_SIZE];
+};
+
+// Fixed table of outstanding status requests. Concurrent pollers share a
+// single BLE request_status() and are all completed by the next status
+// notification, or individually expired when their deadline passes.
+class StatusRequestTracker {
+public:
+    StatusRequestTracker();
+
+    // Track a request; false when every slot is taken
+    bool add(const char* requestId, CommandSource source, uint32_t nowMs, uint32_t timeoutMs);
+
+    // Remove one pending request (any order) when the lock has answered
+    bool takeAny(PendingStatusRequest& out);
+
+    // Remove one request whose deadline has passed
+    bool takeExpired(uint32_t nowMs, PendingStatusRequest& out);
+
+    // Milliseconds until the earliest deadline, or UINT32_MAX if idle
+    uint32_t msUntilNextDeadline(uint32_t nowMs) const;
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+private:
+    PendingStatusRequest slots[STATUS_REQUEST_SLOTS];
+    size_t count;
+};
+
+#endif
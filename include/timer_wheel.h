@@ -0,0 +1,76 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "command.h"
+
+#define TIMER_WHEEL_CAPACITY 16
+#define TIMER_WHEEL_SLOTS 64        // buckets, power of two
+#define TIMER_WHEEL_TICK_MS 256     // per bucket, power of two so ticks wrap with millis()
+
+// What a timer does when it fires
+enum class TimerKind : uint8_t {
+    command,  // run a command scheduled with "delay_s"
+    relock    // lock again after a confirmed unlock
+};
+
+struct TimerEntry {
+    uint8_t lock;            // index into sesameLocks
+    TimerKind kind;
+    uint32_t dueMs;
+    SesameCommand command;
+};
+
+// Hashed timer wheel: timers hang off the bucket of their due tick, so
+// firing only looks at the buckets the clock has passed since the last
+// call and a timer of any length costs the same. Timers further out than
+// one revolution stay in their bucket until their due time comes round.
+// Nodes come from a fixed pool; nothing is allocated.
+class TimerWheel {
+public:
+    TimerWheel();
+
+    // Add a timer; 0 when the pool is full, else a handle for cancel()
+    uint16_t schedule(const TimerEntry& entry, uint32_t nowMs);
+
+    bool cancel(uint16_t handle);
+
+    // Drop every timer of a lock (of one kind, or all of them); returns the count
+    size_t cancelLock(uint8_t lock);
+    size_t cancelLock(uint8_t lock, TimerKind kind);
+
+    // Remove one timer whose due time has passed
+    bool takeDue(uint32_t nowMs, TimerEntry& out);
+
+    // Milliseconds until the earliest timer (of a lock and kind), or UINT32_MAX
+    uint32_t msUntilNext(uint32_t nowMs) const;
+    uint32_t msUntilNext(uint8_t lock, TimerKind kind, uint32_t nowMs) const;
+
+    size_t size() const { return count; }
+
+private:
+    static const uint8_t NONE = 0xFF;
+
+    struct Node {
+        uint8_t next;
+        uint8_t bucket;
+        uint8_t generation;   // bumped on reuse, so stale handles do not cancel a new timer
+        bool active;
+        TimerEntry entry;
+    };
+
+    void unlink(uint8_t index);
+
+    Node nodes[TIMER_WHEEL_CAPACITY];
+    uint8_t buckets[TIMER_WHEEL_SLOTS];
+    uint8_t freeList;
+    size_t count;
+    uint32_t cursorMs;     // start of the oldest bucket not yet fully fired
+};
+
+static_assert((TIMER_WHEEL_SLOTS & (TIMER_WHEEL_SLOTS - 1)) == 0, "TIMER_WHEEL_SLOTS must be a power of two");
+static_assert((TIMER_WHEEL_TICK_MS & (TIMER_WHEEL_TICK_MS - 1)) == 0, "TIMER_WHEEL_TICK_MS must be a power of two");
+static_assert(TIMER_WHEEL_CAPACITY < 0xFF, "TIMER_WHEEL_CAPACITY must fit a node index");
+
+#endif
@@ -95,6 +95,87 @@ build() {
     fi
 }
 
+# Build the production firmware (env:release)
+build_release() {
+    print_status "Building release firmware..."
+    check_platformio
+    check_config
+    
+    pio run --environment release
+    
+    if [ $? -eq 0 ]; then
+        print_success "Release build completed: .pio/build/release/firmware.bin"
+    else
+        print_error "Release build failed!"
+        exit 1
+    fi
+}
+
+# Host unit tests, then the benchmarks with their timings and allocation counts
+host_tests() {
+    echo ""
+    print_status "🧪 Host unit tests (env:native)"
+    if ! pio test --environment native; then
+        print_error "Host tests failed!"
+        exit 1
+    fi
+    
+    echo ""
+    print_status "⏱️ Host benchmarks (env:bench)"
+    if ! pio test --environment bench -v; then
+        print_error "Host benchmarks failed!"
+        exit 1
+    fi
+}
+
+# Flash/RAM per module of the release build, the host tests and benchmarks,
+# plus the boot and outbound metrics the firmware publishes when a broker is given
+report() {
+    local broker="$1"
+    local build_dir=".pio/build/release"
+    local size_tool="$HOME/.platformio/packages/toolchain-xtensa-esp32/bin/xtensa-esp32-elf-size"
+    
+    build_release
+    
+    echo ""
+    print_status "📦 Firmware size (release)"
+    pio run --environment release --target size
+    
+    if [ ! -x "$size_tool" ]; then
+        print_warning "xtensa-esp32-elf-size not found - skipping per-module sizes"
+    else
+        echo ""
+        print_status "📦 Per module (flash = text + data, RAM = data + bss)"
+        printf "%-28s %10s %10s\n" "module" "flash" "ram"
+        for object in "$build_dir"/src/*.o; do
+            "$size_tool" "$object" | awk -v name="$(basename "$object" .cpp.o)" \
+                'NR == 2 { printf "%-28s %10d %10d\n", name, $1 + $2, $2 + $3 }'
+        done | sort -k2 -n -r
+    fi
+    
+    host_tests
+    
+    if [ -z "$broker" ]; then
+        echo ""
+        print_warning "No broker given - skipping boot and throughput metrics"
+        echo "Run: $0 report <mqtt-host> to read them from a flashed device"
+        return
+    fi
+    
+    if ! command -v mosquitto_sub &> /dev/null; then
+        print_error "mosquitto_sub not found! (apt install mosquitto-clients)"
+        exit 1
+    fi
+    
+    echo ""
+    print_status "⏱️ Boot stages - reset the ESP32 now (waiting up to 120 s)"
+    mosquitto_sub -h "$broker" -t "sesame/metrics/boot" -C 1 -W 120 || print_warning "No boot metrics received"
+    
+    echo ""
+    print_status "📈 Outbound throughput (waiting up to 120 s)"
+    mosquitto_sub -h "$broker" -t "sesame/metrics/outbound" -C 1 -W 120 || print_warning "No outbound metrics received"
+}
+
 # Upload to ESP32
 upload() {
     print_status "Uploading to ESP32..."
@@ -152,6 +233,9 @@ show_help() {
     echo ""
     echo "Commands:"
     echo "  build      - Build the project"
+    echo "  release    - Build the release firmware (errors-only logging)"
+    echo "  test       - Host unit tests and benchmarks"
+    echo "  report     - Release build size per module, host tests and benchmarks; boot/throughput metrics with [mqtt-host]"
     echo "  upload     - Upload to ESP32"
     echo "  monitor    - Monitor serial output"
     echo "  deploy     - Build and upload"
@@ -165,6 +249,7 @@ show_help() {
     echo "Examples:"
     echo "  $0 build"
     echo "  $0 deploy"
+    echo "  $0 report 192.168.1.10"
     echo "  $0 full"
     echo "  $0 scan"
 }
@@ -242,8 +327,8 @@ scan_sesame() {
     print_warning "📱 Instructions:"
     echo "1. Make sure your Sesame device is powered on"
     echo "2. Close SESAME app on your phone"
-    echo "3. Wait for scan results below"
-    echo "4. Copy MAC address when found"
+    echo "3. Watch the JSON lines below - devices stream in as they are heard"
+    echo "4. Copy the \"addr\" of records with \"sesame\":true"
     echo "5. Press Ctrl+C to stop monitoring"
     echo ""
     print_status "📊 Serial Monitor Output:"
@@ -298,6 +383,16 @@ main() {
         "build")
             build
             ;;
+        "release")
+            build_release
+            ;;
+        "test")
+            check_platformio
+            host_tests
+            ;;
+        "report")
+            report "$2"
+            ;;
         "upload")
             upload
             ;;
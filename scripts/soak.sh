@@ -0,0 +1,324 @@
+#!/bin/bash
+
+# ESP32 Sesame 3 MQTT Controller Soak Script
+# Floods a flashed device with commands over MQTT, optionally restarting the
+# broker on a schedule, and reports throughput, lost or duplicated replies,
+# outbound drops and the heap trend from the metrics the firmware publishes.
+# Sử dụng: ./scripts/soak.sh [options] <mqtt-host>
+
+set -e  # Exit on error
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+print_status() {
+    echo -e "${BLUE}[INFO]${NC} $1"
+}
+
+print_success() {
+    echo -e "${GREEN}[SUCCESS]${NC} $1"
+}
+
+print_warning() {
+    echo -e "${YELLOW}[WARNING]${NC} $1"
+}
+
+print_error() {
+    echo -e "${RED}[ERROR]${NC} $1"
+}
+
+# Defaults; the device publishes memory and diagnostics every
+# DIAGNOSTICS_INTERVAL_MS (60 s), so the drain covers at least one report
+DURATION_S=3600
+RATE=2
+LOCK_ID="door"
+ACTION="status"
+DRAIN_S=90
+FLAP_EVERY_S=0
+FLAP_COMMAND="sudo systemctl restart mosquitto"
+OUT_DIR=""
+REPORT_DIR=""
+
+show_help() {
+    echo "ESP32 Sesame 3 MQTT Controller Soak Script"
+    echo "Usage: $0 [options] <mqtt-host>"
+    echo "       $0 --report <capture-dir>"
+    echo ""
+    echo "Options:"
+    echo "  -d SECONDS   Flood duration (default $DURATION_S)"
+    echo "  -r RATE      Commands per second (default $RATE)"
+    echo "  -l LOCK      Lock id (default $LOCK_ID)"
+    echo "  -a ACTION    status, lock, unlock or toggle (default $ACTION; the others move the lock)"
+    echo "  -w SECONDS   Wait for replies and metrics after the flood (default $DRAIN_S)"
+    echo "  -F SECONDS   Restart the broker this often (default off)"
+    echo "  -C COMMAND   Broker restart command (default \"$FLAP_COMMAND\")"
+    echo "  -o DIR       Keep the capture here (default a new directory under /tmp)"
+    echo "  --report DIR Report on an earlier capture without flooding"
+    echo ""
+    echo "Examples:"
+    echo "  $0 -d 600 -r 5 192.168.1.10"
+    echo "  $0 -d 7200 -F 300 localhost"
+    echo "  $0 --report /tmp/sesame-soak.XXXXXX"
+}
+
+check_tools() {
+    local missing=0
+    for tool in "$@"; do
+        if ! command -v "$tool" &> /dev/null; then
+            print_error "$tool not found!"
+            missing=1
+        fi
+    done
+    if [ $missing -ne 0 ]; then
+        echo "Install them with: apt install mosquitto-clients jq"
+        exit 1
+    fi
+}
+
+# One timestamped line per message: "<unix time> <topic> <payload>"
+start_capture() {
+    mosquitto_sub -h "$BROKER" -F '%U %t %p' \
+        -t 'sesame/metrics/#' -t 'sesame/diagnostics' \
+        -t "sesame/$LOCK_ID/result" -t "sesame/$LOCK_ID/status/reply" \
+        >> "$OUT_DIR/capture.log" 2>> "$OUT_DIR/capture.err" &
+    CAPTURE_PID=$!
+}
+
+# Keep the capture running across broker restarts
+watch_capture() {
+    if ! kill -0 "$CAPTURE_PID" 2> /dev/null; then
+        start_capture
+    fi
+}
+
+flap_broker() {
+    print_status "🔌 Restarting the broker: $FLAP_COMMAND"
+    if sh -c "$FLAP_COMMAND" >> "$OUT_DIR/flap.log" 2>&1; then
+        echo "$(date +%s) restart" >> "$OUT_DIR/flaps"
+    else
+        print_warning "Broker restart command failed (see $OUT_DIR/flap.log)"
+    fi
+}
+
+flood() {
+    local total=$((DURATION_S * RATE))
+    local interval
+    interval=$(awk -v rate="$RATE" 'BEGIN { printf "%.3f", 1 / rate }')
+    local started next_flap i=0
+
+    started=$(date +%s)
+    next_flap=$((started + FLAP_EVERY_S))
+    : > "$OUT_DIR/sent"
+    : > "$OUT_DIR/failed"
+
+    print_status "🌊 Sending $total $ACTION commands to sesame/$LOCK_ID/command at $RATE/s"
+    while [ $i -lt $total ]; do
+        i=$((i + 1))
+        local id="soak-$started-$i"
+        if mosquitto_pub -h "$BROKER" -t "sesame/$LOCK_ID/command" \
+            -m "{\"action\":\"$ACTION\",\"request_id\":\"$id\"}" 2> /dev/null; then
+            echo "$id" >> "$OUT_DIR/sent"
+        else
+            echo "$id" >> "$OUT_DIR/failed"
+        fi
+
+        if [ "$FLAP_EVERY_S" -gt 0 ] && [ "$(date +%s)" -ge "$next_flap" ]; then
+            flap_broker
+            next_flap=$(($(date +%s) + FLAP_EVERY_S))
+        fi
+        if [ $((i % 100)) -eq 0 ]; then
+            watch_capture
+            echo "  $i/$total sent"
+        fi
+        sleep "$interval"
+    done
+    echo "$started $(date +%s)" > "$OUT_DIR/window"
+}
+
+# Payloads of one topic, as JSON lines with the capture time added as "t"
+messages() {
+    awk -v topic="$1" '$2 == topic { print $1 "\t" substr($0, length($1) + length($2) + 3) }' "$DIR/capture.log" |
+        jq -R -c 'split("\t") | (.[1] | fromjson? // empty) + {t: (.[0] | tonumber)}'
+}
+
+# Replies to this run's commands
+replies() {
+    messages "$REPLY_TOPIC" | jq -c 'select((.request_id // "") | startswith("soak-"))'
+}
+
+# "label<TAB>value" lines as an aligned table
+rows() {
+    awk -F '\t' '{ printf "  %-28s %s\n", $1, $2 }'
+}
+
+# Least-squares slope of a field over time, in units per hour
+trend_per_hour() {
+    messages "$1" | jq -r --arg field "$2" 'select(has($field)) | "\(.t) \(.[$field])"' |
+        awk '{ n++; sx += $1; sy += $2; sxx += $1 * $1; sxy += $1 * $2 }
+             END { d = n * sxx - sx * sx; if (n < 2 || d == 0) print "n/a"; else printf "%+.0f", (n * sxy - sx * sy) / d * 3600 }'
+}
+
+report() {
+    DIR="$1"
+    if [ ! -f "$DIR/capture.log" ] || [ ! -f "$DIR/sent" ]; then
+        print_error "No capture in $DIR"
+        exit 1
+    fi
+    if [ -f "$DIR/settings" ]; then
+        # shellcheck source=/dev/null
+        . "$DIR/settings"
+    fi
+
+    # Status requests are answered on status/reply, lock commands on result
+    REPLY_TOPIC="sesame/$LOCK_ID/result"
+    if [ "$ACTION" = "status" ]; then
+        REPLY_TOPIC="sesame/$LOCK_ID/status/reply"
+    fi
+
+    local sent failed flaps window_s replied unique duplicated missing
+    sent=$(wc -l < "$DIR/sent")
+    failed=$(cat "$DIR/failed" 2> /dev/null | wc -l)
+    flaps=$(cat "$DIR/flaps" 2> /dev/null | wc -l)
+    window_s=$(awk '{ print $2 - $1 }' "$DIR/window" 2> /dev/null || echo 0)
+
+    replies | jq -r '.request_id' | sort > "$DIR/replied"
+    replied=$(wc -l < "$DIR/replied")
+    unique=$(uniq "$DIR/replied" | wc -l)
+    duplicated=$((replied - unique))
+    missing=$(sort "$DIR/sent" | comm -23 - <(uniq "$DIR/replied") | wc -l)
+
+    echo ""
+    print_status "🌊 Commands ($ACTION to $LOCK_ID, $flaps broker restarts)"
+    {
+        printf "sent\t%s\n" "$sent"
+        printf "publish failed\t%s\n" "$failed"
+        if [ "${window_s:-0}" -gt 0 ]; then
+            printf "rate (per s)\t%s\n" "$(awk -v n="$sent" -v s="$window_s" 'BEGIN { printf "%.2f", n / s }')"
+        fi
+        printf "replied\t%s\n" "$unique"
+        printf "missing replies\t%s\n" "$missing"
+        printf "duplicate replies\t%s\n" "$duplicated"
+        replies | jq -r '.result' | sort | uniq -c | awk '{ printf "result %s\t%s\n", $2, $1 }'
+        replies | jq -r '.elapsed_ms // empty' | sort -n |
+            awk '{ v[NR] = $1 } END { if (NR) printf "elapsed ms p50 / p95 / max\t%d / %d / %d\n", v[int((NR - 1) * 0.5) + 1], v[int((NR - 1) * 0.95) + 1], v[NR] }'
+    } | rows
+
+    # Counters in the outbound report are since boot: the run is last minus first
+    echo ""
+    print_status "📤 Outbound (sesame/metrics/outbound)"
+    messages "sesame/metrics/outbound" | jq -s -r '
+        if length == 0 then ["no reports received", ""] | @tsv else
+            ["reports", length],
+            ["published live", .[-1].live - .[0].live],
+            ["published from backlog", .[-1].replayed - .[0].replayed],
+            ["dropped", .[-1].dropped - .[0].dropped],
+            ["backlog max / last", "\(map(.backlog) | max) / \(.[-1].backlog)"]
+            | @tsv
+        end' | rows
+
+    echo ""
+    print_status "🧮 Memory (sesame/metrics/memory)"
+    {
+        messages "sesame/metrics/memory" | jq -s -r '
+            if length == 0 then ["no reports received", ""] | @tsv else
+                (["reports", length],
+                 ["free heap first / last", "\(.[0].free_heap) / \(.[-1].free_heap)"],
+                 ["lowest free heap", .[-1].min_free_heap],
+                 ["largest block first / last", "\(.[0].largest_free_block) / \(.[-1].largest_free_block)"],
+                 ["fragmentation max (%)", (map(.fragmentation_pct) | max)],
+                 (.[-1].stacks[]? | ["stack free " + .task, .stack_free]))
+                | @tsv
+            end'
+        printf "free heap trend (B/h)\t%s\n" "$(trend_per_hour sesame/metrics/memory free_heap)"
+        printf "largest block trend (B/h)\t%s\n" "$(trend_per_hour sesame/metrics/memory largest_free_block)"
+    } | rows
+
+    # Only the first message of each report carries the totals
+    echo ""
+    print_status "🩺 Diagnostics (sesame/diagnostics)"
+    messages "sesame/diagnostics" | jq -s -r '
+        map(select(has("worst_us"))) |
+        if length == 0 then ["no reports received", ""] | @tsv else
+            ["stalls", (map(.stalls) | add)],
+            ["worst section (us)", (max_by(.worst_us) | "\(.worst_section) \(.worst_us)")],
+            ["max watchdog feed gap (ms)", (map(.max_feed_gap_ms) | max)],
+            ["BLE event drops", .[-1].ble_event_drops - .[0].ble_event_drops]
+            | @tsv
+        end' | rows
+
+    echo ""
+    if [ "$missing" -eq 0 ] && [ "$duplicated" -eq 0 ]; then
+        print_success "Every command got exactly one reply (capture: $DIR)"
+    else
+        print_warning "$missing missing and $duplicated duplicate replies (capture: $DIR)"
+    fi
+}
+
+main() {
+    while [ $# -gt 0 ]; do
+        case "$1" in
+            -d) DURATION_S="$2"; shift 2 ;;
+            -r) RATE="$2"; shift 2 ;;
+            -l) LOCK_ID="$2"; shift 2 ;;
+            -a) ACTION="$2"; shift 2 ;;
+            -w) DRAIN_S="$2"; shift 2 ;;
+            -F) FLAP_EVERY_S="$2"; shift 2 ;;
+            -C) FLAP_COMMAND="$2"; shift 2 ;;
+            -o) OUT_DIR="$2"; shift 2 ;;
+            --report) REPORT_DIR="$2"; shift 2 ;;
+            -h|--help|help) show_help; exit 0 ;;
+            -*) print_error "Unknown option: $1"; show_help; exit 1 ;;
+            *) BROKER="$1"; shift ;;
+        esac
+    done
+
+    if [ -n "$REPORT_DIR" ]; then
+        check_tools jq
+        report "$REPORT_DIR"
+        exit 0
+    fi
+
+    if [ -z "$BROKER" ]; then
+        show_help
+        exit 1
+    fi
+    case "$ACTION" in
+        status|lock|unlock|toggle) ;;
+        *) print_error "Unknown action: $ACTION"; exit 1 ;;
+    esac
+    for value in "$DURATION_S" "$RATE" "$DRAIN_S" "$FLAP_EVERY_S"; do
+        if ! [[ "$value" =~ ^[0-9]+$ ]]; then
+            print_error "Durations and the rate are whole numbers: $value"
+            exit 1
+        fi
+    done
+    if [ "$RATE" -eq 0 ]; then
+        print_error "The rate must be at least 1 command per second"
+        exit 1
+    fi
+    check_tools mosquitto_pub mosquitto_sub jq
+
+    OUT_DIR="${OUT_DIR:-$(mktemp -d /tmp/sesame-soak.XXXXXX)}"
+    mkdir -p "$OUT_DIR"
+    echo "ACTION=$ACTION LOCK_ID=$LOCK_ID" > "$OUT_DIR/settings"
+    print_status "Capture directory: $OUT_DIR"
+
+    start_capture
+    trap 'kill "$CAPTURE_PID" 2> /dev/null || true' EXIT
+    sleep 1
+
+    flood
+
+    print_status "⏳ Waiting $DRAIN_S s for replies, the backlog and a final metrics report"
+    sleep "$DRAIN_S"
+    watch_capture
+    kill "$CAPTURE_PID" 2> /dev/null || true
+
+    report "$OUT_DIR"
+}
+
+main "$@"
@@ -0,0 +1,24 @@
+#include "backoff.h"
+
+Backoff::Backoff(uint32_t minMs, uint32_t maxMs, uint8_t jitterPct)
+    : minMs(minMs), maxMs(maxMs < minMs ? minMs : maxMs),
+      jitterPct(jitterPct > 100 ? 100 : jitterPct), failures(0) {}
+
+uint32_t Backoff::nextDelayMs(uint32_t random) {
+    uint32_t base = minMs;
+    for (uint8_t i = 0; i < failures && base < maxMs; i++) {
+        base = base > maxMs / 2 ? maxMs : base * 2;
+    }
+    if (base > maxMs) {
+        base = maxMs;
+    }
+    if (failures < UINT8_MAX) {
+        failures++;
+    }
+
+    uint32_t spread = static_cast<uint32_t>(static_cast<uint64_t>(base) * jitterPct / 100);
+    if (spread == 0) {
+        return base;
+    }
+    return base - spread + random % (2 * spread + 1);
+}
@@ -0,0 +1,33 @@
+#include "boot_metrics.h"
+#include <Arduino.h>
+#include <atomic>
+#include <esp_system.h>
+
+static std::atomic<uint32_t> stageMs[static_cast<size_t>(BootStage::count)];
+
+void markBootStage(BootStage stage) {
+    // millis() is at least 1 by the time any stage is reached, so 0 stays "not yet"
+    uint32_t now = millis();
+    uint32_t expected = 0;
+    stageMs[static_cast<size_t>(stage)].compare_exchange_strong(expected, now == 0 ? 1 : now);
+}
+
+uint32_t bootStageMs(BootStage stage) {
+    return stageMs[static_cast<size_t>(stage)].load();
+}
+
+const char* resetReasonName() {
+    switch (esp_reset_reason()) {
+        case ESP_RST_POWERON: return "poweron";
+        case ESP_RST_EXT: return "external";
+        case ESP_RST_SW: return "software";
+        case ESP_RST_PANIC: return "panic";
+        case ESP_RST_INT_WDT: return "int_wdt";
+        case ESP_RST_TASK_WDT: return "task_wdt";
+        case ESP_RST_WDT: return "wdt";
+        case ESP_RST_DEEPSLEEP: return "deepsleep";
+        case ESP_RST_BROWNOUT: return "brownout";
+        case ESP_RST_SDIO: return "sdio";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,193 @@
+#include "cbor_reader.h"
+#include <string.h>
+
+static const uint8_t CBOR_BREAK = 0xFF;
+static const int CBOR_MAX_NESTING = 4;
+
+bool CborField::keyEquals(FieldId id) const {
+    if (keyIsId) {
+        return keyId == static_cast<uint64_t>(id);
+    }
+    const char* name = fieldName(id);
+    return strlen(name) == keyLength && memcmp(name, key, keyLength) == 0;
+}
+
+bool CborField::copyText(char* out, size_t size) const {
+    if (type != CborValueType::text || valueLength >= size) {
+        return false;
+    }
+    memcpy(out, value, valueLength);
+    out[valueLength] = '\0';
+    return true;
+}
+
+CborMapScanner::CborMapScanner(const uint8_t* data, size_t length)
+    : pos(data), end(data + length), started(false), finished(false), error(false),
+      indefiniteMap(false), remaining(0) {}
+
+bool CborMapScanner::readHead(uint8_t& major, uint64_t& argument, bool& indefinite) {
+    if (pos >= end) {
+        return false;
+    }
+    uint8_t initial = *pos++;
+    major = initial >> 5;
+    uint8_t info = initial & 0x1F;
+    indefinite = false;
+
+    if (info < 24) {
+        argument = info;
+        return true;
+    }
+    if (info == 31) {
+        // Indefinite length: only arrays and maps are accepted here
+        indefinite = true;
+        argument = 0;
+        return major == 4 || major == 5;
+    }
+    if (info > 27) {
+        return false;
+    }
+
+    size_t bytes = static_cast<size_t>(1) << (info - 24);
+    if (static_cast<size_t>(end - pos) < bytes) {
+        return false;
+    }
+    argument = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        argument = (argument << 8) | *pos++;
+    }
+    return true;
+}
+
+bool CborMapScanner::skipItem(int depth) {
+    if (depth > CBOR_MAX_NESTING) {
+        return false;
+    }
+
+    uint8_t major;
+    uint64_t argument;
+    bool indefinite;
+    if (!readHead(major, argument, indefinite)) {
+        return false;
+    }
+
+    switch (major) {
+        case 0:
+        case 1:
+        case 7:
+            // Floats carry their bytes in the argument, already consumed
+            return true;
+        case 2:
+        case 3:
+            if (argument > static_cast<uint64_t>(end - pos)) return false;
+            pos += argument;
+            return true;
+        case 4:
+        case 5: {
+            uint64_t items = major == 5 ? argument * 2 : argument;
+            if (indefinite) {
+                while (pos < end && *pos != CBOR_BREAK) {
+                    if (!skipItem(depth + 1)) return false;
+                }
+                if (pos >= end) return false;
+                pos++;
+                return true;
+            }
+            for (uint64_t i = 0; i < items; i++) {
+                if (!skipItem(depth + 1)) return false;
+            }
+            return true;
+        }
+        case 6:
+            // Tag: skip the tagged item
+            return skipItem(depth + 1);
+        default:
+            return false;
+    }
+}
+
+bool CborMapScanner::next(CborField& field) {
+    if (error || finished) {
+        return false;
+    }
+
+    uint8_t major;
+    uint64_t argument;
+    bool indefinite;
+
+    if (!started) {
+        started = true;
+        if (!readHead(major, argument, indefinite) || major != 5) {
+            error = true;
+            return false;
+        }
+        indefiniteMap = indefinite;
+        remaining = argument;
+    }
+
+    if (indefiniteMap) {
+        if (pos < end && *pos == CBOR_BREAK) {
+            finished = true;
+            return false;
+        }
+    } else if (remaining == 0) {
+        finished = true;
+        return false;
+    } else {
+        remaining--;
+    }
+
+    // Key: unsigned FieldId or text
+    if (!readHead(major, argument, indefinite)) {
+        error = true;
+        return false;
+    }
+    field = CborField();
+    if (major == 0) {
+        field.keyIsId = true;
+        field.keyId = argument;
+    } else if (major == 3 && argument <= static_cast<uint64_t>(end - pos)) {
+        field.key = reinterpret_cast<const char*>(pos);
+        field.keyLength = static_cast<size_t>(argument);
+        pos += argument;
+    } else {
+        error = true;
+        return false;
+    }
+
+    // Value: scalars are decoded, containers skipped
+    const uint8_t* valueStart = pos;
+    if (!readHead(major, argument, indefinite)) {
+        error = true;
+        return false;
+    }
+    field.number = argument;
+    switch (major) {
+        case 0: field.type = CborValueType::unsignedInt; break;
+        case 1: field.type = CborValueType::negativeInt; break;
+        case 2:
+        case 3:
+            if (argument > static_cast<uint64_t>(end - pos)) {
+                error = true;
+                return false;
+            }
+            field.type = major == 2 ? CborValueType::bytes : CborValueType::text;
+            field.value = pos;
+            field.valueLength = static_cast<size_t>(argument);
+            pos += argument;
+            break;
+        case 7:
+            field.type = argument >= 20 && argument <= 23 ? CborValueType::simple : CborValueType::floating;
+            break;
+        default:
+            // Arrays, maps and tags: rewind and skip the whole item
+            pos = valueStart;
+            field.type = major == 5 ? CborValueType::map : CborValueType::array;
+            if (!skipItem(1)) {
+                error = true;
+                return false;
+            }
+            break;
+    }
+    return true;
+}
@@ -0,0 +1,160 @@
+#include "command.h"
+#include <string.h>
+#include "cbor_reader.h"
+#include "json_scanner.h"
+
+// "relock_s": 0 turns auto-relock off for this command
+static bool setRelock(uint64_t seconds, SesameCommand& command) {
+    if (seconds > COMMAND_MAX_DELAY_S) return false;
+    command.relockS = seconds == 0 ? COMMAND_RELOCK_NEVER : static_cast<uint32_t>(seconds);
+    return true;
+}
+
+// CBOR commands use the same fields, keyed by FieldId or by name; the
+// action may also be given as its CommandAction number
+static CommandParseResult parseCommandCbor(const uint8_t* payload, size_t length, SesameCommand& command) {
+    bool haveAction = false;
+    CborMapScanner scanner(payload, length);
+    CborField field;
+
+    while (scanner.next(field)) {
+        if (field.keyEquals(FieldId::action)) {
+            haveAction = true;
+            if (field.type == CborValueType::text) {
+                command.action = parseCommandAction(reinterpret_cast<const char*>(field.value), field.valueLength);
+            } else if (field.type == CborValueType::unsignedInt &&
+                       field.number <= static_cast<uint64_t>(CommandAction::status)) {
+                command.action = static_cast<CommandAction>(field.number);
+            } else {
+                return CommandParseResult::malformed;
+            }
+        } else if (field.keyEquals(FieldId::target)) {
+            if (!field.copyText(command.target, sizeof(command.target))) {
+                return CommandParseResult::fieldTooLong;
+            }
+        } else if (field.keyEquals(FieldId::requestId)) {
+            if (!field.copyText(command.requestId, sizeof(command.requestId))) {
+                return CommandParseResult::fieldTooLong;
+            }
+        } else if (field.keyEquals(FieldId::delayS)) {
+            if (field.type != CborValueType::unsignedInt || field.number > COMMAND_MAX_DELAY_S) {
+                return CommandParseResult::invalidValue;
+            }
+            command.delayS = static_cast<uint32_t>(field.number);
+        } else if (field.keyEquals(FieldId::relockS)) {
+            if (field.type != CborValueType::unsignedInt || !setRelock(field.number, command)) {
+                return CommandParseResult::invalidValue;
+            }
+        }
+    }
+
+    if (scanner.failed()) return CommandParseResult::malformed;
+    if (!haveAction) return CommandParseResult::missingAction;
+    if (command.action == CommandAction::none) return CommandParseResult::unknownAction;
+    return CommandParseResult::ok;
+}
+
+CommandParseResult parseCommandPayload(const char* payload, size_t length, SesameCommand& command) {
+    command.action = CommandAction::none;
+    command.target[0] = '\0';
+    command.requestId[0] = '\0';
+    command.delayS = 0;
+    command.relockS = 0;
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(payload);
+    if (detectPayloadFormat(bytes, length) == PayloadFormat::cbor) {
+        return parseCommandCbor(bytes, length, command);
+    }
+
+    bool haveAction = false;
+    JsonObjectScanner scanner(payload, length);
+    JsonField field;
+
+    while (scanner.next(field)) {
+        if (field.keyEquals("action")) {
+            if (field.type != JsonValueType::string) {
+                return CommandParseResult::malformed;
+            }
+            haveAction = true;
+            command.action = parseCommandAction(field.value, field.valueLength);
+        } else if (field.keyEquals("target")) {
+            if (!field.copyString(command.target, sizeof(command.target))) {
+                return CommandParseResult::fieldTooLong;
+            }
+        } else if (field.keyEquals("request_id")) {
+            if (!field.copyString(command.requestId, sizeof(command.requestId))) {
+                return CommandParseResult::fieldTooLong;
+            }
+        } else if (field.keyEquals("delay_s")) {
+            long seconds;
+            if (!field.toLong(seconds) || seconds < 0 || seconds > COMMAND_MAX_DELAY_S) {
+                return CommandParseResult::invalidValue;
+            }
+            command.delayS = static_cast<uint32_t>(seconds);
+        } else if (field.keyEquals("relock_s")) {
+            long seconds;
+            if (!field.toLong(seconds) || seconds < 0 || !setRelock(static_cast<uint64_t>(seconds), command)) {
+                return CommandParseResult::invalidValue;
+            }
+        }
+        // Other fields (e.g. "tag") are accepted and ignored
+    }
+
+    if (scanner.failed()) return CommandParseResult::malformed;
+    if (!haveAction) return CommandParseResult::missingAction;
+    if (command.action == CommandAction::none) return CommandParseResult::unknownAction;
+    return CommandParseResult::ok;
+}
+
+const char* commandParseResultName(CommandParseResult result) {
+    switch (result) {
+        case CommandParseResult::ok: return "ok";
+        case CommandParseResult::malformed: return "malformed payload";
+        case CommandParseResult::missingAction: return "missing action";
+        case CommandParseResult::unknownAction: return "unknown action";
+        case CommandParseResult::fieldTooLong: return "field too long";
+        case CommandParseResult::invalidValue: return "invalid value";
+        default: return "error";
+    }
+}
+
+CommandAction parseCommandAction(const char* text, size_t length) {
+    struct ActionName {
+        const char* name;
+        CommandAction action;
+    };
+    static const ActionName actions[] = {
+        {"unlock", CommandAction::unlock},
+        {"lock", CommandAction::lock},
+        {"toggle", CommandAction::toggle},
+        {"status", CommandAction::status},
+    };
+
+    for (const ActionName& entry : actions) {
+        if (strlen(entry.name) == length && memcmp(entry.name, text, length) == 0) {
+            return entry.action;
+        }
+    }
+    return CommandAction::none;
+}
+
+const char* commandActionName(CommandAction action) {
+    switch (action) {
+        case CommandAction::lock: return "lock";
+        case CommandAction::unlock: return "unlock";
+        case CommandAction::toggle: return "toggle";
+        case CommandAction::status: return "status";
+        default: return "none";
+    }
+}
+
+const char* commandSourceName(CommandSource source) {
+    switch (source) {
+        case CommandSource::mqtt: return "mqtt";
+        case CommandSource::rxb6: return "rxb6";
+        case CommandSource::autotest: return "autotest";
+        case CommandSource::lan: return "lan";
+        case CommandSource::timer: return "timer";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,134 @@
+#include "command_queue.h"
+
+const char* commandOutcomeName(CommandOutcome outcome) {
+    switch (outcome) {
+        case CommandOutcome::confirmed: return "confirmed";
+        case CommandOutcome::timeout: return "timeout";
+        case CommandOutcome::superseded: return "superseded";
+        case CommandOutcome::duplicate: return "duplicate";
+        case CommandOutcome::expired: return "expired";
+    }
+    return "unknown";
+}
+
+CommandQueue::CommandQueue(uint32_t dedupWindowMs, uint32_t confirmTimeoutMs, uint32_t maxQueuedMs)
+    : dedupWindowMs(dedupWindowMs), confirmTimeoutMs(confirmTimeoutMs), maxQueuedMs(maxQueuedMs),
+      queued(), inFlight(), lastConfirmed(CommandAction::none), lastConfirmedMs(0),
+      results(), resultCount(0), resultOverflows(0) {}
+
+void CommandQueue::addResult(const SesameCommand& command, CommandOutcome outcome, uint32_t elapsedMs,
+                             uint32_t confirmUs) {
+    if (resultCount >= COMMAND_RESULT_SLOTS) {
+        resultOverflows++;
+        return;
+    }
+    results[resultCount].command = command;
+    results[resultCount].outcome = outcome;
+    results[resultCount].elapsedMs = elapsedMs;
+    results[resultCount].confirmUs = confirmUs;
+    resultCount++;
+}
+
+void CommandQueue::finish(Slot& slot, CommandOutcome outcome, uint32_t nowMs, uint32_t confirmUs) {
+    addResult(slot.command, outcome, nowMs - slot.queuedMs, confirmUs);
+    slot.active = false;
+}
+
+bool CommandQueue::push(const SesameCommand& command, uint32_t nowMs) {
+    // Compare against what the lock will do next, else what it just did
+    bool duplicate;
+    if (queued.active) {
+        duplicate = queued.command.action == command.action;
+    } else if (inFlight.active) {
+        duplicate = inFlight.command.action == command.action;
+    } else {
+        duplicate = lastConfirmed == command.action && nowMs - lastConfirmedMs < dedupWindowMs;
+    }
+
+    if (duplicate) {
+        addResult(command, CommandOutcome::duplicate, 0);
+        return false;
+    }
+
+    if (queued.active) {
+        finish(queued, CommandOutcome::superseded, nowMs);
+
+        // lock (in flight) -> unlock -> lock: with the unlock gone the new
+        // command repeats the one already on its way
+        if (inFlight.active && inFlight.command.action == command.action) {
+            addResult(command, CommandOutcome::duplicate, 0);
+            return false;
+        }
+    }
+
+    queued.active = true;
+    queued.command = command;
+    queued.queuedMs = nowMs;
+    queued.sentMs = 0;
+    return true;
+}
+
+bool CommandQueue::next(uint32_t nowMs, uint32_t nowUs, SesameCommand& out) {
+    if (inFlight.active || !queued.active) {
+        return false;
+    }
+
+    inFlight = queued;
+    inFlight.sentMs = nowMs;
+    inFlight.command.dispatchUs = nowUs;
+    queued.active = false;
+    out = inFlight.command;
+    return true;
+}
+
+void CommandQueue::statusUpdate(bool locked, bool unlocked, uint32_t nowMs, uint32_t statusUs) {
+    if (!inFlight.active) {
+        return;
+    }
+
+    CommandAction action = inFlight.command.action;
+    if ((action == CommandAction::lock && locked) || (action == CommandAction::unlock && unlocked)) {
+        finish(inFlight, CommandOutcome::confirmed, nowMs, statusUs);
+        lastConfirmed = action;
+        lastConfirmedMs = nowMs;
+    }
+}
+
+void CommandQueue::expire(uint32_t nowMs) {
+    if (inFlight.active && nowMs - inFlight.sentMs >= confirmTimeoutMs) {
+        finish(inFlight, CommandOutcome::timeout, nowMs);
+    }
+    if (queued.active && nowMs - queued.queuedMs >= maxQueuedMs) {
+        finish(queued, CommandOutcome::expired, nowMs);
+    }
+}
+
+uint32_t CommandQueue::msUntilNextDeadline(uint32_t nowMs) const {
+    uint32_t earliest = UINT32_MAX;
+    if (inFlight.active) {
+        uint32_t elapsed = nowMs - inFlight.sentMs;
+        earliest = elapsed >= confirmTimeoutMs ? 0 : confirmTimeoutMs - elapsed;
+    }
+    if (queued.active) {
+        uint32_t elapsed = nowMs - queued.queuedMs;
+        uint32_t wait = elapsed >= maxQueuedMs ? 0 : maxQueuedMs - elapsed;
+        if (wait < earliest) {
+            earliest = wait;
+        }
+    }
+    return earliest;
+}
+
+bool CommandQueue::takeResult(CommandResult& out) {
+    if (resultCount == 0) {
+        return false;
+    }
+
+    out = results[0];
+    for (size_t i = 1; i < resultCount; i++) {
+        results[i - 1] = results[i];
+    }
+    resultCount--;
+    return true;
+}
+
@@ -0,0 +1,261 @@
+#include "config_store.h"
+#include <Preferences.h>
+#include <atomic>
+#include "cbor_reader.h"
+#include "config.h"
+#include "json_scanner.h"
+#include "log.h"
+
+// Layout version of the NVS overlay: bump when a setting changes meaning or
+// units, and overrides written by an older firmware are dropped at boot
+static const uint32_t CONFIG_STORE_VERSION = 1;
+
+struct ConfigSetting {
+    FieldId field;          // JSON name / CBOR key
+    const char* nvsKey;     // at most 15 characters
+    uint32_t defaultValue;
+    uint32_t minValue;
+    uint32_t maxValue;
+};
+
+// Indexed by ConfigKey
+static const ConfigSetting settings[] = {
+    {FieldId::rxb6SignalTimeoutMs, "rxb6_timeout", RXB6_SIGNAL_TIMEOUT, 0, 10000},
+    {FieldId::connectTimeoutMs, "conn_timeout", SESAME_CONNECT_TIMEOUT_MS, 1000, SESAME_CONNECT_TIMEOUT_MAX_MS},
+    {FieldId::keepaliveMs, "keepalive", SESAME_KEEPALIVE_INTERVAL_MS, 10000, 3600000},
+    {FieldId::idleDisconnectMs, "idle_disc", SESAME_IDLE_DISCONNECT_MS, 1000, 3600000},
+    {FieldId::bleMtu, "mtu", BLE_MTU, 23, 517},
+    {FieldId::connIntervalMin, "itvl_min", BLE_CONN_INTERVAL_MIN, 6, 3200},
+    {FieldId::connIntervalMax, "itvl_max", BLE_CONN_INTERVAL_MAX, 6, 3200},
+    {FieldId::connLatency, "conn_latency", BLE_CONN_LATENCY, 0, 499},
+    {FieldId::supervisionTimeout, "sup_timeout", BLE_SUPERVISION_TIMEOUT, 10, 3200},
+    {FieldId::latencyBudgetMs, "pwr_budget", POWER_LATENCY_BUDGET_MS, 0, 10000},
+    {FieldId::activeHoldMs, "pwr_hold", POWER_ACTIVE_HOLD_MS, 0, 3600000},
+};
+
+static const size_t settingCount = static_cast<size_t>(ConfigKey::count);
+
+static_assert(sizeof(settings) / sizeof(settings[0]) == settingCount, "settings must list every ConfigKey");
+static_assert(settingCount <= 32, "overrides are tracked in a 32-bit mask");
+
+static std::atomic<uint32_t> values[settingCount];
+static std::atomic<uint32_t> overrides{0};
+
+static size_t index(ConfigKey key) {
+    return static_cast<size_t>(key);
+}
+
+uint32_t configValue(ConfigKey key) {
+    return values[index(key)];
+}
+
+bool configOverridden(ConfigKey key) {
+    return (overrides & (1u << index(key))) != 0;
+}
+
+static bool inRange(size_t setting, uint64_t value) {
+    return value >= settings[setting].minValue && value <= settings[setting].maxValue;
+}
+
+// Rules between settings; returns the setting to blame, or settingCount if consistent
+static size_t checkConsistency(const uint32_t* candidate) {
+    size_t intervalMin = index(ConfigKey::connIntervalMin);
+    size_t intervalMax = index(ConfigKey::connIntervalMax);
+    size_t latency = index(ConfigKey::connLatency);
+    size_t timeout = index(ConfigKey::supervisionTimeout);
+
+    if (candidate[intervalMin] > candidate[intervalMax]) {
+        return intervalMax;
+    }
+
+    // Bluetooth Core spec: timeout (10 ms units) > (1 + latency) * max interval (1.25 ms units) * 2
+    if (static_cast<uint64_t>(candidate[timeout]) * 4 <=
+        (1 + static_cast<uint64_t>(candidate[latency])) * candidate[intervalMax]) {
+        return timeout;
+    }
+    return settingCount;
+}
+
+void beginConfigStore() {
+    uint32_t loaded[settingCount];
+    uint32_t loadedOverrides = 0;
+    for (size_t i = 0; i < settingCount; i++) {
+        loaded[i] = settings[i].defaultValue;
+    }
+
+    Preferences preferences;
+    if (preferences.begin(CONFIG_STORE_NAMESPACE, false)) {
+        if (preferences.getUInt("version", CONFIG_STORE_VERSION) != CONFIG_STORE_VERSION) {
+            LOG_INFO("⚙️ Config overrides from an older firmware - back to defaults\n");
+            preferences.clear();
+        }
+        preferences.putUInt("version", CONFIG_STORE_VERSION);
+
+        for (size_t i = 0; i < settingCount; i++) {
+            if (!preferences.isKey(settings[i].nvsKey)) continue;
+            uint32_t value = preferences.getUInt(settings[i].nvsKey, settings[i].defaultValue);
+            if (inRange(i, value)) {
+                loaded[i] = value;
+                loadedOverrides |= 1u << i;
+            }
+        }
+        preferences.end();
+    }
+
+    if (checkConsistency(loaded) != settingCount) {
+        LOG_WARN("⚠️ Stored config is inconsistent - using defaults\n");
+        for (size_t i = 0; i < settingCount; i++) {
+            loaded[i] = settings[i].defaultValue;
+        }
+        loadedOverrides = 0;
+    }
+
+    for (size_t i = 0; i < settingCount; i++) {
+        values[i] = loaded[i];
+    }
+    overrides = loadedOverrides;
+
+    if (loadedOverrides != 0) {
+        LOG_INFO("⚙️ Config: %u setting(s) overridden from NVS\n",
+                 static_cast<unsigned>(__builtin_popcount(loadedOverrides)));
+    }
+}
+
+static size_t findSetting(const JsonField& field) {
+    for (size_t i = 0; i < settingCount; i++) {
+        if (field.keyEquals(fieldName(settings[i].field))) return i;
+    }
+    return settingCount;
+}
+
+static size_t findSetting(const CborField& field) {
+    for (size_t i = 0; i < settingCount; i++) {
+        if (field.keyEquals(settings[i].field)) return i;
+    }
+    return settingCount;
+}
+
+// Stage one field: a new value, or the default for null
+static ConfigSetResult stage(size_t setting, bool isNull, bool isNumber, uint64_t value,
+                             uint32_t* candidate, uint32_t& touched, uint32_t& reset) {
+    if (isNull) {
+        candidate[setting] = settings[setting].defaultValue;
+        reset |= 1u << setting;
+    } else if (isNumber && inRange(setting, value)) {
+        candidate[setting] = static_cast<uint32_t>(value);
+        reset &= ~(1u << setting);
+    } else {
+        return ConfigSetResult::invalidValue;
+    }
+    touched |= 1u << setting;
+    return ConfigSetResult::ok;
+}
+
+static ConfigSetResult parseJson(const char* payload, size_t length, uint32_t* candidate,
+                                 uint32_t& touched, uint32_t& reset, FieldId& rejected) {
+    JsonObjectScanner scanner(payload, length);
+    JsonField field;
+    while (scanner.next(field)) {
+        size_t setting = findSetting(field);
+        if (setting == settingCount) return ConfigSetResult::unknownKey;
+        rejected = settings[setting].field;
+
+        long value = 0;
+        bool isNumber = field.toLong(value) && value >= 0;
+        ConfigSetResult result = stage(setting, field.type == JsonValueType::null, isNumber,
+                                       static_cast<uint64_t>(value), candidate, touched, reset);
+        if (result != ConfigSetResult::ok) return result;
+    }
+    return scanner.failed() ? ConfigSetResult::malformed : ConfigSetResult::ok;
+}
+
+static ConfigSetResult parseCbor(const uint8_t* payload, size_t length, uint32_t* candidate,
+                                 uint32_t& touched, uint32_t& reset, FieldId& rejected) {
+    static const uint64_t CBOR_SIMPLE_NULL = 22;
+
+    CborMapScanner scanner(payload, length);
+    CborField field;
+    while (scanner.next(field)) {
+        size_t setting = findSetting(field);
+        if (setting == settingCount) return ConfigSetResult::unknownKey;
+        rejected = settings[setting].field;
+
+        bool isNull = field.type == CborValueType::simple && field.number == CBOR_SIMPLE_NULL;
+        ConfigSetResult result = stage(setting, isNull, field.type == CborValueType::unsignedInt, field.number,
+                                       candidate, touched, reset);
+        if (result != ConfigSetResult::ok) return result;
+    }
+    return scanner.failed() ? ConfigSetResult::malformed : ConfigSetResult::ok;
+}
+
+ConfigSetResult applyConfigPayload(const uint8_t* payload, size_t length, FieldId& rejected) {
+    uint32_t candidate[settingCount];
+    for (size_t i = 0; i < settingCount; i++) {
+        candidate[i] = values[i];
+    }
+
+    uint32_t touched = 0;
+    uint32_t reset = 0;
+    rejected = FieldId::last;
+    ConfigSetResult result =
+        detectPayloadFormat(payload, length) == PayloadFormat::cbor
+            ? parseCbor(payload, length, candidate, touched, reset, rejected)
+            : parseJson(reinterpret_cast<const char*>(payload), length, candidate, touched, reset, rejected);
+    if (result != ConfigSetResult::ok) {
+        return result;
+    }
+
+    size_t inconsistent = checkConsistency(candidate);
+    if (inconsistent != settingCount) {
+        rejected = settings[inconsistent].field;
+        return ConfigSetResult::invalidValue;
+    }
+    rejected = FieldId::last;
+
+    // Persist first, so the running values never differ from what the next boot loads
+    Preferences preferences;
+    if (!preferences.begin(CONFIG_STORE_NAMESPACE, false)) {
+        return ConfigSetResult::storageFailed;
+    }
+    uint32_t newOverrides = overrides;
+    bool stored = true;
+    for (size_t i = 0; i < settingCount; i++) {
+        if ((touched & (1u << i)) == 0) continue;
+        if (reset & (1u << i)) {
+            if (preferences.isKey(settings[i].nvsKey)) {
+                stored = preferences.remove(settings[i].nvsKey) && stored;
+            }
+            newOverrides &= ~(1u << i);
+        } else {
+            stored = preferences.putUInt(settings[i].nvsKey, candidate[i]) == sizeof(uint32_t) && stored;
+            newOverrides |= 1u << i;
+        }
+    }
+    preferences.end();
+    if (!stored) {
+        return ConfigSetResult::storageFailed;
+    }
+
+    for (size_t i = 0; i < settingCount; i++) {
+        values[i] = candidate[i];
+    }
+    overrides = newOverrides;
+    return ConfigSetResult::ok;
+}
+
+void writeConfig(EventWriter& event) {
+    for (size_t i = 0; i < settingCount; i++) {
+        event.add(settings[i].field, static_cast<uint32_t>(values[i]));
+    }
+}
+
+const char* configSetResultName(ConfigSetResult result) {
+    switch (result) {
+        case ConfigSetResult::ok: return "ok";
+        case ConfigSetResult::malformed: return "malformed payload";
+        case ConfigSetResult::unknownKey: return "unknown key";
+        case ConfigSetResult::invalidValue: return "invalid value";
+        case ConfigSetResult::storageFailed: return "storage failed";
+        default: return "error";
+    }
+}
@@ -0,0 +1,94 @@
+#include "connection_scheduler.h"
+
+ConnectionScheduler::ConnectionScheduler(size_t maxSessions, uint32_t sliceMs)
+    : maxSessions(maxSessions == 0 ? 1 : maxSessions), sliceMs(sliceMs), cursor(0) {}
+
+bool ConnectionScheduler::waiting(const LockSchedule& lock, uint32_t nowMs) const {
+    return !lock.connected && !lock.disabled && (!lock.onDemand || lock.pendingWork) &&
+           static_cast<int32_t>(nowMs - lock.retryAtMs) >= 0;
+}
+
+int ConnectionScheduler::nextToConnect(const LockSchedule* locks, size_t count, uint32_t nowMs) {
+    size_t sessions = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (locks[i].connected) sessions++;
+    }
+    if (sessions >= maxSessions) {
+        return -1;
+    }
+
+    // Two passes from the round-robin cursor: locks with work first, then any
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t n = 0; n < count; n++) {
+            size_t i = (cursor + n) % count;
+            if (!waiting(locks[i], nowMs)) continue;
+            if (pass == 0 && !locks[i].pendingWork) continue;
+
+            cursor = (i + 1) % count;
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int ConnectionScheduler::sessionToRelease(const LockSchedule* locks, size_t count, uint32_t nowMs) const {
+    size_t sessions = 0;
+    bool workWaiting = false;
+    bool anyWaiting = false;
+    for (size_t i = 0; i < count; i++) {
+        if (locks[i].connected) {
+            sessions++;
+        } else if (waiting(locks[i], nowMs)) {
+            anyWaiting = true;
+            workWaiting = workWaiting || locks[i].pendingWork;
+        }
+    }
+    if (sessions < maxSessions || !anyWaiting) {
+        return -1;
+    }
+
+    // Release the least recently used session that has nothing in progress;
+    // without urgent work only sessions past their time slice are eligible
+    int candidate = -1;
+    for (size_t i = 0; i < count; i++) {
+        const LockSchedule& lock = locks[i];
+        if (!lock.connected || lock.pendingWork) continue;
+        if (!workWaiting && nowMs - lock.sessionStartedMs < sliceMs) continue;
+        if (candidate < 0 || static_cast<int32_t>(lock.lastUsedMs - locks[candidate].lastUsedMs) < 0) {
+            candidate = static_cast<int>(i);
+        }
+    }
+    return candidate;
+}
+
+uint32_t ConnectionScheduler::msUntilNextDecision(const LockSchedule* locks, size_t count, uint32_t nowMs) const {
+    size_t sessions = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (locks[i].connected) sessions++;
+    }
+
+    uint32_t wait = UINT32_MAX;
+    for (size_t i = 0; i < count; i++) {
+        const LockSchedule& lock = locks[i];
+        int32_t remaining;
+        if (lock.disabled || (lock.onDemand && !lock.connected && !lock.pendingWork)) {
+            continue;
+        } else if (!lock.connected) {
+            remaining = static_cast<int32_t>(lock.retryAtMs - nowMs);
+            // Due but no free slot: the next decision comes from a slice expiring
+            if (remaining <= 0 && sessions >= maxSessions) continue;
+        } else if (count > maxSessions) {
+            remaining = static_cast<int32_t>(lock.sessionStartedMs + sliceMs - nowMs);
+            // Slices that already expired are re-checked on the next event
+            if (remaining <= 0) continue;
+        } else {
+            continue;
+        }
+
+        uint32_t lockWait = remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+        if (lockWait < wait) {
+            wait = lockWait;
+        }
+    }
+    return wait;
+}
@@ -0,0 +1,113 @@
+#include "device_table.h"
+#include <string.h>
+#include "sesame_advert.h"
+
+static_assert((DEVICE_TABLE_CAPACITY & (DEVICE_TABLE_CAPACITY - 1)) == 0, "device table capacity must be a power of two");
+
+static const size_t MASK = DEVICE_TABLE_CAPACITY - 1;
+static const int RSSI_EMA_SHIFT = 2;
+static const uint16_t SESAME_SERVICE_UUID16 = 0xFD81;
+
+DeviceTable::DeviceTable() : entries(), used(0) {}
+
+size_t DeviceTable::slotFor(uint64_t address) {
+    return static_cast<size_t>((address * 0x9E3779B97F4A7C15ULL) >> 40) & MASK;
+}
+
+DeviceEntry* DeviceTable::find(uint64_t address) {
+    for (size_t i = slotFor(address);; i = (i + 1) & MASK) {
+        if (!entries[i].used) return nullptr;
+        if (entries[i].address == address) return &entries[i];
+    }
+}
+
+DeviceEntry* DeviceTable::insert(uint64_t address, bool& created) {
+    created = false;
+    size_t i = slotFor(address);
+    for (;; i = (i + 1) & MASK) {
+        if (!entries[i].used) break;
+        if (entries[i].address == address) return &entries[i];
+    }
+    if (used >= DEVICE_TABLE_MAX_DEVICES) {
+        return nullptr;
+    }
+    entries[i] = DeviceEntry();
+    entries[i].used = true;
+    entries[i].address = address;
+    used++;
+    created = true;
+    return &entries[i];
+}
+
+void DeviceTable::remove(size_t slot) {
+    entries[slot].used = false;
+    used--;
+
+    // Pull later members of the probe run back over the hole
+    size_t hole = slot;
+    for (size_t i = (slot + 1) & MASK; entries[i].used; i = (i + 1) & MASK) {
+        size_t home = slotFor(entries[i].address);
+        bool movable = hole <= i ? (home <= hole || home > i) : (home <= hole && home > i);
+        if (movable) {
+            entries[hole] = entries[i];
+            entries[i].used = false;
+            hole = i;
+        }
+    }
+}
+
+// Walk the AD structures of a payload; false on a malformed length
+template <typename Visit>
+static bool forEachField(const uint8_t* payload, size_t length, Visit visit) {
+    size_t offset = 0;
+    while (offset < length && payload[offset] != 0) {
+        uint8_t fieldLength = payload[offset];
+        if (offset + 1 + fieldLength > length) return false;
+        visit(payload[offset + 1], payload + offset + 2, static_cast<size_t>(fieldLength - 1));
+        offset += 1 + fieldLength;
+    }
+    return true;
+}
+
+void updateDevice(DeviceEntry& entry, const uint8_t* payload, size_t length, uint8_t addressType,
+                  int8_t rssi, uint32_t nowMs) {
+    entry.addressType = addressType;
+    entry.lastRssi = rssi;
+    int16_t sample = static_cast<int16_t>(rssi * (1 << DEVICE_RSSI_SHIFT));
+    entry.rssiAvg = entry.count == 0 ? sample : static_cast<int16_t>(entry.rssiAvg + ((sample - entry.rssiAvg) >> RSSI_EMA_SHIFT));
+    entry.count++;
+    entry.lastSeenMs = nowMs;
+    if (entry.count == 1) {
+        entry.firstSeenMs = nowMs;
+    }
+
+    forEachField(payload, length, [&entry](uint8_t type, const uint8_t* data, size_t fieldLength) {
+        switch (type) {
+            case 0x08:    // shortened local name
+            case 0x09: {  // complete local name
+                size_t n = fieldLength < DEVICE_NAME_MAX ? fieldLength : DEVICE_NAME_MAX;
+                memcpy(entry.name, data, n);
+                entry.name[n] = '\0';
+                break;
+            }
+            case 0x02:    // incomplete / complete 16-bit service UUID lists
+            case 0x03:
+                for (size_t i = 0; i + 1 < fieldLength; i += 2) {
+                    if ((data[i] | (data[i + 1] << 8)) == SESAME_SERVICE_UUID16) entry.sesame = true;
+                }
+                break;
+            case 0xFF: {  // manufacturer data
+                size_t n = fieldLength < DEVICE_MANUFACTURER_MAX ? fieldLength : DEVICE_MANUFACTURER_MAX;
+                memcpy(entry.manufacturer, data, n);
+                entry.manufacturerLength = static_cast<uint8_t>(n);
+
+                SesameAdvert advert;
+                if (decodeSesameManufacturerData(data, fieldLength, advert)) {
+                    entry.sesame = true;
+                    entry.model = advert.model;
+                }
+                break;
+            }
+        }
+    });
+}
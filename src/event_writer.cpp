@@ -0,0 +1,323 @@
+#include "event_writer.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Indexed by FieldId; keep in step with the enum
+static const char* const fieldNames[] = {
+    "",
+    "lock", "device", "address", "wifi_connected", "mqtt_connected",
+    "sesame_connected", "sesame_authenticated", "battery_pct", "voltage", "position",
+    "locked", "unlocked", "rssi", "advert_age_ms", "request_id",
+    "result", "elapsed_ms", "action", "source", "trigger",
+    "reason", "timestamp", "window_ms", "count", "p50_us",
+    "p95_us", "p99_us", "max_us", "queue", "ble",
+    "total", "reconnect", "entries", "time", "type",
+    "tag", "signal", "code", "bits", "protocol",
+    "accepted", "target", "pin", "age_ms", "live",
+    "replayed", "buffered", "spilled", "dropped", "backlog",
+    "ram_high_water", "spill_high_water", "queue_high_water", "reset_reason", "ble_ms",
+    "wifi_ms", "mqtt_ms", "state_ms", "session_ms", "first_command_ms",
+    "state_restored", "delay_s", "relock_s", "relock_in_ms", "sections",
+    "section", "mean_us", "stalls", "worst_section", "worst_us",
+    "feed_gap_task", "max_feed_gap_ms", "free_heap", "min_free_heap", "largest_free_block",
+    "fragmentation_pct", "stacks", "task", "stack_free", "predicted",
+    "state_mismatch", "mismatches", "rxb6_signal_timeout_ms", "connect_timeout_ms", "keepalive_ms",
+    "idle_disconnect_ms", "ble_mtu", "conn_interval_min", "conn_interval_max", "conn_latency",
+    "supervision_timeout", "latency_budget_ms", "active_hold_ms", "ble_event_drops",
+    "skipped",
+};
+
+static_assert(sizeof(fieldNames) / sizeof(fieldNames[0]) == static_cast<size_t>(FieldId::last),
+              "fieldNames must list every FieldId");
+
+// CBOR initial bytes
+static const uint8_t CBOR_MAP_INDEFINITE = 0xBF;
+static const uint8_t CBOR_ARRAY_INDEFINITE = 0x9F;
+static const uint8_t CBOR_BREAK = 0xFF;
+static const uint8_t CBOR_FALSE = 0xF4;
+static const uint8_t CBOR_TRUE = 0xF5;
+static const uint8_t CBOR_NULL = 0xF6;
+static const uint8_t CBOR_FLOAT32 = 0xFA;
+
+const char* fieldName(FieldId id) {
+    size_t index = static_cast<size_t>(id);
+    return index < sizeof(fieldNames) / sizeof(fieldNames[0]) ? fieldNames[index] : "";
+}
+
+// Major type and argument, big endian, in the shortest form; returns the length
+static size_t encodeCborHead(uint8_t* out, uint8_t major, uint64_t value) {
+    uint8_t type = static_cast<uint8_t>(major << 5);
+    size_t bytes;
+    if (value < 24) {
+        out[0] = static_cast<uint8_t>(type | value);
+        return 1;
+    } else if (value <= 0xFF) {
+        out[0] = type | 24;
+        bytes = 1;
+    } else if (value <= 0xFFFF) {
+        out[0] = type | 25;
+        bytes = 2;
+    } else if (value <= 0xFFFFFFFFULL) {
+        out[0] = type | 26;
+        bytes = 4;
+    } else {
+        out[0] = type | 27;
+        bytes = 8;
+    }
+    for (size_t i = 0; i < bytes; i++) {
+        out[1 + i] = static_cast<uint8_t>(value >> (8 * (bytes - 1 - i)));
+    }
+    return 1 + bytes;
+}
+
+EventWriter::EventWriter(PayloadFormat format, uint8_t* buffer, size_t size)
+    : encoding(format), buffer(buffer), size(size), used(0), overflow(false), depth(0) {
+    firstInLevel[0] = true;
+    put(encoding == PayloadFormat::json ? '{' : CBOR_MAP_INDEFINITE);
+}
+
+void EventWriter::put(uint8_t byte) {
+    put(&byte, 1);
+}
+
+void EventWriter::put(const void* data, size_t length) {
+    if (overflow || length > size - used) {
+        overflow = true;
+        return;
+    }
+    memcpy(buffer + used, data, length);
+    used += length;
+}
+
+void EventWriter::separator() {
+    if (encoding == PayloadFormat::json && !firstInLevel[depth]) {
+        put(',');
+    }
+    firstInLevel[depth] = false;
+}
+
+void EventWriter::key(FieldId id) {
+    separator();
+    if (encoding == PayloadFormat::cbor) {
+        writeCborHead(0, static_cast<uint8_t>(id));
+        return;
+    }
+    const char* name = fieldName(id);
+    put('"');
+    put(name, strlen(name));
+    put('"');
+    put(':');
+}
+
+void EventWriter::writeCborHead(uint8_t major, uint64_t value) {
+    uint8_t head[9];
+    put(head, encodeCborHead(head, major, value));
+}
+
+void EventWriter::writeSigned(int64_t value) {
+    if (encoding == PayloadFormat::cbor) {
+        if (value >= 0) {
+            writeCborHead(0, static_cast<uint64_t>(value));
+        } else {
+            writeCborHead(1, static_cast<uint64_t>(-1 - value));
+        }
+        return;
+    }
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%lld", static_cast<long long>(value));
+    put(text, static_cast<size_t>(length));
+}
+
+void EventWriter::writeUnsigned(uint64_t value) {
+    if (encoding == PayloadFormat::cbor) {
+        writeCborHead(0, value);
+        return;
+    }
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+    put(text, static_cast<size_t>(length));
+}
+
+void EventWriter::writeJsonString(const char* value) {
+    put('"');
+    for (const char* c = value; *c != '\0'; c++) {
+        uint8_t ch = static_cast<uint8_t>(*c);
+        if (ch == '"' || ch == '\\') {
+            put('\\');
+            put(ch);
+        } else if (ch < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+            put(escaped, 6);
+        } else {
+            put(ch);
+        }
+    }
+    put('"');
+}
+
+void EventWriter::add(FieldId id, const char* value) {
+    key(id);
+    if (value == nullptr) {
+        if (encoding == PayloadFormat::cbor) {
+            put(CBOR_NULL);
+        } else {
+            put("null", 4);
+        }
+        return;
+    }
+    if (encoding == PayloadFormat::cbor) {
+        size_t length = strlen(value);
+        writeCborHead(3, length);
+        put(value, length);
+    } else {
+        writeJsonString(value);
+    }
+}
+
+void EventWriter::add(FieldId id, bool value) {
+    key(id);
+    if (encoding == PayloadFormat::cbor) {
+        put(value ? CBOR_TRUE : CBOR_FALSE);
+    } else if (value) {
+        put("true", 4);
+    } else {
+        put("false", 5);
+    }
+}
+
+void EventWriter::add(FieldId id, double value) {
+    key(id);
+    if (encoding == PayloadFormat::cbor) {
+        float single = static_cast<float>(value);
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        uint8_t encoded[5] = {CBOR_FLOAT32, static_cast<uint8_t>(bits >> 24), static_cast<uint8_t>(bits >> 16),
+                              static_cast<uint8_t>(bits >> 8), static_cast<uint8_t>(bits)};
+        put(encoded, sizeof(encoded));
+        return;
+    }
+    if (!isfinite(value)) {
+        put("null", 4);
+        return;
+    }
+    // Float precision is all the lock reports; 7 digits print 6.1f as "6.1"
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%.7g", value);
+    put(text, static_cast<size_t>(length));
+}
+
+void EventWriter::open(uint8_t jsonBracket, uint8_t cborHeader) {
+    if (depth >= EVENT_WRITER_MAX_DEPTH) {
+        overflow = true;
+        return;
+    }
+    put(encoding == PayloadFormat::json ? jsonBracket : cborHeader);
+    depth++;
+    firstInLevel[depth] = true;
+}
+
+void EventWriter::close(uint8_t jsonBracket) {
+    if (depth == 0) {
+        overflow = true;
+        return;
+    }
+    put(encoding == PayloadFormat::json ? jsonBracket : CBOR_BREAK);
+    depth--;
+}
+
+void EventWriter::beginObject(FieldId id) {
+    key(id);
+    open('{', CBOR_MAP_INDEFINITE);
+}
+
+void EventWriter::beginArray(FieldId id) {
+    key(id);
+    open('[', CBOR_ARRAY_INDEFINITE);
+}
+
+void EventWriter::beginArrayObject() {
+    separator();
+    open('{', CBOR_MAP_INDEFINITE);
+}
+
+void EventWriter::endObject() {
+    close('}');
+}
+
+void EventWriter::endArray() {
+    close(']');
+}
+
+bool EventWriter::finish() {
+    if (depth != 0) {
+        // Unbalanced begin/end: the payload would not parse
+        overflow = true;
+    }
+    put(encoding == PayloadFormat::json ? '}' : CBOR_BREAK);
+
+    // JSON payloads stay printable C strings
+    if (encoding == PayloadFormat::json && !overflow) {
+        if (used < size) {
+            buffer[used] = '\0';
+        } else {
+            overflow = true;
+        }
+    }
+    return !overflow;
+}
+
+PayloadFormat detectPayloadFormat(const uint8_t* payload, size_t length) {
+    // CBOR maps are major type 5 (0xA0-0xBF); JSON objects start with '{' or whitespace
+    if (length > 0 && (payload[0] & 0xE0) == 0xA0) {
+        return PayloadFormat::cbor;
+    }
+    return PayloadFormat::json;
+}
+
+size_t appendAgeMs(uint8_t* payload, size_t length, size_t size, uint32_t ageMs) {
+    if (length == 0) {
+        return length;
+    }
+
+    if (detectPayloadFormat(payload, length) == PayloadFormat::cbor) {
+        // Only indefinite-length maps, as EventWriter writes them, can grow in place
+        if (payload[0] != CBOR_MAP_INDEFINITE || payload[length - 1] != CBOR_BREAK) {
+            return length;
+        }
+        uint8_t field[16];
+        size_t n = encodeCborHead(field, 0, static_cast<uint8_t>(FieldId::ageMs));
+        n += encodeCborHead(field + n, 0, ageMs);
+        field[n++] = CBOR_BREAK;
+        if (length - 1 + n > size) {
+            return length;
+        }
+        memcpy(payload + length - 1, field, n);
+        return length - 1 + n;
+    }
+
+    size_t end = length;
+    while (end > 0 && payload[end - 1] != '}') {
+        end--;
+    }
+    if (end == 0) {
+        return length;
+    }
+    end--;
+
+    size_t before = end;
+    while (before > 0 && (payload[before - 1] == ' ' || payload[before - 1] == '\n')) {
+        before--;
+    }
+    bool empty = before > 0 && payload[before - 1] == '{';
+
+    char field[32];
+    int n = snprintf(field, sizeof(field), "%s\"age_ms\":%lu}", empty ? "" : ",", static_cast<unsigned long>(ageMs));
+    // Room for the terminator too, so JSON payloads stay C strings
+    if (n < 0 || end + static_cast<size_t>(n) + 1 > size) {
+        return length;
+    }
+    memcpy(payload + end, field, static_cast<size_t>(n) + 1);
+    return end + static_cast<size_t>(n);
+}
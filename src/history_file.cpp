@@ -0,0 +1,86 @@
+#include "history_file.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "log.h"
+
+HistoryFile::HistoryFile(const char* path, const char* tempPath, size_t maxBytes)
+    : path(path), tempPath(tempPath), maxBytes(maxBytes), mounted(false), fileSize(0) {}
+
+bool HistoryFile::begin(HistoryLog& log) {
+    mounted = LittleFS.begin(true);
+    if (!mounted) {
+        LOG_ERROR("❌ LittleFS mount failed - history kept in RAM only\n");
+        return false;
+    }
+
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return true;
+    }
+
+    // Only the newest HISTORY_LOG_SLOTS records fit in RAM; a torn tail is ignored
+    size_t records = file.size() / sizeof(HistoryEntry);
+    size_t first = records > HISTORY_LOG_SLOTS ? records - HISTORY_LOG_SLOTS : 0;
+    fileSize = records * sizeof(HistoryEntry);
+
+    HistoryEntry entry;
+    file.seek(first * sizeof(HistoryEntry));
+    for (size_t i = first; i < records; i++) {
+        if (file.read(reinterpret_cast<uint8_t*>(&entry), sizeof(entry)) != sizeof(entry)) break;
+        entry.tag[sizeof(entry.tag) - 1] = '\0';
+        // Published before the reboot, or at least not worth re-sending
+        entry.published = 1;
+        log.add(entry);
+    }
+    file.close();
+
+    LOG_INFO("📜 Loaded %u history entries from flash\n", static_cast<unsigned>(log.size()));
+    return true;
+}
+
+bool HistoryFile::append(const HistoryEntry& entry, const HistoryLog& log) {
+    if (!mounted) {
+        return false;
+    }
+    if (fileSize + sizeof(entry) > maxBytes) {
+        return compact(log);
+    }
+
+    File file = LittleFS.open(path, "a");
+    if (!file) {
+        return false;
+    }
+    bool written = file.write(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry)) == sizeof(entry);
+    file.close();
+    if (written) {
+        fileSize += sizeof(entry);
+    }
+    return written;
+}
+
+// Rewrite the file with the RAM ring, via a temporary file so a power loss
+// never leaves it empty
+bool HistoryFile::compact(const HistoryLog& log) {
+    File file = LittleFS.open(tempPath, "w");
+    if (!file) {
+        return false;
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < log.size(); i++) {
+        written += file.write(reinterpret_cast<const uint8_t*>(&log.at(i)), sizeof(HistoryEntry));
+    }
+    file.close();
+
+    if (written != log.size() * sizeof(HistoryEntry)) {
+        LittleFS.remove(tempPath);
+        return false;
+    }
+
+    LittleFS.remove(path);
+    if (!LittleFS.rename(tempPath, path)) {
+        return false;
+    }
+    fileSize = written;
+    return true;
+}
@@ -0,0 +1,71 @@
+#include "history_log.h"
+
+HistoryLog::HistoryLog() : entries(), start(0), count(0), unpublishedCount(0) {}
+
+const HistoryEntry& HistoryLog::at(size_t i) const {
+    return entries[(start + i) % HISTORY_LOG_SLOTS];
+}
+
+bool HistoryLog::contains(uint8_t lock, uint32_t time, uint8_t type) const {
+    // Newest first: repeats are almost always of the latest records
+    for (size_t i = count; i > 0; i--) {
+        const HistoryEntry& entry = at(i - 1);
+        if (entry.lock == lock && entry.time == time && entry.type == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HistoryLog::add(const HistoryEntry& entry) {
+    if (contains(entry.lock, entry.time, entry.type)) {
+        return false;
+    }
+
+    if (count == HISTORY_LOG_SLOTS) {
+        // Overwrite the oldest entry
+        if (!entries[start].published) {
+            unpublishedCount--;
+        }
+        start = (start + 1) % HISTORY_LOG_SLOTS;
+        count--;
+    }
+
+    entries[(start + count) % HISTORY_LOG_SLOTS] = entry;
+    count++;
+    if (!entry.published) {
+        unpublishedCount++;
+    }
+    return true;
+}
+
+uint32_t HistoryLog::newestTime(uint8_t lock) const {
+    uint32_t newest = 0;
+    for (size_t i = 0; i < count; i++) {
+        const HistoryEntry& entry = at(i);
+        if (entry.lock == lock && entry.time > newest) {
+            newest = entry.time;
+        }
+    }
+    return newest;
+}
+
+size_t HistoryLog::takeUnpublished(HistoryEntry* out, size_t max) {
+    size_t taken = 0;
+    int lock = -1;
+
+    for (size_t i = 0; i < count && taken < max; i++) {
+        HistoryEntry& entry = entries[(start + i) % HISTORY_LOG_SLOTS];
+        if (entry.published) continue;
+        if (lock < 0) {
+            lock = entry.lock;
+        } else if (entry.lock != lock) {
+            continue;
+        }
+
+        entry.published = 1;
+        unpublishedCount--;
+        out[taken++] = entry;
+    }
+    return taken;
+}
@@ -0,0 +1,241 @@
+#include "json_scanner.h"
+#include <string.h>
+#include <stdlib.h>
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool JsonField::keyEquals(const char* name) const {
+    size_t length = strlen(name);
+    return length == keyLength && memcmp(key, name, length) == 0;
+}
+
+bool JsonField::valueEquals(const char* text) const {
+    size_t length = strlen(text);
+    return length == valueLength && memcmp(value, text, length) == 0;
+}
+
+bool JsonField::copyString(char* out, size_t size) const {
+    if (type != JsonValueType::string || size == 0) {
+        return false;
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < valueLength; i++) {
+        char c = value[i];
+        uint32_t codepoint = static_cast<uint8_t>(c);
+
+        if (c == '\\') {
+            if (++i >= valueLength) return false;
+            switch (value[i]) {
+                case '"': codepoint = '"'; break;
+                case '\\': codepoint = '\\'; break;
+                case '/': codepoint = '/'; break;
+                case 'b': codepoint = '\b'; break;
+                case 'f': codepoint = '\f'; break;
+                case 'n': codepoint = '\n'; break;
+                case 'r': codepoint = '\r'; break;
+                case 't': codepoint = '\t'; break;
+                case 'u': {
+                    if (i + 4 >= valueLength) return false;
+                    codepoint = 0;
+                    for (int k = 1; k <= 4; k++) {
+                        int digit = hexValue(value[i + k]);
+                        if (digit < 0) return false;
+                        codepoint = (codepoint << 4) | static_cast<uint32_t>(digit);
+                    }
+                    i += 4;
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        // Re-encode escaped code points as UTF-8; raw bytes pass through
+        uint8_t encoded[3];
+        size_t encodedLength;
+        if (c != '\\' || codepoint < 0x80) {
+            encoded[0] = static_cast<uint8_t>(codepoint);
+            encodedLength = 1;
+        } else if (codepoint < 0x800) {
+            encoded[0] = static_cast<uint8_t>(0xC0 | (codepoint >> 6));
+            encoded[1] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            encodedLength = 2;
+        } else {
+            encoded[0] = static_cast<uint8_t>(0xE0 | (codepoint >> 12));
+            encoded[1] = static_cast<uint8_t>(0x80 | ((codepoint >> 6) & 0x3F));
+            encoded[2] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            encodedLength = 3;
+        }
+
+        if (written + encodedLength >= size) {
+            out[written] = '\0';
+            return false;
+        }
+        memcpy(out + written, encoded, encodedLength);
+        written += encodedLength;
+    }
+
+    out[written] = '\0';
+    return true;
+}
+
+bool JsonField::toLong(long& out) const {
+    if (type != JsonValueType::number || valueLength == 0 || valueLength > 20) {
+        return false;
+    }
+
+    char buffer[21];
+    memcpy(buffer, value, valueLength);
+    buffer[valueLength] = '\0';
+
+    char* parsedEnd = nullptr;
+    long parsed = strtol(buffer, &parsedEnd, 10);
+    if (parsedEnd != buffer + valueLength) {
+        return false;
+    }
+    out = parsed;
+    return true;
+}
+
+bool JsonField::toBool(bool& out) const {
+    if (type != JsonValueType::boolean) {
+        return false;
+    }
+    out = valueLength == 4;  // "true" vs "false"
+    return true;
+}
+
+JsonObjectScanner::JsonObjectScanner(const char* data, size_t length)
+    : pos(data), end(data + length), started(false), finished(false), error(false) {}
+
+bool JsonObjectScanner::skipWhitespace() {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+        pos++;
+    }
+    return pos < end;
+}
+
+bool JsonObjectScanner::scanString(const char*& start, size_t& length) {
+    // pos is on the opening quote
+    start = ++pos;
+    while (pos < end) {
+        if (*pos == '\\') {
+            pos += 2;
+            continue;
+        }
+        if (*pos == '"') {
+            length = static_cast<size_t>(pos - start);
+            pos++;
+            return true;
+        }
+        pos++;
+    }
+    return false;
+}
+
+bool JsonObjectScanner::scanValue(JsonField& field) {
+    if (!skipWhitespace()) return false;
+
+    char c = *pos;
+    if (c == '"') {
+        field.type = JsonValueType::string;
+        return scanString(field.value, field.valueLength);
+    }
+
+    if (c == '{' || c == '[') {
+        // Skip nested containers, tracking depth and ignoring brackets inside strings
+        field.type = c == '{' ? JsonValueType::object : JsonValueType::array;
+        field.value = pos;
+        int depth = 0;
+        while (pos < end) {
+            char d = *pos;
+            if (d == '"') {
+                const char* ignoredStart;
+                size_t ignoredLength;
+                if (!scanString(ignoredStart, ignoredLength)) return false;
+                continue;
+            }
+            if (d == '{' || d == '[') depth++;
+            if (d == '}' || d == ']') depth--;
+            pos++;
+            if (depth == 0) {
+                field.valueLength = static_cast<size_t>(pos - field.value);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Bare token: number, true, false or null
+    field.value = pos;
+    while (pos < end && *pos != ',' && *pos != '}' && *pos != ' ' &&
+           *pos != '\t' && *pos != '\n' && *pos != '\r') {
+        pos++;
+    }
+    field.valueLength = static_cast<size_t>(pos - field.value);
+    if (field.valueLength == 0) return false;
+
+    if (field.valueEquals("true") || field.valueEquals("false")) {
+        field.type = JsonValueType::boolean;
+    } else if (field.valueEquals("null")) {
+        field.type = JsonValueType::null;
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+        field.type = JsonValueType::number;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool JsonObjectScanner::next(JsonField& field) {
+    if (finished || error) return false;
+
+    if (!started) {
+        started = true;
+        if (!skipWhitespace() || *pos != '{') {
+            error = true;
+            return false;
+        }
+        pos++;
+        if (skipWhitespace() && *pos == '}') {
+            finished = true;
+            return false;
+        }
+    } else {
+        // Expect a separator between fields or the end of the object
+        if (!skipWhitespace()) {
+            error = true;
+            return false;
+        }
+        if (*pos == '}') {
+            finished = true;
+            return false;
+        }
+        if (*pos != ',') {
+            error = true;
+            return false;
+        }
+        pos++;
+    }
+
+    if (!skipWhitespace() || *pos != '"' || !scanString(field.key, field.keyLength)) {
+        error = true;
+        return false;
+    }
+    if (!skipWhitespace() || *pos != ':') {
+        error = true;
+        return false;
+    }
+    pos++;
+    if (!scanValue(field)) {
+        error = true;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,347 @@
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include "app.h"
+#include "lan_api.h"
+#include "log.h"
+#include "stall_profiler.h"
+
+static const size_t LAN_FRAME_MAX = LAN_FRAME_HEADER_SIZE + OUTBOUND_PAYLOAD_SIZE + LAN_FRAME_MAC_SIZE;
+static const size_t COOKIE_MAC_SIZE = LAN_COOKIE_SIZE - 4;
+static const size_t RECENT_HELLOS = LAN_API_MAX_CLIENTS * 2;
+
+struct LanSession {
+    bool active;
+    IPAddress address;
+    uint16_t port;
+    uint64_t nonce;
+    uint32_t lastSeq;       // last command accepted
+    uint32_t eventSeq;      // sequence of frames we sent
+    uint32_t lastSeenMs;
+};
+
+// Sessions are written by the UDP task and read by publishers
+static LanSession sessions[LAN_API_MAX_CLIENTS];
+static portMUX_TYPE sessionLock = portMUX_INITIALIZER_UNLOCKED;
+
+static AsyncUDP lanUdp;
+static bool lanEnabled = false;
+
+// Client nonces of accepted hellos, so a recorded second hello cannot open
+// a session again while its cookie is still fresh. Touched only on the UDP task.
+struct RecentHello {
+    uint64_t clientNonce;
+    uint32_t acceptedMs;
+};
+
+static RecentHello recentHellos[RECENT_HELLOS];
+
+// Keys the challenge cookies to this boot: millis() starts over after a
+// reset, so cookies from before it must not become fresh again
+static uint64_t bootSecret = 0;
+
+// Datagrams that failed authentication or replay checks
+static uint32_t rejectedFrames = 0;
+
+// Header + body + MAC into out; returns the frame length, 0 if it cannot be signed
+static size_t buildFrame(uint8_t* out, LanFrameType type, uint64_t nonce, uint32_t seq, const uint8_t* body,
+                         size_t bodyLength) {
+    size_t length = lanBuildFrame(LAN_API_KEY, out, type, nonce, seq, body, bodyLength);
+    if (length == 0) {
+        LOG_ERROR("❌ LAN: HMAC failed - frame not sent\n");
+    }
+    return length;
+}
+
+// Cookie MAC: issued time, client endpoint, client nonce and this boot's secret
+static bool cookieMac(uint32_t issuedMs, const IPAddress& address, uint16_t port, const uint8_t* clientNonce,
+                      uint8_t* out) {
+    uint8_t input[8 + 4 + 4 + 2 + LAN_CLIENT_NONCE_SIZE];
+    lanPutLe(input, bootSecret, 8);
+    lanPutLe(input + 8, issuedMs, 4);
+    lanPutLe(input + 12, static_cast<uint32_t>(address), 4);
+    lanPutLe(input + 16, port, 2);
+    memcpy(input + 18, clientNonce, LAN_CLIENT_NONCE_SIZE);
+
+    uint8_t mac[LAN_FRAME_MAC_SIZE];
+    if (!lanMac(LAN_API_KEY, input, sizeof(input), mac)) {
+        return false;
+    }
+    memcpy(out, mac, COOKIE_MAC_SIZE);
+    return true;
+}
+
+static uint64_t newNonce() {
+    uint64_t nonce = 0;
+    while (nonce == 0) {
+        nonce = (static_cast<uint64_t>(esp_random()) << 32) | esp_random();
+    }
+    return nonce;
+}
+
+static bool sameEndpoint(const LanSession& session, const IPAddress& address, uint16_t port) {
+    return session.active && static_cast<uint32_t>(session.address) == static_cast<uint32_t>(address) &&
+           session.port == port;
+}
+
+// Caller holds sessionLock
+static LanSession* findSession(const IPAddress& address, uint16_t port, uint32_t now) {
+    for (LanSession& session : sessions) {
+        if (session.active && now - session.lastSeenMs >= LAN_API_CLIENT_TIMEOUT_MS) {
+            session.active = false;
+        }
+        if (sameEndpoint(session, address, port)) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+static void reject(const char* reason, AsyncUDPPacket& packet) {
+    rejectedFrames++;
+    IPAddress address = packet.remoteIP();
+    LOG_WARN("🚫 LAN: %s from %u.%u.%u.%u:%u (%lu rejected)\n", reason, address[0], address[1], address[2],
+             address[3], packet.remotePort(), static_cast<unsigned long>(rejectedFrames));
+}
+
+// First hello: answer with a cookie bound to the sender, keeping no state
+static void sendChallenge(AsyncUDPPacket& packet, const uint8_t* clientNonce, uint32_t now) {
+    uint8_t body[LAN_CLIENT_NONCE_SIZE + LAN_COOKIE_SIZE];
+    memcpy(body, clientNonce, LAN_CLIENT_NONCE_SIZE);
+    lanPutLe(body + LAN_CLIENT_NONCE_SIZE, now, 4);
+    if (!cookieMac(now, packet.remoteIP(), packet.remotePort(), clientNonce, body + LAN_CLIENT_NONCE_SIZE + 4)) {
+        reject("HMAC failed", packet);
+        return;
+    }
+
+    uint8_t frame[LAN_FRAME_HEADER_SIZE + sizeof(body) + LAN_FRAME_MAC_SIZE];
+    size_t length = buildFrame(frame, LanFrameType::challenge, 0, 0, body, sizeof(body));
+    if (length > 0) {
+        lanUdp.writeTo(frame, length, packet.remoteIP(), packet.remotePort());
+    }
+}
+
+// Second hello: a fresh cookie for this endpoint, not used before
+static bool cookieAccepted(AsyncUDPPacket& packet, const uint8_t* clientNonce, const uint8_t* cookie, uint32_t now) {
+    uint32_t issuedMs = static_cast<uint32_t>(lanGetLe(cookie, 4));
+    if (now - issuedMs >= LAN_API_HELLO_TIMEOUT_MS) {
+        // Also catches times from the future, which wrap to a large age
+        reject("stale hello", packet);
+        return false;
+    }
+
+    uint8_t expected[COOKIE_MAC_SIZE];
+    if (!cookieMac(issuedMs, packet.remoteIP(), packet.remotePort(), clientNonce, expected)) {
+        reject("HMAC failed", packet);
+        return false;
+    }
+    if (!lanMacMatches(expected, cookie + 4, COOKIE_MAC_SIZE)) {
+        reject("bad hello cookie", packet);
+        return false;
+    }
+
+    uint64_t nonce = lanGetLe(clientNonce, LAN_CLIENT_NONCE_SIZE);
+    RecentHello* slot = nullptr;
+    for (RecentHello& recent : recentHellos) {
+        bool live = recent.clientNonce != 0 && now - recent.acceptedMs < LAN_API_HELLO_TIMEOUT_MS;
+        if (live && recent.clientNonce == nonce) {
+            reject("replayed hello", packet);
+            return false;
+        }
+        if (!live && slot == nullptr) {
+            slot = &recent;
+        }
+    }
+    if (slot == nullptr) {
+        // More hellos than sessions within one cookie lifetime: refuse rather than forget one
+        reject("too many hellos", packet);
+        return false;
+    }
+    slot->clientNonce = nonce;
+    slot->acceptedMs = now;
+    return true;
+}
+
+static void handleHello(AsyncUDPPacket& packet, const uint8_t* body, size_t bodyLength, uint32_t now) {
+    if (bodyLength == LAN_CLIENT_NONCE_SIZE) {
+        sendChallenge(packet, body, now);
+        return;
+    }
+    if (bodyLength != LAN_CLIENT_NONCE_SIZE + LAN_COOKIE_SIZE) {
+        reject("malformed hello", packet);
+        return;
+    }
+    if (!cookieAccepted(packet, body, body + LAN_CLIENT_NONCE_SIZE, now)) {
+        return;
+    }
+
+    IPAddress address = packet.remoteIP();
+    uint16_t port = packet.remotePort();
+    uint64_t nonce = newNonce();
+
+    portENTER_CRITICAL(&sessionLock);
+    LanSession* session = findSession(address, port, now);
+    if (session == nullptr) {
+        // Free slot, or the session heard from least recently
+        session = &sessions[0];
+        for (LanSession& candidate : sessions) {
+            if (!candidate.active) {
+                session = &candidate;
+                break;
+            }
+            if (static_cast<int32_t>(candidate.lastSeenMs - session->lastSeenMs) < 0) {
+                session = &candidate;
+            }
+        }
+    }
+    session->active = true;
+    session->address = address;
+    session->port = port;
+    session->nonce = nonce;
+    session->lastSeq = 0;
+    session->eventSeq = 0;
+    session->lastSeenMs = now;
+    portEXIT_CRITICAL(&sessionLock);
+
+    // Echo the client nonce, so the client knows this welcome answers its hello
+    uint8_t frame[LAN_FRAME_HEADER_SIZE + LAN_CLIENT_NONCE_SIZE + LAN_FRAME_MAC_SIZE];
+    size_t length = buildFrame(frame, LanFrameType::welcome, nonce, 0, body, LAN_CLIENT_NONCE_SIZE);
+    if (length > 0) {
+        lanUdp.writeTo(frame, length, address, port);
+    }
+    LOG_INFO("🔗 LAN: session for %u.%u.%u.%u:%u\n", address[0], address[1], address[2], address[3], port);
+}
+
+static void sendAck(AsyncUDPPacket& packet, uint64_t nonce, uint32_t seq, const SesameCommand& command,
+                    const char* result) {
+    uint8_t body[128];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, body, sizeof(body));
+    event.add(FieldId::result, result);
+    event.add(FieldId::action, commandActionName(command.action));
+    if (command.requestId[0] != '\0') {
+        event.add(FieldId::requestId, command.requestId);
+    }
+    event.finish();
+
+    uint8_t frame[LAN_FRAME_HEADER_SIZE + sizeof(body) + LAN_FRAME_MAC_SIZE];
+    size_t length = buildFrame(frame, LanFrameType::ack, nonce, seq, event.data(), event.length());
+    if (length > 0) {
+        lanUdp.writeTo(frame, length, packet.remoteIP(), packet.remotePort());
+    }
+}
+
+static void handleCommand(AsyncUDPPacket& packet, uint64_t nonce, uint32_t seq, const uint8_t* body,
+                          size_t bodyLength, uint32_t ingressUs, uint32_t now) {
+    portENTER_CRITICAL(&sessionLock);
+    LanSession* session = findSession(packet.remoteIP(), packet.remotePort(), now);
+    bool valid = session != nullptr && session->nonce == nonce && seq > session->lastSeq;
+    if (valid) {
+        session->lastSeq = seq;
+        session->lastSeenMs = now;
+    }
+    portEXIT_CRITICAL(&sessionLock);
+
+    if (!valid) {
+        // Unknown session, stale nonce (e.g. after a reboot) or a replay
+        reject("stale session or replayed command", packet);
+        return;
+    }
+
+    SesameCommand command = {};
+    CommandParseResult result = parseCommandPayload(reinterpret_cast<const char*>(body), bodyLength, command);
+    if (result != CommandParseResult::ok) {
+        sendAck(packet, nonce, seq, command, commandParseResultName(result));
+        return;
+    }
+
+    command.source = CommandSource::lan;
+    command.ingressUs = ingressUs;
+    sendAck(packet, nonce, seq, command, queueSesameCommand(command) ? "queued" : "busy");
+}
+
+// Runs on the AsyncUDP task: authenticate, then hand off like mqttCallback()
+static void onLanPacket(AsyncUDPPacket& packet) {
+    uint32_t ingressUs = micros();
+    ProfileScope scope(ProfileSection::lanPacket);
+    uint32_t now = millis();
+    const uint8_t* data = packet.data();
+    size_t length = packet.length();
+
+    LanFrame frame;
+    if (length > LAN_FRAME_MAX || !lanParseFrame(data, length, frame)) {
+        return;
+    }
+
+    size_t signedLength = length - LAN_FRAME_MAC_SIZE;
+    uint8_t mac[LAN_FRAME_MAC_SIZE];
+    if (!lanMac(LAN_API_KEY, data, signedLength, mac)) {
+        reject("HMAC failed", packet);
+        return;
+    }
+    if (!lanMacMatches(mac, data + signedLength, LAN_FRAME_MAC_SIZE)) {
+        reject("bad MAC", packet);
+        return;
+    }
+
+    switch (frame.type) {
+        case LanFrameType::hello:
+            if (frame.nonce != 0 || frame.seq != 0) {
+                reject("malformed hello", packet);
+                break;
+            }
+            handleHello(packet, frame.body, frame.bodyLength, now);
+            break;
+        case LanFrameType::command:
+            handleCommand(packet, frame.nonce, frame.seq, frame.body, frame.bodyLength, ingressUs, now);
+            break;
+        default:
+            reject("unknown frame type", packet);
+            break;
+    }
+}
+
+void startLanApi() {
+    if (!LAN_API_ENABLED) {
+        return;
+    }
+    if (strlen(LAN_API_KEY) < LAN_API_MIN_KEY_LENGTH) {
+        LOG_WARN("⚠️ LAN API disabled - set LAN_API_KEY in config.h\n");
+        return;
+    }
+
+    if (!lanUdp.listen(LAN_API_PORT)) {
+        LOG_ERROR("❌ LAN API: cannot listen on UDP %d\n", LAN_API_PORT);
+        return;
+    }
+    bootSecret = newNonce();
+    lanUdp.onPacket(onLanPacket);
+    lanEnabled = true;
+    LOG_INFO("📶 LAN API listening on UDP %d\n", LAN_API_PORT);
+}
+
+void lanPublish(LanFrameType type, const EventWriter& event) {
+    if (!lanEnabled || event.overflowed()) {
+        return;
+    }
+
+    // Copy the subscribers out, then send without holding the lock
+    LanSession targets[LAN_API_MAX_CLIENTS];
+    size_t count = 0;
+    uint32_t now = millis();
+    portENTER_CRITICAL(&sessionLock);
+    for (LanSession& session : sessions) {
+        if (session.active && now - session.lastSeenMs < LAN_API_CLIENT_TIMEOUT_MS) {
+            session.eventSeq++;
+            targets[count++] = session;
+        }
+    }
+    portEXIT_CRITICAL(&sessionLock);
+
+    uint8_t frame[LAN_FRAME_MAX];
+    for (size_t i = 0; i < count; i++) {
+        size_t length = buildFrame(frame, type, targets[i].nonce, targets[i].eventSeq, event.data(), event.length());
+        if (length == 0) {
+            return;
+        }
+        lanUdp.writeTo(frame, length, targets[i].address, targets[i].port);
+    }
+}
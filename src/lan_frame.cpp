@@ -0,0 +1,70 @@
+#include <string.h>
+#include <mbedtls/md.h>
+#include "lan_frame.h"
+
+void lanPutLe(uint8_t* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t lanGetLe(const uint8_t* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = bytes; i > 0; i--) {
+        value = (value << 8) | in[i - 1];
+    }
+    return value;
+}
+
+bool lanMac(const char* key, const uint8_t* data, size_t length, uint8_t* mac) {
+    const mbedtls_md_info_t* sha256 = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (sha256 == nullptr) {
+        return false;
+    }
+    return mbedtls_md_hmac(sha256, reinterpret_cast<const unsigned char*>(key), strlen(key), data, length, mac) == 0;
+}
+
+bool lanMacMatches(const uint8_t* a, const uint8_t* b, size_t length) {
+    uint8_t difference = 0;
+    for (size_t i = 0; i < length; i++) {
+        difference |= a[i] ^ b[i];
+    }
+    return difference == 0;
+}
+
+size_t lanBuildFrame(const char* key, uint8_t* out, LanFrameType type, uint64_t nonce, uint32_t seq,
+                     const uint8_t* body, size_t bodyLength) {
+    out[0] = LAN_FRAME_MAGIC;
+    out[1] = static_cast<uint8_t>(type);
+    lanPutLe(out + 2, nonce, 8);
+    lanPutLe(out + 10, seq, 4);
+    if (bodyLength > 0) {
+        memcpy(out + LAN_FRAME_HEADER_SIZE, body, bodyLength);
+    }
+    size_t length = LAN_FRAME_HEADER_SIZE + bodyLength;
+    if (!lanMac(key, out, length, out + length)) {
+        return 0;
+    }
+    return length + LAN_FRAME_MAC_SIZE;
+}
+
+bool lanParseFrame(const uint8_t* data, size_t length, LanFrame& frame) {
+    if (length < LAN_FRAME_HEADER_SIZE + LAN_FRAME_MAC_SIZE || data[0] != LAN_FRAME_MAGIC) {
+        return false;
+    }
+    frame.type = static_cast<LanFrameType>(data[1]);
+    frame.nonce = lanGetLe(data + 2, 8);
+    frame.seq = static_cast<uint32_t>(lanGetLe(data + 10, 4));
+    frame.body = data + LAN_FRAME_HEADER_SIZE;
+    frame.bodyLength = length - LAN_FRAME_HEADER_SIZE - LAN_FRAME_MAC_SIZE;
+    return true;
+}
+
+bool lanFrameAuthentic(const char* key, const uint8_t* data, size_t length) {
+    if (length < LAN_FRAME_MAC_SIZE) {
+        return false;
+    }
+    size_t signedLength = length - LAN_FRAME_MAC_SIZE;
+    uint8_t mac[LAN_FRAME_MAC_SIZE];
+    return lanMac(key, data, signedLength, mac) && lanMacMatches(mac, data + signedLength, LAN_FRAME_MAC_SIZE);
+}
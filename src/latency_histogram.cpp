@@ -0,0 +1,62 @@
+#include "latency_histogram.h"
+
+static const uint32_t bucketBounds[LATENCY_BUCKET_COUNT] = {
+    100, 200, 500,
+    1000, 2000, 5000,
+    10000, 20000, 50000,
+    100000, 200000, 500000,
+    1000000, 2000000, 5000000,
+    10000000, 20000000,
+    50000000, UINT32_MAX,
+};
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for (uint32_t& bucket : buckets) {
+        bucket = 0;
+    }
+    samples = 0;
+    maximum = 0;
+}
+
+void LatencyHistogram::record(uint32_t latencyUs) {
+    size_t bucket = 0;
+    while (latencyUs > bucketBounds[bucket]) {
+        bucket++;
+    }
+
+    buckets[bucket]++;
+    samples++;
+    if (latencyUs > maximum) {
+        maximum = latencyUs;
+    }
+}
+
+uint32_t LatencyHistogram::percentileUs(uint8_t percentile) const {
+    if (samples == 0) {
+        return 0;
+    }
+
+    // Rank of the sample at this percentile, rounded up (1-based)
+    uint64_t rank = (static_cast<uint64_t>(samples) * percentile + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // Never report more than was actually observed
+            return bucketBounds[i] < maximum ? bucketBounds[i] : maximum;
+        }
+    }
+    return maximum;
+}
+
+uint32_t LatencyHistogram::bucketBoundUs(size_t bucket) {
+    return bucket < LATENCY_BUCKET_COUNT ? bucketBounds[bucket] : UINT32_MAX;
+}
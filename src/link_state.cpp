@@ -0,0 +1,60 @@
+#include "link_state.h"
+
+LinkState::LinkState(uint32_t attemptTimeoutMs, uint32_t retryMinMs, uint32_t retryMaxMs, uint8_t jitterPct)
+    : attemptTimeoutMs(attemptTimeoutMs), backoff(retryMinMs, retryMaxMs, jitterPct),
+      currentPhase(LinkPhase::down), phaseStartedMs(0), retryAtMs(0), retryDelayMs(0) {}
+
+bool LinkState::attemptDue(uint32_t nowMs) const {
+    return currentPhase == LinkPhase::down && static_cast<int32_t>(nowMs - retryAtMs) >= 0;
+}
+
+bool LinkState::attemptTimedOut(uint32_t nowMs) const {
+    return currentPhase == LinkPhase::connecting && nowMs - phaseStartedMs >= attemptTimeoutMs;
+}
+
+void LinkState::attemptStarted(uint32_t nowMs) {
+    currentPhase = LinkPhase::connecting;
+    phaseStartedMs = nowMs;
+}
+
+void LinkState::attemptFailed(uint32_t nowMs, uint32_t random) {
+    retryDelayMs = backoff.nextDelayMs(random);
+    retryAtMs = nowMs + retryDelayMs;
+    currentPhase = LinkPhase::down;
+    phaseStartedMs = nowMs;
+}
+
+void LinkState::connected(uint32_t nowMs) {
+    backoff.reset();
+    currentPhase = LinkPhase::up;
+    phaseStartedMs = nowMs;
+}
+
+void LinkState::lost(uint32_t nowMs, uint32_t random) {
+    // The first retry after losing a working link comes quickly
+    attemptFailed(nowMs, random);
+}
+
+void LinkState::reset(uint32_t nowMs) {
+    backoff.reset();
+    currentPhase = LinkPhase::down;
+    phaseStartedMs = nowMs;
+    retryAtMs = nowMs;
+    retryDelayMs = 0;
+}
+
+uint32_t LinkState::msUntilNextAction(uint32_t nowMs) const {
+    switch (currentPhase) {
+        case LinkPhase::down: {
+            int32_t remaining = static_cast<int32_t>(retryAtMs - nowMs);
+            return remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+        }
+        case LinkPhase::connecting: {
+            uint32_t elapsed = nowMs - phaseStartedMs;
+            return elapsed >= attemptTimeoutMs ? 0 : attemptTimeoutMs - elapsed;
+        }
+        case LinkPhase::up:
+            break;
+    }
+    return UINT32_MAX;
+}
@@ -0,0 +1,236 @@
+#include "littlefs_spill.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <stddef.h>
+#include "log.h"
+
+struct SpillHeader {
+    uint32_t magic;
+    uint32_t readOffset;
+};
+
+static const uint32_t SPILL_MAGIC = 0x314C5053;  // "SPL1"
+
+LittleFsSpill::LittleFsSpill(const char* path, const char* tempPath, size_t maxBytes)
+    : path(path), tempPath(tempPath), maxBytes(maxBytes), mounted(false), fileSize(0), readOffset(0),
+      frontLength(0), recordCount(0) {}
+
+bool LittleFsSpill::begin() {
+    mounted = LittleFS.begin(true);
+    if (!mounted) {
+        LOG_ERROR("❌ LittleFS mount failed - outbound spill disabled\n");
+        return false;
+    }
+
+    // A compaction cut short before the rename leaves a partial temp file;
+    // one cut short after removing the old log leaves the only copy there
+    if (LittleFS.exists(tempPath)) {
+        if (LittleFS.exists(path)) {
+            LittleFS.remove(tempPath);
+        } else {
+            LittleFS.rename(tempPath, path);
+        }
+    }
+
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return true;
+    }
+
+    size_t size = file.size();
+    SpillHeader header;
+    if (file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header) ||
+        header.magic != SPILL_MAGIC || header.readOffset < sizeof(header) || header.readOffset > size) {
+        file.close();
+        LOG_WARN("⚠️ Outbound spill log unreadable - discarded\n");
+        clear();
+        return true;
+    }
+
+    // Count the undelivered records; a torn tail from a power loss is cut off
+    size_t offset = header.readOffset;
+    uint16_t length;
+    file.seek(offset);
+    while (offset + sizeof(length) <= size && file.read(reinterpret_cast<uint8_t*>(&length), sizeof(length)) == sizeof(length)) {
+        if (offset + sizeof(length) + length > size) break;
+        offset += sizeof(length) + length;
+        file.seek(offset);
+        recordCount++;
+    }
+    file.close();
+
+    readOffset = header.readOffset;
+    fileSize = offset;
+    if (recordCount == 0) {
+        clear();
+        return true;
+    }
+
+    // Appends must not land behind a torn tail, and delivered records need not be kept
+    if ((readOffset > sizeof(header) || offset < size) && !compact()) {
+        LOG_ERROR("❌ Outbound spill log compaction failed - discarded\n");
+        clear();
+        return true;
+    }
+    LOG_INFO("💾 %u outbound messages left from the last boot\n", static_cast<unsigned>(recordCount));
+    return true;
+}
+
+void LittleFsSpill::clear() {
+    LittleFS.remove(path);
+    fileSize = 0;
+    readOffset = 0;
+    frontLength = 0;
+    recordCount = 0;
+}
+
+bool LittleFsSpill::create() {
+    File file = LittleFS.open(path, "w");
+    if (!file) {
+        return false;
+    }
+    SpillHeader header = {SPILL_MAGIC, sizeof(SpillHeader)};
+    bool written = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    file.close();
+    if (!written) {
+        LittleFS.remove(path);
+        return false;
+    }
+
+    fileSize = sizeof(header);
+    readOffset = sizeof(header);
+    return true;
+}
+
+// Rewrite the log with only the undelivered records, via a temporary file
+// so a power loss never loses the old one
+bool LittleFsSpill::compact() {
+    File source = LittleFS.open(path, "r");
+    File target = LittleFS.open(tempPath, "w");
+    bool ok = source && target && source.seek(readOffset);
+
+    SpillHeader header = {SPILL_MAGIC, sizeof(SpillHeader)};
+    ok = ok && target.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+
+    uint8_t chunk[128];
+    size_t remaining = fileSize - readOffset;
+    while (ok && remaining > 0) {
+        size_t count = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+        ok = source.read(chunk, count) == count && target.write(chunk, count) == count;
+        remaining -= count;
+    }
+    if (source) source.close();
+    if (target) target.close();
+
+    if (!ok) {
+        LittleFS.remove(tempPath);
+        return false;
+    }
+
+    LittleFS.remove(path);
+    if (!LittleFS.rename(tempPath, path)) {
+        // begin() picks the temp file up after the next reboot
+        LOG_ERROR("❌ Outbound spill log rename failed\n");
+        fileSize = 0;
+        readOffset = 0;
+        frontLength = 0;
+        recordCount = 0;
+        return false;
+    }
+
+    fileSize = sizeof(header) + (fileSize - readOffset);
+    readOffset = sizeof(header);
+    return true;
+}
+
+bool LittleFsSpill::append(const uint8_t* data, size_t length) {
+    uint16_t header = static_cast<uint16_t>(length);
+    size_t needed = sizeof(header) + length;
+    if (!mounted || length > UINT16_MAX || sizeof(SpillHeader) + bytes() + needed > maxBytes) {
+        return false;
+    }
+
+    if (fileSize == 0) {
+        if (!create()) return false;
+    } else if (fileSize + needed > maxBytes) {
+        if (!compact()) return false;
+    }
+
+    File file = LittleFS.open(path, "a");
+    if (!file) {
+        return false;
+    }
+    bool written = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+                   file.write(data, length) == length;
+    file.close();
+    if (!written) {
+        return false;
+    }
+
+    fileSize += needed;
+    recordCount++;
+    return true;
+}
+
+bool LittleFsSpill::readFront(uint8_t* data, size_t capacity, size_t& length) {
+    if (!mounted || recordCount == 0) {
+        return false;
+    }
+
+    File file = LittleFS.open(path, "r");
+    if (!file || !file.seek(readOffset)) {
+        return false;
+    }
+
+    uint16_t header;
+    bool ok = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    frontLength = ok ? header : 0;
+    if (ok && header <= capacity) {
+        ok = file.read(data, header) == header;
+    }
+    file.close();
+
+    if (!ok) {
+        // Unreadable log: drop it rather than block replay forever
+        clear();
+        return false;
+    }
+    // Too large for the caller: report it so it gets skipped
+    length = frontLength;
+    return header <= capacity;
+}
+
+// Only the read position changes; written in place so the log is not copied
+void LittleFsSpill::persistReadOffset() {
+    File file = LittleFS.open(path, "r+");
+    if (!file) {
+        return;
+    }
+    uint32_t offset = static_cast<uint32_t>(readOffset);
+    if (!file.seek(offsetof(SpillHeader, readOffset)) ||
+        file.write(reinterpret_cast<const uint8_t*>(&offset), sizeof(offset)) != sizeof(offset)) {
+        LOG_WARN("⚠️ Outbound spill read position not saved\n");
+    }
+    file.close();
+}
+
+void LittleFsSpill::popFront() {
+    if (recordCount == 0) {
+        return;
+    }
+    if (frontLength == 0) {
+        size_t ignored;
+        uint8_t probe[1];
+        readFront(probe, 0, ignored);
+        if (recordCount == 0) return;
+    }
+
+    readOffset += sizeof(uint16_t) + frontLength;
+    frontLength = 0;
+    recordCount--;
+    if (recordCount == 0) {
+        clear();
+    } else {
+        persistReadOffset();
+    }
+}
@@ -0,0 +1,36 @@
+#include "lock_config.h"
+#include <string.h>
+
+int findLockIndex(const char* id, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < lockCount; i++) {
+        if (strlen(lockConfigs[i].id) == length && memcmp(lockConfigs[i].id, id, length) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int findLockIndex(const char* id) {
+    return findLockIndex(id, strlen(id));
+}
+
+// The parsers run in the compiler; these pin down their behaviour
+static_assert(isHexKey("00fF9a", 3) && !isHexKey("00fF9", 3) && !isHexKey("00fF9g", 3), "isHexKey");
+static_assert(parseHexKey<3>("00fF9a")[1] == std::byte{0xFF} && parseHexKey<3>("00fF9a")[2] == std::byte{0x9A},
+              "parseHexKey");
+static_assert(isMacAddress("01:23:45:67:89:aB") && !isMacAddress("01:23:45:67:89") &&
+                  !isMacAddress("01-23-45-67-89-ab") && !isMacAddress("01:23:45:67:89:ag"),
+              "isMacAddress");
+static_assert(parseMacAddress("01:23:45:67:89:aB") == 0x0123456789ABULL, "parseMacAddress");
+
+int matchLockCommandTopic(const char* topic) {
+    for (size_t i = 0; i < lockCount; i++) {
+        if (strcmp(topic, lockTopics[i].command) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,21 @@
+#include "lock_registry.h"
+
+SesameLock sesameLocks[lockCount];
+
+void initLockRegistry() {
+    for (size_t i = 0; i < lockCount; i++) {
+        SesameLock& lock = sesameLocks[i];
+        lock.config = &lockConfigs[i];
+        lock.state = libsesame3bt::SesameClient::state_t::idle;
+        lock.topics = &lockTopics[i];
+    }
+}
+
+SesameLock* lockForClient(const libsesame3bt::SesameClient& client) {
+    for (SesameLock& lock : sesameLocks) {
+        if (&lock.client == &client) {
+            return &lock;
+        }
+    }
+    return nullptr;
+}
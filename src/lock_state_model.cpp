@@ -0,0 +1,102 @@
+#include "lock_state_model.h"
+
+static LockState stateFor(CommandAction action) {
+    switch (action) {
+        case CommandAction::lock: return LockState::locked;
+        case CommandAction::unlock: return LockState::unlocked;
+        default: return LockState::unknown;
+    }
+}
+
+static int32_t distance(int16_t a, int16_t b) {
+    int32_t difference = static_cast<int32_t>(a) - b;
+    return difference < 0 ? -difference : difference;
+}
+
+LockStateModel::LockStateModel()
+    : target(CommandAction::none), reported(LockState::unknown), haveLockPosition(false),
+      haveUnlockPosition(false), lockPosition(0), unlockPosition(0), havePosition(false), position(0),
+      previousPosition(0), settled(false), mismatchCount(0) {}
+
+void LockStateModel::commanded(CommandAction action) {
+    if (action == CommandAction::lock || action == CommandAction::unlock) {
+        target = action;
+    }
+}
+
+void LockStateModel::observed(bool locked, bool unlocked, int16_t newPosition, bool positionValid) {
+    settled = locked != unlocked;
+    if (settled) {
+        reported = locked ? LockState::locked : LockState::unlocked;
+    }
+
+    if (positionValid) {
+        previousPosition = havePosition ? position : newPosition;
+        position = newPosition;
+        havePosition = true;
+
+        // Learn where the ends are from the lock's own classification
+        if (locked && !unlocked) {
+            lockPosition = newPosition;
+            haveLockPosition = true;
+        } else if (unlocked && !locked) {
+            unlockPosition = newPosition;
+            haveUnlockPosition = true;
+        }
+    }
+
+    if (settled && stateFor(target) == reported) {
+        target = CommandAction::none;
+    }
+}
+
+bool LockStateModel::finished(CommandAction action, CommandOutcome outcome) {
+    // Superseded and duplicate commands leave a newer or equal target behind
+    if (action != target || outcome == CommandOutcome::superseded || outcome == CommandOutcome::duplicate) {
+        return false;
+    }
+
+    target = CommandAction::none;
+    if (outcome != CommandOutcome::timeout || !settled || reported == stateFor(action)) {
+        return false;
+    }
+    mismatchCount++;
+    return true;
+}
+
+LockState LockStateModel::movingTowards() const {
+    if (!havePosition || !haveLockPosition || !haveUnlockPosition) {
+        return LockState::unknown;
+    }
+
+    // Moving: the end in the direction of travel; standing still: the nearer end
+    if (position != previousPosition) {
+        bool towardsLock = (position > previousPosition) == (lockPosition > unlockPosition);
+        return towardsLock ? LockState::locked : LockState::unlocked;
+    }
+    return distance(position, lockPosition) <= distance(position, unlockPosition) ? LockState::locked
+                                                                                   : LockState::unlocked;
+}
+
+LockState LockStateModel::predicted() const {
+    if (target != CommandAction::none) {
+        return stateFor(target);
+    }
+    if (settled) {
+        return reported;
+    }
+    LockState moving = movingTowards();
+    return moving != LockState::unknown ? moving : reported;
+}
+
+CommandAction LockStateModel::toggleAction() const {
+    return predicted() == LockState::unlocked ? CommandAction::lock : CommandAction::unlock;
+}
+
+const char* lockStateName(LockState state) {
+    switch (state) {
+        case LockState::locked: return "locked";
+        case LockState::unlocked: return "unlocked";
+        default: return "unknown";
+    }
+}
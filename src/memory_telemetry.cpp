@@ -0,0 +1,36 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include "memory_telemetry.h"
+
+struct TrackedTask {
+    TaskHandle_t handle;
+    const char* name;
+};
+
+// Filled from setup() before anything reads it
+static TrackedTask trackedTasks[MEMORY_TRACKED_TASKS];
+static size_t trackedCount = 0;
+
+void trackTaskStack(TaskHandle_t handle, const char* name) {
+    if (handle == nullptr || trackedCount >= MEMORY_TRACKED_TASKS) {
+        return;
+    }
+    trackedTasks[trackedCount++] = {handle, name};
+}
+
+void takeMemoryReport(MemoryReport& out) {
+    out.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    out.minFreeHeap = esp_get_minimum_free_heap_size();
+    out.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    out.fragmentationPct = out.freeHeap == 0 || out.largestFreeBlock >= out.freeHeap
+                               ? 0
+                               : static_cast<uint8_t>(100 - static_cast<uint64_t>(out.largestFreeBlock) * 100 / out.freeHeap);
+
+    // ESP-IDF reports stack high-water marks in bytes
+    out.taskCount = trackedCount;
+    for (size_t i = 0; i < trackedCount; i++) {
+        out.tasks[i].name = trackedTasks[i].name;
+        out.tasks[i].freeBytes = uxTaskGetStackHighWaterMark(trackedTasks[i].handle);
+    }
+}
@@ -0,0 +1,483 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include "app.h"
+#include "boot_metrics.h"
+#include "config_store.h"
+#include "link_state.h"
+#include "littlefs_spill.h"
+#include "lan_api.h"
+#include "lock_config.h"
+#include "log.h"
+#include "memory_telemetry.h"
+#include "power_manager.h"
+#include "stall_profiler.h"
+#include "state_cache.h"
+
+// WiFi and MQTT clients - only touched from the network task
+WiFiClient wifiClient;
+PubSubClient mqttClient(wifiClient);
+
+// PubSubClient builds each packet in one buffer: fixed header, topic length,
+// topic, payload. Its 256-byte default would refuse the larger events
+// (metrics, status) without an error, so it is sized for the largest
+// message the outbound path can hold.
+static const size_t MQTT_BUFFER_SIZE = MQTT_MAX_HEADER_SIZE + 2 + OUTBOUND_TOPIC_SIZE + OUTBOUND_PAYLOAD_SIZE;
+static_assert(MQTT_BUFFER_SIZE <= UINT16_MAX, "MQTT_BUFFER_SIZE exceeds PubSubClient::setBufferSize()");
+static_assert(LOCK_TOPIC_SIZE <= OUTBOUND_TOPIC_SIZE, "per-lock topics must fit OUTBOUND_TOPIC_SIZE");
+
+std::atomic<bool> wifiConnected{false};
+std::atomic<bool> mqttConnected{false};
+
+static QueueHandle_t publishQueue = nullptr;
+static TaskHandle_t networkTaskHandle = nullptr;
+
+// Neither link ever blocks the task for longer than one bounded MQTT attempt
+static LinkState wifiLink(WIFI_CONNECT_TIMEOUT_MS, NETWORK_RETRY_MIN_MS, NETWORK_RETRY_MAX_MS, NETWORK_RETRY_JITTER_PCT);
+static LinkState mqttLink(MQTT_CONNECT_TIMEOUT_MS, NETWORK_RETRY_MIN_MS, NETWORK_RETRY_MAX_MS, NETWORK_RETRY_JITTER_PCT);
+
+// Messages produced while the broker is unreachable, replayed on reconnect
+static_assert((OUTBOUND_BUFFER_BYTES & (OUTBOUND_BUFFER_BYTES - 1)) == 0, "OUTBOUND_BUFFER_BYTES must be a power of two");
+static uint8_t outboundStorage[OUTBOUND_BUFFER_BYTES];
+static LittleFsSpill outboundSpill(OUTBOUND_SPILL_PATH, OUTBOUND_SPILL_TEMP_PATH, OUTBOUND_SPILL_MAX_BYTES);
+static OutboundBuffer outbound(outboundStorage, sizeof(outboundStorage), &outboundSpill);
+static uint32_t nextReplayMs = 0;
+
+// The current WiFi attempt skips the channel scan using the cached AP
+static bool wifiAttemptCached = false;
+
+// Outbound counters for sesame/metrics/outbound
+static uint32_t publishedLive = 0;
+static uint32_t publishedReplay = 0;
+static std::atomic<uint32_t> queueDrops{0};
+static UBaseType_t queueHighWater = 0;
+static uint32_t lastOutboundMetricsMs = 0;
+
+void serviceWiFi(uint32_t now);
+void serviceMQTT(uint32_t now);
+void connectToMQTT(uint32_t now);
+void mqttCallback(char* topic, byte* payload, unsigned int length);
+
+// Runs on the WiFi event task: only flips flags, the network task polls them
+static void wifiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    (void)info;
+
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            wifiConnected = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            wifiConnected = false;
+            mqttConnected = false;
+            break;
+        default:
+            break;
+    }
+}
+
+// Publish now if the broker is up, otherwise keep the message for replay
+static void sendOrBuffer(const OutboundMessage& message) {
+    if (mqttConnected && mqttClient.publish(message.topic, message.payload, message.length)) {
+        publishedLive++;
+        return;
+    }
+    if (!outbound.push(message.topic, message.payload, message.length, message.queuedMs)) {
+        LOG_WARN("⚠️ Outbound buffer full - dropping message for %s\n", message.topic);
+    }
+}
+
+// Replay a few buffered messages per slot, oldest first
+static void replayOutbound(uint32_t now) {
+    if (!mqttConnected || outbound.empty() || static_cast<int32_t>(now - nextReplayMs) < 0) {
+        return;
+    }
+
+    // One spare byte past the payload keeps JSON NUL-terminated after age_ms is added
+    OutboundMessage message;
+    size_t length;
+    for (int i = 0; i < OUTBOUND_REPLAY_BURST && !outbound.empty(); i++) {
+        if (!outbound.peek(message.topic, sizeof(message.topic), message.payload, sizeof(message.payload),
+                           length, message.queuedMs)) {
+            continue;
+        }
+        // Consumers can place replayed events in time
+        length = appendAgeMs(message.payload, length, sizeof(message.payload), now - message.queuedMs);
+        if (!mqttClient.publish(message.topic, message.payload, length)) {
+            // A lost connection is retried after reconnecting; a message refused
+            // while connected is retried a few times, then skipped
+            if (mqttClient.connected() && outbound.frontFailed(OUTBOUND_REPLAY_MAX_ATTEMPTS)) {
+                LOG_WARN("⚠️ Skipping buffered message for %s after %u failed publishes\n", message.topic,
+                         static_cast<unsigned>(OUTBOUND_REPLAY_MAX_ATTEMPTS));
+            }
+            break;
+        }
+        outbound.pop();
+        publishedReplay++;
+    }
+    nextReplayMs = now + OUTBOUND_REPLAY_INTERVAL_MS;
+
+    if (outbound.empty()) {
+        LOG_INFO("📤 Outbound backlog replayed (%lu messages so far)\n",
+                 static_cast<unsigned long>(publishedReplay));
+    }
+}
+
+// Throughput since boot and this window's high-water marks
+static void publishOutboundMetrics(uint32_t now) {
+    const OutboundBufferStats& stats = outbound.stats();
+
+    OutboundMessage message;
+    message.queuedMs = now;
+    strlcpy(message.topic, MQTT_TOPIC_OUTBOUND_METRICS, sizeof(message.topic));
+
+    EventWriter event(MQTT_PAYLOAD_FORMAT, message.payload, sizeof(message.payload));
+    event.add(FieldId::windowMs, now - lastOutboundMetricsMs);
+    event.add(FieldId::live, publishedLive);
+    event.add(FieldId::replayed, publishedReplay);
+    event.add(FieldId::buffered, stats.buffered);
+    event.add(FieldId::spilled, stats.spilled);
+    event.add(FieldId::dropped, stats.dropped + queueDrops);
+    event.add(FieldId::skipped, stats.skipped);
+    event.add(FieldId::backlog, outbound.count());
+    event.add(FieldId::ramHighWater, stats.ramHighWater);
+    event.add(FieldId::spillHighWater, stats.spillHighWater);
+    event.add(FieldId::queueHighWater, queueHighWater);
+    event.finish();
+    message.length = static_cast<uint16_t>(event.length());
+
+    lastOutboundMetricsMs = now;
+    outbound.resetHighWater();
+    queueHighWater = 0;
+    sendOrBuffer(message);
+}
+
+// Network task - drives the WiFi and MQTT state machines and sleeps on the
+// publish queue so outbound messages go out as soon as they are queued
+static void networkTask(void* parameter) {
+    (void)parameter;
+
+    OutboundMessage message;
+    watchdogSubscribe(WatchedTask::network);
+
+    for (;;) {
+        watchdogFeed(WatchedTask::network);
+
+        uint32_t now = millis();
+        {
+            ProfileScope scope(ProfileSection::wifi);
+            serviceWiFi(now);
+        }
+        {
+            ProfileScope scope(ProfileSection::mqttConnect);
+            serviceMQTT(now);
+        }
+
+        TickType_t wait;
+        if (mqttConnected) {
+            {
+                // Handle MQTT loop (dispatches mqttCallback)
+                ProfileScope scope(ProfileSection::mqttLoop);
+                mqttClient.loop();
+            }
+            {
+                ProfileScope scope(ProfileSection::replay);
+                replayOutbound(now);
+            }
+            wait = pdMS_TO_TICKS(powerMqttPollMs());
+        } else {
+            // Only buffering to do: sleep until a message or the next attempt is due.
+            // The broker is only tried once WiFi is up, so its retry time counts from then.
+            uint32_t linkWait = wifiLink.msUntilNextAction(now);
+            if (wifiLink.phase() == LinkPhase::up) {
+                uint32_t mqttWait = mqttLink.msUntilNextAction(now);
+                if (mqttWait < linkWait) {
+                    linkWait = mqttWait;
+                }
+            }
+            wait = pdMS_TO_TICKS(linkWait < NETWORK_IDLE_POLL_MS ? linkWait : NETWORK_IDLE_POLL_MS);
+        }
+
+        if (now - lastOutboundMetricsMs >= METRICS_PUBLISH_INTERVAL_MS) {
+            publishOutboundMetrics(now);
+        }
+
+        // Wait for outbound messages, waking up regularly to service the socket
+        if (xQueueReceive(publishQueue, &message, wait) == pdTRUE) {
+            UBaseType_t waiting = uxQueueMessagesWaiting(publishQueue) + 1;
+            if (waiting > queueHighWater) {
+                queueHighWater = waiting;
+            }
+            ProfileScope scope(ProfileSection::publish);
+            do {
+                sendOrBuffer(message);
+            } while (xQueueReceive(publishQueue, &message, 0) == pdTRUE);
+        }
+    }
+}
+
+void startNetworkTask() {
+    publishQueue = xQueueCreate(PUBLISH_QUEUE_LENGTH, sizeof(OutboundMessage));
+
+    // Messages that did not make it out before the last reboot are replayed too
+    outboundSpill.begin();
+
+    // Reconnects are driven by wifiLink, not by the driver; the state cache
+    // keeps the AP details, so the driver need not rewrite its NVS config
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);
+    WiFi.onEvent(wifiEvent);
+
+    // Binds to any address, so it serves as soon as the station gets a lease
+    startLanApi();
+
+    mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
+    mqttClient.setCallback(mqttCallback);
+    mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+    if (!mqttClient.setBufferSize(MQTT_BUFFER_SIZE)) {
+        LOG_ERROR("❌ MQTT buffer allocation failed (%u bytes) - events over 256 bytes will be dropped\n",
+                  static_cast<unsigned>(MQTT_BUFFER_SIZE));
+    }
+
+    xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr,
+                            NETWORK_TASK_PRIORITY, &networkTaskHandle, APP_TASK_CORE);
+    trackTaskStack(networkTaskHandle, "network");
+}
+
+// Queue a message for the network task, which publishes or buffers it;
+// dropped only when the hand-off queue itself is full or it does not fit
+bool queuePublish(const char* topic, const uint8_t* payload, size_t length) {
+    if (publishQueue == nullptr) {
+        return false;
+    }
+    if (length >= OUTBOUND_PAYLOAD_SIZE) {
+        queueDrops++;
+        LOG_WARN("⚠️ Payload for %s too large (%u bytes) - dropping\n", topic, static_cast<unsigned>(length));
+        return false;
+    }
+
+    OutboundMessage message;
+    message.queuedMs = millis();
+    message.length = static_cast<uint16_t>(length);
+    strlcpy(message.topic, topic, sizeof(message.topic));
+    memcpy(message.payload, payload, length);
+    message.payload[length] = '\0';
+
+    if (xQueueSend(publishQueue, &message, 0) != pdTRUE) {
+        queueDrops++;
+        LOG_WARN("⚠️ Publish queue full - dropping message for %s\n", topic);
+        return false;
+    }
+    return true;
+}
+
+bool queuePublish(const char* topic, const EventWriter& event) {
+    if (event.overflowed()) {
+        queueDrops++;
+        LOG_WARN("⚠️ Event for %s did not fit - dropping\n", topic);
+        return false;
+    }
+    return queuePublish(topic, event.data(), event.length());
+}
+
+// Associated: remember the AP so the next boot can skip the scan
+static void wifiUp(uint32_t now) {
+    wifiLink.connected(now);
+    markBootStage(BootStage::wifi);
+    IPAddress address = WiFi.localIP();
+    LOG_INFO("✅ WiFi connected: %u.%u.%u.%u\n", address[0], address[1], address[2], address[3]);
+
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid != nullptr) {
+        CachedNetwork network;
+        memcpy(network.bssid, bssid, sizeof(network.bssid));
+        network.channel = static_cast<uint8_t>(WiFi.channel());
+        saveNetwork(network);
+    }
+}
+
+// Start, time out and retry WiFi association; the result arrives as an event
+void serviceWiFi(uint32_t now) {
+    switch (wifiLink.phase()) {
+        case LinkPhase::up:
+            if (!wifiConnected) {
+                wifiLink.lost(now, esp_random());
+                LOG_WARN("⚠️ WiFi lost - retry in %lu ms\n",
+                         static_cast<unsigned long>(wifiLink.lastRetryDelayMs()));
+            }
+            break;
+        case LinkPhase::connecting:
+            if (wifiConnected) {
+                wifiUp(now);
+            } else if (wifiLink.attemptTimedOut(now)) {
+                WiFi.disconnect();
+                if (wifiAttemptCached) {
+                    // The AP moved or changed channel: scan from now on
+                    clearNetwork();
+                }
+                wifiLink.attemptFailed(now, esp_random());
+                LOG_ERROR("❌ WiFi connection failed - retry in %lu ms\n",
+                          static_cast<unsigned long>(wifiLink.lastRetryDelayMs()));
+            }
+            break;
+        case LinkPhase::down:
+            if (wifiConnected) {
+                // Associated without our help (e.g. the AP came back mid-backoff)
+                wifiUp(now);
+            } else if (wifiLink.attemptDue(now)) {
+                CachedNetwork network;
+                wifiAttemptCached = wifiLink.failures() == 0 && restoreNetwork(network);
+                if (wifiAttemptCached) {
+                    LOG_INFO("📡 Connecting to WiFi: %s (cached channel %u)\n", WIFI_SSID, network.channel);
+                    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, network.channel, network.bssid);
+                } else {
+                    LOG_INFO("📡 Connecting to WiFi: %s\n", WIFI_SSID);
+                    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+                }
+                wifiLink.attemptStarted(now);
+            }
+            break;
+    }
+}
+
+void serviceMQTT(uint32_t now) {
+    if (wifiLink.phase() != LinkPhase::up) {
+        // Try the broker as soon as WiFi is back
+        if (mqttLink.phase() != LinkPhase::down || mqttLink.failures() > 0) {
+            mqttLink.reset(now);
+        }
+        mqttConnected = false;
+        return;
+    }
+
+    if (mqttLink.phase() == LinkPhase::up) {
+        if (!mqttClient.connected()) {
+            mqttConnected = false;
+            mqttLink.lost(now, esp_random());
+            LOG_WARN("⚠️ MQTT lost, rc=%d - retry in %lu ms\n", mqttClient.state(),
+                     static_cast<unsigned long>(mqttLink.lastRetryDelayMs()));
+        }
+        return;
+    }
+
+    if (mqttLink.attemptDue(now)) {
+        connectToMQTT(now);
+    }
+}
+
+// One bounded attempt: TCP connect with MQTT_CONNECT_TIMEOUT_MS, then
+// CONNECT/CONNACK within MQTT_SOCKET_TIMEOUT_S
+void connectToMQTT(uint32_t now) {
+    LOG_INFO("📨 Connecting to MQTT: %s:%d\n", MQTT_SERVER, MQTT_PORT);
+    mqttLink.attemptStarted(now);
+
+    // PubSubClient reuses an already connected socket, so the blocking part
+    // of its connect() is limited to the CONNACK wait
+    if (!wifiClient.connect(MQTT_SERVER, MQTT_PORT, MQTT_CONNECT_TIMEOUT_MS)) {
+        mqttLink.attemptFailed(millis(), esp_random());
+        LOG_ERROR("❌ MQTT broker unreachable - retry in %lu ms\n",
+                  static_cast<unsigned long>(mqttLink.lastRetryDelayMs()));
+        return;
+    }
+
+    if (mqttClient.connect("ESP32_Sesame", MQTT_USERNAME, MQTT_PASSWORD)) {
+        mqttLink.connected(millis());
+        mqttConnected = true;
+        markBootStage(BootStage::mqtt);
+        LOG_INFO("✅ MQTT connected\n");
+
+        // Subscribe to the shared and per-lock command topics
+        mqttClient.subscribe(MQTT_TOPIC_COMMAND);
+        LOG_INFO("📥 Subscribed to: %s\n", MQTT_TOPIC_COMMAND);
+
+        for (const LockTopics& topics : lockTopics) {
+            mqttClient.subscribe(topics.command);
+            LOG_INFO("📥 Subscribed to: %s\n", topics.command);
+        }
+
+        mqttClient.subscribe(MQTT_TOPIC_CONFIG_SET);
+        mqttClient.subscribe(MQTT_TOPIC_CONFIG_GET);
+        LOG_INFO("📥 Subscribed to: %s, %s\n", MQTT_TOPIC_CONFIG_SET, MQTT_TOPIC_CONFIG_GET);
+
+        // Removed startup message - only publish when explicitly requested
+    } else {
+        wifiClient.stop();
+        mqttLink.attemptFailed(millis(), esp_random());
+        LOG_ERROR("❌ MQTT connection failed, rc=%d - retry in %lu ms\n", mqttClient.state(),
+                  static_cast<unsigned long>(mqttLink.lastRetryDelayMs()));
+    }
+}
+
+// Current settings, with the outcome of the request that asked for them
+static void publishConfig(const char* result, FieldId rejected) {
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::result, result);
+    if (rejected != FieldId::last) {
+        event.add(FieldId::reason, fieldName(rejected));
+    }
+    writeConfig(event);
+    event.finish();
+    queuePublish(MQTT_TOPIC_CONFIG, event);
+}
+
+static void handleConfigSet(const uint8_t* payload, unsigned int length) {
+    FieldId rejected;
+    ConfigSetResult result = applyConfigPayload(payload, length, rejected);
+    if (result == ConfigSetResult::ok) {
+        LOG_INFO("⚙️ Config updated\n");
+        queueConfigChanged();
+    } else {
+        LOG_ERROR("❌ Config rejected: %s%s%s\n", configSetResultName(result),
+                  rejected != FieldId::last ? " - " : "", rejected != FieldId::last ? fieldName(rejected) : "");
+    }
+    publishConfig(configSetResultName(result), rejected);
+}
+
+// Runs inside mqttClient.loop() on the network task. The payload is decoded
+// in place into a fixed SesameCommand and copied into the sesame queue, so
+// ingesting a command never touches the heap.
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+    uint32_t ingressUs = micros();
+    ProfileScope scope(ProfileSection::mqttCallback);
+    const char* message = reinterpret_cast<const char*>(payload);
+
+    if (detectPayloadFormat(payload, length) == PayloadFormat::cbor) {
+        LOG_DEBUG("📥 MQTT [%s]: CBOR, %u bytes\n", topic, length);
+    } else {
+        LOG_DEBUG("📥 MQTT [%s]: %.*s\n", topic, static_cast<int>(length), message);
+    }
+
+    if (strcmp(topic, MQTT_TOPIC_CONFIG_SET) == 0) {
+        handleConfigSet(payload, length);
+        return;
+    }
+    if (strcmp(topic, MQTT_TOPIC_CONFIG_GET) == 0) {
+        publishConfig(configSetResultName(ConfigSetResult::ok), FieldId::last);
+        return;
+    }
+
+    // Per-lock topics pick the lock; the shared topic uses the "target" field
+    int lock = -1;
+    if (strcmp(topic, MQTT_TOPIC_COMMAND) != 0) {
+        lock = matchLockCommandTopic(topic);
+        if (lock < 0) {
+            return;
+        }
+    }
+
+    SesameCommand command = {};
+    CommandParseResult result = parseCommandPayload(message, length, command);
+    if (result != CommandParseResult::ok) {
+        LOG_ERROR("❌ Failed to parse command: %s\n", commandParseResultName(result));
+        return;
+    }
+
+    if (lock >= 0) {
+        strlcpy(command.target, lockConfigs[lock].id, sizeof(command.target));
+    }
+
+    command.source = CommandSource::mqtt;
+    command.ingressUs = ingressUs;
+    queueSesameCommand(command);
+}
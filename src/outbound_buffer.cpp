@@ -0,0 +1,152 @@
+#include "outbound_buffer.h"
+#include <string.h>
+
+OutboundBuffer::OutboundBuffer(uint8_t* storage, size_t size, OutboundSpill* spill)
+    : storage(storage), size(size), spill(spill), head(0), tail(0), ramRecords(0), frontAttempts(0), counters() {}
+
+bool OutboundBuffer::encode(const char* topic, const uint8_t* payload, size_t payloadLength, uint32_t queuedMs,
+                            uint8_t* out, size_t capacity, size_t& length) const {
+    size_t topicLength = strlen(topic);
+    if (topicLength >= OUTBOUND_TOPIC_SIZE || payloadLength >= OUTBOUND_PAYLOAD_SIZE) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.queuedMs = queuedMs;
+    header.topicLength = static_cast<uint16_t>(topicLength);
+    header.payloadLength = static_cast<uint16_t>(payloadLength);
+
+    length = sizeof(header) + topicLength + payloadLength;
+    if (length > capacity) {
+        return false;
+    }
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), topic, topicLength);
+    memcpy(out + sizeof(header) + topicLength, payload, payloadLength);
+    return true;
+}
+
+bool OutboundBuffer::decode(const uint8_t* data, size_t length, char* topic, size_t topicSize, uint8_t* payload,
+                            size_t payloadSize, size_t& payloadLength, uint32_t& queuedMs) const {
+    RecordHeader header;
+    if (length < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (sizeof(header) + header.topicLength + header.payloadLength != length ||
+        header.topicLength >= topicSize || header.payloadLength >= payloadSize) {
+        return false;
+    }
+
+    memcpy(topic, data + sizeof(header), header.topicLength);
+    topic[header.topicLength] = '\0';
+    memcpy(payload, data + sizeof(header) + header.topicLength, header.payloadLength);
+    payload[header.payloadLength] = '\0';
+    payloadLength = header.payloadLength;
+    queuedMs = header.queuedMs;
+    return true;
+}
+
+void OutboundBuffer::write(const uint8_t* data, size_t length) {
+    size_t offset = head % size;
+    size_t first = length < size - offset ? length : size - offset;
+    memcpy(storage + offset, data, first);
+    memcpy(storage, data + first, length - first);
+    head += length;
+}
+
+void OutboundBuffer::read(size_t offset, uint8_t* data, size_t length) const {
+    offset %= size;
+    size_t first = length < size - offset ? length : size - offset;
+    memcpy(data, storage + offset, first);
+    memcpy(data + first, storage, length - first);
+}
+
+bool OutboundBuffer::push(const char* topic, const uint8_t* payload, size_t payloadLength, uint32_t queuedMs) {
+    uint8_t record[OUTBOUND_RECORD_MAX];
+    size_t length;
+    if (!encode(topic, payload, payloadLength, queuedMs, record, sizeof(record), length)) {
+        counters.dropped++;
+        return false;
+    }
+
+    // Once anything sits in the spill log, newer messages must queue behind it
+    bool spilling = spill != nullptr && spill->records() > 0;
+    if (!spilling && size - (head - tail) >= length) {
+        write(record, length);
+        ramRecords++;
+        counters.buffered++;
+        if (head - tail > counters.ramHighWater) {
+            counters.ramHighWater = head - tail;
+        }
+        return true;
+    }
+
+    if (spill == nullptr || !spill->append(record, length)) {
+        counters.dropped++;
+        return false;
+    }
+    counters.buffered++;
+    counters.spilled++;
+    if (spill->bytes() > counters.spillHighWater) {
+        counters.spillHighWater = spill->bytes();
+    }
+    return true;
+}
+
+bool OutboundBuffer::peek(char* topic, size_t topicSize, uint8_t* payload, size_t payloadSize, size_t& payloadLength,
+                          uint32_t& queuedMs) {
+    uint8_t record[OUTBOUND_RECORD_MAX];
+
+    if (ramRecords > 0) {
+        RecordHeader header;
+        read(tail, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+        size_t length = sizeof(header) + header.topicLength + header.payloadLength;
+        read(tail, record, length);
+        return decode(record, length, topic, topicSize, payload, payloadSize, payloadLength, queuedMs);
+    }
+
+    size_t length;
+    if (spill == nullptr || spill->records() == 0) {
+        return false;
+    }
+    if (!spill->readFront(record, sizeof(record), length) ||
+        !decode(record, length, topic, topicSize, payload, payloadSize, payloadLength, queuedMs)) {
+        // Unreadable or corrupt record (e.g. torn write at power loss): skip it
+        if (spill->records() > 0) {
+            spill->popFront();
+        }
+        frontAttempts = 0;
+        counters.dropped++;
+        return false;
+    }
+    return true;
+}
+
+void OutboundBuffer::pop() {
+    frontAttempts = 0;
+    if (ramRecords > 0) {
+        RecordHeader header;
+        read(tail, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+        tail += sizeof(header) + header.topicLength + header.payloadLength;
+        ramRecords--;
+        return;
+    }
+    if (spill != nullptr && spill->records() > 0) {
+        spill->popFront();
+    }
+}
+
+bool OutboundBuffer::frontFailed(uint8_t maxAttempts) {
+    if (empty() || ++frontAttempts < maxAttempts) {
+        return false;
+    }
+    pop();
+    counters.skipped++;
+    return true;
+}
+
+void OutboundBuffer::resetHighWater() {
+    counters.ramHighWater = head - tail;
+    counters.spillHighWater = spill != nullptr ? spill->bytes() : 0;
+}
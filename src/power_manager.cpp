@@ -0,0 +1,154 @@
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <WiFi.h>
+#include <atomic>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include "app.h"
+#include "config_store.h"
+#include "log.h"
+#include "power_manager.h"
+
+// Budget and hold time can be tuned at runtime through the config store.
+// WiFi and BLE share the radio, and the coexistence scheme needs modem sleep.
+static PowerPolicyConfig powerConfig() {
+    return {
+        POWER_PROFILE,
+        configValue(ConfigKey::latencyBudgetMs),
+        configValue(ConfigKey::activeHoldMs),
+        POWER_BLE_RSSI_TARGET,
+        SESAME_SCAN_INTERVAL_MS,
+        SESAME_SCAN_WINDOW_MS,
+        true,
+    };
+}
+
+// CPU clock while busy; frequency scaling drops to 80 MHz (the lowest the radios allow) when idle
+static int powerMaxFreqMhz = 0;
+static bool lightSleepSupported = false;
+
+static std::atomic<uint32_t> lastActivityMs{0};
+static std::atomic<uint32_t> mqttPollMs{POWER_MQTT_POLL_MIN_MS};
+
+// Owned by the sesame task
+static PowerSettings applied;
+static bool appliedValid = false;
+static uint32_t txLoweredMs = 0;
+
+static bool configureLightSleep(bool enable) {
+    esp_pm_config_esp32_t pm = {};
+    pm.max_freq_mhz = powerMaxFreqMhz;
+    pm.min_freq_mhz = 80;
+    pm.light_sleep_enable = enable;
+    return esp_pm_configure(&pm) == ESP_OK;
+}
+
+static wifi_ps_type_t wifiPowerSave(WifiSleep sleep) {
+    switch (sleep) {
+        case WifiSleep::minModem: return WIFI_PS_MIN_MODEM;
+        case WifiSleep::maxModem: return WIFI_PS_MAX_MODEM;
+        default: return WIFI_PS_NONE;
+    }
+}
+
+void startPowerManager() {
+    lastActivityMs = millis();
+    powerMaxFreqMhz = getCpuFrequencyMhz();
+
+    if (POWER_PROFILE == PowerProfile::performance) {
+        LOG_INFO("⚡ Power profile: performance (no sleep)\n");
+        return;
+    }
+
+    // The RXB6 interrupt keeps the pin armed for the level it is not at,
+    // so every edge also wakes the CPU from light sleep
+    if (RXB6_ENABLED) {
+        esp_sleep_enable_gpio_wakeup();
+    }
+
+    // Automatic light sleep needs tickless idle in the SDK configuration;
+    // without it frequency scaling alone still saves some power
+    lightSleepSupported = configureLightSleep(true);
+    if (!lightSleepSupported && !configureLightSleep(false)) {
+        LOG_WARN("⚠️ Power management not available in this SDK build\n");
+    }
+
+    LOG_INFO("⚡ Power profile: %s, latency budget %u ms, light sleep %s\n",
+             powerProfileName(POWER_PROFILE), static_cast<unsigned>(configValue(ConfigKey::latencyBudgetMs)),
+             lightSleepSupported ? "on" : "unavailable");
+}
+
+void notePowerActivity() {
+    lastActivityMs = millis();
+}
+
+static PowerInputs powerInputs(bool rssiKnown, int8_t weakestRssi) {
+    PowerInputs inputs;
+    inputs.msSinceActivity = millis() - lastActivityMs;
+    inputs.rssiKnown = rssiKnown;
+    inputs.weakestRssi = weakestRssi;
+    return inputs;
+}
+
+void servicePower(bool rssiKnown, int8_t weakestRssi) {
+    PowerSettings settings = choosePowerSettings(powerConfig(), powerInputs(rssiKnown, weakestRssi));
+
+    // Advert RSSI jitters by a few dB: follow a weaker signal at once, a
+    // stronger one a step at a time
+    if (appliedValid && settings.bleTxDbm < applied.bleTxDbm) {
+        if (millis() - txLoweredMs >= POWER_BLE_TX_STEP_DOWN_MS) {
+            settings.bleTxDbm = static_cast<int8_t>(applied.bleTxDbm - POWER_BLE_TX_STEP_DBM);
+            txLoweredMs = millis();
+        } else {
+            settings.bleTxDbm = applied.bleTxDbm;
+        }
+    }
+
+    if (appliedValid && settings.wifiSleep == applied.wifiSleep && settings.lightSleep == applied.lightSleep &&
+        settings.mqttPollMs == applied.mqttPollMs && settings.bleTxDbm == applied.bleTxDbm &&
+        settings.scanIntervalMs == applied.scanIntervalMs && settings.scanWindowMs == applied.scanWindowMs) {
+        return;
+    }
+
+    if (!appliedValid || settings.wifiSleep != applied.wifiSleep) {
+        // Stored by the driver and applied again whenever the station starts
+        WiFi.setSleep(wifiPowerSave(settings.wifiSleep));
+    }
+
+    if (lightSleepSupported && (!appliedValid || settings.lightSleep != applied.lightSleep)) {
+        configureLightSleep(settings.lightSleep);
+    }
+
+    if (!appliedValid || settings.bleTxDbm != applied.bleTxDbm) {
+        NimBLEDevice::setPower(settings.bleTxDbm);
+    }
+
+    if (!appliedValid || settings.scanIntervalMs != applied.scanIntervalMs ||
+        settings.scanWindowMs != applied.scanWindowMs) {
+        NimBLEScan* scan = NimBLEDevice::getScan();
+        scan->setInterval(settings.scanIntervalMs);
+        scan->setWindow(settings.scanWindowMs);
+        if (scan->isScanning()) {
+            scan->stop();
+        }
+    }
+
+    mqttPollMs = settings.mqttPollMs;
+
+    LOG_DEBUG("⚡ Power: wifi sleep %u, light sleep %u, poll %u ms, tx %d dBm, scan %u/%u ms, +%lu ms worst case\n",
+              static_cast<unsigned>(settings.wifiSleep), settings.lightSleep && lightSleepSupported,
+              settings.mqttPollMs, settings.bleTxDbm, settings.scanWindowMs, settings.scanIntervalMs,
+              static_cast<unsigned long>(settings.worstLatencyMs));
+
+    applied = settings;
+    appliedValid = true;
+}
+
+uint32_t msUntilPowerChange() {
+    // The RSSI only moves with adverts, which wake the sesame task anyway
+    return msUntilPowerChange(powerConfig(), powerInputs(false, 0));
+}
+
+uint32_t powerMqttPollMs() {
+    return mqttPollMs;
+}
@@ -0,0 +1,112 @@
+#include "power_policy.h"
+
+static uint32_t wifiLatencyMs(WifiSleep sleep) {
+    switch (sleep) {
+        case WifiSleep::minModem: return POWER_BEACON_INTERVAL_MS;
+        case WifiSleep::maxModem: return POWER_BEACON_INTERVAL_MS * POWER_LISTEN_INTERVAL_BEACONS;
+        default: return 0;
+    }
+}
+
+uint32_t powerLatencyMs(const PowerSettings& settings) {
+    // A command over MQTT waits for the next wake of the modem and then for
+    // the next socket poll; an RF press only for the CPU to wake
+    uint32_t network = wifiLatencyMs(settings.wifiSleep) + settings.mqttPollMs;
+    uint32_t rf = settings.lightSleep ? POWER_LIGHT_SLEEP_WAKE_MS : 0;
+    return network > rf ? network : rf;
+}
+
+// Step the TX power down while the weakest lock is received stronger than the target
+static int8_t adaptiveTxDbm(const PowerPolicyConfig& config, const PowerInputs& inputs) {
+    if (!inputs.rssiKnown) {
+        return POWER_BLE_TX_MAX_DBM;
+    }
+    int32_t margin = static_cast<int32_t>(inputs.weakestRssi) - config.rssiTarget;
+    if (margin <= 0) {
+        return POWER_BLE_TX_MAX_DBM;
+    }
+    int32_t dbm = POWER_BLE_TX_MAX_DBM - (margin / POWER_BLE_TX_STEP_DBM) * POWER_BLE_TX_STEP_DBM;
+    return static_cast<int8_t>(dbm < POWER_BLE_TX_MIN_DBM ? POWER_BLE_TX_MIN_DBM : dbm);
+}
+
+PowerSettings choosePowerSettings(const PowerPolicyConfig& config, const PowerInputs& inputs) {
+    // Fastest settings, the baseline every profile starts from
+    WifiSleep lightestSleep = config.wifiMustSleep ? WifiSleep::minModem : WifiSleep::none;
+    PowerSettings settings;
+    settings.wifiSleep = lightestSleep;
+    settings.lightSleep = false;
+    settings.mqttPollMs = POWER_MQTT_POLL_MIN_MS;
+    settings.bleTxDbm = POWER_BLE_TX_MAX_DBM;
+    settings.scanIntervalMs = config.scanIntervalMs;
+    settings.scanWindowMs = config.scanWindowMs;
+    settings.worstLatencyMs = powerLatencyMs(settings);
+
+    if (config.profile == PowerProfile::performance) {
+        return settings;
+    }
+
+    // Nothing is faster than the performance settings
+    uint32_t budget = config.latencyBudgetMs;
+    if (budget < settings.worstLatencyMs) {
+        budget = settings.worstLatencyMs;
+    }
+
+    // The TX power only costs range, never latency
+    settings.bleTxDbm = adaptiveTxDbm(config, inputs);
+    settings.lightSleep = true;
+    settings.wifiSleep = WifiSleep::minModem;
+
+    // Right after activity a follow-up (second press, status poll) is likely
+    if (inputs.msSinceActivity < config.activeHoldMs) {
+        settings.worstLatencyMs = powerLatencyMs(settings);
+        if (settings.worstLatencyMs > budget) {
+            settings.wifiSleep = lightestSleep;
+            settings.worstLatencyMs = powerLatencyMs(settings);
+        }
+        return settings;
+    }
+
+    // Idle: stretch the scan duty cycle and the socket poll
+    uint32_t scanStretch = config.profile == PowerProfile::lowPower ? 10 : 3;
+    uint32_t interval = config.scanIntervalMs * scanStretch;
+    settings.scanIntervalMs = static_cast<uint16_t>(interval > UINT16_MAX ? UINT16_MAX : interval);
+    settings.mqttPollMs = config.profile == PowerProfile::lowPower ? POWER_MQTT_POLL_MAX_MS : POWER_MQTT_POLL_MAX_MS / 2;
+    if (config.profile == PowerProfile::lowPower) {
+        settings.wifiSleep = WifiSleep::maxModem;
+    }
+
+    // Give savings back until the budget holds
+    while (powerLatencyMs(settings) > budget) {
+        if (settings.mqttPollMs > POWER_MQTT_POLL_MIN_MS) {
+            uint32_t excess = powerLatencyMs(settings) - budget;
+            uint32_t reducible = settings.mqttPollMs - POWER_MQTT_POLL_MIN_MS;
+            settings.mqttPollMs = static_cast<uint16_t>(settings.mqttPollMs - (excess < reducible ? excess : reducible));
+        } else if (settings.wifiSleep == WifiSleep::maxModem) {
+            settings.wifiSleep = WifiSleep::minModem;
+            settings.mqttPollMs = POWER_MQTT_POLL_MAX_MS;
+        } else if (settings.wifiSleep == WifiSleep::minModem && lightestSleep == WifiSleep::none) {
+            settings.wifiSleep = WifiSleep::none;
+            settings.mqttPollMs = POWER_MQTT_POLL_MAX_MS;
+        } else {
+            settings.lightSleep = false;
+        }
+    }
+    settings.worstLatencyMs = powerLatencyMs(settings);
+    return settings;
+}
+
+uint32_t msUntilPowerChange(const PowerPolicyConfig& config, const PowerInputs& inputs) {
+    if (config.profile == PowerProfile::performance || inputs.msSinceActivity >= config.activeHoldMs) {
+        return UINT32_MAX;
+    }
+    return config.activeHoldMs - inputs.msSinceActivity;
+}
+
+const char* powerProfileName(PowerProfile profile) {
+    switch (profile) {
+        case PowerProfile::performance: return "performance";
+        case PowerProfile::balanced: return "balanced";
+        case PowerProfile::lowPower: return "low_power";
+        default: return "unknown";
+    }
+}
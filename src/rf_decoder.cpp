@@ -0,0 +1,159 @@
+#include "rf_decoder.h"
+#include <string.h>
+
+static const RfProtocol protocols[] = {
+    {"EV1527/PT2262", 1, 31, 1, 3, 3, 1},
+    {"PT2262-10T", 1, 10, 1, 3, 3, 1},
+};
+
+static const size_t protocolCount = sizeof(protocols) / sizeof(protocols[0]);
+
+const char* rfProtocolName(uint8_t protocol) {
+    if (protocol == 0 || protocol > protocolCount) {
+        return "unknown";
+    }
+    return protocols[protocol - 1].name;
+}
+
+uint8_t rfProtocolId(const char* name) {
+    for (size_t p = 0; p < protocolCount; p++) {
+        if (strcmp(protocols[p].name, name) == 0) {
+            return static_cast<uint8_t>(p + 1);
+        }
+    }
+    return 0;
+}
+
+RfDecoder::RfDecoder(uint32_t minPulseUs, uint8_t tolerancePct, uint8_t repeatFrames)
+    : minPulseUs(minPulseUs), tolerancePct(tolerancePct),
+      repeatFrames(repeatFrames == 0 ? 1 : repeatFrames) {
+    reset();
+}
+
+void RfDecoder::reset() {
+    durationCount = 0;
+    haveLastEdge = false;
+    frameDiscarded = false;
+    lastEdgeUs = 0;
+    lastFrameCode = 0;
+    lastFrameBits = 0;
+    lastFrameProtocol = 0;
+    lastFrameUs = 0;
+    repeatCount = 0;
+    counters = RfDecoderStats();
+}
+
+bool RfDecoder::matches(uint32_t durationUs, uint32_t units, uint32_t pulseUs) const {
+    uint32_t expected = units * pulseUs;
+    uint32_t tolerance = pulseUs * tolerancePct / 100;
+    uint32_t difference = durationUs > expected ? durationUs - expected : expected - durationUs;
+    return difference <= tolerance;
+}
+
+bool RfDecoder::decodeFrame(uint32_t syncGapUs, uint32_t endUs, RfCode& out) const {
+    // Data pairs plus the trailing sync high
+    if (durationCount < 2 * RF_MIN_BITS + 1 || (durationCount & 1) == 0) {
+        return false;
+    }
+    size_t bits = (durationCount - 1) / 2;
+
+    // Every bit spans zeroHigh + zeroLow = oneHigh + oneLow = 4T
+    uint32_t total = 0;
+    for (size_t i = 0; i < bits * 2; i++) {
+        total += durations[i];
+    }
+    uint32_t pulseUs = total / (bits * 4);
+    if (pulseUs == 0) {
+        return false;
+    }
+
+    for (size_t p = 0; p < protocolCount; p++) {
+        const RfProtocol& protocol = protocols[p];
+
+        if (!matches(durations[bits * 2], protocol.syncHigh, pulseUs)) continue;
+
+        // The closing gap only has to be long enough: trailing silence after
+        // the last frame of a burst is arbitrarily long. Protocols are listed
+        // longest sync first, so the first one that fits wins.
+        uint32_t minSync = protocol.syncLow * pulseUs - protocol.syncLow * pulseUs * tolerancePct / 100;
+        if (syncGapUs < minSync) continue;
+
+        uint32_t code = 0;
+        bool valid = true;
+        for (size_t bit = 0; bit < bits; bit++) {
+            uint32_t high = durations[bit * 2];
+            uint32_t low = durations[bit * 2 + 1];
+            code <<= 1;
+            if (matches(high, protocol.zeroHigh, pulseUs) && matches(low, protocol.zeroLow, pulseUs)) {
+                continue;
+            }
+            if (matches(high, protocol.oneHigh, pulseUs) && matches(low, protocol.oneLow, pulseUs)) {
+                code |= 1;
+                continue;
+            }
+            valid = false;
+            break;
+        }
+
+        if (valid) {
+            out.code = code;
+            out.bits = static_cast<uint8_t>(bits);
+            out.protocol = static_cast<uint8_t>(p + 1);
+            out.pulseUs = static_cast<uint16_t>(pulseUs);
+            out.endUs = endUs;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RfDecoder::feedEdge(uint32_t timestampUs, RfCode& out) {
+    counters.edges++;
+
+    if (!haveLastEdge) {
+        haveLastEdge = true;
+        lastEdgeUs = timestampUs;
+        return false;
+    }
+
+    uint32_t duration = timestampUs - lastEdgeUs;
+    lastEdgeUs = timestampUs;
+
+    if (duration < RF_SYNC_GAP_MIN_US) {
+        // Glitches and over-long runs poison the frame until the next sync gap
+        if (duration < minPulseUs || durationCount >= RF_MAX_DURATIONS) {
+            frameDiscarded = true;
+        } else if (!frameDiscarded) {
+            durations[durationCount++] = duration;
+        }
+        return false;
+    }
+
+    // Sync gap: the buffered pulses form a complete frame
+    bool confirmed = false;
+    RfCode frame;
+    if (!frameDiscarded && decodeFrame(duration, timestampUs, frame)) {
+        counters.frames++;
+
+        bool repeat = repeatCount > 0 && frame.code == lastFrameCode && frame.bits == lastFrameBits &&
+                      frame.protocol == lastFrameProtocol && timestampUs - lastFrameUs <= RF_REPEAT_WINDOW_US;
+        repeatCount = repeat ? (repeatCount < 255 ? repeatCount + 1 : repeatCount) : 1;
+        lastFrameCode = frame.code;
+        lastFrameBits = frame.bits;
+        lastFrameProtocol = frame.protocol;
+        lastFrameUs = timestampUs;
+
+        // Report each burst exactly once, when it reaches the repeat threshold
+        if (repeatCount == repeatFrames) {
+            counters.codes++;
+            out = frame;
+            confirmed = true;
+        }
+    } else if (durationCount > 0 || frameDiscarded) {
+        counters.rejected++;
+    }
+
+    durationCount = 0;
+    frameDiscarded = false;
+    return confirmed;
+}
@@ -0,0 +1,191 @@
+#include <Arduino.h>
+#include <hal/gpio_ll.h>
+#include <initializer_list>
+#include "app.h"
+#include "config_store.h"
+#include "log.h"
+#include "memory_telemetry.h"
+#include "rf_decoder.h"
+#include "spsc_ring.h"
+#include "stall_profiler.h"
+
+// A code only matches with the same length and protocol, so a frame of
+// another remote family cannot alias an enrolled code
+struct RemoteCode {
+    uint32_t code;
+    uint8_t bits;
+    const char* protocol; // as reported on MQTT_TOPIC_RXB6, e.g. "EV1527/PT2262"
+    CommandAction action;
+    const char* target;   // lock id from SESAME_LOCKS, "" for the first lock
+};
+
+// Remotes allowed to operate the lock; an initializer_list so the
+// default empty whitelist is valid
+static const std::initializer_list<RemoteCode> remoteCodes = RXB6_REMOTE_CODES;
+
+// Edge timestamps from the ISR to the RXB6 task
+static SpscRing<uint32_t, RXB6_EDGE_BUFFER_SIZE> rxb6Edges;
+static volatile uint32_t rxb6LastEdgeUs = 0;
+
+static RfDecoder rxb6Decoder(RXB6_PULSE_MIN_US, RXB6_PULSE_TOLERANCE, RXB6_REPEAT_FRAMES);
+
+// Last accepted press, for per-code repeat suppression
+static RfCode rxb6LastCode = {};
+static unsigned long rxb6LastProcessedTime = 0;
+
+static TaskHandle_t rxb6TaskHandle = nullptr;
+
+void IRAM_ATTR rxb6InterruptHandler();
+static void IRAM_ATTR armRxb6Wake(int level);
+void setupRXB6();
+void processRXB6Signal(const RfCode& code);
+
+// Light sleep only wakes on GPIO levels, not edges. The pin is armed for
+// the level it is not at, which fires (and wakes) on the next edge either way.
+static void IRAM_ATTR armRxb6Wake(int level) {
+    gpio_ll_wakeup_enable(&GPIO, static_cast<gpio_num_t>(RXB6_DATA_PIN),
+                          level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+}
+
+// RXB6 433MHz Receiver interrupt handler - records every edge and wakes
+// the decoder when a frame has ended (long sync gap) or the ring is half full
+void IRAM_ATTR rxb6InterruptHandler() {
+    uint32_t now = micros();
+    armRxb6Wake(digitalRead(RXB6_DATA_PIN));
+    uint32_t gap = now - rxb6LastEdgeUs;
+    rxb6LastEdgeUs = now;
+
+    rxb6Edges.push(now);
+
+    if (gap >= RF_SYNC_GAP_MIN_US || rxb6Edges.size() >= rxb6Edges.capacity() / 2) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(rxb6TaskHandle, &higherPriorityTaskWoken);
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+}
+
+// RXB6 task - blocks until the interrupt handler notifies it, then decodes
+// every buffered edge
+static void rxb6Task(void* parameter) {
+    (void)parameter;
+
+    uint32_t timestamp;
+    RfCode code;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        ProfileScope scope(ProfileSection::rxb6);
+        while (rxb6Edges.pop(timestamp)) {
+            if (rxb6Decoder.feedEdge(timestamp, code)) {
+                processRXB6Signal(code);
+            }
+        }
+    }
+}
+
+void startRXB6Task() {
+    if (!RXB6_ENABLED) {
+        LOG_INFO("📡 RXB6 disabled in configuration\n");
+        return;
+    }
+
+    xTaskCreatePinnedToCore(rxb6Task, "rxb6", RXB6_TASK_STACK, nullptr,
+                            RXB6_TASK_PRIORITY, &rxb6TaskHandle, APP_TASK_CORE);
+    trackTaskStack(rxb6TaskHandle, "rxb6");
+
+    setupRXB6();
+}
+
+// RXB6 433MHz Receiver setup
+void setupRXB6() {
+    LOG_INFO("📡 Setting up RXB6 433MHz receiver on GPIO %d\n", RXB6_DATA_PIN);
+
+    // Configure pin as input with pullup
+    pinMode(RXB6_DATA_PIN, INPUT_PULLUP);
+
+    // Both edges are needed to measure pulse widths; the interrupt is then
+    // switched to the opposite level so it doubles as a light sleep wake source
+    attachInterrupt(digitalPinToInterrupt(RXB6_DATA_PIN), rxb6InterruptHandler, CHANGE);
+    armRxb6Wake(digitalRead(RXB6_DATA_PIN));
+
+    LOG_INFO("✅ RXB6 setup completed (%u whitelisted codes)\n", static_cast<unsigned>(remoteCodes.size()));
+    for (const RemoteCode& entry : remoteCodes) {
+        if (rfProtocolId(entry.protocol) == 0) {
+            LOG_WARN("⚠️ RXB6: code 0x%06lX has unknown protocol \"%s\" and never matches\n",
+                     static_cast<unsigned long>(entry.code), entry.protocol);
+        }
+    }
+    if (remoteCodes.size() == 0) {
+        LOG_WARN("⚠️ RXB6: no remotes enrolled, codes are only reported on %s\n", MQTT_TOPIC_RXB6);
+    }
+    LOG_INFO("📻 Ready to receive 433MHz signals\n");
+}
+
+static bool sameCode(const RfCode& a, const RfCode& b) {
+    return a.code == b.code && a.bits == b.bits && a.protocol == b.protocol;
+}
+
+static const RemoteCode* findRemoteCode(const RfCode& code) {
+    for (const RemoteCode& entry : remoteCodes) {
+        if (entry.code == code.code && entry.bits == code.bits && rfProtocolId(entry.protocol) == code.protocol) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Process a decoded remote code
+void processRXB6Signal(const RfCode& code) {
+    unsigned long currentTime = millis();
+
+    // Check timeout to prevent double presses of the same button
+    if (sameCode(code, rxb6LastCode) && currentTime - rxb6LastProcessedTime < configValue(ConfigKey::rxb6SignalTimeoutMs)) {
+        return;
+    }
+
+    rxb6LastCode = code;
+    rxb6LastProcessedTime = currentTime;
+
+    const RemoteCode* remote = findRemoteCode(code);
+
+    LOG_DEBUG("📻 RXB6: code 0x%06lX (%u bits, %s, T=%uus) %s\n",
+              static_cast<unsigned long>(code.code), code.bits, rfProtocolName(code.protocol),
+              code.pulseUs, remote ? "accepted" : "not whitelisted");
+
+    // Publish MQTT notification
+    char codeHex[11];
+    snprintf(codeHex, sizeof(codeHex), "%06lX", static_cast<unsigned long>(code.code));
+
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::signal, "received");
+    event.add(FieldId::code, codeHex);
+    event.add(FieldId::bits, code.bits);
+    event.add(FieldId::protocol, rfProtocolName(code.protocol));
+    event.add(FieldId::accepted, remote != nullptr);
+    if (remote) {
+        event.add(FieldId::action, commandActionName(remote->action));
+        event.add(FieldId::target, remote->target);
+    }
+    event.add(FieldId::timestamp, currentTime);
+    event.add(FieldId::pin, RXB6_DATA_PIN);
+    event.finish();
+
+    queuePublish(MQTT_TOPIC_RXB6, event);
+    if (event.format() == PayloadFormat::json) {
+        LOG_DEBUG("📤 RXB6 MQTT: %s\n", reinterpret_cast<const char*>(event.data()));
+    }
+
+    if (!remote) {
+        return;
+    }
+
+    // The sesame task holds the command until the target lock is authenticated
+    SesameCommand command = {};
+    command.action = remote->action;
+    command.source = CommandSource::rxb6;
+    command.ingressUs = code.endUs;
+    strlcpy(command.target, remote->target, sizeof(command.target));
+    queueSesameCommand(command);
+}
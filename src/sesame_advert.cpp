@@ -0,0 +1,42 @@
+#include "sesame_advert.h"
+
+// AD type of manufacturer-specific data
+static const uint8_t AD_TYPE_MANUFACTURER = 0xFF;
+
+static const size_t IDENTITY_LENGTH = 5;
+
+bool decodeSesameManufacturerData(const uint8_t* data, size_t length, SesameAdvert& out) {
+    if (length < IDENTITY_LENGTH) {
+        return false;
+    }
+    uint16_t company = static_cast<uint16_t>(data[0] | (data[1] << 8));
+    if (company != SESAME_ADVERT_COMPANY_ID) {
+        return false;
+    }
+
+    out = SesameAdvert();
+    out.model = data[2];
+    out.registered = (data[4] & 0x01) != 0;
+    return true;
+}
+
+bool decodeSesameAdvert(const uint8_t* payload, size_t length, SesameAdvert& out) {
+    size_t offset = 0;
+    while (offset < length) {
+        uint8_t fieldLength = payload[offset];
+        if (fieldLength == 0) {
+            // Zero padding ends the significant part
+            break;
+        }
+        if (offset + 1 + fieldLength > length) {
+            return false;
+        }
+
+        if (payload[offset + 1] == AD_TYPE_MANUFACTURER &&
+            decodeSesameManufacturerData(payload + offset + 2, fieldLength - 1, out)) {
+            return true;
+        }
+        offset += 1 + fieldLength;
+    }
+    return false;
+}
@@ -0,0 +1,1475 @@
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <Sesame.h>
+#include <SesameClient.h>
+#include "app.h"
+#include "boot_metrics.h"
+#include "config_store.h"
+#include "connection_scheduler.h"
+#include "history_file.h"
+#include "lan_api.h"
+#include "latency_histogram.h"
+#include "lock_registry.h"
+#include "log.h"
+#include "memory_telemetry.h"
+#include "power_manager.h"
+#include "sesame_advert.h"
+#include "stall_profiler.h"
+#include "state_cache.h"
+#include "timer_wheel.h"
+
+// Sesame client using official library
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameClient;
+
+// Longest the task sleeps when no timer is due
+const unsigned long MAX_TIMER_WAIT_MS = 30000;
+
+// Longest connectToSesame() blocks: every try may run to the connect
+// timeout, which the config store caps at SESAME_CONNECT_TIMEOUT_MAX_MS
+static_assert(SESAME_CONNECT_TIMEOUT_MS <= SESAME_CONNECT_TIMEOUT_MAX_MS, "the default connect timeout must be a valid setting");
+const unsigned long MAX_CONNECT_BLOCK_MS = (SESAME_CONNECT_RETRIES + 1) * static_cast<unsigned long>(SESAME_CONNECT_TIMEOUT_MAX_MS);
+
+// One loop pass can start a connection and then sleep; with time left for
+// the rest of the pass, it must still feed the watchdog in time
+const unsigned long LOOP_PASS_MARGIN_MS = 5000;
+static_assert(MAX_TIMER_WAIT_MS + MAX_CONNECT_BLOCK_MS + LOOP_PASS_MARGIN_MS <= TASK_WATCHDOG_TIMEOUT_S * 1000UL,
+              "the sesame task must get round its loop before the watchdog fires");
+
+// Shares the BLE radio between the configured locks
+static ConnectionScheduler connectionScheduler(SESAME_MAX_SESSIONS, SESAME_SESSION_SLICE_MS);
+
+// Command latency, all locks together: ingress (MQTT callback or RF frame
+// edge) -> BLE dispatch -> the status update confirming the new position
+static LatencyHistogram queueLatency;
+static LatencyHistogram bleLatency;
+static LatencyHistogram totalLatency;
+
+// Unexpected session drop -> session active again
+static LatencyHistogram reconnectLatency;
+static unsigned long lastMetricsPublish = 0;
+
+// Lock history, all locks together, mirrored to flash
+static HistoryLog historyLog;
+static HistoryFile historyFile(HISTORY_FILE_PATH, HISTORY_FILE_TEMP_PATH, HISTORY_FILE_MAX_BYTES);
+static unsigned long historyPendingSinceMs = 0;
+
+// Delayed commands and auto-relocks, all locks together
+static TimerWheel lockTimers;
+
+static unsigned long lastDiagnosticsPublish = 0;
+
+static bool bootReported = false;
+static bool bootStateRestored = false;
+
+// Everything the sesame task reacts to is handled in order on its own
+// thread: commands arrive on one queue, BLE callbacks on another
+enum class SesameEventType : uint8_t {
+    command,
+    state,
+    status,
+    history,
+    advert,
+    config     // runtime settings changed
+};
+
+struct SesameEvent {
+    SesameEventType type;
+    uint8_t lock;
+    SesameCommand command;
+    SesameClient::state_t state;
+    LockStatus status;
+    uint32_t timestampUs;   // micros() when the status notification arrived
+    bool historyValid;      // false when the lock had no history entry to return
+    HistoryEntry history;
+    SesameAdvert advert;
+    int8_t rssi;
+};
+
+static QueueHandle_t sesameQueue = nullptr;
+static QueueHandle_t bleQueue = nullptr;
+static QueueSetHandle_t sesameQueueSet = nullptr;
+static TaskHandle_t sesameTaskHandle = nullptr;
+
+// Callback events that did not fit: a lost state change would leave a
+// dropped session marked connected, and a lost status the command queue
+// waiting for a confirmation. Those two are never dropped; when even the
+// reserved queue slots are taken, the newest status waits here and the
+// task re-reads the session state. Adverts and history entries are dropped
+// and counted.
+struct BleOverflow {
+    bool statusPending;
+    bool stateResync;
+    SesameEvent status;
+};
+
+static_assert(SESAME_BLE_QUEUE_RESERVE < SESAME_BLE_QUEUE_LENGTH, "the BLE queue needs slots for adverts and history");
+
+static BleOverflow bleOverflow[lockCount];
+static portMUX_TYPE bleOverflowLock = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<bool> bleOverflowPending{false};
+static std::atomic<uint32_t> bleEventDrops{0};
+
+// Advertisement filter, touched only on the BLE host task: unchanged
+// adverts are forwarded once per SESAME_ADVERT_REFRESH_MS, not per packet
+struct AdvertFilter {
+    bool forwarded;
+    SesameAdvert last;
+    uint32_t forwardedMs;
+};
+
+static NimBLEAddress lockAddresses[lockCount];
+static AdvertFilter advertFilters[lockCount];
+static_assert(SESAME_ADVERT_REFRESH_MS < POWER_RSSI_MAX_AGE_MS, "a lock in range must refresh its RSSI before it counts as gone");
+
+bool prepareSesame(SesameLock& lock);
+void connectToSesame(SesameLock& lock);
+void sendSesameCommand(SesameLock& lock, const SesameCommand& command);
+void performAutoTest(SesameLock& lock);
+void publishStatus(SesameLock& lock);
+void publishStatusReply(SesameLock& lock, const PendingStatusRequest& request, const char* result);
+void publishCommandResult(SesameLock& lock, const CommandResult& result, bool mismatch);
+void publishMetrics();
+void publishHistory();
+void publishBootReport();
+void publishDiagnostics();
+void publishMemoryReport();
+CommandAction toggleSesame(SesameLock& lock, const SesameCommand& command);
+
+// Hand a callback event to the sesame task; runs on the BLE host task
+static void queueBleEvent(const SesameEvent& event) {
+    bool critical = event.type == SesameEventType::state || event.type == SesameEventType::status;
+
+    bool queued = false;
+    portENTER_CRITICAL(&bleOverflowLock);
+    BleOverflow& overflow = bleOverflow[event.lock];
+    // Once a lock's status waits in the overflow, newer ones join it there to keep their order
+    bool overflowing = event.type == SesameEventType::status && overflow.statusPending;
+    portEXIT_CRITICAL(&bleOverflowLock);
+
+    if (!overflowing && (critical || uxQueueSpacesAvailable(bleQueue) > SESAME_BLE_QUEUE_RESERVE)) {
+        queued = xQueueSend(bleQueue, &event, 0) == pdTRUE;
+    }
+    if (queued) {
+        return;
+    }
+    if (!critical) {
+        bleEventDrops++;
+        return;
+    }
+
+    portENTER_CRITICAL(&bleOverflowLock);
+    if (event.type == SesameEventType::state) {
+        overflow.stateResync = true;
+    } else {
+        overflow.statusPending = true;
+        overflow.status = event;
+    }
+    portEXIT_CRITICAL(&bleOverflowLock);
+    bleOverflowPending = true;
+}
+
+// Sesame status callback - called on the BLE host task when device status changes
+void statusUpdate(SesameClient& client, SesameClient::Status status) {
+    ProfileScope scope(ProfileSection::statusUpdate);
+    SesameLock* lock = lockForClient(client);
+    if (lock == nullptr) return;
+
+    LOG_DEBUG("📊 [%s] Status: lock=%u, unlock=%u, pos=%d, volt=%.2f, batt=%.1f%%\n",
+              lock->config->id, status.in_lock(), status.in_unlock(), status.position(),
+              status.voltage(), status.battery_pct());
+
+    SesameEvent event = {};
+    event.type = SesameEventType::status;
+    event.lock = static_cast<uint8_t>(lockIndex(*lock));
+    event.status.valid = true;
+    event.status.locked = status.in_lock();
+    event.status.unlocked = status.in_unlock();
+    event.status.position = status.position();
+    event.status.voltage = status.voltage();
+    event.status.batteryPct = status.battery_pct();
+    event.timestampUs = micros();
+    queueBleEvent(event);
+}
+
+// Sesame state callback - called on the BLE host task when connection state changes
+void stateUpdate(SesameClient& client, SesameClient::state_t state) {
+    ProfileScope scope(ProfileSection::stateUpdate);
+    SesameLock* lock = lockForClient(client);
+    if (lock == nullptr) return;
+
+    SesameEvent event = {};
+    event.type = SesameEventType::state;
+    event.lock = static_cast<uint8_t>(lockIndex(*lock));
+    event.state = state;
+    queueBleEvent(event);
+}
+
+// History callback - called on the BLE host task for every request_history()
+void historyReceived(SesameClient& client, const SesameClient::History& history) {
+    ProfileScope scope(ProfileSection::historyReceived);
+    SesameLock* lock = lockForClient(client);
+    if (lock == nullptr) return;
+
+    SesameEvent event = {};
+    event.type = SesameEventType::history;
+    event.lock = static_cast<uint8_t>(lockIndex(*lock));
+    event.historyValid = history.result == Sesame::result_code_t::success;
+    event.history.time = static_cast<uint32_t>(history.time);
+    event.history.lock = event.lock;
+    event.history.type = static_cast<uint8_t>(history.type);
+    strlcpy(event.history.tag, history.tag, sizeof(event.history.tag));
+    queueBleEvent(event);
+}
+
+static bool sameAdvert(const SesameAdvert& a, const SesameAdvert& b) {
+    return a.model == b.model && a.registered == b.registered;
+}
+
+// Scan callback - called on the BLE host task for every advertisement heard.
+// Runs for all nearby devices, so it only compares addresses and decodes the
+// raw payload in place; nothing is allocated.
+class AdvertScanCallbacks : public NimBLEScanCallbacks {
+    void onResult(const NimBLEAdvertisedDevice* device) override {
+        ProfileScope scope(ProfileSection::advert);
+        for (size_t i = 0; i < lockCount; i++) {
+            if (sesameLocks[i].disabled || !(device->getAddress() == lockAddresses[i])) continue;
+
+            const std::vector<uint8_t>& payload = device->getPayload();
+            SesameAdvert advert;
+            if (!decodeSesameAdvert(payload.data(), payload.size(), advert)) return;
+
+            AdvertFilter& filter = advertFilters[i];
+            uint32_t now = millis();
+            if (filter.forwarded && sameAdvert(advert, filter.last) &&
+                now - filter.forwardedMs < SESAME_ADVERT_REFRESH_MS) {
+                return;
+            }
+            filter.forwarded = true;
+            filter.last = advert;
+            filter.forwardedMs = now;
+
+            SesameEvent event = {};
+            event.type = SesameEventType::advert;
+            event.lock = static_cast<uint8_t>(i);
+            event.advert = advert;
+            event.rssi = static_cast<int8_t>(device->getRSSI());
+            event.timestampUs = micros();
+            queueBleEvent(event);
+            return;
+        }
+    }
+};
+
+static AdvertScanCallbacks advertScanCallbacks;
+
+static void requestHistory(SesameLock& lock) {
+    lock.historyInFlight = true;
+    lock.historyRequestedMs = millis();
+    lock.client.request_history();
+}
+
+// Start a fetch round; it ends at the first entry already stored
+static void startHistoryFetch(SesameLock& lock) {
+    lock.historyFetchBudget = HISTORY_FETCH_MAX;
+    if (lock.authenticated && !lock.historyInFlight) {
+        requestHistory(lock);
+    }
+}
+
+static void handleHistory(SesameLock& lock, const SesameEvent& event) {
+    lock.historyInFlight = false;
+
+    if (!event.historyValid || !historyLog.add(event.history)) {
+        // Nothing new: the lock has caught up with what we stored
+        lock.historyFetchBudget = 0;
+        return;
+    }
+
+    historyFile.append(event.history, historyLog);
+    if (historyLog.unpublished() == 1) {
+        historyPendingSinceMs = millis();
+    }
+
+    time_t time = event.history.time;
+    struct tm tm;
+    gmtime_r(&time, &tm);
+    LOG_DEBUG("📜 [%s] History: type=%u, %04d/%02d/%02d %02d:%02d:%02d, tag=%s\n",
+              lock.config->id, event.history.type, tm.tm_year + 1900, tm.tm_mon + 1,
+              tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, event.history.tag);
+
+    if (lock.historyFetchBudget > 0 && lock.authenticated) {
+        lock.historyFetchBudget--;
+        requestHistory(lock);
+    }
+}
+
+// Send the next queued lock/unlock once the previous one has been confirmed
+static void dispatchCommands(SesameLock& lock) {
+    if (!lock.authenticated) return;
+
+    SesameCommand command;
+    if (lock.commands.next(millis(), micros(), command)) {
+        queueLatency.record(command.dispatchUs - command.ingressUs);
+        sendSesameCommand(lock, command);
+    }
+}
+
+static void scheduleRelock(SesameLock& lock, uint32_t delayMs, const SesameCommand& unlock) {
+    TimerEntry entry = {};
+    entry.lock = static_cast<uint8_t>(lockIndex(lock));
+    entry.kind = TimerKind::relock;
+    entry.dueMs = millis() + delayMs;
+    strlcpy(entry.command.requestId, unlock.requestId, sizeof(entry.command.requestId));
+
+    // Only the latest unlock's relock counts
+    lockTimers.cancelLock(entry.lock, TimerKind::relock);
+    if (lockTimers.schedule(entry, millis()) == 0) {
+        LOG_WARN("⚠️ [%s] Timer table full - no auto-relock\n", lock.config->id);
+        return;
+    }
+    LOG_INFO("⏲️ [%s] Auto-relock in %lu ms\n", lock.config->id, static_cast<unsigned long>(delayMs));
+}
+
+// The relock timer starts once the lock has confirmed the unlock, and a
+// relock the lock never confirmed (out of range, no session) is retried
+static void updateRelock(SesameLock& lock, const CommandResult& result) {
+    const SesameCommand& command = result.command;
+
+    if (command.action == CommandAction::unlock && result.outcome == CommandOutcome::confirmed) {
+        uint32_t relockS = command.relockS == 0 ? AUTO_RELOCK_S : command.relockS;
+        if (relockS != 0 && relockS != COMMAND_RELOCK_NEVER) {
+            scheduleRelock(lock, relockS * 1000, command);
+        }
+    } else if (command.source == CommandSource::timer &&
+               (result.outcome == CommandOutcome::timeout || result.outcome == CommandOutcome::expired)) {
+        scheduleRelock(lock, AUTO_RELOCK_RETRY_MS, command);
+    }
+}
+
+static void publishCommandResults(SesameLock& lock) {
+    CommandResult result;
+    while (lock.commands.takeResult(result)) {
+        updateRelock(lock, result);
+        bool mismatch = lock.model.finished(result.command.action, result.outcome);
+        if (mismatch) {
+            LOG_INFO("🔀 [%s] %s not carried out - lock reports %s (%lu mismatches)\n", lock.config->id,
+                     commandActionName(result.command.action), lockStateName(lock.model.predicted()),
+                     static_cast<unsigned long>(lock.model.mismatches()));
+        }
+        if (result.outcome == CommandOutcome::confirmed) {
+            markBootStage(BootStage::command);
+            bleLatency.record(result.confirmUs - result.command.dispatchUs);
+            totalLatency.record(result.confirmUs - result.command.ingressUs);
+        }
+        LOG_DEBUG("📋 [%s] %s from %s: %s after %lu ms\n", lock.config->id,
+                  commandActionName(result.command.action), commandSourceName(result.command.source),
+                  commandOutcomeName(result.outcome), static_cast<unsigned long>(result.elapsedMs));
+        publishCommandResult(lock, result, mismatch);
+    }
+}
+
+// Connection parameters are left to NimBLE until one of them is overridden
+static void applyConnParams(SesameLock& lock) {
+    if (!configOverridden(ConfigKey::connIntervalMin) && !configOverridden(ConfigKey::connIntervalMax) &&
+        !configOverridden(ConfigKey::connLatency) && !configOverridden(ConfigKey::supervisionTimeout)) {
+        return;
+    }
+
+    NimBLEClient* client = NimBLEDevice::getClientByPeerAddress(lockAddresses[lockIndex(lock)]);
+    if (client == nullptr || !client->isConnected()) {
+        return;
+    }
+    if (!client->updateConnParams(configValue(ConfigKey::connIntervalMin), configValue(ConfigKey::connIntervalMax),
+                                  configValue(ConfigKey::connLatency), configValue(ConfigKey::supervisionTimeout))) {
+        LOG_WARN("⚠️ [%s] Connection parameter update refused\n", lock.config->id);
+    }
+}
+
+// Settings changed over MQTT: what the sesame task applies itself. Timeouts
+// and intervals are read where they are used and need nothing here.
+static void applyConfig() {
+    NimBLEDevice::setMTU(configValue(ConfigKey::bleMtu));
+    for (SesameLock& lock : sesameLocks) {
+        lock.client.set_connect_timeout(configValue(ConfigKey::connectTimeoutMs));
+        if (lock.authenticated) {
+            applyConnParams(lock);
+        }
+    }
+}
+
+static void handleStateChange(SesameLock& lock, SesameClient::state_t state) {
+    lock.state = state;
+
+    const char* stateName = nullptr;
+    switch (state) {
+        case SesameClient::state_t::idle:
+            stateName = "idle";
+            if (lock.releasing) {
+                // Session handed to another lock - eligible again right away
+                lock.retryAtMs = millis();
+            } else {
+                if (lock.authenticated && !lock.reconnecting) {
+                    lock.reconnecting = true;
+                    lock.droppedAtMs = millis();
+                }
+                uint32_t delayMs = lock.backoff.nextDelayMs(esp_random());
+                lock.retryAtMs = millis() + delayMs;
+                if (lock.connected || lock.authenticated) {
+                    LOG_WARN("⚠️ [%s] Connection lost - will retry in %lu ms\n", lock.config->id,
+                             static_cast<unsigned long>(delayMs));
+                }
+            }
+            lock.releasing = false;
+            lock.connected = false;
+            lock.authenticated = false;
+            lock.historyInFlight = false;
+            break;
+        case SesameClient::state_t::connected:
+            stateName = "connected";
+            lock.connected = true;
+            break;
+        case SesameClient::state_t::authenticating:
+            stateName = "authenticating";
+            break;
+        case SesameClient::state_t::active:
+            stateName = "active";
+            lock.authenticated = true;
+            lock.sessionStartedMs = millis();
+            lock.lastUsedMs = lock.sessionStartedMs;
+            lock.lastTrafficMs = lock.sessionStartedMs;
+            lock.lastAutoTest = millis(); // Start auto-test timer
+            lock.backoff.reset();
+            markBootStage(BootStage::session);
+            applyConnParams(lock);
+
+            if (lock.reconnecting) {
+                unsigned long downMs = millis() - lock.droppedAtMs;
+                reconnectLatency.record(downMs < UINT32_MAX / 1000 ? downMs * 1000 : UINT32_MAX);
+                lock.reconnecting = false;
+                LOG_INFO("⏱️ [%s] Session back after %lu ms\n", lock.config->id, downMs);
+            }
+
+            // Verify session is truly active
+            if (lock.client.is_session_active()) {
+                LOG_INFO("🔐 [%s] Authentication successful! Session is active\n", lock.config->id);
+                // Request initial status (also answers status requests made while offline)
+                lock.client.request_status();
+                // Catch up on history written while we were not connected
+                startHistoryFetch(lock);
+            } else {
+                LOG_WARN("⚠️ [%s] State is active but session not confirmed\n", lock.config->id);
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (stateName != nullptr) {
+        LOG_INFO("🔄 [%s] Sesame state: %s\n", lock.config->id, stateName);
+    } else {
+        LOG_INFO("🔄 [%s] Sesame state: unknown(%u)\n", lock.config->id, static_cast<unsigned>(state));
+    }
+}
+
+// The lock answered - every pending status request gets this fresh status
+static void completeStatusRequests(SesameLock& lock) {
+    bool publishedStatus = false;
+    PendingStatusRequest request;
+
+    while (lock.statusRequests.takeAny(request)) {
+        if (request.requestId[0] != '\0') {
+            publishStatusReply(lock, request, "ok");
+        } else if (!publishedStatus) {
+            // Requests without an id keep the old behaviour: one publish on the status topic
+            publishStatus(lock);
+            publishedStatus = true;
+        }
+    }
+}
+
+static void expireStatusRequests(SesameLock& lock) {
+    PendingStatusRequest request;
+    unsigned long now = millis();
+
+    while (lock.statusRequests.takeExpired(now, request)) {
+        LOG_INFO("⏰ [%s] Status request '%s' timed out\n", lock.config->id, request.requestId);
+        if (request.requestId[0] != '\0') {
+            publishStatusReply(lock, request, "timeout");
+        }
+    }
+}
+
+static void startCommand(SesameLock& lock, const SesameCommand& command) {
+    // A command for an idle lock skips whatever backoff delay is left
+    if (!lock.connected && !lock.disabled && static_cast<int32_t>(millis() - lock.retryAtMs) < 0) {
+        LOG_INFO("⚡ [%s] Command while idle - reconnecting now\n", lock.config->id);
+        lock.retryAtMs = millis();
+    }
+
+    if (command.action == CommandAction::status) {
+        sendSesameCommand(lock, command);
+        return;
+    }
+
+    // Toggles are resolved against the predicted state, so a second toggle
+    // behind an unconfirmed one reverses it instead of repeating it
+    SesameCommand queued = command;
+    if (command.action == CommandAction::toggle) {
+        queued.action = toggleSesame(lock, command);
+    }
+
+    if (!lock.commands.push(queued, millis())) {
+        return;
+    }
+    lock.model.commanded(queued.action);
+    if (!lock.authenticated) {
+        // The scheduler brings the lock up; the task loop sends it once active
+        LOG_INFO("⏳ [%s] Not authenticated - holding %s command until connected\n",
+                 lock.config->id, commandActionName(queued.action));
+    }
+}
+
+static void handleCommand(const SesameCommand& command) {
+    int index = findLockIndex(command.target);
+    if (index < 0) {
+        LOG_ERROR("❌ Unknown lock: %s\n", command.target);
+        return;
+    }
+    SesameLock& lock = sesameLocks[index];
+
+    if (command.action != CommandAction::status) {
+        if (command.delayS > 0) {
+            TimerEntry entry = {};
+            entry.lock = static_cast<uint8_t>(index);
+            entry.kind = TimerKind::command;
+            entry.dueMs = millis() + command.delayS * 1000;
+            entry.command = command;
+            if (lockTimers.schedule(entry, millis()) == 0) {
+                LOG_WARN("⚠️ [%s] Timer table full - dropping delayed %s\n", lock.config->id,
+                         commandActionName(command.action));
+            } else {
+                LOG_INFO("⏲️ [%s] %s in %lu s\n", lock.config->id, commandActionName(command.action),
+                         static_cast<unsigned long>(command.delayS));
+            }
+            return;
+        }
+
+        // Anything done to the lock now overrides what was scheduled for it
+        size_t cancelled = lockTimers.cancelLock(static_cast<uint8_t>(index));
+        if (cancelled > 0) {
+            LOG_INFO("⏹️ [%s] %u timer(s) cancelled by %s command\n", lock.config->id,
+                     static_cast<unsigned>(cancelled), commandSourceName(command.source));
+        }
+    }
+
+    startCommand(lock, command);
+}
+
+// Run delayed commands and relocks whose time has come
+static void fireTimers() {
+    TimerEntry entry;
+    while (lockTimers.takeDue(millis(), entry)) {
+        SesameLock& lock = sesameLocks[entry.lock];
+        SesameCommand command = entry.command;
+        command.delayS = 0;
+        command.ingressUs = micros();
+
+        if (entry.kind == TimerKind::relock) {
+            // The lock confirmed it is already locked (by hand or by the lock's own auto-lock)
+            if (lock.status.valid && lock.status.locked && !lock.statusRestored) {
+                LOG_INFO("🔒 [%s] Auto-relock not needed - already locked\n", lock.config->id);
+                continue;
+            }
+            command.action = CommandAction::lock;
+            command.source = CommandSource::timer;
+        }
+
+        LOG_DEBUG("⏰ [%s] Timer: %s\n", lock.config->id, commandActionName(command.action));
+        startCommand(lock, command);
+    }
+}
+
+static void handleStatus(SesameLock& lock, const SesameEvent& event) {
+    // Only a change of lock state writes a history record worth fetching
+    bool moved = !lock.status.valid || lock.status.locked != event.status.locked ||
+                 lock.status.unlocked != event.status.unlocked;
+
+    lock.status = event.status;
+    lock.model.observed(event.status.locked, event.status.unlocked, event.status.position, true);
+    lock.statusRestored = false;
+    lock.lastTrafficMs = millis();
+    saveLockStatus(lockIndex(lock), lock.status);
+    markBootStage(BootStage::state);
+    lock.commands.statusUpdate(event.status.locked, event.status.unlocked, millis(), event.timestampUs);
+    completeStatusRequests(lock);
+
+    if (moved) {
+        startHistoryFetch(lock);
+    }
+}
+
+// The lock advertised: it is in range. Adverts only tell presence, model and
+// registration; the lock state always comes from a session.
+static void handleAdvert(SesameLock& lock, const SesameEvent& event) {
+    if (!lock.advertSeen || lock.advertRegistered != event.advert.registered) {
+        if (event.advert.registered) {
+            LOG_DEBUG("📡 [%s] Advertising, rssi=%d\n", lock.config->id, event.rssi);
+        } else {
+            LOG_WARN("⚠️ [%s] Lock advertises itself as unregistered - sessions will fail\n", lock.config->id);
+        }
+    }
+    lock.advertSeen = true;
+    lock.advertRegistered = event.advert.registered;
+    lock.advertRssi = event.rssi;
+    lock.advertSeenMs = millis();
+}
+
+static void handleEvent(const SesameEvent& event) {
+    switch (event.type) {
+        case SesameEventType::command:
+            notePowerActivity();
+            handleCommand(event.command);
+            break;
+        case SesameEventType::state:
+            handleStateChange(sesameLocks[event.lock], event.state);
+            break;
+        case SesameEventType::status:
+            handleStatus(sesameLocks[event.lock], event);
+            break;
+        case SesameEventType::history:
+            handleHistory(sesameLocks[event.lock], event);
+            break;
+        case SesameEventType::advert:
+            handleAdvert(sesameLocks[event.lock], event);
+            break;
+        case SesameEventType::config:
+            applyConfig();
+            break;
+    }
+}
+
+// Apply what overflowed the BLE queue, once everything queued before it is handled
+static void serviceBleOverflow() {
+    if (!bleOverflowPending || uxQueueMessagesWaiting(bleQueue) > 0) {
+        return;
+    }
+    bleOverflowPending = false;
+
+    for (SesameLock& lock : sesameLocks) {
+        portENTER_CRITICAL(&bleOverflowLock);
+        BleOverflow overflow = bleOverflow[lockIndex(lock)];
+        bleOverflow[lockIndex(lock)].statusPending = false;
+        bleOverflow[lockIndex(lock)].stateResync = false;
+        portEXIT_CRITICAL(&bleOverflowLock);
+
+        if (overflow.stateResync) {
+            SesameClient::state_t state = lock.client.get_state();
+            LOG_WARN("⚠️ [%s] BLE events overflowed - resyncing session state\n", lock.config->id);
+            if (state != lock.state) {
+                handleStateChange(lock, state);
+            }
+        }
+        if (overflow.statusPending) {
+            handleStatus(lock, overflow.status);
+        }
+    }
+}
+
+static void buildSchedule(LockSchedule* schedule) {
+    for (size_t i = 0; i < lockCount; i++) {
+        const SesameLock& lock = sesameLocks[i];
+        schedule[i].connected = lock.connected;
+        schedule[i].disabled = lock.disabled;
+        schedule[i].pendingWork = lock.commands.hasQueued() || !lock.statusRequests.empty();
+        schedule[i].onDemand = SESAME_PASSIVE_MONITOR;
+        schedule[i].retryAtMs = lock.retryAtMs;
+        schedule[i].sessionStartedMs = lock.sessionStartedMs;
+        schedule[i].lastUsedMs = lock.lastUsedMs;
+    }
+}
+
+// Free a session slot if another lock needs the radio, then start the next connection
+static void scheduleConnections() {
+    LockSchedule schedule[lockCount];
+    buildSchedule(schedule);
+
+    unsigned long now = millis();
+    int release = connectionScheduler.sessionToRelease(schedule, lockCount, now);
+    if (release >= 0 && !sesameLocks[release].releasing) {
+        SesameLock& lock = sesameLocks[release];
+        LOG_INFO("🔀 [%s] Releasing BLE session for another lock\n", lock.config->id);
+        lock.releasing = true;
+        lock.client.disconnect();
+    }
+
+    int next = connectionScheduler.nextToConnect(schedule, lockCount, now);
+    if (next >= 0) {
+        LOG_INFO("🔄 [%s] Attempting to connect to Sesame...\n", sesameLocks[next].config->id);
+        connectToSesame(sesameLocks[next]);
+    }
+}
+
+// Poll status on a quiet session so neither side lets it go idle, and so a
+// session the lock dropped silently is noticed before the next command
+static void keepAlive(SesameLock& lock) {
+    if (!lock.authenticated || millis() - lock.lastTrafficMs < configValue(ConfigKey::keepaliveMs)) {
+        return;
+    }
+
+    lock.lastTrafficMs = millis();
+    lock.client.request_status();
+}
+
+// Passive monitoring: nothing left for this session to do
+static bool sessionIdle(const SesameLock& lock) {
+    return SESAME_PASSIVE_MONITOR && lock.authenticated && !lock.releasing &&
+           lock.commands.depth() == 0 && lock.statusRequests.empty() && !lock.historyInFlight &&
+           !(AUTO_TEST_ENABLED && !lock.autoTestCompleted);
+}
+
+// Hand back a session once its work is done; adverts keep the lock's
+// presence and signal known until the next command needs a connection
+static void releaseIdleSession(SesameLock& lock) {
+    if (!sessionIdle(lock) || millis() - lock.lastTrafficMs < configValue(ConfigKey::idleDisconnectMs)) {
+        return;
+    }
+
+    LOG_INFO("💤 [%s] Session idle - disconnecting\n", lock.config->id);
+    lock.releasing = true;
+    lock.client.disconnect();
+}
+
+// Keep the passive scan running. Starting a connection stops it (NimBLE
+// cannot scan and initiate at the same time), so it resumes once no
+// connection is being set up.
+static void serviceAdvertScan() {
+    if (!SESAME_PASSIVE_MONITOR) return;
+
+    for (const SesameLock& lock : sesameLocks) {
+        if (lock.connected && !lock.authenticated) return;
+    }
+
+    NimBLEScan* scan = NimBLEDevice::getScan();
+    if (!scan->isScanning()) {
+        scan->start(0, false, false);
+    }
+}
+
+// Feed the power manager the furthest lock's signal, for the adaptive TX
+// power; unknown until every usable lock has advertised recently
+static void updatePower() {
+    bool rssiKnown = true;
+    int8_t weakestRssi = INT8_MAX;
+    for (const SesameLock& lock : sesameLocks) {
+        if (lock.disabled) continue;
+        if (!lock.advertSeen || millis() - lock.advertSeenMs > POWER_RSSI_MAX_AGE_MS) {
+            rssiKnown = false;
+            break;
+        }
+        if (lock.advertRssi < weakestRssi) {
+            weakestRssi = lock.advertRssi;
+        }
+    }
+    servicePower(rssiKnown && weakestRssi != INT8_MAX, weakestRssi);
+}
+
+// Ticks until the next timed job (lock timers, auto-test, keepalive, timeouts, metrics or connection) is due
+static TickType_t nextTimerWait() {
+    unsigned long now = millis();
+    uint32_t wait = MAX_TIMER_WAIT_MS;
+
+    if (bleOverflowPending) {
+        return 0;
+    }
+
+    LockSchedule schedule[lockCount];
+    buildSchedule(schedule);
+    uint32_t scheduleWait = connectionScheduler.msUntilNextDecision(schedule, lockCount, now);
+    if (scheduleWait < wait) {
+        wait = scheduleWait;
+    }
+
+    uint32_t timerWait = lockTimers.msUntilNext(now);
+    if (timerWait < wait) {
+        wait = timerWait;
+    }
+
+    uint32_t powerWait = msUntilPowerChange();
+    if (powerWait < wait) {
+        wait = powerWait;
+    }
+
+    unsigned long sinceMetrics = now - lastMetricsPublish;
+    uint32_t metricsWait = sinceMetrics >= METRICS_PUBLISH_INTERVAL_MS ? 0 : METRICS_PUBLISH_INTERVAL_MS - sinceMetrics;
+    if (metricsWait < wait) {
+        wait = metricsWait;
+    }
+
+    unsigned long sinceDiagnostics = now - lastDiagnosticsPublish;
+    uint32_t diagnosticsWait = sinceDiagnostics >= DIAGNOSTICS_INTERVAL_MS ? 0 : DIAGNOSTICS_INTERVAL_MS - sinceDiagnostics;
+    if (diagnosticsWait < wait) {
+        wait = diagnosticsWait;
+    }
+
+    if (!bootReported) {
+        uint32_t bootWait = now >= BOOT_REPORT_DELAY_MS ? 0 : BOOT_REPORT_DELAY_MS - now;
+        if (bootWait < wait) {
+            wait = bootWait;
+        }
+    }
+
+    if (historyLog.unpublished() > 0) {
+        unsigned long pending = now - historyPendingSinceMs;
+        uint32_t historyWait = pending >= HISTORY_PUBLISH_DELAY_MS ? 0 : HISTORY_PUBLISH_DELAY_MS - pending;
+        if (historyWait < wait) {
+            wait = historyWait;
+        }
+    }
+
+    for (const SesameLock& lock : sesameLocks) {
+        if (lock.historyInFlight) {
+            unsigned long waited = now - lock.historyRequestedMs;
+            uint32_t fetchWait = waited >= HISTORY_FETCH_TIMEOUT_MS ? 0 : HISTORY_FETCH_TIMEOUT_MS - waited;
+            if (fetchWait < wait) {
+                wait = fetchWait;
+            }
+        }
+
+        if (lock.authenticated) {
+            unsigned long quiet = now - lock.lastTrafficMs;
+            uint32_t interval = configValue(ConfigKey::keepaliveMs);
+            uint32_t keepAliveWait = quiet >= interval ? 0 : interval - quiet;
+            if (keepAliveWait < wait) {
+                wait = keepAliveWait;
+            }
+        }
+
+        if (sessionIdle(lock)) {
+            unsigned long quiet = now - lock.lastTrafficMs;
+            uint32_t idleAfter = configValue(ConfigKey::idleDisconnectMs);
+            uint32_t idleWait = quiet >= idleAfter ? 0 : idleAfter - quiet;
+            if (idleWait < wait) {
+                wait = idleWait;
+            }
+        }
+
+        if (AUTO_TEST_ENABLED && lock.authenticated && !lock.autoTestCompleted) {
+            unsigned long elapsed = now - lock.lastAutoTest;
+            uint32_t autoTestWait = elapsed > AUTO_TEST_DELAY_MS ? 0 : AUTO_TEST_DELAY_MS - elapsed + 1;
+            if (autoTestWait < wait) {
+                wait = autoTestWait;
+            }
+        }
+
+        uint32_t statusWait = lock.statusRequests.msUntilNextDeadline(now);
+        if (statusWait < wait) {
+            wait = statusWait;
+        }
+
+        uint32_t commandWait = lock.commands.msUntilNextDeadline(now);
+        if (commandWait < wait) {
+            wait = commandWait;
+        }
+    }
+
+    return pdMS_TO_TICKS(wait);
+}
+
+// Sesame task - sleeps until a command/callback arrives or a timer is due
+static void sesameTask(void* parameter) {
+    (void)parameter;
+
+    SesameEvent event;
+    watchdogSubscribe(WatchedTask::sesame);
+
+    for (;;) {
+        watchdogFeed(WatchedTask::sesame);
+
+        {
+            ProfileScope scope(ProfileSection::connect);
+            scheduleConnections();
+        }
+
+        QueueSetMemberHandle_t ready = xQueueSelectFromSet(sesameQueueSet, nextTimerWait());
+        if (ready != nullptr && xQueueReceive(ready, &event, 0) == pdTRUE) {
+            ProfileScope scope(ProfileSection::sesameEvent);
+            handleEvent(event);
+        }
+        serviceBleOverflow();
+
+        // Everything else this pass does, publishing included
+        ProfileScope scope(ProfileSection::sesameService);
+        fireTimers();
+
+        for (SesameLock& lock : sesameLocks) {
+            // Answer status requests the lock never replied to
+            expireStatusRequests(lock);
+
+            keepAlive(lock);
+
+            // A history request the lock never answered ends the round
+            if (lock.historyInFlight && millis() - lock.historyRequestedMs >= HISTORY_FETCH_TIMEOUT_MS) {
+                lock.historyInFlight = false;
+                lock.historyFetchBudget = 0;
+            }
+
+            // Auto-test after authentication
+            if (AUTO_TEST_ENABLED && lock.authenticated && !lock.autoTestCompleted &&
+                (millis() - lock.lastAutoTest) > AUTO_TEST_DELAY_MS) {
+                performAutoTest(lock);
+            }
+
+            // Time out unconfirmed commands, send the next one and report outcomes
+            lock.commands.expire(millis());
+            dispatchCommands(lock);
+            publishCommandResults(lock);
+
+            releaseIdleSession(lock);
+        }
+
+        // May stop the scan to change its duty cycle; serviceAdvertScan() restarts it
+        updatePower();
+        serviceAdvertScan();
+
+        if (millis() - lastMetricsPublish >= METRICS_PUBLISH_INTERVAL_MS) {
+            publishMetrics();
+        }
+
+        if (millis() - lastDiagnosticsPublish >= DIAGNOSTICS_INTERVAL_MS) {
+            publishDiagnostics();
+            publishMemoryReport();
+        }
+
+        if (!bootReported && (bootStageMs(BootStage::command) != 0 || millis() >= BOOT_REPORT_DELAY_MS)) {
+            publishBootReport();
+        }
+
+        if (historyLog.unpublished() >= HISTORY_BATCH_SIZE ||
+            (historyLog.unpublished() > 0 && millis() - historyPendingSinceMs >= HISTORY_PUBLISH_DELAY_MS)) {
+            publishHistory();
+        }
+    }
+}
+
+void startSesameTask() {
+    sesameQueue = xQueueCreate(SESAME_QUEUE_LENGTH, sizeof(SesameEvent));
+    bleQueue = xQueueCreate(SESAME_BLE_QUEUE_LENGTH, sizeof(SesameEvent));
+    sesameQueueSet = xQueueCreateSet(SESAME_QUEUE_LENGTH + SESAME_BLE_QUEUE_LENGTH);
+    xQueueAddToSet(sesameQueue, sesameQueueSet);
+    xQueueAddToSet(bleQueue, sesameQueueSet);
+
+    initLockRegistry();
+    historyFile.begin(historyLog);
+
+    // Start from the last known state, so a toggle right after a reset
+    // goes the right way; the first live status replaces it
+    for (SesameLock& lock : sesameLocks) {
+        if (restoreLockStatus(lockIndex(lock), lock.status)) {
+            lock.model.observed(lock.status.locked, lock.status.unlocked, 0, false);
+            lock.statusRestored = true;
+            bootStateRestored = true;
+            LOG_INFO("💾 [%s] Restored last state: lock=%u, unlock=%u\n", lock.config->id,
+                     lock.status.locked, lock.status.unlocked);
+        }
+    }
+
+    // Configure Sesame client callbacks
+    for (SesameLock& lock : sesameLocks) {
+        lock.client.set_state_callback(stateUpdate);
+        lock.client.set_status_callback(statusUpdate);
+        lock.client.set_history_callback(historyReceived);
+        lock.client.set_connect_timeout(configValue(ConfigKey::connectTimeoutMs));
+
+        lock.disabled = !prepareSesame(lock);
+    }
+
+    if (SESAME_PASSIVE_MONITOR) {
+        // Passive scan with duplicates reported: every advert is a presence/RSSI sample
+        NimBLEScan* scan = NimBLEDevice::getScan();
+        scan->setScanCallbacks(&advertScanCallbacks, true);
+        scan->setActiveScan(false);
+        scan->setInterval(SESAME_SCAN_INTERVAL_MS);
+        scan->setWindow(SESAME_SCAN_WINDOW_MS);
+        scan->setMaxResults(0);
+        LOG_INFO("📡 Passive monitoring: tracking locks from advertisements\n");
+    }
+
+    xTaskCreatePinnedToCore(sesameTask, "sesame", SESAME_TASK_STACK, nullptr,
+                            SESAME_TASK_PRIORITY, &sesameTaskHandle, APP_TASK_CORE);
+    trackTaskStack(sesameTaskHandle, "sesame");
+}
+
+// Wake the sesame task to apply changed settings; safe to call from any task
+bool queueConfigChanged() {
+    SesameEvent event = {};
+    event.type = SesameEventType::config;
+    return sesameQueue != nullptr && xQueueSend(sesameQueue, &event, 0) == pdTRUE;
+}
+
+// Hand a command to the sesame task; safe to call from any task
+bool queueSesameCommand(const SesameCommand& command) {
+    SesameEvent event = {};
+    event.type = SesameEventType::command;
+    event.command = command;
+
+    if (sesameQueue == nullptr || xQueueSend(sesameQueue, &event, 0) != pdTRUE) {
+        LOG_WARN("⚠️ Sesame queue full - dropping %s command\n", commandActionName(command.action));
+        return false;
+    }
+    return true;
+}
+
+// Parse the address and keys and hand them to the client once; reconnects
+// then only need connect()
+static_assert(LOCK_SECRET_SIZE == Sesame::SECRET_SIZE && LOCK_PUBLIC_KEY_SIZE == Sesame::PK_SIZE,
+              "lock_config.h key sizes must match libsesame3bt");
+
+// Keys and address were validated and converted by the compiler (lock_config.h)
+bool prepareSesame(SesameLock& lock) {
+    const LockSecrets& secrets = lockSecrets[lockIndex(lock)];
+    if (secrets.address == 0) {
+        LOG_ERROR("❌ [%s] No address configured in SESAME_LOCKS\n", lock.config->id);
+        return false;
+    }
+
+    // Setup client with fixed address
+    NimBLEAddress deviceAddress(secrets.address, BLE_ADDR_RANDOM);
+    lockAddresses[lockIndex(lock)] = deviceAddress;
+    Sesame::model_t model = static_cast<Sesame::model_t>(lock.config->model);
+
+    if (!lock.client.begin(deviceAddress, model)) {
+        LOG_ERROR("❌ [%s] Failed to begin Sesame client\n", lock.config->id);
+        return false;
+    }
+
+    if (!lock.client.set_keys(secrets.publicKey, secrets.secret)) {
+        LOG_ERROR("❌ [%s] Failed to set keys\n", lock.config->id);
+        return false;
+    }
+
+    LOG_INFO("🔑 [%s] Keys set for %s\n", lock.config->id, lock.config->address);
+    return true;
+}
+
+void connectToSesame(SesameLock& lock) {
+    LOG_INFO("🔗 [%s] Connecting to Sesame: %s\n", lock.config->id, lock.config->address);
+
+    if (SESAME_PASSIVE_MONITOR) {
+        NimBLEDevice::getScan()->stop();
+    }
+
+    if (!lock.client.connect(SESAME_CONNECT_RETRIES)) {
+        uint32_t delayMs = lock.backoff.nextDelayMs(esp_random());
+        lock.retryAtMs = millis() + delayMs;
+        LOG_ERROR("❌ Failed to connect to Sesame - retry in %lu ms\n", static_cast<unsigned long>(delayMs));
+        if (lock.backoff.attempts() == 1) {
+            LOG_INFO("💡 Please ensure:\n");
+            LOG_INFO("   - Sesame app is completely closed\n");
+            LOG_INFO("   - Device is not connected to other services\n");
+            LOG_INFO("   - ESP32 is close to Sesame device\n");
+        }
+        return;
+    }
+
+    // Holds a session slot from now on, even before the state callback arrives.
+    // The slice starts now too, or slice rotation would see the previous
+    // session's start and release the lock before it authenticates.
+    lock.connected = true;
+    lock.sessionStartedMs = millis();
+    LOG_INFO("✅ Connection initiated successfully\n");
+}
+
+// History tag recorded by the lock for a command
+static const char* commandTag(const SesameCommand& command) {
+    switch (command.source) {
+        case CommandSource::rxb6: return "RXB6 433MHz";
+        case CommandSource::autotest: return "Auto-test";
+        case CommandSource::timer: return "Auto-relock";
+        default: return command.action == CommandAction::lock ? "ESP32 lock" : "ESP32 unlock";
+    }
+}
+
+void sendSesameCommand(SesameLock& lock, const SesameCommand& command) {
+    LOG_DEBUG("🔧 [%s] Sending command: %s (queued %lu us)\n",
+              lock.config->id, commandActionName(command.action),
+              static_cast<unsigned long>(micros() - command.ingressUs));
+
+    lock.lastUsedMs = millis();
+    lock.lastTrafficMs = lock.lastUsedMs;
+
+    switch (command.action) {
+        case CommandAction::unlock:
+            lock.client.unlock(commandTag(command));
+            break;
+        case CommandAction::lock:
+            lock.client.lock(commandTag(command));
+            break;
+        case CommandAction::status: {
+            // Completed from statusUpdate(); only the first concurrent poller hits BLE.
+            // Without a session the request waits for the status sent on authentication.
+            bool requestOutstanding = !lock.statusRequests.empty();
+            if (!lock.statusRequests.add(command.requestId, command.source, millis(), STATUS_REQUEST_TIMEOUT_MS)) {
+                LOG_WARN("⚠️ Too many pending status requests - dropping\n");
+                break;
+            }
+            if (!requestOutstanding && lock.authenticated) {
+                lock.client.request_status();
+            }
+            break;
+        }
+        default:
+            LOG_ERROR("❌ Unknown command: %s\n", commandActionName(command.action));
+            break;
+    }
+}
+
+void performAutoTest(SesameLock& lock) {
+    if (!lock.authenticated) return;
+
+    LOG_INFO("⚡ [%s] Starting auto-test sequence...\n", lock.config->id);
+    LOG_INFO("🔓 Auto-test: UNLOCK\n");
+
+    SesameCommand command = {};
+    command.action = CommandAction::unlock;
+    command.source = CommandSource::autotest;
+    command.ingressUs = micros();
+    command.relockS = AUTO_TEST_RELOCK_S;
+    if (lock.commands.push(command, millis())) {
+        lock.model.commanded(command.action);
+    }
+    lock.autoTestCompleted = true;
+
+    LOG_INFO("⏰ Auto-test: LOCK follows %u s after the unlock is confirmed\n", AUTO_TEST_RELOCK_S);
+}
+
+static void fillStatus(EventWriter& event, const SesameLock& lock) {
+    event.add(FieldId::lock, lock.config->id);
+    if (event.format() == PayloadFormat::json) {
+        // Static per lock; compact consumers know them from the lock id
+        event.add(FieldId::device, lock.config->name);
+        event.add(FieldId::address, lock.config->address);
+    }
+    event.add(FieldId::wifiConnected, wifiConnected.load());
+    event.add(FieldId::mqttConnected, mqttConnected.load());
+    event.add(FieldId::sesameConnected, lock.connected);
+    event.add(FieldId::sesameAuthenticated, lock.authenticated);
+
+    if (lock.status.valid) {
+        event.add(FieldId::batteryPct, lock.status.batteryPct);
+        event.add(FieldId::voltage, lock.status.voltage);
+        event.add(FieldId::position, lock.status.position);
+        event.add(FieldId::locked, lock.status.locked);
+        event.add(FieldId::unlocked, lock.status.unlocked);
+        if (lock.statusRestored) {
+            event.add(FieldId::stateRestored, true);
+        }
+    }
+
+    if (lock.advertSeen) {
+        event.add(FieldId::rssi, lock.advertRssi);
+        event.add(FieldId::advertAgeMs, millis() - lock.advertSeenMs);
+    }
+
+    event.add(FieldId::predicted, lockStateName(lock.model.predicted()));
+    if (lock.model.mismatches() > 0) {
+        event.add(FieldId::mismatches, lock.model.mismatches());
+    }
+
+    uint32_t relockIn = lockTimers.msUntilNext(static_cast<uint8_t>(lockIndex(lock)), TimerKind::relock, millis());
+    if (relockIn != UINT32_MAX) {
+        event.add(FieldId::relockInMs, relockIn);
+    }
+}
+
+// The first lock also publishes on the single-lock topics from before
+// SESAME_LOCKS, so existing subscribers keep working
+static void publishLockEvent(const SesameLock& lock, const char* topic, const char* legacyTopic,
+                             const EventWriter& event) {
+    queuePublish(topic, event);
+    if (lockIndex(lock) == 0) {
+        queuePublish(legacyTopic, event);
+    }
+}
+
+void publishStatus(SesameLock& lock) {
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    fillStatus(event, lock);
+    event.finish();
+
+    publishLockEvent(lock, lock.topics->status, MQTT_TOPIC_STATUS, event);
+    lanPublish(LanFrameType::status, event);
+}
+
+// Reply to one correlated status request on the lock's status/reply topic
+void publishStatusReply(SesameLock& lock, const PendingStatusRequest& request, const char* result) {
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::requestId, request.requestId);
+    event.add(FieldId::result, result);
+    event.add(FieldId::elapsedMs, millis() - request.startedMs);
+    if (strcmp(result, "ok") == 0) {
+        fillStatus(event, lock);
+    }
+    event.finish();
+
+    publishLockEvent(lock, lock.topics->statusReply, MQTT_TOPIC_STATUS_REPLY, event);
+    lanPublish(LanFrameType::statusReply, event);
+}
+
+// Publish how a lock/unlock command ended on the lock's result topic
+void publishCommandResult(SesameLock& lock, const CommandResult& result, bool mismatch) {
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::lock, lock.config->id);
+    event.add(FieldId::action, commandActionName(result.command.action));
+    event.add(FieldId::source, commandSourceName(result.command.source));
+    if (result.command.requestId[0] != '\0') {
+        event.add(FieldId::requestId, result.command.requestId);
+    }
+    event.add(FieldId::result, commandOutcomeName(result.outcome));
+    event.add(FieldId::elapsedMs, result.elapsedMs);
+    if (mismatch) {
+        // The lock settled in the other state: jammed, or turned by hand meanwhile
+        event.add(FieldId::stateMismatch, true);
+    }
+    event.finish();
+
+    queuePublish(lock.topics->result, event);
+    lanPublish(LanFrameType::result, event);
+}
+
+static void addLatency(EventWriter& event, FieldId stage, const LatencyHistogram& histogram) {
+    event.beginObject(stage);
+    event.add(FieldId::count, histogram.count());
+    event.add(FieldId::p50Us, histogram.percentileUs(50));
+    event.add(FieldId::p95Us, histogram.percentileUs(95));
+    event.add(FieldId::p99Us, histogram.percentileUs(99));
+    event.add(FieldId::maxUs, histogram.maxUs());
+    event.endObject();
+}
+
+// Publish this window's latency histograms and start a new window
+void publishMetrics() {
+    unsigned long now = millis();
+    unsigned long window = now - lastMetricsPublish;
+    lastMetricsPublish = now;
+
+    if (queueLatency.count() == 0 && totalLatency.count() == 0 && reconnectLatency.count() == 0) {
+        return;
+    }
+
+    LOG_INFO("⏱️ Command latency: n=%lu p50=%lu us p95=%lu us p99=%lu us\n",
+             static_cast<unsigned long>(totalLatency.count()),
+             static_cast<unsigned long>(totalLatency.percentileUs(50)),
+             static_cast<unsigned long>(totalLatency.percentileUs(95)),
+             static_cast<unsigned long>(totalLatency.percentileUs(99)));
+
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::windowMs, window);
+    addLatency(event, FieldId::queue, queueLatency);
+    addLatency(event, FieldId::ble, bleLatency);
+    addLatency(event, FieldId::total, totalLatency);
+    addLatency(event, FieldId::reconnect, reconnectLatency);
+    event.finish();
+
+    queuePublish(MQTT_TOPIC_METRICS, event);
+
+    queueLatency.reset();
+    bleLatency.reset();
+    totalLatency.reset();
+    reconnectLatency.reset();
+}
+
+// Section timings, stalls and watchdog margin for the last window. Only
+// sections that ran are listed, a few per message to stay within the payload size.
+void publishDiagnostics() {
+    unsigned long now = millis();
+    unsigned long window = now - lastDiagnosticsPublish;
+    lastDiagnosticsPublish = now;
+
+    StallReport report;
+    takeStallReport(report);
+
+    uint32_t stalls = 0;
+    for (const SectionStats& stats : report.sections) {
+        stalls += stats.stalls;
+    }
+
+    LOG_INFO("🩺 Diagnostics: %lu stalls, worst %s %lu us, watchdog gap %lu ms (%s)\n",
+             static_cast<unsigned long>(stalls), profileSectionName(report.worstSection),
+             static_cast<unsigned long>(report.worstUs), static_cast<unsigned long>(report.maxFeedGapMs),
+             watchedTaskName(report.gapTask));
+
+    const size_t sectionCount = static_cast<size_t>(ProfileSection::count);
+    size_t next = 0;
+    bool first = true;
+    while (first || next < sectionCount) {
+        uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+        EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+        event.add(FieldId::windowMs, window);
+        if (first) {
+            event.add(FieldId::stalls, stalls);
+            event.add(FieldId::worstSection, profileSectionName(report.worstSection));
+            event.add(FieldId::worstUs, report.worstUs);
+            event.add(FieldId::feedGapTask, watchedTaskName(report.gapTask));
+            event.add(FieldId::maxFeedGapMs, report.maxFeedGapMs);
+            event.add(FieldId::bleEventDrops, bleEventDrops.load());
+            first = false;
+        }
+
+        event.beginArray(FieldId::sections);
+        size_t listed = 0;
+        for (; next < sectionCount && listed < DIAGNOSTICS_SECTIONS_PER_MESSAGE; next++) {
+            const SectionStats& stats = report.sections[next];
+            if (stats.count == 0) continue;
+
+            event.beginArrayObject();
+            event.add(FieldId::section, profileSectionName(static_cast<ProfileSection>(next)));
+            event.add(FieldId::count, stats.count);
+            event.add(FieldId::meanUs, static_cast<uint32_t>(stats.totalUs / stats.count));
+            event.add(FieldId::maxUs, stats.maxUs);
+            event.add(FieldId::stalls, stats.stalls);
+            event.endObject();
+            listed++;
+        }
+        event.endArray();
+        event.finish();
+
+        queuePublish(MQTT_TOPIC_DIAGNOSTICS, event);
+
+        while (next < sectionCount && report.sections[next].count == 0) {
+            next++;
+        }
+    }
+}
+
+// Heap and stack headroom, published with the diagnostics
+void publishMemoryReport() {
+    MemoryReport report;
+    takeMemoryReport(report);
+
+    LOG_INFO("🧮 Heap: %lu free, %lu largest block (%u%% fragmented), %lu lowest\n",
+             static_cast<unsigned long>(report.freeHeap), static_cast<unsigned long>(report.largestFreeBlock),
+             report.fragmentationPct, static_cast<unsigned long>(report.minFreeHeap));
+
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::freeHeap, report.freeHeap);
+    event.add(FieldId::minFreeHeap, report.minFreeHeap);
+    event.add(FieldId::largestFreeBlock, report.largestFreeBlock);
+    event.add(FieldId::fragmentationPct, report.fragmentationPct);
+    event.beginArray(FieldId::stacks);
+    for (size_t i = 0; i < report.taskCount; i++) {
+        event.beginArrayObject();
+        event.add(FieldId::task, report.tasks[i].name);
+        event.add(FieldId::stackFree, report.tasks[i].freeBytes);
+        event.endObject();
+    }
+    event.endArray();
+    event.finish();
+
+    queuePublish(MQTT_TOPIC_MEMORY, event);
+}
+
+// Once per boot: how long each bring-up stage took after the reset
+void publishBootReport() {
+    bootReported = true;
+
+    static const struct {
+        BootStage stage;
+        FieldId field;
+    } stages[] = {
+        {BootStage::ble, FieldId::bleMs},
+        {BootStage::wifi, FieldId::wifiMs},
+        {BootStage::mqtt, FieldId::mqttMs},
+        {BootStage::state, FieldId::stateMs},
+        {BootStage::session, FieldId::sessionMs},
+        {BootStage::command, FieldId::firstCommandMs},
+    };
+
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::resetReason, resetReasonName());
+    for (const auto& entry : stages) {
+        // Stages not reached by now are left out
+        uint32_t ms = bootStageMs(entry.stage);
+        if (ms != 0) {
+            event.add(entry.field, ms);
+        }
+    }
+    event.add(FieldId::stateRestored, bootStateRestored);
+    event.finish();
+
+    queuePublish(MQTT_TOPIC_BOOT, event);
+    LOG_INFO("⏱️ Boot report: ble=%lu ms, wifi=%lu ms, mqtt=%lu ms, session=%lu ms, first command=%lu ms\n",
+             static_cast<unsigned long>(bootStageMs(BootStage::ble)),
+             static_cast<unsigned long>(bootStageMs(BootStage::wifi)),
+             static_cast<unsigned long>(bootStageMs(BootStage::mqtt)),
+             static_cast<unsigned long>(bootStageMs(BootStage::session)),
+             static_cast<unsigned long>(bootStageMs(BootStage::command)));
+}
+
+// Publish one batch of new history entries (all of one lock) on its history topic
+void publishHistory() {
+    HistoryEntry batch[HISTORY_BATCH_SIZE];
+    size_t count = historyLog.takeUnpublished(batch, HISTORY_BATCH_SIZE);
+    if (count == 0) {
+        return;
+    }
+    // Anything left over goes out with the next batch right away
+    historyPendingSinceMs = millis() - HISTORY_PUBLISH_DELAY_MS;
+
+    SesameLock& lock = sesameLocks[batch[0].lock];
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::lock, lock.config->id);
+    event.beginArray(FieldId::entries);
+    for (size_t i = 0; i < count; i++) {
+        event.beginArrayObject();
+        event.add(FieldId::time, batch[i].time);
+        event.add(FieldId::type, batch[i].type);
+        event.add(FieldId::tag, batch[i].tag);
+        event.endObject();
+    }
+    event.endArray();
+    event.finish();
+
+    queuePublish(lock.topics->history, event);
+    LOG_DEBUG("📤 [%s] Published %u history entries\n", lock.config->id, static_cast<unsigned>(count));
+}
+
+// Decide which way a toggle goes: away from the predicted state (the
+// pending target, else the last reported or approached position)
+CommandAction toggleSesame(SesameLock& lock, const SesameCommand& command) {
+    CommandAction action = lock.model.toggleAction();
+    switch (lock.model.predicted()) {
+        case LockState::locked:
+            LOG_DEBUG("🔓 Toggle: UNLOCKING Sesame\n");
+            break;
+        case LockState::unlocked:
+            LOG_DEBUG("🔒 Toggle: LOCKING Sesame\n");
+            break;
+        default:
+            LOG_DEBUG("❓ Toggle: Unknown state, defaulting to UNLOCK\n");
+            break;
+    }
+
+    // Publish MQTT action notification
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    EventWriter event(MQTT_PAYLOAD_FORMAT, payload, sizeof(payload));
+    event.add(FieldId::lock, lock.config->id);
+    event.add(FieldId::action, commandActionName(action));
+    event.add(FieldId::trigger, commandSourceName(command.source));
+    event.add(FieldId::reason, command.source == CommandSource::rxb6 ? "RXB6 433MHz" : "ESP32 toggle");
+    event.add(FieldId::timestamp, millis());
+    event.finish();
+
+    publishLockEvent(lock, lock.topics->status, MQTT_TOPIC_STATUS, event);
+    LOG_DEBUG("📤 [%s] Sesame %s triggered by %s\n", lock.config->id, commandActionName(action),
+              commandSourceName(command.source));
+
+    return action;
+}
@@ -0,0 +1,116 @@
+#include <Arduino.h>
+#include <esp_task_wdt.h>
+#include "config.h"
+#include "log.h"
+#include "stall_profiler.h"
+
+static const size_t sectionCount = static_cast<size_t>(ProfileSection::count);
+static const size_t taskCount = static_cast<size_t>(WatchedTask::count);
+
+// Written from several tasks; every update is a few stores under the spinlock
+static portMUX_TYPE profilerLock = portMUX_INITIALIZER_UNLOCKED;
+static StallReport window;
+static uint32_t lastFeedMs[taskCount];
+static bool watched[taskCount];
+
+void recordSection(ProfileSection section, uint32_t elapsedUs) {
+    bool stalled = elapsedUs >= STALL_THRESHOLD_US;
+
+    portENTER_CRITICAL(&profilerLock);
+    SectionStats& stats = window.sections[static_cast<size_t>(section)];
+    stats.count++;
+    stats.totalUs += elapsedUs;
+    if (elapsedUs > stats.maxUs) {
+        stats.maxUs = elapsedUs;
+    }
+    if (stalled) {
+        stats.stalls++;
+    }
+    if (elapsedUs > window.worstUs) {
+        window.worstUs = elapsedUs;
+        window.worstSection = section;
+    }
+    portEXIT_CRITICAL(&profilerLock);
+
+    if (stalled) {
+        LOG_WARN("🐢 Stall: %s took %lu ms\n", profileSectionName(section),
+                 static_cast<unsigned long>(elapsedUs / 1000));
+    }
+}
+
+void takeStallReport(StallReport& out) {
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&profilerLock);
+    // A task stuck right now counts too, not only gaps that have ended
+    for (size_t i = 0; i < taskCount; i++) {
+        uint32_t gap = now - lastFeedMs[i];
+        if (watched[i] && gap > window.maxFeedGapMs) {
+            window.maxFeedGapMs = gap;
+            window.gapTask = static_cast<WatchedTask>(i);
+        }
+    }
+    out = window;
+    window = StallReport();
+    portEXIT_CRITICAL(&profilerLock);
+}
+
+void watchdogBegin() {
+    // Arduino starts the watchdog with a 5 s timeout meant for the idle
+    // tasks; ours sleep for up to MAX_TIMER_WAIT_MS between feeds
+    esp_task_wdt_init(TASK_WATCHDOG_TIMEOUT_S, true);
+}
+
+void watchdogSubscribe(WatchedTask task) {
+    esp_task_wdt_add(nullptr);
+
+    portENTER_CRITICAL(&profilerLock);
+    watched[static_cast<size_t>(task)] = true;
+    lastFeedMs[static_cast<size_t>(task)] = millis();
+    portEXIT_CRITICAL(&profilerLock);
+}
+
+void watchdogFeed(WatchedTask task) {
+    esp_task_wdt_reset();
+
+    uint32_t now = millis();
+    size_t index = static_cast<size_t>(task);
+
+    portENTER_CRITICAL(&profilerLock);
+    uint32_t gap = now - lastFeedMs[index];
+    if (gap > window.maxFeedGapMs) {
+        window.maxFeedGapMs = gap;
+        window.gapTask = task;
+    }
+    lastFeedMs[index] = now;
+    portEXIT_CRITICAL(&profilerLock);
+}
+
+const char* profileSectionName(ProfileSection section) {
+    switch (section) {
+        case ProfileSection::wifi: return "wifi";
+        case ProfileSection::mqttConnect: return "mqtt_connect";
+        case ProfileSection::mqttLoop: return "mqtt_loop";
+        case ProfileSection::mqttCallback: return "mqtt_callback";
+        case ProfileSection::publish: return "publish";
+        case ProfileSection::replay: return "replay";
+        case ProfileSection::sesameEvent: return "sesame_event";
+        case ProfileSection::sesameService: return "sesame_service";
+        case ProfileSection::connect: return "connect";
+        case ProfileSection::statusUpdate: return "status_update";
+        case ProfileSection::stateUpdate: return "state_update";
+        case ProfileSection::historyReceived: return "history_received";
+        case ProfileSection::advert: return "advert";
+        case ProfileSection::rxb6: return "rxb6";
+        case ProfileSection::lanPacket: return "lan_packet";
+        default: return "unknown";
+    }
+}
+
+const char* watchedTaskName(WatchedTask task) {
+    switch (task) {
+        case WatchedTask::network: return "network";
+        case WatchedTask::sesame: return "sesame";
+        default: return "unknown";
+    }
+}
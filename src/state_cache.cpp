@@ -0,0 +1,124 @@
+#include "state_cache.h"
+#include <Preferences.h>
+#include "lock_config.h"
+#include "log.h"
+#include "rtc_section.h"
+
+// Layout version: a firmware with different structs ignores old contents
+static const uint32_t CACHE_MAGIC = 0x53455301;
+
+// One section per owning task: locks (sesame task), network (network task)
+static RTC_NOINIT_ATTR RtcSection<LockStatus[lockCount]> rtcLocks;
+static RTC_NOINIT_ATTR RtcSection<CachedNetwork> rtcNetwork;
+
+// What NVS currently holds per lock, to skip writes that change nothing
+static bool nvsLocked[lockCount];
+static bool nvsUnlocked[lockCount];
+static bool nvsKnown[lockCount];
+
+static void lockKey(char* key, size_t size, size_t lock) {
+    snprintf(key, size, "lock%u", static_cast<unsigned>(lock));
+}
+
+static bool nvsRead(const char* key, void* data, size_t length) {
+    Preferences preferences;
+    if (!preferences.begin(STATE_CACHE_NAMESPACE, true)) {
+        return false;
+    }
+    bool ok = preferences.getBytesLength(key) == length && preferences.getBytes(key, data, length) == length;
+    preferences.end();
+    return ok;
+}
+
+static void nvsWrite(const char* key, const void* data, size_t length) {
+    Preferences preferences;
+    if (!preferences.begin(STATE_CACHE_NAMESPACE, false)) {
+        return;
+    }
+    if (preferences.putBytes(key, data, length) != length) {
+        LOG_WARN("⚠️ State cache: failed to write %s\n", key);
+    }
+    preferences.end();
+}
+
+bool restoreLockStatus(size_t lock, LockStatus& out) {
+    if (lock >= lockCount) {
+        return false;
+    }
+
+    char key[12];
+    lockKey(key, sizeof(key), lock);
+    LockStatus stored;
+    if (nvsRead(key, &stored, sizeof(stored)) && stored.valid) {
+        nvsKnown[lock] = true;
+        nvsLocked[lock] = stored.locked;
+        nvsUnlocked[lock] = stored.unlocked;
+    } else {
+        stored.valid = false;
+    }
+
+    // RTC memory is newer whenever it survived the reset
+    if (rtcLocks.valid(CACHE_MAGIC) && rtcLocks.data[lock].valid) {
+        out = rtcLocks.data[lock];
+        return true;
+    }
+    if (stored.valid) {
+        out = stored;
+        return true;
+    }
+    return false;
+}
+
+void saveLockStatus(size_t lock, const LockStatus& status) {
+    if (lock >= lockCount || !status.valid) {
+        return;
+    }
+
+    if (!rtcLocks.valid(CACHE_MAGIC)) {
+        memset(&rtcLocks.data, 0, sizeof(rtcLocks.data));
+    }
+    rtcLocks.data[lock] = status;
+    rtcLocks.seal(CACHE_MAGIC);
+
+    if (nvsKnown[lock] && nvsLocked[lock] == status.locked && nvsUnlocked[lock] == status.unlocked) {
+        return;
+    }
+    char key[12];
+    lockKey(key, sizeof(key), lock);
+    nvsWrite(key, &status, sizeof(status));
+    nvsKnown[lock] = true;
+    nvsLocked[lock] = status.locked;
+    nvsUnlocked[lock] = status.unlocked;
+}
+
+bool restoreNetwork(CachedNetwork& out) {
+    if (rtcNetwork.valid(CACHE_MAGIC)) {
+        out = rtcNetwork.data;
+        return true;
+    }
+    if (nvsRead("wifi", &out, sizeof(out))) {
+        rtcNetwork.data = out;
+        rtcNetwork.seal(CACHE_MAGIC);
+        return true;
+    }
+    return false;
+}
+
+void saveNetwork(const CachedNetwork& network) {
+    if (rtcNetwork.valid(CACHE_MAGIC) && memcmp(&rtcNetwork.data, &network, sizeof(network)) == 0) {
+        return;
+    }
+    rtcNetwork.data = network;
+    rtcNetwork.seal(CACHE_MAGIC);
+    nvsWrite("wifi", &network, sizeof(network));
+}
+
+void clearNetwork() {
+    rtcNetwork.invalidate();
+
+    Preferences preferences;
+    if (preferences.begin(STATE_CACHE_NAMESPACE, false)) {
+        preferences.remove("wifi");
+        preferences.end();
+    }
+}
@@ -0,0 +1,59 @@
+#include "status_requests.h"
+#include <string.h>
+
+StatusRequestTracker::StatusRequestTracker() : slots(), count(0) {}
+
+bool StatusRequestTracker::add(const char* requestId, CommandSource source, uint32_t nowMs, uint32_t timeoutMs) {
+    for (PendingStatusRequest& slot : slots) {
+        if (slot.active) continue;
+
+        slot.active = true;
+        slot.source = source;
+        slot.startedMs = nowMs;
+        slot.deadlineMs = nowMs + timeoutMs;
+        strncpy(slot.requestId, requestId, sizeof(slot.requestId) - 1);
+        slot.requestId[sizeof(slot.requestId) - 1] = '\0';
+        count++;
+        return true;
+    }
+    return false;
+}
+
+bool StatusRequestTracker::takeAny(PendingStatusRequest& out) {
+    for (PendingStatusRequest& slot : slots) {
+        if (!slot.active) continue;
+
+        out = slot;
+        slot.active = false;
+        count--;
+        return true;
+    }
+    return false;
+}
+
+bool StatusRequestTracker::takeExpired(uint32_t nowMs, PendingStatusRequest& out) {
+    for (PendingStatusRequest& slot : slots) {
+        // Signed difference keeps the comparison valid across millis() wrap-around
+        if (!slot.active || static_cast<int32_t>(nowMs - slot.deadlineMs) < 0) continue;
+
+        out = slot;
+        slot.active = false;
+        count--;
+        return true;
+    }
+    return false;
+}
+
+uint32_t StatusRequestTracker::msUntilNextDeadline(uint32_t nowMs) const {
+    uint32_t earliest = UINT32_MAX;
+    for (const PendingStatusRequest& slot : slots) {
+        if (!slot.active) continue;
+
+        int32_t remaining = static_cast<int32_t>(slot.deadlineMs - nowMs);
+        uint32_t wait = remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+        if (wait < earliest) {
+            earliest = wait;
+        }
+    }
+    return earliest;
+}
@@ -0,0 +1,156 @@
+#include "timer_wheel.h"
+
+// Start of the tick containing ms
+static uint32_t tickStart(uint32_t ms) {
+    return ms & ~static_cast<uint32_t>(TIMER_WHEEL_TICK_MS - 1);
+}
+
+static size_t bucketOf(uint32_t ms) {
+    return (ms / TIMER_WHEEL_TICK_MS) & (TIMER_WHEEL_SLOTS - 1);
+}
+
+TimerWheel::TimerWheel() : nodes(), freeList(0), count(0), cursorMs(0) {
+    for (uint8_t& bucket : buckets) {
+        bucket = NONE;
+    }
+    for (size_t i = 0; i < TIMER_WHEEL_CAPACITY; i++) {
+        nodes[i].next = i + 1 < TIMER_WHEEL_CAPACITY ? static_cast<uint8_t>(i + 1) : NONE;
+    }
+}
+
+uint16_t TimerWheel::schedule(const TimerEntry& entry, uint32_t nowMs) {
+    if (freeList == NONE) {
+        return 0;
+    }
+    if (count == 0) {
+        // Nothing to fire in between: the cursor can jump to now
+        cursorMs = tickStart(nowMs);
+    }
+
+    uint8_t index = freeList;
+    Node& node = nodes[index];
+    freeList = node.next;
+
+    node.active = true;
+    node.generation++;
+    node.entry = entry;
+
+    // A timer already due goes in the cursor bucket, which is scanned next
+    uint32_t tick = tickStart(entry.dueMs);
+    if (static_cast<int32_t>(tick - cursorMs) < 0) {
+        tick = cursorMs;
+    }
+    node.bucket = static_cast<uint8_t>(bucketOf(tick));
+    node.next = buckets[node.bucket];
+    buckets[node.bucket] = index;
+    count++;
+
+    // index + 1 keeps the handle non-zero
+    return static_cast<uint16_t>((node.generation << 8) | (index + 1));
+}
+
+void TimerWheel::unlink(uint8_t index) {
+    for (uint8_t* link = &buckets[nodes[index].bucket]; *link != NONE; link = &nodes[*link].next) {
+        if (*link == index) {
+            *link = nodes[index].next;
+            nodes[index].active = false;
+            nodes[index].next = freeList;
+            freeList = index;
+            count--;
+            return;
+        }
+    }
+}
+
+bool TimerWheel::cancel(uint16_t handle) {
+    uint8_t slot = handle & 0xFF;
+    if (slot == 0 || slot > TIMER_WHEEL_CAPACITY) {
+        return false;
+    }
+    uint8_t index = slot - 1;
+    if (!nodes[index].active || nodes[index].generation != (handle >> 8)) {
+        return false;
+    }
+    unlink(index);
+    return true;
+}
+
+size_t TimerWheel::cancelLock(uint8_t lock) {
+    size_t cancelled = 0;
+    for (size_t i = 0; i < TIMER_WHEEL_CAPACITY; i++) {
+        if (nodes[i].active && nodes[i].entry.lock == lock) {
+            unlink(static_cast<uint8_t>(i));
+            cancelled++;
+        }
+    }
+    return cancelled;
+}
+
+size_t TimerWheel::cancelLock(uint8_t lock, TimerKind kind) {
+    size_t cancelled = 0;
+    for (size_t i = 0; i < TIMER_WHEEL_CAPACITY; i++) {
+        if (nodes[i].active && nodes[i].entry.lock == lock && nodes[i].entry.kind == kind) {
+            unlink(static_cast<uint8_t>(i));
+            cancelled++;
+        }
+    }
+    return cancelled;
+}
+
+bool TimerWheel::takeDue(uint32_t nowMs, TimerEntry& out) {
+    uint32_t nowTick = tickStart(nowMs);
+    if (count == 0) {
+        cursorMs = nowTick;
+        return false;
+    }
+
+    // After a long sleep one revolution covers every bucket
+    const uint32_t revolutionMs = TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK_MS;
+    if (nowTick - cursorMs >= revolutionMs) {
+        cursorMs = nowTick - (revolutionMs - TIMER_WHEEL_TICK_MS);
+    }
+
+    for (;;) {
+        for (uint8_t* link = &buckets[bucketOf(cursorMs)]; *link != NONE; link = &nodes[*link].next) {
+            Node& node = nodes[*link];
+            // Later revolutions share the bucket; only entries that are due fire
+            if (static_cast<int32_t>(nowMs - node.entry.dueMs) >= 0) {
+                out = node.entry;
+                unlink(*link);
+                return true;
+            }
+        }
+        if (cursorMs == nowTick) {
+            return false;
+        }
+        cursorMs += TIMER_WHEEL_TICK_MS;
+    }
+}
+
+uint32_t TimerWheel::msUntilNext(uint32_t nowMs) const {
+    uint32_t earliest = UINT32_MAX;
+    for (const Node& node : nodes) {
+        if (!node.active) continue;
+
+        int32_t remaining = static_cast<int32_t>(node.entry.dueMs - nowMs);
+        uint32_t wait = remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+        if (wait < earliest) {
+            earliest = wait;
+        }
+    }
+    return earliest;
+}
+
+uint32_t TimerWheel::msUntilNext(uint8_t lock, TimerKind kind, uint32_t nowMs) const {
+    uint32_t earliest = UINT32_MAX;
+    for (const Node& node : nodes) {
+        if (!node.active || node.entry.lock != lock || node.entry.kind != kind) continue;
+
+        int32_t remaining = static_cast<int32_t>(node.entry.dueMs - nowMs);
+        uint32_t wait = remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+        if (wait < earliest) {
+            earliest = wait;
+        }
+    }
+    return earliest;
+}
@@ -0,0 +1,12 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <stddef.h>
+
+// Heap allocations made by code under test, for the suites that check a
+// path does not touch the heap. Counted by the global operator new of the
+// host simulation (test/support/sim/src/heap.cpp), which every native
+// binary links; the simulation's own bookkeeping is left out.
+extern size_t allocations;
+
+#endif
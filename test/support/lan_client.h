@@ -0,0 +1,98 @@
+#ifndef LAN_CLIENT_H
+#define LAN_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include "lan_frame.h"
+
+// Host side of the LAN command API (include/lan_api.h), on the frame code
+// the firmware uses: hello, answer the challenge with its cookie, take the
+// session nonce from the welcome, then signed commands with an increasing
+// sequence number. Transport is up to the caller: hello() and command()
+// fill a datagram to send, receive() takes one from the device and may
+// fill the reply.
+class LanClient {
+public:
+    static constexpr size_t FRAME_MAX = LAN_FRAME_HEADER_SIZE + 512 + LAN_FRAME_MAC_SIZE;
+
+    LanClient(const char* key, uint64_t nonceSeed) : key(key), clientNonce(nonceSeed) {}
+
+    // Starts a new session with a fresh client nonce (the firmware accepts
+    // each one once)
+    size_t hello(uint8_t* out) {
+        clientNonce++;
+        sessionOpen = false;
+        uint8_t body[LAN_CLIENT_NONCE_SIZE];
+        lanPutLe(body, clientNonce, LAN_CLIENT_NONCE_SIZE);
+        return lanBuildFrame(key, out, LanFrameType::hello, 0, 0, body, sizeof(body));
+    }
+
+    // A datagram from the device. Returns the length of the reply written
+    // to reply (the second hello, after a challenge), else 0.
+    size_t receive(const uint8_t* data, size_t length, uint8_t* reply) {
+        LanFrame frame;
+        if (!lanParseFrame(data, length, frame) || !lanFrameAuthentic(key, data, length)) {
+            rejected++;
+            return 0;
+        }
+        lastType = frame.type;
+        lastBody.assign(reinterpret_cast<const char*>(frame.body), frame.bodyLength);
+
+        bool ours = frame.bodyLength >= LAN_CLIENT_NONCE_SIZE &&
+                    lanGetLe(frame.body, LAN_CLIENT_NONCE_SIZE) == clientNonce;
+        switch (frame.type) {
+            case LanFrameType::challenge:
+                if (!ours || frame.bodyLength != LAN_CLIENT_NONCE_SIZE + LAN_COOKIE_SIZE) {
+                    rejected++;
+                    return 0;
+                }
+                // Client nonce and cookie go back unchanged
+                return lanBuildFrame(key, reply, LanFrameType::hello, 0, 0, frame.body, frame.bodyLength);
+            case LanFrameType::welcome:
+                if (!ours) {
+                    rejected++;
+                    return 0;
+                }
+                sessionNonce = frame.nonce;
+                sessionOpen = true;
+                seq = 0;
+                return 0;
+            default:
+                if (!sessionOpen || frame.nonce != sessionNonce) {
+                    rejected++;
+                }
+                return 0;
+        }
+    }
+
+    bool open() const { return sessionOpen; }
+
+    // A command (JSON or CBOR body, as on MQTT) with the next sequence
+    // number; 0 without a session
+    size_t command(const uint8_t* body, size_t bodyLength, uint8_t* out) {
+        if (!sessionOpen) {
+            return 0;
+        }
+        return lanBuildFrame(key, out, LanFrameType::command, sessionNonce, ++seq, body, bodyLength);
+    }
+
+    size_t command(const char* json, uint8_t* out) {
+        return command(reinterpret_cast<const uint8_t*>(json), strlen(json), out);
+    }
+
+    // The last authentic frame received
+    LanFrameType lastType = LanFrameType::hello;
+    std::string lastBody;
+    uint32_t rejected = 0;   // bad MAC, or not for this session
+
+private:
+    const char* key;
+    uint64_t clientNonce;
+    uint64_t sessionNonce = 0;
+    uint32_t seq = 0;
+    bool sessionOpen = false;
+};
+
+#endif
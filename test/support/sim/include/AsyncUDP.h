@@ -0,0 +1,45 @@
+#ifndef SIM_ASYNCUDP_H
+#define SIM_ASYNCUDP_H
+
+#include <functional>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+// Datagrams to and from the simulated LAN (sim::LanPeer). Handlers run on
+// the simulation thread, like the AsyncUDP task.
+
+class AsyncUDPPacket {
+public:
+    AsyncUDPPacket(const uint8_t* data, size_t length, IPAddress remoteIp, uint16_t remotePort)
+        : bytes(data), size(length), fromIp(remoteIp), fromPort(remotePort) {}
+
+    uint8_t* data() { return const_cast<uint8_t*>(bytes); }
+    size_t length() { return size; }
+    IPAddress remoteIP() { return fromIp; }
+    uint16_t remotePort() { return fromPort; }
+
+private:
+    const uint8_t* bytes;
+    size_t size;
+    IPAddress fromIp;
+    uint16_t fromPort;
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+class AsyncUDP {
+public:
+    bool listen(uint16_t port);
+    void onPacket(AuPacketHandlerFunction callback);
+    size_t writeTo(const uint8_t* data, size_t length, const IPAddress& address, uint16_t port);
+    void close();
+
+    // Called by the simulated LAN
+    void deliver(AsyncUDPPacket& packet);
+
+private:
+    uint16_t port = 0;
+    AuPacketHandlerFunction handler;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+// A flat in-memory file system with the partition's capacity; bytes
+// written are counted in sim::storageStats() (flash wear)
+
+namespace sim {
+struct FileNode;
+}
+
+class File {
+public:
+    File() {}
+    File(std::shared_ptr<sim::FileNode> node, bool readable, bool writable, bool append);
+
+    explicit operator bool() const { return node != nullptr; }
+    size_t size() const;
+    size_t position() const { return offset; }
+    bool seek(uint32_t position);
+    size_t read(uint8_t* buffer, size_t length);
+    size_t write(const uint8_t* buffer, size_t length);
+    void flush() {}
+    void close();
+
+private:
+    std::shared_ptr<sim::FileNode> node;
+    size_t offset = 0;
+    bool readable = false;
+    bool writable = false;
+    bool append = false;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false);
+    File open(const char* path, const char* mode = "r");
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    size_t totalBytes();
+    size_t usedBytes();
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef SIM_NIMBLEDEVICE_H
+#define SIM_NIMBLEDEVICE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// The NimBLE-Arduino 2.x surface the firmware uses. Connections are made by
+// the libsesame3bt fake (SesameClient.h) to simulated locks (sim::Lock);
+// the scanner reports their advertisements while it runs.
+
+#define BLE_ADDR_PUBLIC 0
+#define BLE_ADDR_RANDOM 1
+
+class NimBLEAddress {
+public:
+    NimBLEAddress() : value(0), type(BLE_ADDR_PUBLIC) {}
+    // First octet in the most significant byte
+    NimBLEAddress(uint64_t address, uint8_t type) : value(address & 0xFFFFFFFFFFFFull), type(type) {}
+
+    uint64_t toUint64() const { return value; }
+    uint8_t getType() const { return type; }
+    bool isNull() const { return value == 0; }
+    std::string toString() const;
+    bool operator==(const NimBLEAddress& other) const { return value == other.value && type == other.type; }
+    bool operator!=(const NimBLEAddress& other) const { return !(*this == other); }
+
+private:
+    uint64_t value;
+    uint8_t type;
+};
+
+typedef NimBLEAddress BLEAddress;
+
+// The link to one connected lock
+class NimBLEClient {
+public:
+    bool isConnected() const { return connected; }
+    bool updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+
+    // Set by the simulated lock
+    bool connected = false;
+    uint16_t connInterval = 0;  // last accepted maximum interval, 1.25 ms units
+    uint32_t paramUpdates = 0;
+};
+
+class NimBLEAdvertisedDevice {
+public:
+    NimBLEAdvertisedDevice(const NimBLEAddress& address, int8_t rssi, const std::vector<uint8_t>& payload)
+        : address(address), rssi(rssi), payload(payload) {}
+
+    const NimBLEAddress& getAddress() const { return address; }
+    int8_t getRSSI() const { return rssi; }
+    const std::vector<uint8_t>& getPayload() const { return payload; }
+
+private:
+    NimBLEAddress address;
+    int8_t rssi;
+    const std::vector<uint8_t>& payload;
+};
+
+class NimBLEScanResults {};
+
+class NimBLEScanCallbacks {
+public:
+    virtual ~NimBLEScanCallbacks() {}
+    virtual void onDiscovered(const NimBLEAdvertisedDevice* device) { (void)device; }
+    virtual void onResult(const NimBLEAdvertisedDevice* device) { (void)device; }
+    virtual void onScanEnd(const NimBLEScanResults& results, int reason) {
+        (void)results;
+        (void)reason;
+    }
+};
+
+class NimBLEScan {
+public:
+    void setScanCallbacks(NimBLEScanCallbacks* callbacks, bool wantDuplicates = false);
+    void setActiveScan(bool active);
+    void setInterval(uint16_t intervalMs);
+    void setWindow(uint16_t windowMs);
+    void setMaxResults(uint8_t maxResults);
+    bool start(uint32_t durationMs, bool isContinue = false, bool restart = true);
+    bool stop();
+    bool isScanning();
+
+    // Read by the simulated locks
+    NimBLEScanCallbacks* callbacks = nullptr;
+    uint16_t intervalMs = 100;
+    uint16_t windowMs = 100;
+    bool scanning = false;
+    uint32_t generation = 0;   // bumped on every start, so old advert events lapse
+    uint32_t starts = 0;
+};
+
+class NimBLEDevice {
+public:
+    static bool init(const std::string& deviceName);
+    static bool setMTU(uint16_t mtu);
+    static bool setPower(int8_t dbm);
+    static int getPower();
+    static NimBLEScan* getScan();
+    // Connected client for a peer, nullptr if there is none
+    static NimBLEClient* getClientByPeerAddress(const NimBLEAddress& address);
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SIM_PUBSUBCLIENT_H
+#define SIM_PUBSUBCLIENT_H
+
+#include <functional>
+#include <vector>
+#include "Arduino.h"
+#include "WiFi.h"
+
+// PubSubClient 2.8 against the simulated broker (sim::broker()): QoS 0,
+// the same buffer limit on publish, one inbound packet per loop() and the
+// keepalive/ping handling that notices a silent broker.
+
+#define MQTT_MAX_HEADER_SIZE 5
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_KEEPALIVE 15
+#define MQTT_SOCKET_TIMEOUT 15
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient {
+public:
+    explicit PubSubClient(WiFiClient& client);
+
+    PubSubClient& setServer(const char* domain, uint16_t port);
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+    PubSubClient& setKeepAlive(uint16_t keepAlive);
+    PubSubClient& setSocketTimeout(uint16_t timeout);
+    bool setBufferSize(uint16_t size);
+    uint16_t getBufferSize();
+
+    // Blocks the calling task for CONNACK, or socketTimeout seconds
+    bool connect(const char* id, const char* user, const char* pass);
+    void disconnect();
+    bool publish(const char* topic, const char* payload);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length);
+    bool subscribe(const char* topic);
+    bool loop();
+    bool connected();
+    int state();
+
+private:
+    WiFiClient* client;
+    std::function<void(char*, uint8_t*, unsigned int)> callback;
+    std::vector<uint8_t> buffer;
+    uint16_t keepAlive = MQTT_KEEPALIVE;
+    uint16_t socketTimeout = MQTT_SOCKET_TIMEOUT;
+    int currentState = MQTT_DISCONNECTED;
+    bool pingOutstanding = false;
+    uint32_t lastInActivity = 0;
+    uint32_t lastOutActivity = 0;
+};
+
+#endif
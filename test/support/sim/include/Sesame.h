@@ -0,0 +1,50 @@
+#ifndef SIM_SESAME_H
+#define SIM_SESAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// libsesame3bt 0.25 constants the firmware reads. Enum values match the
+// library (history types: the subset the simulated locks produce).
+namespace libsesame3bt {
+
+class Sesame {
+public:
+    enum class model_t : int8_t {
+        unknown = -1,
+        sesame_3 = 0,
+        wifi_2 = 1,
+        sesame_bot = 2,
+        sesame_bike = 3,
+        sesame_4 = 4,
+        sesame_5 = 5,
+        sesame_5_pro = 7,
+    };
+
+    enum class result_code_t : uint8_t {
+        success = 0,
+        invalid_format = 1,
+        not_supported = 2,
+        storage_fail = 3,
+        invalid_sig = 4,
+        not_found = 5,
+        unknown = 6,
+        busy = 7,
+        invalid_param = 8,
+    };
+
+    enum class history_type_t : uint8_t {
+        none = 0,
+        ble_lock = 1,
+        ble_unlock = 2,
+        manual_locked = 7,
+        manual_unlocked = 8,
+    };
+
+    static constexpr size_t PK_SIZE = 64;
+    static constexpr size_t SECRET_SIZE = 16;
+};
+
+}  // namespace libsesame3bt
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef SIM_SESAMECLIENT_H
+#define SIM_SESAMECLIENT_H
+
+#include <stdint.h>
+#include <time.h>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include "NimBLEDevice.h"
+#include "Sesame.h"
+
+namespace sim {
+class Lock;
+}
+
+namespace libsesame3bt {
+
+// libsesame3bt's client, talking to the simulated lock with the same
+// address (sim::addLock()). connect() blocks the calling task and reports
+// "connected" on it; authentication, status, history and drops arrive
+// later as callbacks on the simulation thread, like the NimBLE host task.
+class SesameClient {
+public:
+    enum class state_t : uint8_t { idle, connecting, connected, authenticating, active };
+
+    class Status {
+    public:
+        Status(bool locked, bool unlocked, int16_t position, float voltage, float batteryPct)
+            : locked(locked), unlocked(unlocked), pos(position), volts(voltage), battery(batteryPct) {}
+
+        bool in_lock() const { return locked; }
+        bool in_unlock() const { return unlocked; }
+        int16_t position() const { return pos; }
+        float voltage() const { return volts; }
+        float battery_pct() const { return battery; }
+
+    private:
+        bool locked;
+        bool unlocked;
+        int16_t pos;
+        float volts;
+        float battery;
+    };
+
+    struct History {
+        Sesame::result_code_t result;
+        Sesame::history_type_t type;
+        time_t time;
+        char tag[22];
+    };
+
+    using status_callback_t = std::function<void(SesameClient& client, Status status)>;
+    using state_callback_t = std::function<void(SesameClient& client, state_t state)>;
+    using history_callback_t = std::function<void(SesameClient& client, const History& history)>;
+
+    bool begin(const BLEAddress& address, Sesame::model_t model);
+    bool set_keys(const std::array<std::byte, Sesame::PK_SIZE>& publicKey,
+                  const std::array<std::byte, Sesame::SECRET_SIZE>& secret);
+    void set_connect_timeout(uint32_t timeoutMs) { connectTimeoutMs = timeoutMs; }
+    bool connect(int retry = 0);
+    void disconnect();
+
+    bool lock(const char* tag);
+    bool unlock(const char* tag);
+    bool request_status();
+    bool request_history();
+
+    bool is_session_active() const { return state == state_t::active; }
+    state_t get_state() const { return state; }
+
+    void set_status_callback(status_callback_t callback) { statusCallback = callback; }
+    void set_state_callback(state_callback_t callback) { stateCallback = callback; }
+    void set_history_callback(history_callback_t callback) { historyCallback = callback; }
+
+    // Used by the simulated lock
+    void changeState(state_t next);
+    void notifyStatus(const Status& status);
+    void notifyHistory(const History& history);
+    // The link went down without disconnect(): supervision timeout or the
+    // lock ended the session
+    void linkLost();
+    uint32_t session() const { return sessionId; }
+
+private:
+    bool sendCommand(bool lock, const char* tag);
+
+    BLEAddress address;
+    Sesame::model_t model = Sesame::model_t::unknown;
+    bool keysSet = false;
+    uint32_t connectTimeoutMs = 30000;
+    state_t state = state_t::idle;
+    uint32_t sessionId = 0;
+    sim::Lock* peer = nullptr;
+    status_callback_t statusCallback;
+    state_callback_t stateCallback;
+    history_callback_t historyCallback;
+};
+
+}  // namespace libsesame3bt
+
+#endif
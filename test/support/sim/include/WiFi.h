@@ -0,0 +1,84 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <functional>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+// Station side of the simulated access point (sim::accessPoint()): begin()
+// associates after the scan or cached-channel delay, and the result comes
+// back as an event on the simulation thread, like the WiFi event task.
+
+typedef enum {
+    WIFI_PS_NONE,
+    WIFI_PS_MIN_MODEM,
+    WIFI_PS_MAX_MODEM,
+} wifi_ps_type_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+} wifi_mode_t;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8,
+} arduino_event_id_t;
+
+typedef struct {
+    uint8_t reason;
+} arduino_event_info_t;
+
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+typedef int wifi_event_id_t;
+
+// TCP to the simulated LAN; the only server is the MQTT broker
+class WiFiClient {
+public:
+    // Blocks the calling task for the handshake, or for the whole timeout
+    // when the SYN goes unanswered
+    int connect(const char* host, uint16_t port);
+    int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    void stop();
+    uint8_t connected();
+
+    // Simulated connection id, 0 when closed (used by PubSubClient)
+    uint32_t connectionId() const { return connection; }
+
+private:
+    uint32_t connection = 0;
+};
+
+class WiFiClass {
+public:
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    wl_status_t status();
+    bool mode(wifi_mode_t mode);
+    void persistent(bool persistent);
+    bool setAutoReconnect(bool autoReconnect);
+    bool setSleep(wifi_ps_type_t sleep);
+    bool setSleep(bool enabled);
+    wifi_ps_type_t getSleep();
+    wifi_event_id_t onEvent(WiFiEventFuncCb callback);
+
+    IPAddress localIP();
+    uint8_t* BSSID();
+    int32_t channel();
+    int8_t RSSI();
+};
+
+extern WiFiClass WiFi;
+
+#endif
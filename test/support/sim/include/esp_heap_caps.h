@@ -0,0 +1,15 @@
+#ifndef SIM_ESP_HEAP_CAPS_H
+#define SIM_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+// A heap of SIM_HEAP_SIZE bytes of which the firmware's own operator new
+// allocations are taken (see heap.cpp); the fakes' bookkeeping is not
+// counted. Never fragmented, so the largest block is all that is free.
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include "esp_err.h"
+
+esp_err_t esp_sleep_enable_gpio_wakeup();
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SIM_ESP_SYSTEM_H
+#define SIM_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+// Power-on unless the harness set another reason before sim::boot()
+esp_reset_reason_t esp_reset_reason();
+
+// Seeded by the harness, so every run of a scenario is the same
+uint32_t esp_random();
+
+// Lowest free heap since boot, see esp_heap_caps.h
+uint32_t esp_get_minimum_free_heap_size();
+
+#endif
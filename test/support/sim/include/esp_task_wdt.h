@@ -0,0 +1,15 @@
+#ifndef SIM_ESP_TASK_WDT_H
+#define SIM_ESP_TASK_WDT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Task watchdog on the simulated clock. A subscribed task that goes longer
+// than the timeout without a reset counts as a trip (sim::watchdogTrips())
+// instead of rebooting the device.
+esp_err_t esp_task_wdt_init(uint32_t timeoutSeconds, bool panic);
+esp_err_t esp_task_wdt_add(void* task);
+esp_err_t esp_task_wdt_reset();
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// FreeRTOS on the host: every task is a thread, but only one of them runs
+// at a time, picked by priority like the single application core it is
+// pinned to (see kernel.cpp). One tick is one millisecond.
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+struct SimTask;
+struct SimQueue;
+typedef SimTask* TaskHandle_t;
+typedef SimQueue* QueueHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define errQUEUE_FULL 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define tskNO_AFFINITY 0x7fffffff
+
+// Only one task or event runs at any moment, so critical sections have
+// nothing to exclude
+typedef struct {
+    int owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux) (void)(mux)
+
+// Interrupts run on the simulation thread with no task running; the woken
+// task is scheduled as soon as the interrupt returns
+#define portYIELD_FROM_ISR(woken) (void)(woken)
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SIM_HAL_GPIO_LL_H
+#define SIM_HAL_GPIO_LL_H
+
+#include <stdint.h>
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL,
+    GPIO_INTR_HIGH_LEVEL,
+} gpio_int_type_t;
+
+typedef struct {
+    uint32_t unused;
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
+
+// Light sleep is not simulated: the wake level is only remembered
+void gpio_ll_wakeup_enable(gpio_dev_t* hw, gpio_num_t pin, gpio_int_type_t type);
+
+#endif
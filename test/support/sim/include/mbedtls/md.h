@@ -0,0 +1,19 @@
+#ifndef SIM_MBEDTLS_MD_H
+#define SIM_MBEDTLS_MD_H
+
+#include <stddef.h>
+
+// HMAC-SHA256 only, computed for real (sha256.cpp), so frames signed on the
+// host verify against the firmware and the other way round
+typedef enum {
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+typedef struct mbedtls_md_info_t mbedtls_md_info_t;
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t type);
+int mbedtls_md_hmac(const mbedtls_md_info_t* info, const unsigned char* key, size_t keyLength,
+                    const unsigned char* input, size_t inputLength, unsigned char* output);
+
+#endif
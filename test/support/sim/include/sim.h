@@ -0,0 +1,346 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include "IPAddress.h"
+#include "NimBLEDevice.h"
+#include "SesameClient.h"
+
+// Host simulation of the whole firmware: the tasks from src/ run unchanged
+// against a simulated access point, MQTT broker, Sesame locks, 433 MHz band
+// and LAN, on a simulated clock.
+//
+// The test thread is the harness. Nothing moves unless it calls one of the
+// run functions, and then exactly one thing runs at a time: the highest
+// priority ready task (like the single core the tasks are pinned to), or,
+// when every task is blocked, the next timed event (an interrupt, a packet
+// arriving, a BLE notification). Code takes no simulated time to run, so
+// latencies are made of the waits the firmware chooses (polls, timeouts,
+// backoffs) and the link and mechanism delays modeled here, and a scenario
+// replays identically on every run. Events run on the harness thread with
+// no task running, in the place of the ISRs and the WiFi, NimBLE host and
+// AsyncUDP tasks.
+namespace sim {
+
+// ---- Clock and scheduler
+
+// Creates loopTask, which runs setup() and then loop(), like the Arduino
+// core. Once per process; locks and the RF band are set up before it.
+void boot();
+
+uint64_t nowUs();
+inline uint64_t nowMs() { return nowUs() / 1000; }
+
+void runFor(uint64_t ms);
+void runUntilUs(uint64_t atUs);
+// Runs until done() holds, checked after every task switch and event; false
+// if timeoutMs of simulated time passed first
+bool runUntil(const std::function<bool()>& done, uint64_t timeoutMs);
+
+// Harness events; same-time events run in the order they were added
+void at(uint64_t atUs, std::function<void()> action);
+void after(uint64_t delayUs, std::function<void()> action);
+
+// Seed of esp_random(); call before boot()
+void seed(uint64_t value);
+
+struct KernelStats {
+    uint64_t contextSwitches;
+    uint64_t events;
+    uint32_t tasks;
+    uint32_t watchdogTrips;      // subscribed task went longer than the timeout without a reset
+    const char* lastWatchdogTask;
+};
+
+KernelStats kernelStats();
+
+// ---- Heap: allocations made by firmware code only (see heap.cpp)
+
+struct HeapStats {
+    size_t liveBytes;
+    size_t peakBytes;
+    uint64_t allocations;
+};
+
+HeapStats heapStats();
+
+// ---- Serial output
+
+// Print the firmware's log with the simulated time (also SIM_ECHO=1)
+void setEcho(bool echo);
+// Called with every complete log line, e.g. to count warnings
+void onLog(std::function<void(const char* line)> observer);
+
+// ---- GPIO
+
+// Drives an input pin; a change fires the attached interrupt
+void setPin(uint8_t pin, int level);
+int pinLevel(uint8_t pin);
+
+// ---- 433 MHz band, as the receiver's data pin sees it
+
+class RfBand {
+public:
+    explicit RfBand(uint8_t pin) : pin(pin) {}
+
+    // One button press of a fixed-code remote starting at startUs: a sync
+    // gap, then the frame sent `frames` times (EV1527/PT2262 timing: bit 0
+    // is T high 3T low, bit 1 3T high T low, each frame ends with T high and
+    // syncLow*T low). Returns the time the last frame ends.
+    uint64_t press(uint64_t startUs, uint32_t code, uint8_t bits, uint32_t pulseUs, int frames = 4,
+                   uint8_t syncLow = 31);
+
+    // Random pulses from minUs to maxUs long between startUs and endUs, the
+    // receiver's AGC turned up on an empty band
+    void noise(uint64_t startUs, uint64_t endUs, uint32_t minUs, uint32_t maxUs, uint32_t seed);
+
+    uint64_t edges() const { return edgeCount; }
+
+private:
+    void play(uint64_t startUs, std::vector<uint32_t> durations);
+
+    uint8_t pin;
+    uint64_t edgeCount = 0;
+};
+
+// ---- Network
+
+struct NetworkTiming {
+    uint32_t wifiHopUs = 2000;         // device <-> access point, radio awake
+    uint32_t lanHopUs = 300;           // access point <-> a wired host
+    uint32_t brokerUs = 150;           // broker routing one message
+    uint32_t beaconUs = 102400;        // frames for a sleeping station wait for its next beacon
+    uint32_t scanAssociateMs = 2200;   // scan, associate, DHCP
+    uint32_t cachedAssociateMs = 600;  // channel and BSSID known
+};
+
+NetworkTiming& networkTiming();
+
+class AccessPoint {
+public:
+    // Down: the station is dropped and association attempts go unanswered
+    void setUp(bool up);
+    bool up() const { return apUp; }
+    bool stationConnected() const;
+
+    uint32_t associations = 0;
+    uint32_t disconnects = 0;
+
+private:
+    bool apUp = true;
+};
+
+AccessPoint& accessPoint();
+
+struct Message {
+    uint64_t atUs;     // when it reached the broker
+    std::string topic;
+    std::string payload;
+};
+
+class Broker {
+public:
+    using Observer = std::function<void(const Message& message)>;
+
+    // Stop resets every connection and loses what was queued for the
+    // device; connects are refused until start()
+    void stop();
+    void start();
+    void restart(uint32_t downMs);
+    // The host stops answering: packets vanish both ways and connects time
+    // out. When it answers again its sessions have expired and are reset.
+    void setBlackhole(bool blackhole);
+    bool running() const { return isRunning; }
+
+    // Another client on the LAN publishing at QoS 0; false while stopped
+    bool publish(const std::string& topic, const std::string& payload);
+    // Device publishes matching filter (+ and # wildcards), as they arrive
+    void subscribe(const std::string& filter, Observer observer);
+    // Device publishes lost on the way: broker stopped, unreachable or the
+    // connection reset while they were in flight
+    void onLost(Observer observer);
+
+    struct Stats {
+        uint64_t fromDevice;      // device publishes that reached the broker
+        uint64_t toDevice;        // messages the device read in loop()
+        uint64_t lostUplink;
+        uint64_t lostDownlink;    // queued for the device when its connection went
+        uint64_t inboxOverflows;  // dropped: the device fell inboxLimit messages behind
+        uint64_t connects;
+        uint64_t refused;
+    };
+
+    const Stats& stats() const { return counters; }
+    size_t inboxLimit = 1000;     // per session, like max_queued_messages
+
+    // Used by WiFiClient/PubSubClient
+    struct Inbound {
+        uint64_t atUs;
+        bool pingResponse;
+        std::string topic;
+        std::string payload;
+    };
+
+    struct Session {
+        uint32_t connection;
+        std::string clientId;
+        std::vector<std::string> filters;
+        std::deque<Inbound> inbox;
+    };
+
+    bool isRunning = true;
+    bool blackholed = false;
+    std::vector<Session> sessions;
+    std::vector<std::pair<std::string, Observer>> observers;
+    std::vector<Observer> lostObservers;
+    Stats counters = {};
+    uint32_t epoch = 0;           // bumped on every stop, so packets in flight lapse
+};
+
+Broker& broker();
+
+// MQTT topic filter match with + and #
+bool topicMatches(const std::string& filter, const std::string& topic);
+
+// A host on the wired LAN talking UDP to the device
+class LanPeer {
+public:
+    LanPeer(uint8_t hostOctet, uint16_t port);
+    ~LanPeer();
+
+    IPAddress address() const { return ip; }
+    uint16_t port() const { return localPort; }
+
+    // False when the device is not on the network
+    bool send(uint16_t devicePort, const uint8_t* data, size_t length);
+
+    // Datagrams from the device, when they arrive
+    std::function<void(const uint8_t* data, size_t length)> onReceive;
+
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t lost = 0;        // the device left the network before they arrived
+
+private:
+    IPAddress ip;
+    uint16_t localPort;
+};
+
+// Deliver a datagram from the device to the peer at ip:port, if there is one
+LanPeer* findLanPeer(uint32_t ip, uint16_t port);
+
+// ---- Sesame locks
+
+class Lock {
+public:
+    enum class Fault : uint8_t {
+        none,
+        ignored,            // the write is lost over the air: no reply, nothing moves
+        dropBeforeMoving,   // the session ends as the command arrives: nothing moves
+        dropAfterMoving,    // the bolt moves but the session ends before the final status
+    };
+
+    explicit Lock(uint64_t address) : address(address) {}
+
+    // Out of range: connects time out and a session drops after the
+    // supervision timeout
+    void setInRange(bool inRange);
+    bool inRange() const { return reachable; }
+    // The lock ends the session now
+    void dropSession();
+    // Applies to the next lock/unlock written to it
+    void failNext(Fault fault) { nextFault = fault; }
+    // Thumb turn: a status notification and a history entry
+    void turnByHand(bool lock);
+
+    bool locked() const { return isLocked; }
+    bool moving() const { return isMoving; }
+    bool sessionActive() const;
+
+    struct Command {
+        uint64_t atUs;
+        bool lock;
+        std::string tag;
+        Fault fault;
+    };
+
+    struct Stats {
+        uint32_t connects;
+        uint32_t failedConnects;
+        uint32_t drops;             // sessions ended by the lock or the radio
+        uint32_t moves;             // bolt travels completed
+        uint32_t statusNotifications;
+        uint32_t historyServed;
+    };
+
+    const std::vector<Command>& commands() const { return received; }
+    const Stats& stats() const { return counters; }
+
+    const uint64_t address;
+
+    // Timing, ms
+    uint32_t connectMs = 350;       // connection and service discovery
+    uint32_t authenticateMs = 250;  // login exchange after connecting
+    uint32_t replyMs = 60;          // request to notification
+    uint32_t moveMs = 1500;         // bolt travel
+    uint32_t supervisionMs = 4000;  // a lost link is noticed after this
+    uint32_t advertIntervalMs = 300;
+    int8_t rssi = -62;
+
+    NimBLEClient bleClient;
+
+private:
+    friend class libsesame3bt::SesameClient;
+    friend void advertise(Lock& lock, uint32_t generation);
+
+    bool accepts() const { return reachable && client == nullptr; }
+    void attach(libsesame3bt::SesameClient* client);
+    void detach();
+    bool receive(bool lock, const char* tag);
+    void startMove(bool lock, libsesame3bt::Sesame::history_type_t type, const char* tag);
+    void sendStatus(uint32_t delayMs);
+    void sendHistory();
+    libsesame3bt::SesameClient::Status status() const;
+
+    bool reachable = true;
+    bool isLocked = true;
+    bool isMoving = false;
+    uint32_t moveSeq = 0;
+    Fault nextFault = Fault::none;
+    libsesame3bt::SesameClient* client = nullptr;
+    std::deque<libsesame3bt::SesameClient::History> unread;
+    std::vector<Command> received;
+    Stats counters = {};
+};
+
+// address as in SESAME_LOCKS ("xx:xx:xx:xx:xx:xx"); call before boot()
+Lock& addLock(const char* address);
+Lock* findLock(uint64_t address);
+
+// ---- Storage and power
+
+struct StorageStats {
+    uint64_t nvsWrites;
+    uint64_t flashBytesWritten;
+    size_t flashUsed;
+};
+
+StorageStats storageStats();
+
+struct PowerState {
+    int wifiSleep;          // wifi_ps_type_t
+    bool lightSleep;
+    int8_t bleTxDbm;
+    uint32_t wifiSleepChanges;
+};
+
+PowerState powerState();
+
+}  // namespace sim
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SIM_CONFIG_H
+#define SIM_CONFIG_H
+
+// Host simulation settings, included at the end of config.h when SESAME_SIM
+// is defined ([env:native]): two simulated locks, two enrolled remotes and
+// a LAN API key. Addresses and keys only have to pass lock_config.h's
+// checks; the simulated locks accept any.
+
+#undef SESAME_LOCKS
+#define SESAME_LOCKS { \
+    { "door", "Door", "c0:5e:5a:00:00:01", "00112233445566778899aabbccddeeff", \
+      "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef" \
+      "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef", 5 }, \
+    { "gate", "Gate", "c0:5e:5a:00:00:02", "ffeeddccbbaa99887766554433221100", \
+      "fedcba9876543210fedcba9876543210fedcba9876543210fedcba9876543210" \
+      "fedcba9876543210fedcba9876543210fedcba9876543210fedcba9876543210", 5 }, \
+}
+
+#undef RXB6_REMOTE_CODES
+#define RXB6_REMOTE_CODES { \
+    { 0x3A9C51, 24, "EV1527/PT2262", CommandAction::toggle, "" }, \
+    { 0x3A9C52, 24, "EV1527/PT2262", CommandAction::lock, "gate" }, \
+}
+
+#undef LAN_API_KEY
+#define LAN_API_KEY "host-simulation-lan-key"
+
+#endif
@@ -0,0 +1,296 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "WiFi.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "hal/gpio_ll.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+// Arduino core, ESP-IDF odds and ends, GPIO and the serial log
+
+HardwareSerial Serial;
+gpio_dev_t GPIO;
+
+namespace {
+
+const int PIN_COUNT = 40;
+
+struct Pin {
+    int level = LOW;
+    uint8_t mode = INPUT;
+    void (*handler)() = nullptr;
+    int interruptMode = 0;
+};
+
+Pin pins[PIN_COUNT];
+
+uint64_t randomState = 0x9E3779B97F4A7C15ull;
+
+bool echo = getenv("SIM_ECHO") != nullptr && strcmp(getenv("SIM_ECHO"), "0") != 0;
+std::vector<std::function<void(const char*)>> logObservers;
+std::string pendingLine;
+
+sim::PowerState power = {WIFI_PS_NONE, false, 9, 0};
+
+}  // namespace
+
+uint32_t millis() {
+    return static_cast<uint32_t>(sim::nowUs() / 1000);
+}
+
+uint32_t micros() {
+    return static_cast<uint32_t>(sim::nowUs());
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= PIN_COUNT) return;
+    // Inputs keep the level the harness drives (sim::setPin()); the RXB6
+    // output overpowers the pull-up
+    pins[pin].mode = mode;
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < PIN_COUNT ? pins[pin].level : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    if (pin < PIN_COUNT) {
+        pins[pin].level = level ? HIGH : LOW;
+    }
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {
+    if (pin >= PIN_COUNT) return;
+    pins[pin].handler = handler;
+    pins[pin].interruptMode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < PIN_COUNT) {
+        pins[pin].handler = nullptr;
+    }
+}
+
+void gpio_ll_wakeup_enable(gpio_dev_t* hw, gpio_num_t pin, gpio_int_type_t type) {
+    (void)hw;
+    (void)pin;
+    (void)type;
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return 240;
+}
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size > 0) {
+        size_t n = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return length;
+}
+#endif
+
+// xorshift64*
+uint32_t esp_random() {
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return static_cast<uint32_t>((randomState * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+esp_reset_reason_t esp_reset_reason() {
+    return ESP_RST_POWERON;
+}
+
+esp_err_t esp_pm_configure(const void* config) {
+    const esp_pm_config_esp32_t* pm = static_cast<const esp_pm_config_esp32_t*>(config);
+    power.lightSleep = pm->light_sleep_enable;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+    return ESP_OK;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    (void)baud;
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    size_t written = static_cast<size_t>(length) < sizeof(text) ? static_cast<size_t>(length) : sizeof(text) - 1;
+    sim::logWrite(text, written);
+    return written;
+}
+
+size_t HardwareSerial::print(const char* text) {
+    size_t length = strlen(text);
+    sim::logWrite(text, length);
+    return length;
+}
+
+size_t HardwareSerial::println(const char* text) {
+    size_t length = print(text);
+    sim::logWrite("\n", 1);
+    return length + 1;
+}
+
+namespace sim {
+
+void logWrite(const char* text, size_t length) {
+    if (!echo && logObservers.empty()) return;
+    SimScope scope;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] != '\n') {
+            pendingLine += text[i];
+            continue;
+        }
+        if (echo) {
+            uint64_t now = nowUs();
+            fprintf(stderr, "[%6llu.%06llu] %s\n", static_cast<unsigned long long>(now / 1000000),
+                    static_cast<unsigned long long>(now % 1000000), pendingLine.c_str());
+        }
+        for (const auto& observer : logObservers) {
+            observer(pendingLine.c_str());
+        }
+        pendingLine.clear();
+    }
+}
+
+void setEcho(bool enabled) {
+    echo = enabled;
+}
+
+void onLog(std::function<void(const char* line)> observer) {
+    SimScope scope;
+    logObservers.push_back(std::move(observer));
+}
+
+void seed(uint64_t value) {
+    randomState = value != 0 ? value : 0x9E3779B97F4A7C15ull;
+}
+
+void setPin(uint8_t pin, int level) {
+    if (pin >= PIN_COUNT) return;
+    Pin& state = pins[pin];
+    int previous = state.level;
+    state.level = level ? HIGH : LOW;
+    if (state.handler == nullptr || previous == state.level) return;
+    bool rising = state.level == HIGH;
+    if (state.interruptMode == CHANGE || (state.interruptMode == RISING && rising) ||
+        (state.interruptMode == FALLING && !rising)) {
+        FirmwareScope scope;
+        state.handler();
+    }
+}
+
+int pinLevel(uint8_t pin) {
+    return pin < PIN_COUNT ? pins[pin].level : LOW;
+}
+
+void recordWifiSleep(int sleep) {
+    if (sleep != power.wifiSleep) {
+        power.wifiSleepChanges++;
+    }
+    power.wifiSleep = sleep;
+}
+
+void recordBleTxPower(int8_t dbm) {
+    power.bleTxDbm = dbm;
+}
+
+PowerState powerState() {
+    return power;
+}
+
+// ---- RF band
+
+struct Waveform {
+    uint8_t pin;
+    std::vector<uint32_t> durations;
+    size_t next;
+    uint64_t* edges;
+};
+
+// One edge, then the next one is scheduled, so the queue holds one event
+// per waveform however long it is
+static void playEdge(const std::shared_ptr<Waveform>& wave) {
+    setPin(wave->pin, pinLevel(wave->pin) == HIGH ? LOW : HIGH);
+    (*wave->edges)++;
+    if (wave->next < wave->durations.size()) {
+        uint32_t wait = wave->durations[wave->next++];
+        after(wait, [wave] { playEdge(wave); });
+    }
+}
+
+void RfBand::play(uint64_t startUs, std::vector<uint32_t> durations) {
+    SimScope scope;
+    auto wave = std::make_shared<Waveform>(Waveform{pin, std::move(durations), 0, &edgeCount});
+    at(startUs, [wave] { playEdge(wave); });
+}
+
+uint64_t RfBand::press(uint64_t startUs, uint32_t code, uint8_t bits, uint32_t pulseUs, int frames, uint8_t syncLow) {
+    // The line idles low: the first edge rises into the sync pulse
+    std::vector<uint32_t> durations;
+    uint64_t total = 0;
+    auto add = [&](uint32_t us) {
+        durations.push_back(us);
+        total += us;
+    };
+    add(pulseUs);
+    add(syncLow * pulseUs);
+    for (int frame = 0; frame < frames; frame++) {
+        for (int bit = bits - 1; bit >= 0; bit--) {
+            bool one = (code >> bit) & 1;
+            add(one ? 3 * pulseUs : pulseUs);
+            add(one ? pulseUs : 3 * pulseUs);
+        }
+        add(pulseUs);
+        add(syncLow * pulseUs);
+    }
+    // Back to idle (low)
+    add(pulseUs);
+    play(startUs, std::move(durations));
+    return startUs + total;
+}
+
+void RfBand::noise(uint64_t startUs, uint64_t endUs, uint32_t minUs, uint32_t maxUs, uint32_t seed) {
+    SimScope scope;
+    std::vector<uint32_t> durations;
+    uint64_t t = startUs;
+    uint32_t state = seed;
+    while (t < endUs) {
+        state = state * 1664525u + 1013904223u;
+        uint32_t us = minUs + (state >> 8) % (maxUs - minUs + 1);
+        durations.push_back(us);
+        t += us;
+    }
+    if (durations.size() % 2 == 0) {
+        // An even number of edges leaves the line where it started
+        durations.push_back(minUs);
+    }
+    play(startUs, std::move(durations));
+}
+
+}  // namespace sim
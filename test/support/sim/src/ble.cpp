@@ -0,0 +1,441 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+#include "NimBLEDevice.h"
+#include "SesameClient.h"
+#include "esp_system.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+// NimBLE and libsesame3bt against simulated locks. Positions follow the
+// Sesame 5 scale: 0 locked, 256 unlocked.
+
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameClient;
+
+namespace {
+
+const int16_t LOCKED_POSITION = 0;
+const int16_t UNLOCKED_POSITION = 256;
+const time_t EPOCH_AT_BOOT = 1767225600;   // 2026-01-01, as if NTP had set the lock's clock
+
+std::vector<std::unique_ptr<sim::Lock>> locks;
+NimBLEScan scanner;
+int8_t txPowerDbm = 9;
+uint32_t nextSession = 0;
+
+uint64_t ms(uint32_t value) {
+    return static_cast<uint64_t>(value) * 1000;
+}
+
+}  // namespace
+
+namespace sim {
+
+// One advertisement, then the next one while the scan that asked for them runs
+void advertise(Lock& lock, uint32_t generation) {
+    if (!scanner.scanning || scanner.generation != generation) return;
+    // Connected locks stop advertising
+    if (lock.reachable && lock.client == nullptr && scanner.callbacks != nullptr) {
+        SimScope scope;
+        std::vector<uint8_t> payload = {0x02, 0x01, 0x06, 0x03, 0x02, 0x56, 0xFD, 0x0E, 0xFF, 0x5A, 0x05,
+                                        static_cast<uint8_t>(Sesame::model_t::sesame_5), 0x00, 0x01};
+        for (int i = 0; i < 8; i++) {
+            payload.push_back(static_cast<uint8_t>(lock.address >> (i * 8)));
+        }
+        NimBLEAdvertisedDevice device(NimBLEAddress(lock.address, BLE_ADDR_RANDOM), lock.rssi, payload);
+        FirmwareScope firmware;
+        scanner.callbacks->onResult(&device);
+    }
+    // Advertising events are spread by a random 0-10 ms delay
+    Lock* target = &lock;
+    after(ms(lock.advertIntervalMs) + esp_random() % 10000, [target, generation] { advertise(*target, generation); });
+}
+
+void scanStarted(NimBLEScan& scan) {
+    for (const std::unique_ptr<Lock>& lock : locks) {
+        Lock* target = lock.get();
+        uint32_t generation = scan.generation;
+        after(esp_random() % ms(lock->advertIntervalMs), [target, generation] { advertise(*target, generation); });
+    }
+}
+
+Lock& addLock(const char* address) {
+    SimScope scope;
+    uint64_t value = 0;
+    for (const char* p = address; *p != '\0'; p++) {
+        if (*p == ':') continue;
+        char digit[2] = {*p, '\0'};
+        value = (value << 4) | static_cast<uint64_t>(strtoul(digit, nullptr, 16));
+    }
+    locks.push_back(std::unique_ptr<Lock>(new Lock(value)));
+    return *locks.back();
+}
+
+Lock* findLock(uint64_t address) {
+    for (const std::unique_ptr<Lock>& lock : locks) {
+        if (lock->address == address) {
+            return lock.get();
+        }
+    }
+    return nullptr;
+}
+
+void Lock::setInRange(bool inRange) {
+    reachable = inRange;
+    if (inRange || client == nullptr) return;
+    uint32_t session = client->session();
+    after(ms(supervisionMs), [this, session] {
+        if (!reachable && client != nullptr && client->session() == session) {
+            dropSession();
+        }
+    });
+}
+
+void Lock::dropSession() {
+    if (client == nullptr) return;
+    counters.drops++;
+    SesameClient* dropped = client;
+    detach();
+    dropped->linkLost();
+}
+
+void Lock::turnByHand(bool lock) {
+    startMove(lock, lock ? Sesame::history_type_t::manual_locked : Sesame::history_type_t::manual_unlocked, "");
+}
+
+bool Lock::sessionActive() const {
+    return client != nullptr && client->is_session_active();
+}
+
+void Lock::attach(SesameClient* sesameClient) {
+    client = sesameClient;
+    bleClient.connected = true;
+    counters.connects++;
+}
+
+void Lock::detach() {
+    client = nullptr;
+    bleClient.connected = false;
+    bleClient.connInterval = 0;
+}
+
+bool Lock::receive(bool lock, const char* tag) {
+    SimScope scope;
+    Fault fault = nextFault;
+    nextFault = Fault::none;
+    received.push_back(Command{nowUs(), lock, tag != nullptr ? tag : "", fault});
+
+    uint32_t session = client->session();
+    auto dropAfter = [this, session](uint32_t delayMs) {
+        after(ms(delayMs), [this, session] {
+            if (client != nullptr && client->session() == session) {
+                dropSession();
+            }
+        });
+    };
+
+    switch (fault) {
+        case Fault::ignored:
+            break;
+        case Fault::dropBeforeMoving:
+            dropAfter(replyMs / 2);
+            break;
+        case Fault::dropAfterMoving:
+            startMove(lock, lock ? Sesame::history_type_t::ble_lock : Sesame::history_type_t::ble_unlock, tag);
+            dropAfter(replyMs * 2);
+            break;
+        case Fault::none:
+            startMove(lock, lock ? Sesame::history_type_t::ble_lock : Sesame::history_type_t::ble_unlock, tag);
+            break;
+    }
+    return true;
+}
+
+void Lock::startMove(bool lock, Sesame::history_type_t type, const char* tag) {
+    SimScope scope;
+    if (!isMoving && isLocked == lock) {
+        sendStatus(replyMs);
+        return;
+    }
+    isMoving = true;
+    uint32_t seq = ++moveSeq;
+    sendStatus(replyMs);
+
+    SesameClient::History entry = {};
+    entry.result = Sesame::result_code_t::success;
+    entry.type = type;
+    snprintf(entry.tag, sizeof(entry.tag), "%s", tag != nullptr ? tag : "");
+    after(ms(moveMs), [this, seq, lock, entry]() mutable {
+        // A newer command took over the bolt
+        if (seq != moveSeq) return;
+        isMoving = false;
+        isLocked = lock;
+        entry.time = EPOCH_AT_BOOT + static_cast<time_t>(nowUs() / 1000000);
+        unread.push_back(entry);
+        counters.moves++;
+        sendStatus(0);
+    });
+}
+
+void Lock::sendStatus(uint32_t delayMs) {
+    if (client == nullptr) return;
+    uint32_t session = client->session();
+    after(ms(delayMs), [this, session] {
+        if (client == nullptr || client->session() != session) return;
+        counters.statusNotifications++;
+        client->notifyStatus(status());
+    });
+}
+
+void Lock::sendHistory() {
+    if (client == nullptr) return;
+    uint32_t session = client->session();
+    after(ms(replyMs), [this, session] {
+        if (client == nullptr || client->session() != session) return;
+        SesameClient::History entry = {};
+        if (unread.empty()) {
+            entry.result = Sesame::result_code_t::not_found;
+            entry.type = Sesame::history_type_t::none;
+        } else {
+            SimScope scope;
+            entry = unread.front();
+            unread.pop_front();
+        }
+        counters.historyServed++;
+        client->notifyHistory(entry);
+    });
+}
+
+SesameClient::Status Lock::status() const {
+    int16_t position = isMoving ? (LOCKED_POSITION + UNLOCKED_POSITION) / 2
+                                : (isLocked ? LOCKED_POSITION : UNLOCKED_POSITION);
+    return SesameClient::Status(!isMoving && isLocked, !isMoving && !isLocked, position, 5.9f, 95.0f);
+}
+
+}  // namespace sim
+
+// ---- NimBLE
+
+std::string NimBLEAddress::toString() const {
+    char text[18];
+    snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x", static_cast<unsigned>(value >> 40) & 0xFF,
+             static_cast<unsigned>(value >> 32) & 0xFF, static_cast<unsigned>(value >> 24) & 0xFF,
+             static_cast<unsigned>(value >> 16) & 0xFF, static_cast<unsigned>(value >> 8) & 0xFF,
+             static_cast<unsigned>(value) & 0xFF);
+    return text;
+}
+
+bool NimBLEClient::updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+    (void)minInterval;
+    (void)latency;
+    (void)timeout;
+    if (!connected) return false;
+    connInterval = maxInterval;
+    paramUpdates++;
+    return true;
+}
+
+void NimBLEScan::setScanCallbacks(NimBLEScanCallbacks* scanCallbacks, bool wantDuplicates) {
+    (void)wantDuplicates;
+    callbacks = scanCallbacks;
+}
+
+void NimBLEScan::setActiveScan(bool active) {
+    (void)active;
+}
+
+void NimBLEScan::setInterval(uint16_t interval) {
+    intervalMs = interval;
+}
+
+void NimBLEScan::setWindow(uint16_t window) {
+    windowMs = window;
+}
+
+void NimBLEScan::setMaxResults(uint8_t maxResults) {
+    (void)maxResults;
+}
+
+bool NimBLEScan::start(uint32_t durationMs, bool isContinue, bool restart) {
+    (void)isContinue;
+    if (scanning && !restart) {
+        return true;
+    }
+    sim::SimScope scope;
+    scanning = true;
+    generation++;
+    starts++;
+    sim::scanStarted(*this);
+    if (durationMs != 0) {
+        uint32_t started = generation;
+        sim::after(ms(durationMs), [this, started] {
+            if (generation == started) stop();
+        });
+    }
+    return true;
+}
+
+bool NimBLEScan::stop() {
+    scanning = false;
+    generation++;
+    return true;
+}
+
+bool NimBLEScan::isScanning() {
+    return scanning;
+}
+
+bool NimBLEDevice::init(const std::string& deviceName) {
+    (void)deviceName;
+    return true;
+}
+
+bool NimBLEDevice::setMTU(uint16_t mtu) {
+    (void)mtu;
+    return true;
+}
+
+bool NimBLEDevice::setPower(int8_t dbm) {
+    txPowerDbm = dbm;
+    sim::recordBleTxPower(dbm);
+    return true;
+}
+
+int NimBLEDevice::getPower() {
+    return txPowerDbm;
+}
+
+NimBLEScan* NimBLEDevice::getScan() {
+    return &scanner;
+}
+
+NimBLEClient* NimBLEDevice::getClientByPeerAddress(const NimBLEAddress& address) {
+    sim::Lock* lock = sim::findLock(address.toUint64());
+    return lock != nullptr && lock->bleClient.connected ? &lock->bleClient : nullptr;
+}
+
+// ---- libsesame3bt
+
+namespace libsesame3bt {
+
+bool SesameClient::begin(const BLEAddress& bleAddress, Sesame::model_t sesameModel) {
+    address = bleAddress;
+    model = sesameModel;
+    return true;
+}
+
+bool SesameClient::set_keys(const std::array<std::byte, Sesame::PK_SIZE>& publicKey,
+                            const std::array<std::byte, Sesame::SECRET_SIZE>& secret) {
+    (void)publicKey;
+    (void)secret;
+    keysSet = true;
+    return true;
+}
+
+// Each attempt waits out the connect timeout when the lock does not answer
+bool SesameClient::connect(int retry) {
+    if (!keysSet || state != state_t::idle) {
+        return false;
+    }
+    for (int attempt = 0; attempt <= retry; attempt++) {
+        sim::Lock* lock = sim::findLock(address.toUint64());
+        if (lock != nullptr && lock->accepts()) {
+            sim::blockFor(ms(lock->connectMs));
+            if (lock->accepts()) {
+                sim::SimScope scope;
+                sessionId = ++nextSession;
+                peer = lock;
+                lock->attach(this);
+                changeState(state_t::connected);
+
+                uint32_t session = sessionId;
+                sim::after(ms(lock->authenticateMs / 2), [this, session] {
+                    if (sessionId == session && peer != nullptr) changeState(state_t::authenticating);
+                });
+                sim::after(ms(lock->authenticateMs), [this, session] {
+                    if (sessionId == session && peer != nullptr) changeState(state_t::active);
+                });
+                return true;
+            }
+        } else {
+            sim::blockFor(ms(connectTimeoutMs));
+        }
+        if (lock != nullptr) {
+            lock->counters.failedConnects++;
+        }
+    }
+    return false;
+}
+
+void SesameClient::disconnect() {
+    if (peer != nullptr) {
+        peer->detach();
+        peer = nullptr;
+    }
+    if (state != state_t::idle) {
+        changeState(state_t::idle);
+    }
+}
+
+bool SesameClient::sendCommand(bool lockIt, const char* tag) {
+    if (!is_session_active() || peer == nullptr) {
+        return false;
+    }
+    return peer->receive(lockIt, tag);
+}
+
+bool SesameClient::lock(const char* tag) {
+    return sendCommand(true, tag);
+}
+
+bool SesameClient::unlock(const char* tag) {
+    return sendCommand(false, tag);
+}
+
+bool SesameClient::request_status() {
+    if (!is_session_active() || peer == nullptr) {
+        return false;
+    }
+    peer->sendStatus(peer->replyMs);
+    return true;
+}
+
+bool SesameClient::request_history() {
+    if (!is_session_active() || peer == nullptr) {
+        return false;
+    }
+    peer->sendHistory();
+    return true;
+}
+
+void SesameClient::changeState(state_t next) {
+    state = next;
+    if (stateCallback) {
+        sim::FirmwareScope scope;
+        stateCallback(*this, next);
+    }
+}
+
+void SesameClient::notifyStatus(const Status& status) {
+    if (statusCallback) {
+        sim::FirmwareScope scope;
+        statusCallback(*this, status);
+    }
+}
+
+void SesameClient::notifyHistory(const History& history) {
+    if (historyCallback) {
+        sim::FirmwareScope scope;
+        historyCallback(*this, history);
+    }
+}
+
+void SesameClient::linkLost() {
+    peer = nullptr;
+    changeState(state_t::idle);
+}
+
+}  // namespace libsesame3bt
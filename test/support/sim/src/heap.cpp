@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <new>
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+// Global operator new/delete for every host binary: counts the firmware's
+// heap use. `allocations` is what test/support/alloc_counter.h exposes to
+// the allocation-free checks; live and peak bytes back heap_caps_*() and
+// sim::heapStats(). Allocations made inside a SimScope (the fakes and the
+// harness thread after sim::boot()) are the simulation's, not counted.
+
+#ifndef SIM_HEAP_SIZE
+#define SIM_HEAP_SIZE 180000   // free heap of the real build after WiFi and NimBLE start
+#endif
+
+size_t allocations = 0;
+
+namespace sim {
+thread_local int heapDepth = 0;
+}
+
+namespace {
+
+struct alignas(16) BlockHeader {
+    size_t size;
+    size_t counted;
+};
+
+size_t liveBytes = 0;
+size_t peakBytes = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+    BlockHeader* block = static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + size));
+    if (block == nullptr) throw std::bad_alloc();
+    block->size = size;
+    block->counted = sim::heapDepth == 0;
+    if (block->counted) {
+        allocations++;
+        liveBytes += size;
+        if (liveBytes > peakBytes) {
+            peakBytes = liveBytes;
+        }
+    }
+    return block + 1;
+}
+
+void operator delete(void* p) noexcept {
+    if (p == nullptr) return;
+    BlockHeader* block = static_cast<BlockHeader*>(p) - 1;
+    if (block->counted) {
+        liveBytes -= block->size;
+    }
+    free(block);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    return liveBytes < SIM_HEAP_SIZE ? SIM_HEAP_SIZE - liveBytes : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+uint32_t esp_get_minimum_free_heap_size() {
+    return static_cast<uint32_t>(peakBytes < SIM_HEAP_SIZE ? SIM_HEAP_SIZE - peakBytes : 0);
+}
+
+namespace sim {
+
+HeapStats heapStats() {
+    return HeapStats{liveBytes, peakBytes, allocations};
+}
+
+}  // namespace sim
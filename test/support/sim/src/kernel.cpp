@@ -0,0 +1,597 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Arduino.h"
+#include "esp_task_wdt.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+// FreeRTOS on threads. Every task is a std::thread, but a task only runs
+// while it holds the baton (running == true), and the harness hands the
+// baton to one task at a time: the highest priority ready one, first come
+// first served among equals, as on the core the tasks share. A task gives
+// the baton back when it blocks, or when it readies a higher priority task
+// (preemption). With every task blocked the harness moves the clock to the
+// next timeout or event. The kernel is never destroyed, so parked threads
+// can outlive the test.
+
+struct SimTask {
+    std::string name;
+    UBaseType_t priority;
+    uint32_t stackDepth;
+    TaskFunction_t function;
+    void* parameter;
+
+    std::condition_variable wake;
+    bool running = false;
+    bool blocked = false;
+    bool deleted = false;
+    bool timedOut = false;
+    uint64_t wakeUs = UINT64_MAX;
+    uint64_t readyOrder = 0;
+
+    // What a blocked task waits for
+    const SimQueue* waitingOn = nullptr;
+    bool waitingToSend = false;
+    bool waitingNotify = false;
+    uint32_t notifyValue = 0;
+
+    bool watched = false;
+    bool watchdogTripped = false;
+    uint64_t lastFeedUs = 0;
+};
+
+struct SimQueue {
+    size_t itemSize;
+    size_t capacity;
+    std::vector<uint8_t> storage;
+    size_t head = 0;
+    size_t count = 0;
+    SimQueue* set = nullptr;
+};
+
+namespace {
+
+const uint64_t SPIN_LIMIT = 1000000;
+
+// Thrown by vTaskDelete(nullptr) to unwind the calling task
+struct TaskDeleted {};
+
+struct Event {
+    uint64_t atUs;
+    uint64_t seq;
+    std::function<void()> action;
+};
+
+struct Later {
+    bool operator()(const Event& a, const Event& b) const {
+        return a.atUs != b.atUs ? a.atUs > b.atUs : a.seq > b.seq;
+    }
+};
+
+struct Kernel {
+    std::mutex mutex;
+    std::condition_variable harnessWake;
+    SimTask* current = nullptr;
+    std::vector<SimTask*> tasks;
+    std::priority_queue<Event, std::vector<Event>, Later> events;
+    uint64_t eventSeq = 0;
+    uint64_t readySeq = 0;
+    uint64_t now = 0;
+    bool booted = false;
+    uint64_t watchdogUs = 0;
+    uint64_t switchesAtNow = 0;   // dispatches since the clock last moved
+    sim::KernelStats stats = {};
+};
+
+Kernel& kernel() {
+    static Kernel* instance = [] {
+        sim::SimScope scope;
+        return new Kernel();
+    }();
+    return *instance;
+}
+
+thread_local SimTask* self = nullptr;
+
+using Guard = std::unique_lock<std::mutex>;
+
+void makeReady(Kernel& k, SimTask* task) {
+    task->blocked = false;
+    task->waitingOn = nullptr;
+    task->waitingToSend = false;
+    task->waitingNotify = false;
+    task->wakeUs = UINT64_MAX;
+    task->readyOrder = ++k.readySeq;
+}
+
+SimTask* pickReady(Kernel& k) {
+    SimTask* best = nullptr;
+    for (SimTask* task : k.tasks) {
+        if (task->deleted || task->blocked) continue;
+        if (best == nullptr || task->priority > best->priority ||
+            (task->priority == best->priority && task->readyOrder < best->readyOrder)) {
+            best = task;
+        }
+    }
+    return best;
+}
+
+// The running task hands the baton back and waits to be picked again
+void park(Kernel& k, SimTask* task, Guard& lock) {
+    task->running = false;
+    k.current = nullptr;
+    k.harnessWake.notify_one();
+    task->wake.wait(lock, [task] { return task->running; });
+}
+
+void dispatch(Kernel& k, SimTask* task, Guard& lock) {
+    k.current = task;
+    task->running = true;
+    k.stats.contextSwitches++;
+    task->wake.notify_one();
+    k.harnessWake.wait(lock, [&k] { return k.current == nullptr; });
+}
+
+// After readying another task: a higher priority one takes the core now.
+// In callback context the harness schedules it when the callback returns.
+void preemptIfNeeded(Kernel& k, Guard& lock) {
+    SimTask* me = self;
+    if (me == nullptr) return;
+    for (SimTask* task : k.tasks) {
+        if (task != me && !task->deleted && !task->blocked && task->priority > me->priority) {
+            park(k, me, lock);
+            return;
+        }
+    }
+}
+
+// Blocks the calling task until it is readied or the deadline passes;
+// false on timeout
+bool block(Kernel& k, Guard& lock, uint64_t deadlineUs) {
+    SimTask* me = self;
+    me->blocked = true;
+    me->timedOut = false;
+    me->wakeUs = deadlineUs;
+    park(k, me, lock);
+    return !me->timedOut;
+}
+
+uint64_t deadlineFor(const Kernel& k, TickType_t ticks) {
+    return ticks == portMAX_DELAY ? UINT64_MAX : k.now + static_cast<uint64_t>(ticks) * 1000;
+}
+
+void wakeWaiters(Kernel& k, const SimQueue* queue, bool senders) {
+    for (SimTask* task : k.tasks) {
+        if (task->blocked && task->waitingOn == queue && task->waitingToSend == senders) {
+            makeReady(k, task);
+        }
+    }
+}
+
+bool push(Kernel& k, SimQueue* queue, const void* item) {
+    if (queue->count == queue->capacity) return false;
+    size_t tail = (queue->head + queue->count) % queue->capacity;
+    memcpy(&queue->storage[tail * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    wakeWaiters(k, queue, false);
+    if (queue->set != nullptr && !push(k, queue->set, &queue)) {
+        // configASSERT on the device: the set must hold every member's items
+        fprintf(stderr, "sim: queue set full\n");
+        abort();
+    }
+    return true;
+}
+
+bool pop(Kernel& k, SimQueue* queue, void* item) {
+    if (queue->count == 0) return false;
+    memcpy(item, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    wakeWaiters(k, queue, true);
+    return true;
+}
+
+void checkWatchdog(Kernel& k) {
+    if (k.watchdogUs == 0) return;
+    for (SimTask* task : k.tasks) {
+        if (task->watched && !task->deleted && !task->watchdogTripped && k.now - task->lastFeedUs > k.watchdogUs) {
+            task->watchdogTripped = true;
+            k.stats.watchdogTrips++;
+            k.stats.lastWatchdogTask = task->name.c_str();
+        }
+    }
+}
+
+uint64_t nextWake(const Kernel& k) {
+    uint64_t next = k.events.empty() ? UINT64_MAX : k.events.top().atUs;
+    for (const SimTask* task : k.tasks) {
+        if (!task->deleted && task->blocked && task->wakeUs < next) {
+            next = task->wakeUs;
+        }
+    }
+    return next;
+}
+
+void taskMain(SimTask* task) {
+    self = task;
+    Kernel& k = kernel();
+    {
+        Guard lock(k.mutex);
+        task->wake.wait(lock, [task] { return task->running; });
+    }
+    try {
+        task->function(task->parameter);
+    } catch (const TaskDeleted&) {
+    }
+    Guard lock(k.mutex);
+    task->deleted = true;
+    task->running = false;
+    k.current = nullptr;
+    k.harnessWake.notify_one();
+}
+
+void loopTask(void*) {
+    setup();
+    for (;;) {
+        loop();
+    }
+}
+
+// The harness loop: run ready tasks, else the next timeout or event
+bool run(uint64_t untilUs, const std::function<bool()>* done) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    for (;;) {
+        if (done != nullptr) {
+            lock.unlock();
+            bool finished = (*done)();
+            lock.lock();
+            if (finished) return true;
+        }
+
+        SimTask* task = pickReady(k);
+        if (task != nullptr) {
+            // Code takes no simulated time, so a task that polls without
+            // ever blocking would spin here forever; on the device it would
+            // starve the tasks below it
+            if (++k.switchesAtNow > SPIN_LIMIT) {
+                fprintf(stderr, "sim: task \"%s\" is spinning at %llu us without blocking\n", task->name.c_str(),
+                        static_cast<unsigned long long>(k.now));
+                abort();
+            }
+            dispatch(k, task, lock);
+            continue;
+        }
+
+        uint64_t next = nextWake(k);
+        if (next > untilUs) {
+            if (k.now < untilUs) {
+                k.now = untilUs;
+                k.switchesAtNow = 0;
+                checkWatchdog(k);
+            }
+            return false;
+        }
+        if (next > k.now) {
+            k.now = next;
+            k.switchesAtNow = 0;
+            checkWatchdog(k);
+        }
+
+        // Timeouts due now run before events at the same time
+        bool woke = false;
+        for (SimTask* blocked : k.tasks) {
+            if (!blocked->deleted && blocked->blocked && blocked->wakeUs <= k.now) {
+                blocked->timedOut = true;
+                makeReady(k, blocked);
+                woke = true;
+            }
+        }
+        if (woke) continue;
+
+        Event event = std::move(const_cast<Event&>(k.events.top()));
+        k.events.pop();
+        k.stats.events++;
+        lock.unlock();
+        event.action();
+        lock.lock();
+    }
+}
+
+}  // namespace
+
+// ---- Tasks
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+    (void)core;
+    Kernel& k = kernel();
+    sim::SimScope scope;
+    Guard lock(k.mutex);
+    SimTask* task = new SimTask();
+    task->name = name;
+    task->priority = priority;
+    task->stackDepth = stackDepth;
+    task->function = function;
+    task->parameter = parameter;
+    task->readyOrder = ++k.readySeq;
+    k.tasks.push_back(task);
+    k.stats.tasks++;
+    if (created != nullptr) {
+        *created = task;
+    }
+    std::thread(taskMain, task).detach();
+    preemptIfNeeded(k, lock);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                       UBaseType_t priority, TaskHandle_t* created) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == self) {
+        throw TaskDeleted();
+    }
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    task->deleted = true;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        taskYIELD();
+        return;
+    }
+    sim::blockFor(static_cast<uint64_t>(ticks) * 1000);
+}
+
+void taskYIELD() {
+    if (self == nullptr) return;
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    self->readyOrder = ++k.readySeq;
+    park(k, self, lock);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    SimTask* me = self;
+    if (me == nullptr) return 0;
+    uint64_t deadline = deadlineFor(k, ticks);
+    for (;;) {
+        if (me->notifyValue > 0) {
+            uint32_t value = me->notifyValue;
+            me->notifyValue = clearOnExit ? 0 : value - 1;
+            return value;
+        }
+        if (ticks == 0) return 0;
+        me->waitingNotify = true;
+        if (!block(k, lock, deadline)) return 0;
+    }
+}
+
+static void notifyGive(Kernel& k, SimTask* task) {
+    task->notifyValue++;
+    if (task->blocked && task->waitingNotify) {
+        makeReady(k, task);
+    }
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    notifyGive(k, task);
+    preemptIfNeeded(k, lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    notifyGive(k, task);
+    if (higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+TickType_t xTaskGetTickCount() {
+    return static_cast<TickType_t>(kernel().now / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return self;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    if (task == nullptr) task = self;
+    return task != nullptr ? task->stackDepth : 0;
+}
+
+// ---- Queues
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    sim::SimScope scope;
+    SimQueue* queue = new SimQueue();
+    queue->itemSize = itemSize;
+    queue->capacity = length;
+    queue->storage.resize(static_cast<size_t>(length) * itemSize);
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    uint64_t deadline = deadlineFor(k, ticks);
+    for (;;) {
+        if (push(k, queue, item)) {
+            preemptIfNeeded(k, lock);
+            return pdTRUE;
+        }
+        if (ticks == 0 || self == nullptr) return errQUEUE_FULL;
+        self->waitingOn = queue;
+        self->waitingToSend = true;
+        if (!block(k, lock, deadline)) return errQUEUE_FULL;
+    }
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return xQueueSend(queue, item, ticks);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* higherPriorityTaskWoken) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    bool sent = push(k, queue, item);
+    if (higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = sent ? pdTRUE : pdFALSE;
+    }
+    return sent ? pdTRUE : errQUEUE_FULL;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    uint64_t deadline = deadlineFor(k, ticks);
+    for (;;) {
+        if (pop(k, queue, item)) {
+            preemptIfNeeded(k, lock);
+            return pdTRUE;
+        }
+        if (ticks == 0 || self == nullptr) return pdFALSE;
+        self->waitingOn = queue;
+        if (!block(k, lock, deadline)) return pdFALSE;
+    }
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    return static_cast<UBaseType_t>(queue->count);
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    return static_cast<UBaseType_t>(queue->capacity - queue->count);
+}
+
+QueueSetHandle_t xQueueCreateSet(UBaseType_t length) {
+    return xQueueCreate(length, sizeof(SimQueue*));
+}
+
+BaseType_t xQueueAddToSet(QueueSetMemberHandle_t member, QueueSetHandle_t set) {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    if (member->set != nullptr || member->count > 0) return pdFAIL;
+    member->set = set;
+    return pdPASS;
+}
+
+QueueSetMemberHandle_t xQueueSelectFromSet(QueueSetHandle_t set, TickType_t ticks) {
+    SimQueue* member = nullptr;
+    return xQueueReceive(set, &member, ticks) == pdTRUE ? member : nullptr;
+}
+
+// ---- Task watchdog
+
+esp_err_t esp_task_wdt_init(uint32_t timeoutSeconds, bool panic) {
+    (void)panic;
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    k.watchdogUs = static_cast<uint64_t>(timeoutSeconds) * 1000000;
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_add(void* task) {
+    SimTask* watched = task != nullptr ? static_cast<SimTask*>(task) : self;
+    if (watched == nullptr) return ESP_ERR_INVALID_ARG;
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    watched->watched = true;
+    watched->lastFeedUs = k.now;
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_reset() {
+    if (self == nullptr || !self->watched) return ESP_ERR_NOT_FOUND;
+    self->lastFeedUs = kernel().now;
+    self->watchdogTripped = false;
+    return ESP_OK;
+}
+
+// ---- Harness
+
+namespace sim {
+
+bool inTask() {
+    return self != nullptr;
+}
+
+void blockFor(uint64_t us) {
+    if (self == nullptr) return;
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    block(k, lock, k.now + us);
+}
+
+void boot() {
+    Kernel& k = kernel();
+    if (k.booted) return;
+    k.booted = true;
+    // This thread is the harness from now on: nothing it allocates is the
+    // firmware's
+    heapDepth++;
+    xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, nullptr, 1, nullptr, 1);
+}
+
+uint64_t nowUs() {
+    return kernel().now;
+}
+
+void runUntilUs(uint64_t atUs) {
+    run(atUs, nullptr);
+}
+
+void runFor(uint64_t ms) {
+    run(kernel().now + ms * 1000, nullptr);
+}
+
+bool runUntil(const std::function<bool()>& done, uint64_t timeoutMs) {
+    return run(kernel().now + timeoutMs * 1000, &done);
+}
+
+void at(uint64_t atUs, std::function<void()> action) {
+    Kernel& k = kernel();
+    SimScope scope;
+    Guard lock(k.mutex);
+    k.events.push(Event{atUs < k.now ? k.now : atUs, ++k.eventSeq, std::move(action)});
+}
+
+void after(uint64_t delayUs, std::function<void()> action) {
+    at(kernel().now + delayUs, std::move(action));
+}
+
+KernelStats kernelStats() {
+    Kernel& k = kernel();
+    Guard lock(k.mutex);
+    KernelStats stats = k.stats;
+    if (stats.lastWatchdogTask == nullptr) {
+        stats.lastWatchdogTask = "";
+    }
+    return stats;
+}
+
+}  // namespace sim
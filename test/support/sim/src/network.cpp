@@ -0,0 +1,682 @@
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "AsyncUDP.h"
+#include "PubSubClient.h"
+#include "WiFi.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+// The access point, the TCP connections to the broker, the broker itself
+// and UDP on the LAN. A frame for the device reaches the access point, then
+// waits there for the station's next beacon while modem sleep is on.
+
+WiFiClass WiFi;
+
+namespace {
+
+struct Station {
+    bool connected = false;
+    uint32_t attempt = 0;   // bumped to cancel a pending association
+    wifi_ps_type_t sleep = WIFI_PS_NONE;
+    std::vector<WiFiEventFuncCb> handlers;
+    uint8_t bssid[6] = {0x24, 0x0A, 0xC4, 0x5E, 0x5A, 0x01};
+};
+
+Station station;
+
+// Open TCP connections from the device; all of them go to the broker
+std::vector<uint32_t> liveConnections;
+uint32_t nextConnection = 1;
+
+std::vector<std::pair<uint16_t, AsyncUDP*>> udpListeners;
+std::vector<sim::LanPeer*> lanPeers;
+
+const IPAddress DEVICE_IP(192, 168, 0, 50);
+
+bool isLive(uint32_t connection) {
+    return connection != 0 && std::find(liveConnections.begin(), liveConnections.end(), connection) !=
+                                  liveConnections.end();
+}
+
+uint64_t uplinkUs() {
+    const sim::NetworkTiming& timing = sim::networkTiming();
+    return timing.wifiHopUs + timing.lanHopUs;
+}
+
+uint64_t roundTripUs() {
+    return 2 * uplinkUs();
+}
+
+void fireWifiEvent(arduino_event_id_t id) {
+    arduino_event_info_t info = {};
+    for (const WiFiEventFuncCb& handler : station.handlers) {
+        sim::FirmwareScope scope;
+        handler(id, info);
+    }
+}
+
+size_t pendingMessages(const sim::Broker::Session& session) {
+    size_t count = 0;
+    for (const sim::Broker::Inbound& inbound : session.inbox) {
+        count += inbound.pingResponse ? 0 : 1;
+    }
+    return count;
+}
+
+// The broker forgets the session on a connection that went away
+void closeConnection(uint32_t connection) {
+    liveConnections.erase(std::remove(liveConnections.begin(), liveConnections.end(), connection),
+                          liveConnections.end());
+    sim::Broker& broker = sim::broker();
+    for (size_t i = 0; i < broker.sessions.size(); i++) {
+        if (broker.sessions[i].connection == connection) {
+            broker.counters.lostDownlink += pendingMessages(broker.sessions[i]);
+            broker.sessions.erase(broker.sessions.begin() + static_cast<long>(i));
+            break;
+        }
+    }
+}
+
+void closeAllConnections() {
+    while (!liveConnections.empty()) {
+        closeConnection(liveConnections.back());
+    }
+}
+
+sim::Broker::Session* findSession(uint32_t connection) {
+    for (sim::Broker::Session& session : sim::broker().sessions) {
+        if (session.connection == connection) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+void dropStation() {
+    station.connected = false;
+    sim::accessPoint().disconnects++;
+    closeAllConnections();
+    sim::after(0, [] { fireWifiEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED); });
+}
+
+AsyncUDP* findListener(uint16_t port) {
+    for (const auto& listener : udpListeners) {
+        if (listener.first == port) {
+            return listener.second;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+namespace sim {
+
+NetworkTiming& networkTiming() {
+    static NetworkTiming timing;
+    return timing;
+}
+
+AccessPoint& accessPoint() {
+    static AccessPoint ap;
+    return ap;
+}
+
+Broker& broker() {
+    static Broker* instance = [] {
+        SimScope scope;
+        return new Broker();
+    }();
+    return *instance;
+}
+
+bool stationConnected() {
+    return station.connected;
+}
+
+uint64_t downlinkArrivalUs(uint64_t atUs) {
+    const NetworkTiming& timing = networkTiming();
+    if (station.sleep != WIFI_PS_NONE) {
+        // Buffered by the access point until a beacon the station wakes for
+        uint64_t period = static_cast<uint64_t>(timing.beaconUs) * (station.sleep == WIFI_PS_MAX_MODEM ? 3 : 1);
+        atUs = (atUs + period - 1) / period * period;
+    }
+    return atUs + timing.wifiHopUs;
+}
+
+void resetDeviceConnections() {
+    closeAllConnections();
+}
+
+void AccessPoint::setUp(bool up) {
+    SimScope scope;
+    apUp = up;
+    if (!up) {
+        station.attempt++;
+        if (station.connected) {
+            dropStation();
+        }
+    }
+}
+
+bool AccessPoint::stationConnected() const {
+    return station.connected;
+}
+
+bool topicMatches(const std::string& filter, const std::string& topic) {
+    size_t f = 0;
+    size_t t = 0;
+    while (f < filter.size()) {
+        if (filter[f] == '#') {
+            return true;
+        }
+        size_t filterEnd = filter.find('/', f);
+        size_t topicEnd = topic.find('/', t);
+        if (filterEnd == std::string::npos) filterEnd = filter.size();
+        if (topicEnd == std::string::npos) topicEnd = topic.size();
+        if (t > topic.size()) {
+            return false;
+        }
+        if (!(filterEnd - f == 1 && filter[f] == '+') &&
+            filter.compare(f, filterEnd - f, topic, t, topicEnd - t) != 0) {
+            return false;
+        }
+        f = filterEnd + 1;
+        t = topicEnd + 1;
+    }
+    return t > topic.size();
+}
+
+void Broker::stop() {
+    SimScope scope;
+    isRunning = false;
+    epoch++;
+    closeAllConnections();
+}
+
+void Broker::start() {
+    isRunning = true;
+}
+
+void Broker::restart(uint32_t downMs) {
+    stop();
+    after(static_cast<uint64_t>(downMs) * 1000, [this] { start(); });
+}
+
+void Broker::setBlackhole(bool blackhole) {
+    SimScope scope;
+    if (blackholed && !blackhole) {
+        // Its sessions expired while it was unreachable
+        epoch++;
+        closeAllConnections();
+    }
+    blackholed = blackhole;
+}
+
+bool Broker::publish(const std::string& topic, const std::string& payload) {
+    if (!isRunning || blackholed) {
+        return false;
+    }
+    SimScope scope;
+    const NetworkTiming& timing = networkTiming();
+    uint64_t arrival = downlinkArrivalUs(nowUs() + 2 * timing.lanHopUs + timing.brokerUs);
+    for (Session& session : sessions) {
+        bool subscribed = false;
+        for (const std::string& filter : session.filters) {
+            subscribed = subscribed || topicMatches(filter, topic);
+        }
+        if (!subscribed) continue;
+        if (pendingMessages(session) >= inboxLimit) {
+            counters.inboxOverflows++;
+            continue;
+        }
+        session.inbox.push_back(Inbound{arrival, false, topic, payload});
+    }
+    return true;
+}
+
+void Broker::subscribe(const std::string& filter, Observer observer) {
+    SimScope scope;
+    observers.emplace_back(filter, std::move(observer));
+}
+
+void Broker::onLost(Observer observer) {
+    SimScope scope;
+    lostObservers.push_back(std::move(observer));
+}
+
+// ---- LAN peers
+
+LanPeer::LanPeer(uint8_t hostOctet, uint16_t port) : ip(192, 168, 0, hostOctet), localPort(port) {
+    SimScope scope;
+    lanPeers.push_back(this);
+}
+
+LanPeer::~LanPeer() {
+    SimScope scope;
+    lanPeers.erase(std::remove(lanPeers.begin(), lanPeers.end(), this), lanPeers.end());
+}
+
+LanPeer* findLanPeer(uint32_t ip, uint16_t port) {
+    for (LanPeer* peer : lanPeers) {
+        if (static_cast<uint32_t>(peer->address()) == ip && peer->port() == port) {
+            return peer;
+        }
+    }
+    return nullptr;
+}
+
+bool LanPeer::send(uint16_t devicePort, const uint8_t* data, size_t length) {
+    if (!station.connected) {
+        lost++;
+        return false;
+    }
+    SimScope scope;
+    sent++;
+    std::vector<uint8_t> bytes(data, data + length);
+    IPAddress from = ip;
+    uint16_t fromPort = localPort;
+    at(downlinkArrivalUs(nowUs() + networkTiming().lanHopUs), [bytes, from, fromPort, devicePort]() {
+        LanPeer* peer = findLanPeer(from, fromPort);
+        AsyncUDP* listener = findListener(devicePort);
+        if (!station.connected || listener == nullptr) {
+            if (peer != nullptr) peer->lost++;
+            return;
+        }
+        AsyncUDPPacket packet(bytes.data(), bytes.size(), from, fromPort);
+        listener->deliver(packet);
+    });
+    return true;
+}
+
+}  // namespace sim
+
+// ---- WiFi
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid,
+                             bool connect) {
+    (void)ssid;
+    (void)passphrase;
+    if (!connect) {
+        return WL_DISCONNECTED;
+    }
+    sim::SimScope scope;
+    uint32_t attempt = ++station.attempt;
+    const sim::NetworkTiming& timing = sim::networkTiming();
+    uint64_t delayMs = channel != 0 && bssid != nullptr ? timing.cachedAssociateMs : timing.scanAssociateMs;
+    sim::after(delayMs * 1000, [attempt] {
+        if (attempt != station.attempt || station.connected || !sim::accessPoint().up()) return;
+        station.connected = true;
+        sim::accessPoint().associations++;
+        fireWifiEvent(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+        fireWifiEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    });
+    return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    (void)wifiOff;
+    (void)eraseAp;
+    sim::SimScope scope;
+    station.attempt++;
+    if (station.connected) {
+        dropStation();
+    }
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    return station.connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    (void)mode;
+    return true;
+}
+
+void WiFiClass::persistent(bool persistent) {
+    (void)persistent;
+}
+
+bool WiFiClass::setAutoReconnect(bool autoReconnect) {
+    (void)autoReconnect;
+    return true;
+}
+
+bool WiFiClass::setSleep(wifi_ps_type_t sleep) {
+    station.sleep = sleep;
+    sim::recordWifiSleep(sleep);
+    return true;
+}
+
+bool WiFiClass::setSleep(bool enabled) {
+    return setSleep(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+}
+
+wifi_ps_type_t WiFiClass::getSleep() {
+    return station.sleep;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback) {
+    sim::SimScope scope;
+    station.handlers.push_back(std::move(callback));
+    return static_cast<wifi_event_id_t>(station.handlers.size());
+}
+
+IPAddress WiFiClass::localIP() {
+    return station.connected ? DEVICE_IP : IPAddress();
+}
+
+uint8_t* WiFiClass::BSSID() {
+    return station.connected ? station.bssid : nullptr;
+}
+
+int32_t WiFiClass::channel() {
+    return 6;
+}
+
+int8_t WiFiClass::RSSI() {
+    return station.connected ? -58 : 0;
+}
+
+// ---- TCP
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, 3000);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    (void)host;
+    (void)port;
+    stop();
+    if (!station.connected) {
+        return 0;
+    }
+    sim::Broker& broker = sim::broker();
+    if (broker.blackholed) {
+        // SYNs go unanswered
+        sim::blockFor(static_cast<uint64_t>(timeoutMs) * 1000);
+        broker.counters.refused++;
+        return 0;
+    }
+    sim::blockFor(roundTripUs());
+    if (!station.connected || !broker.isRunning || broker.blackholed) {
+        broker.counters.refused++;
+        return 0;
+    }
+    sim::SimScope scope;
+    connection = nextConnection++;
+    liveConnections.push_back(connection);
+    return 1;
+}
+
+void WiFiClient::stop() {
+    if (connection != 0) {
+        sim::SimScope scope;
+        closeConnection(connection);
+        connection = 0;
+    }
+}
+
+uint8_t WiFiClient::connected() {
+    return isLive(connection) ? 1 : 0;
+}
+
+// ---- MQTT client
+
+PubSubClient::PubSubClient(WiFiClient& client) : client(&client) {
+    buffer.resize(MQTT_MAX_PACKET_SIZE);
+}
+
+PubSubClient& PubSubClient::setServer(const char* domain, uint16_t port) {
+    (void)domain;
+    (void)port;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+    this->callback = callback;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setKeepAlive(uint16_t keepAlive) {
+    this->keepAlive = keepAlive;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setSocketTimeout(uint16_t timeout) {
+    socketTimeout = timeout;
+    return *this;
+}
+
+// The library reallocs its buffer: the firmware's heap
+bool PubSubClient::setBufferSize(uint16_t size) {
+    if (size == 0) {
+        return false;
+    }
+    buffer.resize(size);
+    return true;
+}
+
+uint16_t PubSubClient::getBufferSize() {
+    return static_cast<uint16_t>(buffer.size());
+}
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass) {
+    (void)user;
+    (void)pass;
+    if (!client->connected() && !client->connect("broker", 1883)) {
+        currentState = MQTT_CONNECT_FAILED;
+        return false;
+    }
+    sim::Broker& broker = sim::broker();
+    if (broker.isRunning && !broker.blackholed) {
+        sim::blockFor(roundTripUs() + sim::networkTiming().brokerUs);
+        if (client->connected() && broker.isRunning && !broker.blackholed) {
+            sim::SimScope scope;
+            // Clean session; a client with the same id is disconnected
+            for (size_t i = 0; i < broker.sessions.size(); i++) {
+                if (broker.sessions[i].clientId == id) {
+                    closeConnection(broker.sessions[i].connection);
+                    break;
+                }
+            }
+            broker.sessions.push_back(sim::Broker::Session{client->connectionId(), id, {}, {}});
+            broker.counters.connects++;
+            currentState = MQTT_CONNECTED;
+            pingOutstanding = false;
+            lastInActivity = lastOutActivity = millis();
+            return true;
+        }
+    }
+    // No CONNACK
+    sim::blockFor(static_cast<uint64_t>(socketTimeout) * 1000000);
+    currentState = MQTT_CONNECTION_TIMEOUT;
+    client->stop();
+    return false;
+}
+
+void PubSubClient::disconnect() {
+    currentState = MQTT_DISCONNECTED;
+    client->stop();
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload) {
+    return publish(topic, reinterpret_cast<const uint8_t*>(payload), static_cast<unsigned int>(strlen(payload)));
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length) {
+    if (!connected()) {
+        return false;
+    }
+    size_t topicLength = strnlen(topic, buffer.size());
+    if (buffer.size() < MQTT_MAX_HEADER_SIZE + 2 + topicLength + length) {
+        return false;
+    }
+    sim::SimScope scope;
+    lastOutActivity = millis();
+    uint32_t connection = client->connectionId();
+    uint32_t epoch = sim::broker().epoch;
+    sim::Message message{0, topic, std::string(reinterpret_cast<const char*>(payload), length)};
+    sim::after(uplinkUs(), [connection, epoch, message]() mutable {
+        sim::Broker& broker = sim::broker();
+        message.atUs = sim::nowUs();
+        if (!broker.isRunning || broker.blackholed || broker.epoch != epoch || !isLive(connection)) {
+            broker.counters.lostUplink++;
+            for (const sim::Broker::Observer& observer : broker.lostObservers) {
+                observer(message);
+            }
+            return;
+        }
+        broker.counters.fromDevice++;
+        for (const auto& observer : broker.observers) {
+            if (sim::topicMatches(observer.first, message.topic)) {
+                observer.second(message);
+            }
+        }
+    });
+    return true;
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+    if (!connected()) {
+        return false;
+    }
+    sim::SimScope scope;
+    sim::Broker::Session* session = findSession(client->connectionId());
+    if (session != nullptr) {
+        session->filters.push_back(topic);
+    }
+    lastOutActivity = millis();
+    return true;
+}
+
+bool PubSubClient::loop() {
+    if (!connected()) {
+        return false;
+    }
+    uint32_t now = millis();
+    if (now - lastInActivity > keepAlive * 1000UL || now - lastOutActivity > keepAlive * 1000UL) {
+        if (pingOutstanding) {
+            currentState = MQTT_CONNECTION_TIMEOUT;
+            client->stop();
+            return false;
+        }
+        sim::SimScope scope;
+        uint32_t connection = client->connectionId();
+        uint32_t epoch = sim::broker().epoch;
+        sim::after(uplinkUs(), [connection, epoch] {
+            sim::Broker& broker = sim::broker();
+            sim::Broker::Session* session = findSession(connection);
+            if (!broker.isRunning || broker.blackholed || broker.epoch != epoch || session == nullptr) return;
+            const sim::NetworkTiming& timing = sim::networkTiming();
+            uint64_t arrival = sim::downlinkArrivalUs(sim::nowUs() + timing.brokerUs + timing.lanHopUs);
+            session->inbox.push_back(sim::Broker::Inbound{arrival, true, std::string(), std::string()});
+        });
+        lastOutActivity = now;
+        lastInActivity = now;
+        pingOutstanding = true;
+    }
+
+    // One packet per call, as the library reads them
+    sim::Broker::Session* session = findSession(client->connectionId());
+    if (session == nullptr || session->inbox.empty() || session->inbox.front().atUs > sim::nowUs()) {
+        return true;
+    }
+    sim::Broker::Inbound inbound;
+    {
+        sim::SimScope scope;
+        inbound = std::move(session->inbox.front());
+        session->inbox.pop_front();
+    }
+    lastInActivity = now;
+    if (inbound.pingResponse) {
+        pingOutstanding = false;
+        return true;
+    }
+    sim::broker().counters.toDevice++;
+    size_t topicLength = inbound.topic.size();
+    size_t length = inbound.payload.size();
+    if (MQTT_MAX_HEADER_SIZE + 2 + topicLength + length > buffer.size()) {
+        // Too long for the buffer: the library skips the packet
+        return true;
+    }
+    memcpy(buffer.data(), inbound.topic.data(), topicLength);
+    buffer[topicLength] = 0;
+    memcpy(buffer.data() + topicLength + 1, inbound.payload.data(), length);
+    if (callback) {
+        sim::FirmwareScope scope;
+        callback(reinterpret_cast<char*>(buffer.data()), buffer.data() + topicLength + 1,
+                 static_cast<unsigned int>(length));
+    }
+    return true;
+}
+
+bool PubSubClient::connected() {
+    if (client == nullptr) {
+        return false;
+    }
+    if (!client->connected()) {
+        if (currentState == MQTT_CONNECTED) {
+            currentState = MQTT_CONNECTION_LOST;
+            client->stop();
+        }
+        return false;
+    }
+    return currentState == MQTT_CONNECTED;
+}
+
+int PubSubClient::state() {
+    return currentState;
+}
+
+// ---- UDP
+
+bool AsyncUDP::listen(uint16_t port) {
+    sim::SimScope scope;
+    close();
+    this->port = port;
+    udpListeners.emplace_back(port, this);
+    return true;
+}
+
+void AsyncUDP::onPacket(AuPacketHandlerFunction callback) {
+    sim::SimScope scope;
+    handler = callback;
+}
+
+size_t AsyncUDP::writeTo(const uint8_t* data, size_t length, const IPAddress& address, uint16_t port) {
+    if (!station.connected) {
+        return 0;
+    }
+    sim::SimScope scope;
+    std::vector<uint8_t> bytes(data, data + length);
+    uint32_t ip = address;
+    sim::after(uplinkUs(), [bytes, ip, port] {
+        sim::LanPeer* peer = sim::findLanPeer(ip, port);
+        if (peer == nullptr) return;
+        peer->received++;
+        if (peer->onReceive) {
+            peer->onReceive(bytes.data(), bytes.size());
+        }
+    });
+    return length;
+}
+
+void AsyncUDP::close() {
+    udpListeners.erase(std::remove_if(udpListeners.begin(), udpListeners.end(),
+                                      [this](const std::pair<uint16_t, AsyncUDP*>& listener) {
+                                          return listener.second == this;
+                                      }),
+                       udpListeners.end());
+    port = 0;
+}
+
+void AsyncUDP::deliver(AsyncUDPPacket& packet) {
+    if (handler) {
+        sim::FirmwareScope scope;
+        handler(packet);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef SIM_INTERNAL_H
+#define SIM_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include "sim.h"
+
+// Shared between the simulation's sources; not for tests
+namespace sim {
+
+// Heap accounting depth of the calling thread: allocations are counted as
+// the firmware's only at depth 0 (heap.cpp)
+extern thread_local int heapDepth;
+
+// Simulation bookkeeping (fakes, harness): not counted
+class SimScope {
+public:
+    SimScope() { heapDepth++; }
+    ~SimScope() { heapDepth--; }
+    SimScope(const SimScope&) = delete;
+    SimScope& operator=(const SimScope&) = delete;
+};
+
+// Firmware code called back from a fake: counted again
+class FirmwareScope {
+public:
+    FirmwareScope() : saved(heapDepth) { heapDepth = 0; }
+    ~FirmwareScope() { heapDepth = saved; }
+    FirmwareScope(const FirmwareScope&) = delete;
+    FirmwareScope& operator=(const FirmwareScope&) = delete;
+
+private:
+    int saved;
+};
+
+// True on a task thread, false on the harness (interrupt/callback context)
+bool inTask();
+
+// Blocks the calling task for us of simulated time; outside a task it
+// returns at once (callback context cannot block)
+void blockFor(uint64_t us);
+
+void logWrite(const char* text, size_t length);
+
+// WiFi station (network.cpp)
+bool stationConnected();
+// When a frame reaching the access point at atUs gets to the device, which
+// may be asleep until its next beacon
+uint64_t downlinkArrivalUs(uint64_t atUs);
+void resetDeviceConnections();
+
+// Power (arduino.cpp)
+void recordWifiSleep(int sleep);
+void recordBleTxPower(int8_t dbm);
+
+// BLE scan (ble.cpp)
+void scanStarted(NimBLEScan& scan);
+
+}  // namespace sim
+
+#endif
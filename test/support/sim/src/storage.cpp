@@ -0,0 +1,252 @@
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "LittleFS.h"
+#include "Preferences.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+// NVS and LittleFS in memory. Nothing survives the process, which is one
+// boot of the simulated device.
+
+LittleFSFS LittleFS;
+
+namespace sim {
+
+struct FileNode {
+    std::vector<uint8_t> data;
+};
+
+}  // namespace sim
+
+namespace {
+
+const size_t FLASH_CAPACITY = 1408 * 1024;   // the default partition table's spiffs partition
+
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>>& nvs() {
+    static auto* namespaces = [] {
+        sim::SimScope scope;
+        return new std::map<std::string, std::map<std::string, std::vector<uint8_t>>>();
+    }();
+    return *namespaces;
+}
+
+std::map<std::string, std::shared_ptr<sim::FileNode>>& files() {
+    static auto* table = [] {
+        sim::SimScope scope;
+        return new std::map<std::string, std::shared_ptr<sim::FileNode>>();
+    }();
+    return *table;
+}
+
+uint64_t nvsWrites = 0;
+uint64_t flashBytesWritten = 0;
+bool mounted = false;
+
+size_t flashUsed() {
+    size_t used = 0;
+    for (const auto& file : files()) {
+        used += file.second->data.size();
+    }
+    return used;
+}
+
+}  // namespace
+
+// ---- Preferences
+
+bool Preferences::begin(const char* space, bool readOnlyMode, const char* partition) {
+    (void)partition;
+    if (space == nullptr || strlen(space) >= sizeof(name)) {
+        return false;
+    }
+    strncpy(name, space, sizeof(name) - 1);
+    readOnly = readOnlyMode;
+    opened = true;
+    return true;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+bool Preferences::clear() {
+    if (!opened || readOnly) return false;
+    sim::SimScope scope;
+    nvs()[name].clear();
+    nvsWrites++;
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!opened || readOnly) return false;
+    sim::SimScope scope;
+    nvsWrites++;
+    return nvs()[name].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    if (!opened) return false;
+    sim::SimScope scope;
+    return nvs()[name].count(key) > 0;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t value = defaultValue;
+    if (getBytesLength(key) == sizeof(value)) {
+        getBytes(key, &value, sizeof(value));
+    }
+    return value;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (!opened || readOnly || key == nullptr) return 0;
+    sim::SimScope scope;
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    nvs()[name][key].assign(bytes, bytes + length);
+    nvsWrites++;
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!opened) return 0;
+    sim::SimScope scope;
+    auto& space = nvs()[name];
+    auto entry = space.find(key);
+    return entry != space.end() ? entry->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    if (!opened) return 0;
+    sim::SimScope scope;
+    auto& space = nvs()[name];
+    auto entry = space.find(key);
+    if (entry == space.end() || entry->second.size() > maxLength) return 0;
+    memcpy(buffer, entry->second.data(), entry->second.size());
+    return entry->second.size();
+}
+
+// ---- LittleFS
+
+File::File(std::shared_ptr<sim::FileNode> fileNode, bool canRead, bool canWrite, bool appending)
+    : node(std::move(fileNode)), readable(canRead), writable(canWrite), append(appending) {
+    if (append) {
+        offset = node->data.size();
+    }
+}
+
+size_t File::size() const {
+    return node != nullptr ? node->data.size() : 0;
+}
+
+bool File::seek(uint32_t position) {
+    if (node == nullptr || position > node->data.size()) return false;
+    offset = position;
+    return true;
+}
+
+size_t File::read(uint8_t* buffer, size_t length) {
+    if (node == nullptr || !readable || offset >= node->data.size()) return 0;
+    size_t n = std::min(length, node->data.size() - offset);
+    memcpy(buffer, node->data.data() + offset, n);
+    offset += n;
+    return n;
+}
+
+size_t File::write(const uint8_t* buffer, size_t length) {
+    if (node == nullptr || !writable) return 0;
+    sim::SimScope scope;
+    if (append) {
+        offset = node->data.size();
+    }
+    size_t growth = offset + length > node->data.size() ? offset + length - node->data.size() : 0;
+    if (flashUsed() + growth > FLASH_CAPACITY) return 0;
+    if (growth > 0) {
+        node->data.resize(offset + length);
+    }
+    memcpy(node->data.data() + offset, buffer, length);
+    offset += length;
+    flashBytesWritten += length;
+    return length;
+}
+
+void File::close() {
+    sim::SimScope scope;
+    node.reset();
+}
+
+bool LittleFSFS::begin(bool formatOnFail) {
+    (void)formatOnFail;
+    mounted = true;
+    return true;
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+    if (!mounted || path == nullptr || mode == nullptr) return File();
+    sim::SimScope scope;
+    auto& table = files();
+    auto entry = table.find(path);
+    bool plus = strchr(mode, '+') != nullptr;
+    switch (mode[0]) {
+        case 'r':
+            if (entry == table.end()) return File();
+            return File(entry->second, true, plus, false);
+        case 'w': {
+            auto node = std::make_shared<sim::FileNode>();
+            table[path] = node;
+            return File(node, plus, true, false);
+        }
+        case 'a':
+            if (entry == table.end()) {
+                entry = table.emplace(path, std::make_shared<sim::FileNode>()).first;
+            }
+            return File(entry->second, plus, true, true);
+        default:
+            return File();
+    }
+}
+
+bool LittleFSFS::exists(const char* path) {
+    sim::SimScope scope;
+    return mounted && files().count(path) > 0;
+}
+
+bool LittleFSFS::remove(const char* path) {
+    sim::SimScope scope;
+    return mounted && files().erase(path) > 0;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    if (!mounted) return false;
+    sim::SimScope scope;
+    auto& table = files();
+    auto entry = table.find(from);
+    if (entry == table.end()) return false;
+    std::shared_ptr<sim::FileNode> node = entry->second;
+    table.erase(entry);
+    table[to] = node;
+    return true;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return FLASH_CAPACITY;
+}
+
+size_t LittleFSFS::usedBytes() {
+    return flashUsed();
+}
+
+namespace sim {
+
+StorageStats storageStats() {
+    return StorageStats{nvsWrites, flashBytesWritten, flashUsed()};
+}
+
+}  // namespace sim
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "alloc_counter.h"
+#include "command.h"
+#include "command_queue.h"
+#include "event_writer.h"
+#include "history_log.h"
+#include "latency_histogram.h"
+#include "outbound_buffer.h"
+
+// The per-event paths must not touch the heap: over weeks of uptime every
+// allocation is a chance to fragment it. Each test drives one path many
+// times with operator new counting, and the soak runs them all together.
+//
+// Only the modules themselves are covered: parsing, the command queue,
+// event encoding, the history ring and the outbound buffer.
+// The glue in network_task.cpp and sesame_task.cpp that calls them (MQTT
+// publish, dispatch to the BLE client) is not exercised here; test_soak
+// runs it in the simulator and checks the heap does not grow.
+
+static const uint32_t ROUNDS = 20000;
+
+static const char JSON_COMMAND[] = "{\"action\":\"toggle\",\"target\":\"door\",\"request_id\":\"r-1\",\"relock_s\":30}";
+static const uint8_t CBOR_COMMAND[] = {0xA2, 0x12, 0x01, 0x0F, 0x63, 'r', '-', '2'};
+
+static uint8_t ring[4096];
+
+void setUp(void) { allocations = 0; }
+void tearDown(void) {}
+
+// One command from payload to result; returns the number of results taken
+static size_t commandRound(CommandQueue& queue, uint32_t i) {
+    SesameCommand command = {};
+    CommandParseResult parsed = (i & 1)
+        ? parseCommandPayload(JSON_COMMAND, sizeof(JSON_COMMAND) - 1, command)
+        : parseCommandPayload(reinterpret_cast<const char*>(CBOR_COMMAND), sizeof(CBOR_COMMAND), command);
+    TEST_ASSERT_EQUAL(CommandParseResult::ok, parsed);
+    if (command.action == CommandAction::toggle) {
+        command.action = CommandAction::unlock;
+    }
+    uint32_t now = i * 10;
+    queue.push(command, now);
+    SesameCommand sent;
+    if (queue.next(now, now, sent)) {
+        queue.statusUpdate(sent.action == CommandAction::lock, sent.action == CommandAction::unlock, now + 1, now + 1);
+    }
+    queue.expire(now + 2);
+    CommandResult result;
+    size_t results = 0;
+    while (queue.takeResult(result)) {
+        results++;
+    }
+    return results;
+}
+
+static size_t encodeEvents(PayloadFormat format, uint8_t* payload, size_t size, uint32_t i) {
+    EventWriter status(format, payload, size);
+    status.add(FieldId::lock, "door");
+    status.add(FieldId::locked, (i & 1) != 0);
+    status.add(FieldId::voltage, 6.0 + (i % 10) * 0.01);
+    status.add(FieldId::position, static_cast<int16_t>(i % 512) - 256);
+    status.add(FieldId::predicted, "locked");
+    status.finish();
+
+    EventWriter metrics(format, payload, size);
+    metrics.beginObject(FieldId::queue);
+    metrics.add(FieldId::count, i);
+    metrics.add(FieldId::p95Us, 1234u);
+    metrics.endObject();
+    metrics.beginArray(FieldId::stacks);
+    metrics.beginArrayObject();
+    metrics.add(FieldId::task, "sesame");
+    metrics.add(FieldId::stackFree, 2048u);
+    metrics.endObject();
+    metrics.endArray();
+    metrics.finish();
+    return metrics.length();
+}
+
+void test_command_path(void) {
+    CommandQueue queue(2000, 10000, 30000);
+    size_t results = 0;
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        results += commandRound(queue, i);
+    }
+    TEST_ASSERT_TRUE(results > 0);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+void test_event_encoding(void) {
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        encodeEvents((i & 1) ? PayloadFormat::json : PayloadFormat::cbor, payload, sizeof(payload), i);
+    }
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+void test_offline_buffer_and_replay(void) {
+    OutboundBuffer buffer(ring, sizeof(ring), nullptr);
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    char topic[OUTBOUND_TOPIC_SIZE];
+    uint8_t replay[OUTBOUND_PAYLOAD_SIZE + 1];
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        size_t length = encodeEvents((i & 1) ? PayloadFormat::json : PayloadFormat::cbor, payload, sizeof(payload), i);
+        buffer.push("sesame/door/status", payload, length, i);
+        if (i % 16 == 15) {
+            size_t replayLength;
+            uint32_t queuedMs;
+            while (buffer.peek(topic, sizeof(topic), replay, sizeof(replay), replayLength, queuedMs)) {
+                appendAgeMs(replay, replayLength, sizeof(replay) - 1, i - queuedMs);
+                buffer.pop();
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(buffer.stats().buffered > 0);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+void test_history_and_latency(void) {
+    static HistoryLog history;
+    LatencyHistogram latency;
+    HistoryEntry batch[6];
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        HistoryEntry entry = {};
+        entry.time = 1000 + i;
+        entry.lock = static_cast<uint8_t>(i % 3);
+        entry.type = 1;
+        strncpy(entry.tag, "rf", sizeof(entry.tag) - 1);
+        TEST_ASSERT_TRUE(history.add(entry));
+
+        size_t count = history.takeUnpublished(batch, 6);
+        TEST_ASSERT_EQUAL(1, count);
+        EventWriter event(PayloadFormat::json, payload, sizeof(payload));
+        event.beginArray(FieldId::entries);
+        for (size_t n = 0; n < count; n++) {
+            event.beginArrayObject();
+            event.add(FieldId::time, batch[n].time);
+            event.add(FieldId::tag, batch[n].tag);
+            event.endObject();
+        }
+        event.endArray();
+        event.finish();
+
+        latency.record(i % 50000);
+        latency.percentileUs(95);
+    }
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+// All paths interleaved, as a long uptime would run them
+void test_soak(void) {
+    CommandQueue queue(2000, 10000, 30000);
+    OutboundBuffer buffer(ring, sizeof(ring), nullptr);
+    LatencyHistogram latency;
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    char topic[OUTBOUND_TOPIC_SIZE];
+    uint8_t replay[OUTBOUND_PAYLOAD_SIZE + 1];
+
+    for (uint32_t i = 0; i < ROUNDS * 10; i++) {
+        commandRound(queue, i);
+        size_t length = encodeEvents((i & 2) ? PayloadFormat::json : PayloadFormat::cbor, payload, sizeof(payload), i);
+        latency.record(i % 100000);
+        // Broker away for 50 of every 200 events
+        if (i % 200 < 50) {
+            buffer.push("sesame/door/status", payload, length, i);
+        } else {
+            size_t replayLength;
+            uint32_t queuedMs;
+            if (buffer.peek(topic, sizeof(topic), replay, sizeof(replay), replayLength, queuedMs)) {
+                appendAgeMs(replay, replayLength, sizeof(replay) - 1, i - queuedMs);
+                buffer.pop();
+            }
+        }
+    }
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u events, %zu allocations", static_cast<unsigned>(ROUNDS * 10), allocations);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(buffer.empty());
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_command_path);
+    RUN_TEST(test_event_encoding);
+    RUN_TEST(test_offline_buffer_and_replay);
+    RUN_TEST(test_history_and_latency);
+    RUN_TEST(test_soak);
+    return UNITY_END();
+}
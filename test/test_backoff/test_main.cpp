@@ -0,0 +1,78 @@
+#include <unity.h>
+#include "backoff.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_delay_doubles_up_to_the_cap(void) {
+    Backoff backoff(1000, 30000, 0);
+    const uint32_t expected[] = {1000, 2000, 4000, 8000, 16000, 30000, 30000};
+    for (uint32_t delay : expected) {
+        TEST_ASSERT_EQUAL_UINT32(delay, backoff.nextDelayMs(0));
+    }
+    TEST_ASSERT_EQUAL(7, backoff.attempts());
+}
+
+void test_reset_makes_the_next_retry_fast(void) {
+    Backoff backoff(500, 8000, 0);
+    backoff.nextDelayMs(0);
+    backoff.nextDelayMs(0);
+    backoff.nextDelayMs(0);
+    backoff.reset();
+    TEST_ASSERT_EQUAL(0, backoff.attempts());
+    TEST_ASSERT_EQUAL_UINT32(500, backoff.nextDelayMs(0));
+}
+
+void test_jitter_stays_within_the_spread(void) {
+    Backoff backoff(1000, 1000, 20);
+    uint32_t lowest = UINT32_MAX;
+    uint32_t highest = 0;
+    uint32_t seed = 5;
+    for (int i = 0; i < 10000; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t delay = backoff.nextDelayMs(seed);
+        if (delay < lowest) lowest = delay;
+        if (delay > highest) highest = delay;
+    }
+    TEST_ASSERT_EQUAL_UINT32(800, lowest);
+    TEST_ASSERT_EQUAL_UINT32(1200, highest);
+}
+
+void test_locks_dropped_together_spread_out(void) {
+    // Two locks failing in step get different delays from different random values
+    Backoff first(1000, 60000, 25);
+    Backoff second(1000, 60000, 25);
+    TEST_ASSERT_NOT_EQUAL(first.nextDelayMs(12345), second.nextDelayMs(67890));
+}
+
+void test_many_failures_do_not_overflow(void) {
+    Backoff backoff(1000, UINT32_MAX, 0);
+    uint32_t previous = 0;
+    for (int i = 0; i < 300; i++) {
+        uint32_t delay = backoff.nextDelayMs(0);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(previous, delay);
+        previous = delay;
+    }
+    TEST_ASSERT_EQUAL(UINT8_MAX, backoff.attempts());
+}
+
+void test_constructor_clamps_its_arguments(void) {
+    Backoff backoff(5000, 1000, 150);
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(10000, backoff.nextDelayMs(UINT32_MAX));
+    }
+    Backoff fixed(5000, 1000, 0);
+    TEST_ASSERT_EQUAL_UINT32(5000, fixed.nextDelayMs(0));
+    TEST_ASSERT_EQUAL_UINT32(5000, fixed.nextDelayMs(0));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_delay_doubles_up_to_the_cap);
+    RUN_TEST(test_reset_makes_the_next_retry_fast);
+    RUN_TEST(test_jitter_stays_within_the_spread);
+    RUN_TEST(test_locks_dropped_together_spread_out);
+    RUN_TEST(test_many_failures_do_not_overflow);
+    RUN_TEST(test_constructor_clamps_its_arguments);
+    return UNITY_END();
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "alloc_counter.h"
+#include "command.h"
+#include "json_scanner.h"
+
+// Messages/sec and heap allocations per message for MQTT command ingestion.
+// "legacy" models the old mqttCallback(): the payload appended to a String
+// one character at a time, a String for the topic, a 256-byte
+// DynamicJsonDocument pool the fields are copied into, and the action
+// handed on as a String by value (std::string stands in for String).
+// "in place" is parseCommandPayload() as mqttCallback() now calls it.
+
+static const uint32_t ITERATIONS = 200000;
+static const char* TOPIC = "sesame/door/command";
+static const char* PAYLOAD = "{\"action\":\"unlock\",\"target\":\"door\",\"request_id\":\"ha-4711\"}";
+
+static size_t legacySink = 0;
+
+static void legacyDispatch(std::string action) {
+    legacySink += action.size();
+}
+
+static void legacyCallback(const char* topic, const uint8_t* payload, unsigned int length) {
+    std::string message;
+    for (unsigned int i = 0; i < length; i++) {
+        message += static_cast<char>(payload[i]);
+    }
+    std::string topicString(topic);
+    if (topicString != TOPIC) return;
+
+    char* pool = new char[256];
+    size_t used = 0;
+    std::string action;
+    JsonObjectScanner scanner(message.c_str(), message.size());
+    JsonField field;
+    while (scanner.next(field)) {
+        if (used + field.valueLength + 1 <= 256) {
+            memcpy(pool + used, field.value, field.valueLength);
+            pool[used + field.valueLength] = '\0';
+            if (field.keyEquals("action")) action = pool + used;
+            used += field.valueLength + 1;
+        }
+    }
+    legacyDispatch(action);
+    delete[] pool;
+}
+
+static void report(const char* name, std::chrono::steady_clock::duration elapsed, size_t allocated) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    char line[128];
+    snprintf(line, sizeof(line), "%s: %.0f messages/s, %.2f allocations/message",
+             name, ITERATIONS / seconds, static_cast<double>(allocated) / ITERATIONS);
+    TEST_MESSAGE(line);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bench_legacy_string_path(void) {
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(PAYLOAD);
+    unsigned int length = static_cast<unsigned int>(strlen(PAYLOAD));
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        legacyCallback(TOPIC, payload, length);
+    }
+    report("legacy", std::chrono::steady_clock::now() - start, allocations);
+    TEST_ASSERT_GREATER_THAN(0, legacySink);
+}
+
+void test_bench_in_place_path(void) {
+    size_t length = strlen(PAYLOAD);
+    SesameCommand command;
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        if (strcmp(TOPIC, "sesame/door/command") != 0 ||
+            parseCommandPayload(PAYLOAD, length, command) != CommandParseResult::ok) {
+            TEST_FAIL_MESSAGE("parse failed");
+        }
+    }
+    report("in place", std::chrono::steady_clock::now() - start, allocations);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_legacy_string_path);
+    RUN_TEST(test_bench_in_place_path);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <chrono>
+#include <stdio.h>
+#include <unity.h>
+#include "connection_scheduler.h"
+
+// Simulated controller with more locks than BLE sessions. Fake locks take
+// CONNECT_MS to connect and COMMAND_MS to run a command; commands arrive at
+// random locks. Reports how long commands wait for a session and how fast
+// the scheduler itself runs. Run with pio test -e bench -v.
+
+static const size_t LOCKS = 6;
+static const size_t MAX_SESSIONS = 3;
+static const uint32_t SLICE_MS = 60000;
+static const uint32_t CONNECT_MS = 1500;
+static const uint32_t COMMAND_MS = 300;
+static const uint32_t STEP_MS = 10;
+static const uint32_t SIMULATED_MS = 6 * 3600 * 1000UL;
+
+struct FakeLock {
+    bool authenticated;
+    uint32_t readyAtMs;      // connection attempt completes
+    bool commandWaiting;
+    uint32_t commandSinceMs;
+    uint32_t busyUntilMs;
+    uint32_t served;
+    uint32_t maxWaitMs;
+};
+
+static uint32_t seed = 7;
+
+static uint32_t nextRandom() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bench_fake_locks(void) {
+    ConnectionScheduler scheduler(MAX_SESSIONS, SLICE_MS);
+    LockSchedule schedule[LOCKS] = {};
+    FakeLock locks[LOCKS] = {};
+    uint64_t totalWaitMs = 0;
+    uint32_t served = 0;
+    uint32_t connects = 0;
+    uint32_t decisions = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t now = 0; now < SIMULATED_MS; now += STEP_MS) {
+        // A command every ~20 s on average, for a random lock
+        if (nextRandom() % 2000 == 0) {
+            size_t target = nextRandom() % LOCKS;
+            if (!locks[target].commandWaiting) {
+                locks[target].commandWaiting = true;
+                locks[target].commandSinceMs = now;
+            }
+        }
+
+        for (size_t i = 0; i < LOCKS; i++) {
+            FakeLock& lock = locks[i];
+            if (schedule[i].connected && !lock.authenticated && now >= lock.readyAtMs) {
+                lock.authenticated = true;
+                schedule[i].sessionStartedMs = now;
+                schedule[i].lastUsedMs = now;
+            }
+            if (lock.authenticated && lock.commandWaiting && now >= lock.busyUntilMs) {
+                uint32_t waited = now - lock.commandSinceMs;
+                totalWaitMs += waited;
+                served++;
+                lock.served++;
+                if (waited > lock.maxWaitMs) lock.maxWaitMs = waited;
+                lock.commandWaiting = false;
+                lock.busyUntilMs = now + COMMAND_MS;
+                schedule[i].lastUsedMs = now;
+            }
+            schedule[i].pendingWork = lock.commandWaiting || now < lock.busyUntilMs;
+        }
+
+        decisions++;
+        int release = scheduler.sessionToRelease(schedule, LOCKS, now);
+        if (release >= 0) {
+            schedule[release].connected = false;
+            locks[release].authenticated = false;
+        }
+        int connect = scheduler.nextToConnect(schedule, LOCKS, now);
+        if (connect >= 0) {
+            // As connectToSesame(): the slot and the slice are taken from the attempt on
+            schedule[connect].connected = true;
+            schedule[connect].sessionStartedMs = now;
+            locks[connect].readyAtMs = now + CONNECT_MS;
+            connects++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t worstMs = 0;
+    for (const FakeLock& lock : locks) {
+        if (lock.maxWaitMs > worstMs) worstMs = lock.maxWaitMs;
+        TEST_ASSERT_GREATER_THAN(0, lock.served);
+    }
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%u locks / %u sessions: %lu commands, mean wait %.0f ms, worst %lu ms, %lu connects, %.2f us/decision",
+             static_cast<unsigned>(LOCKS), static_cast<unsigned>(MAX_SESSIONS), static_cast<unsigned long>(served),
+             static_cast<double>(totalWaitMs) / served, static_cast<unsigned long>(worstMs),
+             static_cast<unsigned long>(connects), seconds * 1e6 / decisions);
+    TEST_MESSAGE(line);
+
+    // A waiting command frees an idle session at once: it never waits for a slice
+    TEST_ASSERT_LESS_THAN(SLICE_MS, worstMs);
+    // Sessions change hands for commands and slice rotation only, never mid-connect
+    TEST_ASSERT_LESS_THAN(served + SIMULATED_MS / SLICE_MS * MAX_SESSIONS, connects);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_fake_locks);
+    return UNITY_END();
+}
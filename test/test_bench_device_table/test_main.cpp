@@ -0,0 +1,138 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "alloc_counter.h"
+#include "device_table.h"
+
+// Advertisement floods through the scanner's device table: a building full
+// of devices, some rotating their private addresses, replayed as fast as
+// the host can take them. Run with pio test -e bench -v.
+
+static const uint32_t ADVERTS = 4000000;   // 2000 s of radio time
+static const uint32_t ADVERTS_PER_MS = 2;        // ~2000 adverts/s heard by the radio
+static const uint32_t ROTATE_EVERY_MS = 60000;   // private address rotation
+static const uint32_t MAX_AGE_MS = 30000;
+static_assert(MAX_AGE_MS <= ROTATE_EVERY_MS, "at most one stale address per rotating device");
+
+static const size_t MAX_DEVICES = 1024;
+
+static DeviceTable table;
+static uint64_t addresses[MAX_DEVICES];
+static uint32_t seed;
+
+// High bits only: the low bits of the LCG repeat with a short period
+static uint32_t nextRandom() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static uint64_t randomAddress() {
+    return ((static_cast<uint64_t>(nextRandom()) << 16) ^ nextRandom()) & 0xFFFFFFFFFFFFULL;
+}
+
+// Flags, a short name and manufacturer data: a typical 31-byte advert
+static size_t buildPayload(uint8_t* payload, uint32_t device) {
+    size_t n = 0;
+    payload[n++] = 0x02;
+    payload[n++] = 0x01;
+    payload[n++] = 0x06;
+    payload[n++] = 0x09;
+    payload[n++] = 0x09;
+    n += static_cast<size_t>(snprintf(reinterpret_cast<char*>(payload + n), 9, "dev%05u", static_cast<unsigned>(device % 100000)));
+    payload[n++] = 0x0F;
+    payload[n++] = 0xFF;
+    payload[n++] = static_cast<uint8_t>(device);
+    payload[n++] = static_cast<uint8_t>(device >> 8);
+    for (int i = 0; i < 12; i++) {
+        payload[n++] = static_cast<uint8_t>(nextRandom());
+    }
+    return n;
+}
+
+void setUp(void) {
+    table = DeviceTable();
+    seed = 1;
+}
+
+void tearDown(void) {}
+
+static void flood(size_t devices, uint32_t rotatingPct) {
+    static uint8_t payloads[MAX_DEVICES][31];
+    static size_t lengths[MAX_DEVICES];
+    for (size_t i = 0; i < devices; i++) {
+        addresses[i] = randomAddress();
+        lengths[i] = buildPayload(payloads[i], static_cast<uint32_t>(i));
+    }
+
+    uint32_t tableFull = 0;
+    uint32_t lost = 0;
+    uint32_t now = 0;
+    uint32_t lastAgingMs = 0;
+    uint32_t lastRotationMs = 0;
+    size_t peak = 0;
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ADVERTS; i++) {
+        now = i / ADVERTS_PER_MS;
+        if (now - lastRotationMs >= ROTATE_EVERY_MS) {
+            lastRotationMs = now;
+            for (size_t d = 0; d < devices * rotatingPct / 100; d++) {
+                addresses[d] = randomAddress();
+            }
+        }
+        size_t device = nextRandom() % devices;
+
+        bool created;
+        DeviceEntry* entry = table.insert(addresses[device], created);
+        if (entry == nullptr) {
+            tableFull++;
+        } else {
+            updateDevice(*entry, payloads[device], lengths[device], 0, static_cast<int8_t>(-40 - (nextRandom() % 50)), now);
+        }
+
+        if (now - lastAgingMs >= 1000) {
+            lastAgingMs = now;
+            lost += static_cast<uint32_t>(table.age(now, MAX_AGE_MS, [](DeviceEntry&) {}));
+        }
+        if (table.size() > peak) {
+            peak = table.size();
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ADVERTS;
+
+    char line[192];
+    snprintf(line, sizeof(line),
+             "%4zu devices, %2u%% rotating: %.0f ns/advert, %.1fM adverts/s, peak %zu in table, %u table full, %u aged out, %zu allocations",
+             devices, static_cast<unsigned>(rotatingPct), ns, 1e3 / ns, peak, static_cast<unsigned>(tableFull),
+             static_cast<unsigned>(lost), allocations);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL(0, allocations);
+    TEST_ASSERT_LESS_OR_EQUAL(DEVICE_TABLE_MAX_DEVICES, peak);
+    // Rotated-away addresses linger until they age out
+    if (devices * (100 + rotatingPct) / 100 <= DEVICE_TABLE_MAX_DEVICES) {
+        TEST_ASSERT_EQUAL_UINT32(0, tableFull);
+    }
+}
+
+void test_bench_flood_100_devices(void) {
+    flood(100, 0);
+}
+
+void test_bench_flood_200_devices_rotating(void) {
+    flood(200, 50);
+}
+
+void test_bench_flood_over_capacity(void) {
+    flood(MAX_DEVICES, 0);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_flood_100_devices);
+    RUN_TEST(test_bench_flood_200_devices_rotating);
+    RUN_TEST(test_bench_flood_over_capacity);
+    return UNITY_END();
+}
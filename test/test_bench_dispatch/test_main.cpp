@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "alloc_counter.h"
+#include "command.h"
+#include "command_queue.h"
+#include "config.h"
+#include "sim.h"
+
+// Ingress-to-dispatch on the host. The first case times the parse and queue
+// code on its own. The others boot the firmware in the simulator
+// (test/support/sim) and time, in simulated time, a trigger (a publish
+// reaching the broker, or the first edge of a remote press) to the BLE
+// write reaching the lock: the real network, rxb6 and sesame tasks, their
+// queues, polls and power saving, idle and under an MQTT flood plus RF
+// noise. Run with pio test -e bench -v.
+
+static const uint32_t ITERATIONS = 200000;
+
+static const uint32_t DOOR_REMOTE = 0x3A9C51;   // toggle, first lock (sim_config.h)
+static const uint32_t RF_PULSE_US = 350;
+static const uint32_t WRITE_TIMEOUT_MS = 5000;
+
+static sim::Lock* door = nullptr;
+static sim::Lock* gate = nullptr;
+static sim::RfBand band(RXB6_DATA_PIN);
+static std::string lastMetrics;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bench_parse_and_queue(void) {
+    static const char* payloads[] = {
+        "{\"action\":\"lock\",\"request_id\":\"bench-1\"}",
+        "{\"action\":\"unlock\",\"request_id\":\"bench-2\",\"relock_s\":30}",
+    };
+    CommandQueue queue(0, 5000, 30000);
+    SesameCommand command;
+    SesameCommand sent;
+    CommandResult result;
+    uint32_t dispatched = 0;
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        const char* payload = payloads[i & 1];
+        if (parseCommandPayload(payload, strlen(payload), command) != CommandParseResult::ok) {
+            TEST_FAIL_MESSAGE("parse failed");
+        }
+        queue.push(command, i);
+        if (queue.next(i, i, sent)) {
+            dispatched++;
+        }
+        queue.statusUpdate(sent.action == CommandAction::lock, sent.action == CommandAction::unlock, i, i);
+        while (queue.takeResult(result)) {}
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+
+    char line[128];
+    snprintf(line, sizeof(line), "parse+queue only: %.0f ns/command, %.0f commands/s, %zu allocations",
+             ns, 1e9 / ns, allocations);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, dispatched);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+// ---- Firmware tasks in the simulator
+
+struct Load {
+    bool mqttFlood;   // 20 status requests/s to the other lock
+    bool rfNoise;     // the receiver's AGC on an empty band, ~2900 edges/s
+};
+
+// Everything one scenario leaves behind
+struct Run {
+    std::vector<uint64_t> latencyUs;
+    uint32_t missed;
+    double wallUs;
+    uint64_t switches;
+};
+
+static uint64_t percentile(std::vector<uint64_t> values, int p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[(values.size() - 1) * p / 100];
+}
+
+static void report(const char* name, const Run& run) {
+    size_t n = run.latencyUs.size();
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%s: n=%zu p50=%.1f ms p95=%.1f ms max=%.1f ms missed=%u | %.0f us wall/command, %.0f switches/command",
+             name, n, percentile(run.latencyUs, 50) / 1000.0, percentile(run.latencyUs, 95) / 1000.0,
+             percentile(run.latencyUs, 100) / 1000.0, static_cast<unsigned>(run.missed),
+             n > 0 ? run.wallUs / n : 0.0, n > 0 ? static_cast<double>(run.switches) / n : 0.0);
+    TEST_MESSAGE(line);
+}
+
+static void bootOnce() {
+    static bool booted = false;
+    if (booted) return;
+    booted = true;
+
+    door = &sim::addLock("c0:5e:5a:00:00:01");
+    gate = &sim::addLock("c0:5e:5a:00:00:02");
+    sim::broker().subscribe(MQTT_TOPIC_METRICS, [](const sim::Message& message) { lastMetrics = message.payload; });
+    sim::boot();
+    // Sessions, the auto-test and its relock
+    sim::runFor(30000);
+}
+
+// Status requests to the gate every 50 ms until endUs
+static void floodUntil(uint64_t endUs, uint32_t seq) {
+    if (sim::nowUs() >= endUs) return;
+    char payload[64];
+    snprintf(payload, sizeof(payload), "{\"action\":\"status\",\"request_id\":\"load-%u\"}", static_cast<unsigned>(seq));
+    sim::broker().publish(MQTT_TOPIC_PREFIX "/gate/" MQTT_LOCK_TOPIC_COMMAND, payload);
+    sim::after(50000, [endUs, seq] { floodUntil(endUs, seq + 1); });
+}
+
+// count triggers spacingMs apart; trigger(i, startUs) fires one and returns
+// when it began, and the time to the next write on the door is recorded
+static Run measure(int count, uint32_t spacingMs, const Load& load,
+                   const std::function<uint64_t(int i, uint64_t slotUs, uint64_t slotEndUs)>& trigger) {
+    bootOnce();
+    Run run = {};
+    uint64_t startUs = sim::nowUs();
+    uint64_t endUs = startUs + static_cast<uint64_t>(count) * spacingMs * 1000;
+    if (load.mqttFlood) {
+        floodUntil(endUs, 0);
+    }
+
+    uint64_t switchesBefore = sim::kernelStats().contextSwitches;
+    auto wallStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        uint64_t slotUs = startUs + static_cast<uint64_t>(i) * spacingMs * 1000;
+        sim::runUntilUs(slotUs);
+        size_t writes = door->commands().size();
+        uint64_t triggerUs = trigger(i, slotUs, slotUs + spacingMs * 1000ull);
+        if (sim::runUntil([writes] { return door->commands().size() > writes; }, WRITE_TIMEOUT_MS)) {
+            run.latencyUs.push_back(door->commands()[writes].atUs - triggerUs);
+        } else {
+            run.missed++;
+        }
+    }
+    sim::runUntilUs(endUs);
+    run.wallUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wallStart).count();
+    run.switches = sim::kernelStats().contextSwitches - switchesBefore;
+    return run;
+}
+
+static uint64_t mqttTrigger(int i, uint64_t slotUs, uint64_t slotEndUs, bool noise) {
+    if (noise) {
+        band.noise(slotUs, slotEndUs - 5000, 100, 600, 0x5EED0000u + static_cast<uint32_t>(i));
+    }
+    char payload[96];
+    snprintf(payload, sizeof(payload), "{\"action\":\"%s\",\"request_id\":\"bench-%d\"}",
+             door->locked() ? "unlock" : "lock", i);
+    sim::broker().publish(MQTT_TOPIC_PREFIX "/door/" MQTT_LOCK_TOPIC_COMMAND, payload);
+    return sim::nowUs();
+}
+
+// The press goes out 200 ms into the slot; with noise the band is busy up
+// to a few ms before it and from the end of the press on
+static uint64_t rfTrigger(int i, uint64_t slotUs, uint64_t slotEndUs, bool noise) {
+    uint64_t pressUs = slotUs + 200000;
+    if (noise) {
+        band.noise(slotUs, pressUs - 5000, 100, 600, 0xA6C00000u + static_cast<uint32_t>(i));
+    }
+    uint64_t pressEndUs = band.press(pressUs, DOOR_REMOTE, 24, RF_PULSE_US);
+    if (noise) {
+        band.noise(pressEndUs + 5000, slotEndUs - 5000, 100, 600, 0xA6C10000u + static_cast<uint32_t>(i));
+    }
+    sim::runUntilUs(pressUs);
+    return pressUs;
+}
+
+// Commands 45 s apart: the power manager is back in its saving mode for each
+void test_bench_mqtt_to_write_idle(void) {
+    Run run = measure(40, 45000, Load{false, false}, [](int i, uint64_t slot, uint64_t end) {
+        return mqttTrigger(i, slot, end, false);
+    });
+    report("mqtt->write, idle", run);
+    TEST_ASSERT_EQUAL_UINT32(0, run.missed);
+}
+
+void test_bench_mqtt_to_write_busy(void) {
+    Run run = measure(100, 3000, Load{false, false}, [](int i, uint64_t slot, uint64_t end) {
+        return mqttTrigger(i, slot, end, false);
+    });
+    report("mqtt->write, 1 command/3 s", run);
+    TEST_ASSERT_EQUAL_UINT32(0, run.missed);
+}
+
+void test_bench_mqtt_to_write_loaded(void) {
+    Run run = measure(100, 3000, Load{true, true}, [](int i, uint64_t slot, uint64_t end) {
+        return mqttTrigger(i, slot, end, true);
+    });
+    report("mqtt->write, flood + RF noise", run);
+    TEST_ASSERT_EQUAL_UINT32(0, run.missed);
+}
+
+void test_bench_rf_to_write_idle(void) {
+    Run run = measure(40, 45000, Load{false, false}, [](int i, uint64_t slot, uint64_t end) {
+        return rfTrigger(i, slot, end, false);
+    });
+    report("rf press->write, idle", run);
+    TEST_ASSERT_EQUAL_UINT32(0, run.missed);
+}
+
+void test_bench_rf_to_write_loaded(void) {
+    Run run = measure(100, 3000, Load{true, true}, [](int i, uint64_t slot, uint64_t end) {
+        return rfTrigger(i, slot, end, true);
+    });
+    report("rf press->write, flood + RF noise", run);
+    TEST_ASSERT_EQUAL_UINT32(0, run.missed);
+
+    // The firmware's own view of the last window (sesame/metrics)
+    sim::runFor(METRICS_PUBLISH_INTERVAL_MS);
+    std::string line = "firmware histogram: " + lastMetrics;
+    TEST_MESSAGE(line.c_str());
+
+    sim::KernelStats kernel = sim::kernelStats();
+    char summary[160];
+    snprintf(summary, sizeof(summary), "simulated %.0f s: %llu context switches, %llu events, %u watchdog trips",
+             sim::nowUs() / 1e6, static_cast<unsigned long long>(kernel.contextSwitches),
+             static_cast<unsigned long long>(kernel.events), static_cast<unsigned>(kernel.watchdogTrips));
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_EQUAL_UINT32(0, kernel.watchdogTrips);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_parse_and_queue);
+    RUN_TEST(test_bench_mqtt_to_write_idle);
+    RUN_TEST(test_bench_mqtt_to_write_busy);
+    RUN_TEST(test_bench_mqtt_to_write_loaded);
+    RUN_TEST(test_bench_rf_to_write_idle);
+    RUN_TEST(test_bench_rf_to_write_loaded);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "alloc_counter.h"
+#include "config.h"
+#include "event_writer.h"
+#include "history_log.h"
+#include "outbound_buffer.h"
+
+// History write path (fetched records into the de-duplicating ring) and
+// replay path (batches out of the ring, encoded as publishHistory() does).
+// Run with pio test -e bench -v.
+
+static const uint32_t ROUNDS = 20000;
+static const uint8_t LOCKS = 3;
+
+static HistoryLog history;
+
+static HistoryEntry entry(uint8_t lock, uint32_t time) {
+    HistoryEntry e = {};
+    e.time = time;
+    e.lock = lock;
+    e.type = static_cast<uint8_t>(time % 4);
+    strncpy(e.tag, "bench-tag", sizeof(e.tag) - 1);
+    return e;
+}
+
+void setUp(void) { history = HistoryLog(); }
+void tearDown(void) {}
+
+// Every fetch re-reads the newest stored record as well as new ones, so
+// half the writes are duplicates caught by the scan
+void test_bench_write_path(void) {
+    uint32_t time = 1000;
+    uint32_t added = 0;
+    uint32_t writes = 0;
+    HistoryEntry batch[HISTORY_BATCH_SIZE];
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        uint8_t lock = static_cast<uint8_t>(round % LOCKS);
+        uint32_t newest = history.newestTime(lock);
+        if (newest != 0) {
+            added += history.add(entry(lock, newest)) ? 1 : 0;
+            writes++;
+        }
+        added += history.add(entry(lock, ++time)) ? 1 : 0;
+        writes++;
+        if (history.unpublished() >= HISTORY_BATCH_SIZE) {
+            history.takeUnpublished(batch, HISTORY_BATCH_SIZE);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / writes;
+
+    char line[128];
+    snprintf(line, sizeof(line), "write: %.0f ns/entry (%u of %u were duplicates), %zu allocations",
+             ns, static_cast<unsigned>(writes - added), static_cast<unsigned>(writes), allocations);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS, added);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+static size_t encodeBatch(PayloadFormat format, const HistoryEntry* batch, size_t count, uint8_t* payload) {
+    EventWriter event(format, payload, OUTBOUND_PAYLOAD_SIZE);
+    event.add(FieldId::lock, "lock-0");
+    event.beginArray(FieldId::entries);
+    for (size_t i = 0; i < count; i++) {
+        event.beginArrayObject();
+        event.add(FieldId::time, batch[i].time);
+        event.add(FieldId::type, batch[i].type);
+        event.add(FieldId::tag, batch[i].tag);
+        event.endObject();
+    }
+    event.endArray();
+    return event.finish() ? event.length() : 0;
+}
+
+static void replay(PayloadFormat format, const char* name) {
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+    HistoryEntry batch[HISTORY_BATCH_SIZE];
+    uint32_t time = 1000;
+    uint32_t entries = 0;
+    uint32_t messages = 0;
+    size_t bytes = 0;
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < ROUNDS / HISTORY_LOG_SLOTS; round++) {
+        // A full ring of unpublished entries, interleaved across locks
+        for (uint32_t i = 0; i < HISTORY_LOG_SLOTS; i++) {
+            history.add(entry(static_cast<uint8_t>(i % LOCKS), ++time));
+        }
+        size_t count;
+        while ((count = history.takeUnpublished(batch, HISTORY_BATCH_SIZE)) > 0) {
+            size_t length = encodeBatch(format, batch, count, payload);
+            if (length == 0) {
+                TEST_FAIL_MESSAGE("batch does not fit the payload buffer");
+            }
+            entries += count;
+            bytes += length;
+            messages++;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / entries;
+
+    char line[160];
+    snprintf(line, sizeof(line), "replay %s: %.0f ns/entry, %.1f entries/message, %.1f bytes/entry, %zu allocations",
+             name, ns, static_cast<double>(entries) / messages, static_cast<double>(bytes) / entries, allocations);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32((ROUNDS / HISTORY_LOG_SLOTS) * HISTORY_LOG_SLOTS, entries);
+    TEST_ASSERT_EQUAL(0, history.unpublished());
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+void test_bench_replay_json(void) {
+    replay(PayloadFormat::json, "json");
+}
+
+void test_bench_replay_cbor(void) {
+    replay(PayloadFormat::cbor, "cbor");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_write_path);
+    RUN_TEST(test_bench_replay_json);
+    RUN_TEST(test_bench_replay_cbor);
+    return UNITY_END();
+}
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "config.h"
+#include "lan_client.h"
+#include "lan_frame.h"
+#include "sim.h"
+
+// The LAN command API against MQTT for the same command. The first case
+// times the frame code on the host: signing a command the way a client
+// does and checking a frame the way the firmware does. The others boot
+// the firmware in the simulator (test/support/sim), open a session with
+// LanClient (test/support/lan_client.h, the same frame code) and send
+// commands to the door alternately over UDP and through the broker,
+// timing each from the send to the BLE write reaching the lock and to the
+// result reaching the sender. Run with pio test -e bench -v.
+
+static const uint32_t ITERATIONS = 100000;
+static const uint32_t RESULT_TIMEOUT_MS = 15000;
+static const char* COMMAND = "{\"action\":\"unlock\",\"request_id\":\"bench-lan-1\"}";
+
+static sim::Lock* door = nullptr;
+static sim::LanPeer* peer = nullptr;
+static LanClient client(LAN_API_KEY, 0x1A40000000000000ull);
+static uint64_t openedUs = 0;
+
+// The request_id waited for, the path it went out on, and when its ack and
+// result came back on that path (a LAN command's result is on MQTT too)
+static std::string pendingId;
+static bool pendingLan = false;
+static uint64_t ackUs = 0;
+static uint64_t resultUs = 0;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bench_frame_cost(void) {
+    uint8_t frame[LanClient::FRAME_MAX];
+    size_t length = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        length = lanBuildFrame(LAN_API_KEY, frame, LanFrameType::command, 0x5E55105E55105E55ull, i + 1,
+                               reinterpret_cast<const uint8_t*>(COMMAND), strlen(COMMAND));
+    }
+    double signNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                    ITERATIONS;
+
+    uint32_t authentic = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        frame[LAN_FRAME_HEADER_SIZE] ^= static_cast<uint8_t>(i & 1);   // every other one forged
+        authentic += lanFrameAuthentic(LAN_API_KEY, frame, length) ? 1 : 0;
+    }
+    double verifyNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                      ITERATIONS;
+
+    char line[160];
+    snprintf(line, sizeof(line), "%zu-byte command frame: sign %.0f ns, verify %.0f ns (HMAC-SHA256 on the host)",
+             length, signNs, verifyNs);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS / 2, authentic);
+}
+
+// ---- Firmware in the simulator
+
+static std::string field(const std::string& json, const char* key) {
+    std::string needle = std::string("\"") + key + "\":\"";
+    size_t at = json.find(needle);
+    if (at == std::string::npos) return std::string();
+    at += needle.size();
+    return json.substr(at, json.find('"', at) - at);
+}
+
+static void onDatagram(const uint8_t* data, size_t length) {
+    uint8_t reply[LanClient::FRAME_MAX];
+    size_t replyLength = client.receive(data, length, reply);
+    if (replyLength > 0) {
+        peer->send(LAN_API_PORT, reply, replyLength);
+        return;
+    }
+    if (client.open() && openedUs == 0) {
+        openedUs = sim::nowUs();
+    }
+    if (!pendingLan || pendingId.empty() || field(client.lastBody, "request_id") != pendingId) return;
+    if (client.lastType == LanFrameType::ack && ackUs == 0) {
+        ackUs = sim::nowUs();
+    } else if (client.lastType == LanFrameType::result && resultUs == 0) {
+        resultUs = sim::nowUs();
+    }
+}
+
+static void bootOnce() {
+    static bool booted = false;
+    if (booted) return;
+    booted = true;
+
+    door = &sim::addLock("c0:5e:5a:00:00:01");
+    sim::addLock("c0:5e:5a:00:00:02");
+    peer = new sim::LanPeer(20, 40210);
+    peer->onReceive = onDatagram;
+    // A subscriber on the LAN sees the result one hop after the broker
+    sim::broker().subscribe(MQTT_TOPIC_PREFIX "/+/" MQTT_LOCK_TOPIC_RESULT, [](const sim::Message& message) {
+        if (!pendingLan && !pendingId.empty() && field(message.payload, "request_id") == pendingId && resultUs == 0) {
+            const sim::NetworkTiming& timing = sim::networkTiming();
+            resultUs = sim::nowUs() + timing.brokerUs + timing.lanHopUs;
+        }
+    });
+    sim::boot();
+    // Sessions, the auto-test and its relock
+    sim::runFor(30000);
+}
+
+// Hello to welcome: two round trips, the second through the firmware's cookie check
+static uint64_t openSession() {
+    uint8_t frame[LanClient::FRAME_MAX];
+    openedUs = 0;
+    uint64_t startUs = sim::nowUs();
+    peer->send(LAN_API_PORT, frame, client.hello(frame));
+    if (!sim::runUntil([] { return client.open(); }, 5000)) {
+        return 0;
+    }
+    return openedUs - startUs;
+}
+
+struct Path {
+    std::vector<uint64_t> writeUs;
+    std::vector<uint64_t> ackUs;
+    std::vector<uint64_t> resultUs;
+    uint32_t missed;
+};
+
+static uint64_t percentile(std::vector<uint64_t> values, int p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[(values.size() - 1) * p / 100];
+}
+
+static void report(const char* name, const Path& path) {
+    // Results include the bolt's travel (Lock::moveMs); only the LAN has acks
+    char ack[40] = "";
+    if (!path.ackUs.empty()) {
+        snprintf(ack, sizeof(ack), " | ack p50=%.1f ms", percentile(path.ackUs, 50) / 1000.0);
+    }
+    char line[240];
+    snprintf(line, sizeof(line), "%s: n=%zu write p50=%.1f p95=%.1f ms | result p50=%.1f p95=%.1f ms%s | missed=%u",
+             name, path.resultUs.size(), percentile(path.writeUs, 50) / 1000.0, percentile(path.writeUs, 95) / 1000.0,
+             percentile(path.resultUs, 50) / 1000.0, percentile(path.resultUs, 95) / 1000.0, ack,
+             static_cast<unsigned>(path.missed));
+    TEST_MESSAGE(line);
+}
+
+// One command to the door over the LAN or the broker, recorded into path
+static void roundTrip(bool lan, int i, Path& path) {
+    char requestId[24];
+    snprintf(requestId, sizeof(requestId), "%s-%d", lan ? "lan" : "mqtt", i);
+    char payload[96];
+    snprintf(payload, sizeof(payload), "{\"action\":\"%s\",\"request_id\":\"%s\"}",
+             door->locked() ? "unlock" : "lock", requestId);
+
+    if (lan && !client.open() && openSession() == 0) {
+        path.missed++;
+        return;
+    }
+    pendingId = requestId;
+    pendingLan = lan;
+    ackUs = 0;
+    resultUs = 0;
+    size_t writes = door->commands().size();
+    uint64_t startUs = sim::nowUs();
+    if (lan) {
+        uint8_t frame[LanClient::FRAME_MAX];
+        peer->send(LAN_API_PORT, frame, client.command(payload, frame));
+    } else {
+        sim::broker().publish(MQTT_TOPIC_PREFIX "/door/" MQTT_LOCK_TOPIC_COMMAND, payload);
+    }
+
+    if (!sim::runUntil([] { return resultUs != 0; }, RESULT_TIMEOUT_MS) || door->commands().size() == writes) {
+        path.missed++;
+    } else {
+        path.writeUs.push_back(door->commands()[writes].atUs - startUs);
+        path.resultUs.push_back(resultUs - startUs);
+        if (ackUs != 0) {
+            path.ackUs.push_back(ackUs - startUs);
+        }
+    }
+    pendingId.clear();
+}
+
+// count pairs spacingMs apart, the LAN command first and the MQTT one
+// half a period later
+static void compare(const char* name, int count, uint32_t spacingMs) {
+    bootOnce();
+    Path lan = {};
+    Path mqtt = {};
+    uint64_t startUs = sim::nowUs();
+    for (int i = 0; i < count; i++) {
+        uint64_t slotUs = startUs + static_cast<uint64_t>(i) * spacingMs * 1000;
+        sim::runUntilUs(slotUs);
+        roundTrip(true, i, lan);
+        sim::runUntilUs(slotUs + spacingMs * 500ull);
+        roundTrip(false, i, mqtt);
+    }
+    sim::runUntilUs(startUs + static_cast<uint64_t>(count) * spacingMs * 1000);
+
+    std::string label = std::string("lan, ") + name;
+    report(label.c_str(), lan);
+    label = std::string("mqtt, ") + name;
+    report(label.c_str(), mqtt);
+    TEST_ASSERT_EQUAL_UINT32(0, lan.missed);
+    TEST_ASSERT_EQUAL_UINT32(0, mqtt.missed);
+    TEST_ASSERT_EQUAL_UINT32(0, client.rejected);
+}
+
+void test_bench_lan_handshake(void) {
+    bootOnce();
+    std::vector<uint64_t> handshakeUs;
+    for (int i = 0; i < 20; i++) {
+        uint64_t us = openSession();
+        TEST_ASSERT_TRUE(us > 0);
+        handshakeUs.push_back(us);
+        sim::runFor(10000);
+    }
+    char line[120];
+    snprintf(line, sizeof(line), "lan hello->welcome: n=%zu p50=%.1f ms p95=%.1f ms", handshakeUs.size(),
+             percentile(handshakeUs, 50) / 1000.0, percentile(handshakeUs, 95) / 1000.0);
+    TEST_MESSAGE(line);
+}
+
+// Commands 60 s apart: the power manager is back in its saving mode for each
+void test_bench_lan_vs_mqtt_idle(void) {
+    compare("idle", 30, 60000);
+}
+
+void test_bench_lan_vs_mqtt_busy(void) {
+    compare("1 command/2 s", 100, 4000);
+}
+
+// The point of the LAN path: it keeps working with the broker down
+void test_bench_lan_broker_down(void) {
+    bootOnce();
+    sim::broker().stop();
+    Path lan = {};
+    for (int i = 0; i < 20; i++) {
+        roundTrip(true, 1000 + i, lan);
+        sim::runFor(3000);
+    }
+    sim::broker().start();
+    report("lan, broker down", lan);
+    TEST_ASSERT_EQUAL_UINT32(0, lan.missed);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_frame_cost);
+    RUN_TEST(test_bench_lan_handshake);
+    RUN_TEST(test_bench_lan_vs_mqtt_idle);
+    RUN_TEST(test_bench_lan_vs_mqtt_busy);
+    RUN_TEST(test_bench_lan_broker_down);
+    return UNITY_END();
+}
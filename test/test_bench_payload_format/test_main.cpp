@@ -0,0 +1,120 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "alloc_counter.h"
+#include "command.h"
+#include "event_writer.h"
+
+// Bytes and CPU per message for each payload format: a lock status as
+// fillStatus() writes it, and a command as parseCommandPayload() reads it.
+// Run with pio test -e bench -v.
+
+static const uint32_t ITERATIONS = 200000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static size_t encodeStatus(PayloadFormat format, uint8_t* buffer, size_t size, uint32_t i) {
+    EventWriter event(format, buffer, size);
+    event.add(FieldId::lock, "front-door");
+    if (format == PayloadFormat::json) {
+        event.add(FieldId::device, "Front door");
+        event.add(FieldId::address, "aa:bb:cc:dd:ee:ff");
+    }
+    event.add(FieldId::wifiConnected, true);
+    event.add(FieldId::mqttConnected, true);
+    event.add(FieldId::sesameConnected, (i & 1) != 0);
+    event.add(FieldId::sesameAuthenticated, (i & 1) != 0);
+    event.add(FieldId::batteryPct, static_cast<uint8_t>(80 + (i % 20)));
+    event.add(FieldId::voltage, 5.9 + (i % 5) * 0.1);
+    event.add(FieldId::position, static_cast<int16_t>(-100 + static_cast<int16_t>(i % 200)));
+    event.add(FieldId::locked, (i & 2) != 0);
+    event.add(FieldId::unlocked, (i & 2) == 0);
+    event.add(FieldId::rssi, static_cast<int8_t>(-60 - static_cast<int8_t>(i % 20)));
+    event.add(FieldId::advertAgeMs, i % 10000);
+    event.add(FieldId::predicted, (i & 2) != 0 ? "locked" : "unlocked");
+    return event.finish() ? event.length() : 0;
+}
+
+static void benchEncode(PayloadFormat format, const char* name) {
+    uint8_t buffer[512];
+    size_t bytes = 0;
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        size_t length = encodeStatus(format, buffer, sizeof(buffer), i);
+        if (length == 0) {
+            TEST_FAIL_MESSAGE("status does not fit");
+        }
+        bytes += length;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+
+    char line[128];
+    snprintf(line, sizeof(line), "status encode %s: %.1f bytes/message, %.0f ns/message, %zu allocations",
+             name, static_cast<double>(bytes) / ITERATIONS, ns, allocations);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+static void benchDecode(const uint8_t* payload, size_t length, const char* name) {
+    SesameCommand command;
+    uint32_t parsed = 0;
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        if (parseCommandPayload(reinterpret_cast<const char*>(payload), length, command) == CommandParseResult::ok) {
+            parsed++;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+
+    char line[128];
+    snprintf(line, sizeof(line), "command decode %s: %zu bytes/message, %.0f ns/message, %zu allocations",
+             name, length, ns, allocations);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, parsed);
+    TEST_ASSERT_EQUAL(CommandAction::unlock, command.action);
+    TEST_ASSERT_EQUAL_STRING("front-door", command.target);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+void test_bench_encode_json(void) {
+    benchEncode(PayloadFormat::json, "json");
+}
+
+void test_bench_encode_cbor(void) {
+    benchEncode(PayloadFormat::cbor, "cbor");
+}
+
+void test_bench_decode_json(void) {
+    static const char payload[] =
+        "{\"action\":\"unlock\",\"target\":\"front-door\",\"request_id\":\"a1b2c3\",\"relock_s\":30}";
+    benchDecode(reinterpret_cast<const uint8_t*>(payload), sizeof(payload) - 1, "json");
+}
+
+void test_bench_decode_cbor(void) {
+    // The same command with FieldId keys and the action as its number
+    static const uint8_t payload[] = {
+        0xA4,
+        0x12, 0x02,
+        0x18, 0x2A, 0x6A, 'f', 'r', 'o', 'n', 't', '-', 'd', 'o', 'o', 'r',
+        0x0F, 0x66, 'a', '1', 'b', '2', 'c', '3',
+        0x18, 0x3F, 0x18, 0x1E,
+    };
+    benchDecode(payload, sizeof(payload), "cbor");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_encode_json);
+    RUN_TEST(test_bench_encode_cbor);
+    RUN_TEST(test_bench_decode_json);
+    RUN_TEST(test_bench_decode_cbor);
+    return UNITY_END();
+}
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <stdio.h>
+#include <unity.h>
+#include "rf_decoder.h"
+
+// Decoder throughput (edges/s) and false positives: codes confirmed from
+// random edge noise, per million edges, at the default tolerance and
+// repeat settings. Run with pio test -e bench -v.
+
+static const uint32_t MIN_PULSE_US = 100;
+static const uint8_t TOLERANCE_PCT = 35;
+static const uint8_t REPEAT_FRAMES = 2;
+
+static uint32_t seed = 1;
+
+static uint32_t nextRandom() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+void setUp(void) { seed = 1; }
+void tearDown(void) {}
+
+void test_bench_valid_presses(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, REPEAT_FRAMES);
+    RfCode code;
+    uint32_t now = 0;
+    uint32_t confirmed = 0;
+    const uint32_t presses = 20000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t press = 0; press < presses; press++) {
+        uint32_t value = nextRandom() & 0xFFFFFF;
+        decoder.feedEdge(now += 31 * 350, code);
+        for (int frame = 0; frame < 4; frame++) {
+            for (int bit = 23; bit >= 0; bit--) {
+                bool one = (value >> bit) & 1;
+                decoder.feedEdge(now += (one ? 3 : 1) * 350 + nextRandom() % 80 - 40, code);
+                decoder.feedEdge(now += (one ? 1 : 3) * 350 + nextRandom() % 80 - 40, code);
+            }
+            decoder.feedEdge(now += 350, code);
+            if (decoder.feedEdge(now += 31 * 350, code)) {
+                confirmed++;
+            }
+        }
+        now += RF_REPEAT_WINDOW_US * 2;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char line[128];
+    snprintf(line, sizeof(line), "valid: %.1f M edges/s, %lu/%lu presses decoded",
+             decoder.stats().edges / seconds / 1e6, static_cast<unsigned long>(confirmed),
+             static_cast<unsigned long>(presses));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(presses, confirmed);
+}
+
+void test_bench_noise_false_positives(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, REPEAT_FRAMES);
+    RfCode code;
+    uint32_t now = 0;
+    uint32_t falseCodes = 0;
+    const uint32_t edges = 20000000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < edges; i++) {
+        uint32_t r = nextRandom();
+        // Receiver noise: mostly short random pulses, the occasional long gap
+        uint32_t duration = (r & 0xFF) < 4 ? RF_SYNC_GAP_MIN_US + (r >> 8) % 20000 : 40 + (r >> 8) % 1500;
+        if (decoder.feedEdge(now += duration, code)) {
+            falseCodes++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char line[160];
+    snprintf(line, sizeof(line), "noise: %.1f M edges/s, %lu frames / %lu codes from %lu edges (%.3f codes per million)",
+             edges / seconds / 1e6, static_cast<unsigned long>(decoder.stats().frames),
+             static_cast<unsigned long>(falseCodes), static_cast<unsigned long>(edges),
+             falseCodes * 1e6 / edges);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, falseCodes);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_valid_presses);
+    RUN_TEST(test_bench_noise_false_positives);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+#include <chrono>
+#include <initializer_list>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "alloc_counter.h"
+#include "sesame_advert.h"
+
+// The advert decoder under a crowded 2.4 GHz band: a stream of mixed
+// advertisements (phones, beacons, trackers, a few locks, broken and
+// random payloads) decoded as fast as the host can take them. With
+// passive monitoring every advert the scanner hears from a lock address
+// goes through decodeSesameAdvert(). Run with pio test -e bench -v.
+
+static const uint32_t ADVERTS = 20000000;
+static const size_t CORPUS = 1024;
+static const size_t MAX_PAYLOAD = 31;
+
+enum class Kind : uint8_t {
+    sesameRegistered,
+    sesameUnregistered,
+    appleContinuity,
+    microsoftSwiftPair,
+    iBeacon,
+    eddystone,
+    named,
+    truncated,
+    zeroPadded,
+    random,
+    count
+};
+
+// Share of each kind in the stream, in percent
+static const uint8_t MIX[] = {5, 1, 30, 10, 10, 10, 20, 5, 4, 5};
+static_assert(sizeof(MIX) == static_cast<size_t>(Kind::count), "MIX must list every Kind");
+
+static uint8_t payloads[CORPUS][MAX_PAYLOAD];
+static size_t lengths[CORPUS];
+static Kind kinds[CORPUS];
+static uint32_t seed;
+
+// High bits only: the low bits of the LCG repeat with a short period
+static uint32_t nextRandom() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static Kind pickKind() {
+    uint32_t roll = nextRandom() % 100;
+    for (size_t k = 0; k < sizeof(MIX); k++) {
+        if (roll < MIX[k]) {
+            return static_cast<Kind>(k);
+        }
+        roll -= MIX[k];
+    }
+    return Kind::random;
+}
+
+static size_t put(uint8_t* out, size_t n, std::initializer_list<uint8_t> bytes) {
+    for (uint8_t b : bytes) {
+        out[n++] = b;
+    }
+    return n;
+}
+
+static size_t putRandom(uint8_t* out, size_t n, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[n++] = static_cast<uint8_t>(nextRandom());
+    }
+    return n;
+}
+
+static size_t buildPayload(uint8_t* out, Kind kind) {
+    size_t n = put(out, 0, {0x02, 0x01, 0x06});
+    switch (kind) {
+        case Kind::sesameRegistered:
+        case Kind::sesameUnregistered:
+            n = put(out, n, {0x03, 0x02, 0x56, 0xFD, 0x0E, 0xFF, 0x5A, 0x05,
+                             static_cast<uint8_t>(4 + nextRandom() % 3), 0x00,
+                             static_cast<uint8_t>(kind == Kind::sesameRegistered ? 0x01 : 0x00)});
+            return putRandom(out, n, 8);
+        case Kind::appleContinuity:
+            n = put(out, n, {0x0B, 0xFF, 0x4C, 0x00, 0x10, 0x06});
+            return putRandom(out, n, 6);
+        case Kind::microsoftSwiftPair:
+            n = put(out, n, {0x18, 0xFF, 0x06, 0x00, 0x03, 0x00, 0x80});
+            return putRandom(out, n, 18);
+        case Kind::iBeacon:
+            n = put(out, n, {0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15});
+            return putRandom(out, n, 21);
+        case Kind::eddystone:
+            n = put(out, n, {0x03, 0x03, 0xAA, 0xFE, 0x11, 0x16, 0xAA, 0xFE, 0x10, 0xEB});
+            return putRandom(out, n, 12);
+        case Kind::named: {
+            n = put(out, n, {0x0B, 0x09});
+            memcpy(out + n, "tracker-42", 10);
+            n += 10;
+            // Manufacturer data that starts like CANDY HOUSE but is too short
+            return put(out, n, {0x04, 0xFF, 0x5A, 0x05, 0x05});
+        }
+        case Kind::truncated:
+            // Length byte runs past the end of the payload
+            n = put(out, n, {0x1E, 0xFF, 0x5A, 0x05, 0x05, 0x00, 0x01});
+            return n;
+        case Kind::zeroPadded:
+            n = put(out, n, {0x03, 0x02, 0x0F, 0x18, 0x00, 0x00});
+            return putRandom(out, n, 10);
+        default:
+            return putRandom(out, 0, 1 + nextRandom() % MAX_PAYLOAD);
+    }
+}
+
+void setUp(void) {
+    seed = 2024;
+    allocations = 0;
+}
+
+void tearDown(void) {}
+
+void test_bench_mixed_flood(void) {
+    for (size_t i = 0; i < CORPUS; i++) {
+        kinds[i] = pickKind();
+        lengths[i] = buildPayload(payloads[i], kinds[i]);
+    }
+
+    uint32_t perKind[static_cast<size_t>(Kind::count)] = {};
+    uint32_t decoded[static_cast<size_t>(Kind::count)] = {};
+    uint32_t registered = 0;
+    uint32_t badModel = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ADVERTS; i++) {
+        size_t slot = nextRandom() % CORPUS;
+        size_t kind = static_cast<size_t>(kinds[slot]);
+        perKind[kind]++;
+
+        SesameAdvert advert;
+        if (decodeSesameAdvert(payloads[slot], lengths[slot], advert)) {
+            decoded[kind]++;
+            registered += advert.registered ? 1 : 0;
+            badModel += advert.model < 4 || advert.model > 6 ? 1 : 0;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ADVERTS;
+
+    size_t sesameRegistered = static_cast<size_t>(Kind::sesameRegistered);
+    size_t sesameUnregistered = static_cast<size_t>(Kind::sesameUnregistered);
+    uint32_t sesame = perKind[sesameRegistered] + perKind[sesameUnregistered];
+    uint32_t falsePositives = 0;
+    for (size_t k = 0; k < static_cast<size_t>(Kind::count); k++) {
+        if (k != sesameRegistered && k != sesameUnregistered && k != static_cast<size_t>(Kind::random)) {
+            falsePositives += decoded[k];
+        }
+    }
+
+    char line[192];
+    snprintf(line, sizeof(line),
+             "%u adverts (%u from locks): %.1f ns/advert, %.1fM adverts/s, %u false positives, %u from random bytes, %zu allocations",
+             static_cast<unsigned>(ADVERTS), static_cast<unsigned>(sesame), ns, 1e3 / ns,
+             static_cast<unsigned>(falsePositives), static_cast<unsigned>(decoded[static_cast<size_t>(Kind::random)]),
+             allocations);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_UINT32(perKind[sesameRegistered], decoded[sesameRegistered]);
+    TEST_ASSERT_EQUAL_UINT32(perKind[sesameUnregistered], decoded[sesameUnregistered]);
+    TEST_ASSERT_EQUAL_UINT32(perKind[sesameRegistered], registered);
+    TEST_ASSERT_EQUAL_UINT32(0, badModel);
+    TEST_ASSERT_EQUAL_UINT32(0, falsePositives);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+// Worst case for the AD walk: 12 one-byte fields before the lock's data
+void test_bench_longest_walk(void) {
+    uint8_t payload[MAX_PAYLOAD];
+    size_t n = 0;
+    for (int i = 0; i < 12; i++) {
+        n = put(payload, n, {0x01, 0x19});
+    }
+    n = put(payload, n, {0x06, 0xFF, 0x5A, 0x05, 0x05, 0x00, 0x01});
+    TEST_ASSERT_EQUAL(MAX_PAYLOAD, n);
+
+    uint32_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ADVERTS; i++) {
+        // Defeat hoisting the call out of the loop
+        payload[n - 1] = static_cast<uint8_t>(i & 1);
+        SesameAdvert advert;
+        if (decodeSesameAdvert(payload, n, advert) && advert.registered == ((i & 1) != 0)) {
+            hits++;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ADVERTS;
+
+    char line[128];
+    snprintf(line, sizeof(line), "13 AD fields, lock data last: %.1f ns/advert, %.1fM adverts/s", ns, 1e3 / ns);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(ADVERTS, hits);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_mixed_flood);
+    RUN_TEST(test_bench_longest_walk);
+    return UNITY_END();
+}
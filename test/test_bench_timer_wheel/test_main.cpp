@@ -0,0 +1,136 @@
+#include <chrono>
+#include <stdio.h>
+#include <unity.h>
+#include "alloc_counter.h"
+#include "timer_wheel.h"
+
+// Timer wheel cost and accuracy on the host: schedule/cancel/fire with a
+// busy pool, and how late timers fire when the caller sleeps for
+// msUntilNext() like the sesame task does. Run with pio test -e bench -v.
+
+static const uint32_t ITERATIONS = 1000000;
+
+static TimerWheel wheel;
+static uint32_t seed;
+
+static uint32_t nextRandom() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static TimerEntry timer(uint32_t dueMs) {
+    TimerEntry entry = {};
+    entry.kind = TimerKind::command;
+    entry.dueMs = dueMs;
+    return entry;
+}
+
+void setUp(void) {
+    wheel = TimerWheel();
+    seed = 1;
+}
+
+void tearDown(void) {}
+
+// Pool kept three quarters full; every step schedules, cancels or fires
+void test_bench_operations(void) {
+    uint16_t handles[TIMER_WHEEL_CAPACITY] = {};
+    uint32_t now = 0;
+    uint32_t fired = 0;
+    TimerEntry out;
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        now += nextRandom() % 50;
+        size_t slot = nextRandom() % TIMER_WHEEL_CAPACITY;
+        if (wheel.size() < TIMER_WHEEL_CAPACITY * 3 / 4) {
+            handles[slot] = wheel.schedule(timer(now + nextRandom() % 30000), now);
+        } else {
+            wheel.cancel(handles[slot]);
+        }
+        while (wheel.takeDue(now, out)) {
+            fired++;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+
+    char line[128];
+    snprintf(line, sizeof(line), "wheel: %.0f ns/step (schedule or cancel + poll), %u fired, %zu allocations",
+             ns, static_cast<unsigned>(fired), allocations);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL(0, allocations);
+}
+
+// Idle polls, as every loop pass makes them
+void test_bench_idle_poll(void) {
+    for (size_t i = 0; i < TIMER_WHEEL_CAPACITY / 2; i++) {
+        wheel.schedule(timer(3600000 + static_cast<uint32_t>(i)), 0);
+    }
+    TimerEntry out;
+    uint32_t fired = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        fired += wheel.takeDue(i, out) ? 1 : 0;
+        fired += wheel.msUntilNext(i) == 0 ? 1 : 0;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+
+    char line[128];
+    snprintf(line, sizeof(line), "idle poll: %.0f ns (takeDue + msUntilNext, %u timers pending)", ns,
+             static_cast<unsigned>(TIMER_WHEEL_CAPACITY / 2));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, fired);
+}
+
+// Sleep until msUntilNext() (capped like MAX_TIMER_WAIT_MS), plus up to
+// 20 ms of scheduling jitter, then fire: lateness comes only from the jitter
+void test_bench_accuracy(void) {
+    const uint32_t maxWaitMs = 1000;
+    const uint32_t timers = 100000;
+    uint32_t now = 0;
+    uint32_t scheduled = 0;
+    uint32_t fired = 0;
+    uint32_t early = 0;
+    uint32_t maxLateMs = 0;
+    uint64_t totalLateMs = 0;
+    TimerEntry out;
+
+    while (fired < timers) {
+        while (scheduled < timers && wheel.size() < TIMER_WHEEL_CAPACITY) {
+            wheel.schedule(timer(now + 1 + nextRandom() % 120000), now);
+            scheduled++;
+        }
+        uint32_t wait = wheel.msUntilNext(now);
+        now += (wait < maxWaitMs ? wait : maxWaitMs) + nextRandom() % 21;
+        while (wheel.takeDue(now, out)) {
+            uint32_t late = now - out.dueMs;
+            if (static_cast<int32_t>(late) < 0) {
+                early++;
+            } else {
+                totalLateMs += late;
+                maxLateMs = late > maxLateMs ? late : maxLateMs;
+            }
+            fired++;
+        }
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "accuracy: %u timers, mean %.1f ms late, max %u ms late, %u early",
+             static_cast<unsigned>(fired), static_cast<double>(totalLateMs) / fired, static_cast<unsigned>(maxLateMs),
+             static_cast<unsigned>(early));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, early);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(20, maxLateMs);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_operations);
+    RUN_TEST(test_bench_idle_poll);
+    RUN_TEST(test_bench_accuracy);
+    return UNITY_END();
+}
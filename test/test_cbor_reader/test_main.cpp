@@ -0,0 +1,172 @@
+#include <string.h>
+#include <unity.h>
+#include "cbor_reader.h"
+#include "command.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_definite_map_with_text_and_id_keys(void) {
+    static const uint8_t payload[] = {
+        0xA3,
+        0x66, 'a', 'c', 't', 'i', 'o', 'n', 0x64, 'l', 'o', 'c', 'k',   // "action": "lock"
+        0x0F, 0x62, 'r', '1',                                          // request_id (15): "r1"
+        0x18, 0x3E, 0x19, 0x01, 0x2C,                                  // delay_s (62): 300
+    };
+    CborMapScanner scanner(payload, sizeof(payload));
+    CborField field;
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(field.keyIsId);
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::action));
+    TEST_ASSERT_EQUAL(CborValueType::text, field.type);
+    TEST_ASSERT_EQUAL(4, field.valueLength);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyIsId);
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::requestId));
+    TEST_ASSERT_FALSE(field.keyEquals(FieldId::action));
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::delayS));
+    TEST_ASSERT_EQUAL(CborValueType::unsignedInt, field.type);
+    TEST_ASSERT_EQUAL_UINT32(300, field.number);
+
+    TEST_ASSERT_FALSE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.failed());
+}
+
+void test_nested_values_are_skipped(void) {
+    static const uint8_t payload[] = {
+        0xBF,
+        0x61, 'a', 0x82, 0x01, 0xA1, 0x01, 0x9F, 0x02, 0xFF,   // "a": [1, {1: [_ 2]}]
+        0x61, 'b', 0xC1, 0x1A, 0x00, 0x00, 0x00, 0x01,         // "b": 1(1) tagged
+        0x61, 'c', 0x43, 0x01, 0x02, 0x03,                     // "c": h'010203'
+        0x61, 'd', 0x07,
+        0xFF,
+    };
+    CborMapScanner scanner(payload, sizeof(payload));
+    CborField field;
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_EQUAL(CborValueType::array, field.type);
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_EQUAL(1, field.keyLength);
+    TEST_ASSERT_EQUAL('b', field.key[0]);
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_EQUAL(CborValueType::bytes, field.type);
+    TEST_ASSERT_EQUAL(3, field.valueLength);
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_EQUAL_UINT32(7, field.number);
+    TEST_ASSERT_FALSE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.failed());
+}
+
+void test_malformed_input_fails(void) {
+    static const uint8_t notMap[] = {0x82, 0x01, 0x02};
+    static const uint8_t truncatedText[] = {0xA1, 0x01, 0x65, 'a', 'b'};
+    static const uint8_t missingBreak[] = {0xBF, 0x01, 0x02};
+    static const uint8_t badKey[] = {0xA1, 0x41, 'x', 0x01};
+    static const uint8_t tooDeep[] = {0xA1, 0x01, 0x81, 0x81, 0x81, 0x81, 0x81, 0x01};
+    const struct {
+        const uint8_t* data;
+        size_t length;
+    } cases[] = {
+        {notMap, sizeof(notMap)},
+        {truncatedText, sizeof(truncatedText)},
+        {missingBreak, sizeof(missingBreak)},
+        {badKey, sizeof(badKey)},
+        {tooDeep, sizeof(tooDeep)},
+    };
+
+    for (const auto& c : cases) {
+        CborMapScanner scanner(c.data, c.length);
+        CborField field;
+        while (scanner.next(field)) {}
+        TEST_ASSERT_TRUE(scanner.failed());
+    }
+}
+
+void test_copy_text_checks_type_and_size(void) {
+    static const uint8_t payload[] = {0xA2, 0x01, 0x64, 'd', 'o', 'o', 'r', 0x02, 0x05};
+    CborMapScanner scanner(payload, sizeof(payload));
+    CborField field;
+    char text[5];
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(field.copyText(text, 4));
+    TEST_ASSERT_TRUE(field.copyText(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("door", text);
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(field.copyText(text, sizeof(text)));
+}
+
+void test_cbor_command_with_field_ids(void) {
+    static const uint8_t payload[] = {
+        0xA4,
+        0x12, 0x02,                                   // action (18): unlock as CommandAction
+        0x18, 0x2A, 0x64, 'd', 'o', 'o', 'r',         // target (42): "door"
+        0x0F, 0x63, 'r', '-', '1',                    // request_id (15): "r-1"
+        0x18, 0x3F, 0x00,                             // relock_s (63): 0 - never
+    };
+    SesameCommand command;
+    TEST_ASSERT_EQUAL(CommandParseResult::ok,
+                      parseCommandPayload(reinterpret_cast<const char*>(payload), sizeof(payload), command));
+    TEST_ASSERT_EQUAL(CommandAction::unlock, command.action);
+    TEST_ASSERT_EQUAL_STRING("door", command.target);
+    TEST_ASSERT_EQUAL_STRING("r-1", command.requestId);
+    TEST_ASSERT_EQUAL_UINT32(COMMAND_RELOCK_NEVER, command.relockS);
+}
+
+void test_cbor_command_with_text_keys(void) {
+    static const uint8_t payload[] = {
+        0xBF,
+        0x66, 'a', 'c', 't', 'i', 'o', 'n', 0x66, 't', 'o', 'g', 'g', 'l', 'e',
+        0x67, 'd', 'e', 'l', 'a', 'y', '_', 's', 0x18, 0x3C,
+        0xFF,
+    };
+    SesameCommand command;
+    TEST_ASSERT_EQUAL(CommandParseResult::ok,
+                      parseCommandPayload(reinterpret_cast<const char*>(payload), sizeof(payload), command));
+    TEST_ASSERT_EQUAL(CommandAction::toggle, command.action);
+    TEST_ASSERT_EQUAL_UINT32(60, command.delayS);
+    TEST_ASSERT_EQUAL_STRING("", command.target);
+}
+
+void test_cbor_command_errors(void) {
+    static const uint8_t noAction[] = {0xA1, 0x0F, 0x61, 'x'};
+    static const uint8_t unknownAction[] = {0xA1, 0x12, 0x63, 'o', 'p', 'e'};
+    static const uint8_t actionOutOfRange[] = {0xA1, 0x12, 0x09};
+    static const uint8_t longTarget[] = {
+        0xA2, 0x12, 0x01, 0x18, 0x2A, 0x70,
+        'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
+    };
+    static const uint8_t delayTooLong[] = {0xA2, 0x12, 0x01, 0x18, 0x3E, 0x1A, 0x00, 0x10, 0x00, 0x00};
+    static const uint8_t truncated[] = {0xA2, 0x12, 0x01, 0x0F};
+    SesameCommand command;
+
+    TEST_ASSERT_EQUAL(CommandParseResult::missingAction,
+                      parseCommandPayload(reinterpret_cast<const char*>(noAction), sizeof(noAction), command));
+    TEST_ASSERT_EQUAL(CommandParseResult::unknownAction,
+                      parseCommandPayload(reinterpret_cast<const char*>(unknownAction), sizeof(unknownAction), command));
+    TEST_ASSERT_EQUAL(CommandParseResult::malformed,
+                      parseCommandPayload(reinterpret_cast<const char*>(actionOutOfRange), sizeof(actionOutOfRange), command));
+    TEST_ASSERT_EQUAL(CommandParseResult::fieldTooLong,
+                      parseCommandPayload(reinterpret_cast<const char*>(longTarget), sizeof(longTarget), command));
+    TEST_ASSERT_EQUAL(CommandParseResult::invalidValue,
+                      parseCommandPayload(reinterpret_cast<const char*>(delayTooLong), sizeof(delayTooLong), command));
+    TEST_ASSERT_EQUAL(CommandParseResult::malformed,
+                      parseCommandPayload(reinterpret_cast<const char*>(truncated), sizeof(truncated), command));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_definite_map_with_text_and_id_keys);
+    RUN_TEST(test_nested_values_are_skipped);
+    RUN_TEST(test_malformed_input_fails);
+    RUN_TEST(test_copy_text_checks_type_and_size);
+    RUN_TEST(test_cbor_command_with_field_ids);
+    RUN_TEST(test_cbor_command_with_text_keys);
+    RUN_TEST(test_cbor_command_errors);
+    return UNITY_END();
+}
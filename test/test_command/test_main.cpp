@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "command.h"
+
+static SesameCommand command;
+
+static CommandParseResult parse(const char* payload) {
+    return parseCommandPayload(payload, strlen(payload), command);
+}
+
+void setUp(void) {
+    // Stale values from the previous test must be overwritten, not kept
+    memset(&command, 0x5A, sizeof(command));
+}
+
+void tearDown(void) {}
+
+void test_all_fields(void) {
+    TEST_ASSERT_EQUAL(CommandParseResult::ok,
+                      parse("{\"action\":\"unlock\",\"target\":\"garage\",\"request_id\":\"abc-1\","
+                            "\"delay_s\":15,\"relock_s\":60}"));
+    TEST_ASSERT_EQUAL(CommandAction::unlock, command.action);
+    TEST_ASSERT_EQUAL_STRING("garage", command.target);
+    TEST_ASSERT_EQUAL_STRING("abc-1", command.requestId);
+    TEST_ASSERT_EQUAL_UINT32(15, command.delayS);
+    TEST_ASSERT_EQUAL_UINT32(60, command.relockS);
+}
+
+void test_optional_fields_default_to_empty(void) {
+    TEST_ASSERT_EQUAL(CommandParseResult::ok, parse("{\"action\":\"status\"}"));
+    TEST_ASSERT_EQUAL(CommandAction::status, command.action);
+    TEST_ASSERT_EQUAL_STRING("", command.target);
+    TEST_ASSERT_EQUAL_STRING("", command.requestId);
+    TEST_ASSERT_EQUAL_UINT32(0, command.delayS);
+    TEST_ASSERT_EQUAL_UINT32(0, command.relockS);
+}
+
+void test_relock_zero_means_never(void) {
+    TEST_ASSERT_EQUAL(CommandParseResult::ok, parse("{\"action\":\"unlock\",\"relock_s\":0}"));
+    TEST_ASSERT_EQUAL_UINT32(COMMAND_RELOCK_NEVER, command.relockS);
+}
+
+void test_delay_limits(void) {
+    char payload[64];
+    snprintf(payload, sizeof(payload), "{\"action\":\"lock\",\"delay_s\":%lu}",
+             static_cast<unsigned long>(COMMAND_MAX_DELAY_S));
+    TEST_ASSERT_EQUAL(CommandParseResult::ok, parse(payload));
+
+    snprintf(payload, sizeof(payload), "{\"action\":\"lock\",\"delay_s\":%lu}",
+             static_cast<unsigned long>(COMMAND_MAX_DELAY_S) + 1);
+    TEST_ASSERT_EQUAL(CommandParseResult::invalidValue, parse(payload));
+    TEST_ASSERT_EQUAL(CommandParseResult::invalidValue, parse("{\"action\":\"lock\",\"relock_s\":-5}"));
+    TEST_ASSERT_EQUAL(CommandParseResult::invalidValue, parse("{\"action\":\"lock\",\"delay_s\":\"5\"}"));
+}
+
+void test_unknown_fields_are_ignored(void) {
+    TEST_ASSERT_EQUAL(CommandParseResult::ok, parse("{\"tag\":\"x\",\"action\":\"toggle\",\"extra\":{\"n\":1}}"));
+    TEST_ASSERT_EQUAL(CommandAction::toggle, command.action);
+}
+
+void test_field_length_limits(void) {
+    char payload[96];
+    char target[COMMAND_TARGET_SIZE + 1];
+
+    memset(target, 'a', COMMAND_TARGET_SIZE - 1);
+    target[COMMAND_TARGET_SIZE - 1] = '\0';
+    snprintf(payload, sizeof(payload), "{\"action\":\"lock\",\"target\":\"%s\"}", target);
+    TEST_ASSERT_EQUAL(CommandParseResult::ok, parse(payload));
+    TEST_ASSERT_EQUAL_STRING(target, command.target);
+
+    memset(target, 'a', COMMAND_TARGET_SIZE);
+    target[COMMAND_TARGET_SIZE] = '\0';
+    snprintf(payload, sizeof(payload), "{\"action\":\"lock\",\"target\":\"%s\"}", target);
+    TEST_ASSERT_EQUAL(CommandParseResult::fieldTooLong, parse(payload));
+}
+
+void test_action_errors(void) {
+    TEST_ASSERT_EQUAL(CommandParseResult::missingAction, parse("{}"));
+    TEST_ASSERT_EQUAL(CommandParseResult::unknownAction, parse("{\"action\":\"LOCK\"}"));
+    TEST_ASSERT_EQUAL(CommandParseResult::malformed, parse("{\"action\":1}"));
+    TEST_ASSERT_EQUAL(CommandParseResult::malformed, parse("lock"));
+}
+
+void test_action_names_round_trip(void) {
+    const CommandAction actions[] = {
+        CommandAction::lock, CommandAction::unlock, CommandAction::toggle, CommandAction::status,
+    };
+    for (CommandAction action : actions) {
+        const char* name = commandActionName(action);
+        TEST_ASSERT_EQUAL(action, parseCommandAction(name, strlen(name)));
+    }
+    TEST_ASSERT_EQUAL(CommandAction::none, parseCommandAction("loc", 3));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_all_fields);
+    RUN_TEST(test_optional_fields_default_to_empty);
+    RUN_TEST(test_relock_zero_means_never);
+    RUN_TEST(test_delay_limits);
+    RUN_TEST(test_unknown_fields_are_ignored);
+    RUN_TEST(test_field_length_limits);
+    RUN_TEST(test_action_errors);
+    RUN_TEST(test_action_names_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <string.h>
+#include <unity.h>
+#include "command_queue.h"
+
+static const uint32_t DEDUP_MS = 2000;
+static const uint32_t CONFIRM_MS = 5000;
+static const uint32_t MAX_QUEUED_MS = 30000;
+
+static SesameCommand make(CommandAction action, const char* requestId = "") {
+    SesameCommand command = {};
+    command.action = action;
+    strncpy(command.requestId, requestId, sizeof(command.requestId) - 1);
+    return command;
+}
+
+static CommandOutcome takeOutcome(CommandQueue& queue) {
+    CommandResult result;
+    TEST_ASSERT_TRUE(queue.takeResult(result));
+    return result.outcome;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_newer_command_supersedes_the_waiting_one(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+    SesameCommand sent;
+
+    queue.push(make(CommandAction::lock, "a"), 0);
+    TEST_ASSERT_TRUE(queue.next(0, 0, sent));
+    queue.push(make(CommandAction::unlock, "b"), 10);
+    queue.push(make(CommandAction::lock, "c"), 20);
+
+    // "b" was superseded, and "c" repeats the lock already in flight
+    CommandResult result;
+    TEST_ASSERT_TRUE(queue.takeResult(result));
+    TEST_ASSERT_EQUAL(CommandOutcome::superseded, result.outcome);
+    TEST_ASSERT_EQUAL_STRING("b", result.command.requestId);
+    TEST_ASSERT_TRUE(queue.takeResult(result));
+    TEST_ASSERT_EQUAL(CommandOutcome::duplicate, result.outcome);
+    TEST_ASSERT_EQUAL_STRING("c", result.command.requestId);
+    TEST_ASSERT_EQUAL(1, queue.depth());
+}
+
+void test_duplicates_of_queued_or_in_flight_are_dropped(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+    SesameCommand sent;
+
+    TEST_ASSERT_TRUE(queue.push(make(CommandAction::unlock), 0));
+    TEST_ASSERT_FALSE(queue.push(make(CommandAction::unlock), 1));
+    TEST_ASSERT_EQUAL(CommandOutcome::duplicate, takeOutcome(queue));
+
+    TEST_ASSERT_TRUE(queue.next(2, 2, sent));
+    TEST_ASSERT_FALSE(queue.push(make(CommandAction::unlock), 3));
+    TEST_ASSERT_EQUAL(CommandOutcome::duplicate, takeOutcome(queue));
+}
+
+void test_dedup_window_after_confirmation(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+    SesameCommand sent;
+
+    queue.push(make(CommandAction::lock), 0);
+    queue.next(0, 0, sent);
+    queue.statusUpdate(true, false, 100, 100);
+    TEST_ASSERT_EQUAL(CommandOutcome::confirmed, takeOutcome(queue));
+
+    TEST_ASSERT_FALSE(queue.push(make(CommandAction::lock), 100 + DEDUP_MS - 1));
+    TEST_ASSERT_EQUAL(CommandOutcome::duplicate, takeOutcome(queue));
+    TEST_ASSERT_TRUE(queue.push(make(CommandAction::lock), 100 + DEDUP_MS));
+}
+
+void test_unrelated_status_does_not_confirm(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+    SesameCommand sent;
+    CommandResult result;
+
+    queue.push(make(CommandAction::unlock), 0);
+    queue.next(0, 0, sent);
+    queue.statusUpdate(true, false, 50, 50);
+    TEST_ASSERT_FALSE(queue.takeResult(result));
+    TEST_ASSERT_EQUAL(1, queue.depth());
+}
+
+void test_confirm_timeout_and_queue_expiry(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+    SesameCommand sent;
+
+    queue.push(make(CommandAction::lock), 0);
+    queue.next(0, 0, sent);
+    queue.push(make(CommandAction::unlock), 1000);
+    TEST_ASSERT_EQUAL_UINT32(CONFIRM_MS - 1000, queue.msUntilNextDeadline(1000));
+
+    queue.expire(CONFIRM_MS - 1);
+    TEST_ASSERT_EQUAL(2, queue.depth());
+    queue.expire(CONFIRM_MS);
+    TEST_ASSERT_EQUAL(CommandOutcome::timeout, takeOutcome(queue));
+
+    // The waiting unlock never got a session
+    TEST_ASSERT_EQUAL_UINT32(1000 + MAX_QUEUED_MS - CONFIRM_MS, queue.msUntilNextDeadline(CONFIRM_MS));
+    queue.expire(1000 + MAX_QUEUED_MS);
+    CommandResult result;
+    TEST_ASSERT_TRUE(queue.takeResult(result));
+    TEST_ASSERT_EQUAL(CommandOutcome::expired, result.outcome);
+    TEST_ASSERT_EQUAL_UINT32(MAX_QUEUED_MS, result.elapsedMs);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, queue.msUntilNextDeadline(1000 + MAX_QUEUED_MS));
+}
+
+void test_depth_stays_bounded_under_a_flood(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+    SesameCommand sent = {};
+    CommandResult result;
+    uint32_t outcomes[5] = {};
+    uint32_t pushed = 0;
+
+    uint32_t seed = 3;
+    for (uint32_t now = 0; now < 100000; now++) {
+        seed = seed * 1664525u + 1013904223u;
+        queue.push(make((seed >> 16) & 1 ? CommandAction::lock : CommandAction::unlock), now);
+        pushed++;
+        TEST_ASSERT_LESS_OR_EQUAL(2, queue.depth());
+
+        // The lock confirms whatever was sent last, every 300 ms
+        queue.next(now, now, sent);
+        if (now % 300 == 0) {
+            queue.statusUpdate(sent.action == CommandAction::lock, sent.action == CommandAction::unlock, now, now);
+        }
+        queue.expire(now);
+        while (queue.takeResult(result)) {
+            outcomes[static_cast<int>(result.outcome)]++;
+        }
+    }
+
+    // Every command is accounted for exactly once
+    uint32_t finished = 0;
+    for (uint32_t count : outcomes) finished += count;
+    TEST_ASSERT_EQUAL_UINT32(pushed, finished + queue.depth() + queue.droppedResults());
+    TEST_ASSERT_GREATER_THAN(0, outcomes[static_cast<int>(CommandOutcome::confirmed)]);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.droppedResults());
+}
+
+void test_result_slots_overflow_is_counted(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+
+    queue.push(make(CommandAction::lock), 0);
+    for (int i = 0; i < COMMAND_RESULT_SLOTS + 3; i++) {
+        queue.push(make(CommandAction::lock), 0);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, queue.droppedResults());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_newer_command_supersedes_the_waiting_one);
+    RUN_TEST(test_duplicates_of_queued_or_in_flight_are_dropped);
+    RUN_TEST(test_dedup_window_after_confirmation);
+    RUN_TEST(test_unrelated_status_does_not_confirm);
+    RUN_TEST(test_confirm_timeout_and_queue_expiry);
+    RUN_TEST(test_depth_stays_bounded_under_a_flood);
+    RUN_TEST(test_result_slots_overflow_is_counted);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#include <unity.h>
+#include "connection_scheduler.h"
+
+static const uint32_t SLICE_MS = 60000;
+
+static LockSchedule idleLock() {
+    LockSchedule lock = {};
+    return lock;
+}
+
+static LockSchedule connectedLock(uint32_t startedMs, uint32_t lastUsedMs) {
+    LockSchedule lock = {};
+    lock.connected = true;
+    lock.sessionStartedMs = startedMs;
+    lock.lastUsedMs = lastUsedMs;
+    return lock;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_connects_up_to_the_session_limit(void) {
+    ConnectionScheduler scheduler(2, SLICE_MS);
+    LockSchedule locks[3] = {idleLock(), idleLock(), idleLock()};
+
+    int first = scheduler.nextToConnect(locks, 3, 0);
+    TEST_ASSERT_EQUAL(0, first);
+    locks[first].connected = true;
+
+    int second = scheduler.nextToConnect(locks, 3, 0);
+    TEST_ASSERT_EQUAL(1, second);
+    locks[second].connected = true;
+
+    TEST_ASSERT_EQUAL(-1, scheduler.nextToConnect(locks, 3, 0));
+}
+
+void test_locks_with_work_connect_first(void) {
+    ConnectionScheduler scheduler(1, SLICE_MS);
+    LockSchedule locks[3] = {idleLock(), idleLock(), idleLock()};
+    locks[2].pendingWork = true;
+
+    TEST_ASSERT_EQUAL(2, scheduler.nextToConnect(locks, 3, 0));
+}
+
+void test_retry_time_and_disabled_locks_are_respected(void) {
+    ConnectionScheduler scheduler(3, SLICE_MS);
+    LockSchedule locks[2] = {idleLock(), idleLock()};
+    locks[0].disabled = true;
+    locks[1].retryAtMs = 1000;
+
+    TEST_ASSERT_EQUAL(-1, scheduler.nextToConnect(locks, 2, 999));
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.msUntilNextDecision(locks, 2, 999));
+    TEST_ASSERT_EQUAL(1, scheduler.nextToConnect(locks, 2, 1000));
+}
+
+void test_on_demand_locks_wait_for_work(void) {
+    ConnectionScheduler scheduler(3, SLICE_MS);
+    LockSchedule locks[1] = {idleLock()};
+    locks[0].onDemand = true;
+
+    TEST_ASSERT_EQUAL(-1, scheduler.nextToConnect(locks, 1, 0));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, scheduler.msUntilNextDecision(locks, 1, 0));
+
+    locks[0].pendingWork = true;
+    TEST_ASSERT_EQUAL(0, scheduler.nextToConnect(locks, 1, 0));
+}
+
+void test_idle_session_released_for_urgent_work(void) {
+    ConnectionScheduler scheduler(2, SLICE_MS);
+    LockSchedule locks[3] = {connectedLock(0, 500), connectedLock(0, 100), idleLock()};
+
+    // Nothing waiting: sessions are kept
+    locks[2].onDemand = true;
+    TEST_ASSERT_EQUAL(-1, scheduler.sessionToRelease(locks, 3, 1000));
+
+    // Work for the third lock: the least recently used idle session goes
+    locks[2].pendingWork = true;
+    TEST_ASSERT_EQUAL(1, scheduler.sessionToRelease(locks, 3, 1000));
+
+    // ...unless it is busy itself
+    locks[1].pendingWork = true;
+    TEST_ASSERT_EQUAL(0, scheduler.sessionToRelease(locks, 3, 1000));
+    locks[0].pendingWork = true;
+    TEST_ASSERT_EQUAL(-1, scheduler.sessionToRelease(locks, 3, 1000));
+}
+
+void test_sessions_rotate_after_the_slice(void) {
+    ConnectionScheduler scheduler(1, SLICE_MS);
+    LockSchedule locks[2] = {connectedLock(0, 0), idleLock()};
+
+    // Another lock waits without work: only a session past its slice is rotated
+    TEST_ASSERT_EQUAL(-1, scheduler.sessionToRelease(locks, 2, SLICE_MS - 1));
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.msUntilNextDecision(locks, 2, SLICE_MS - 1));
+    TEST_ASSERT_EQUAL(0, scheduler.sessionToRelease(locks, 2, SLICE_MS));
+}
+
+void test_round_robin_between_waiting_locks(void) {
+    ConnectionScheduler scheduler(1, SLICE_MS);
+    LockSchedule locks[3] = {idleLock(), idleLock(), idleLock()};
+
+    int order[6];
+    for (int i = 0; i < 6; i++) {
+        order[i] = scheduler.nextToConnect(locks, 3, 0);
+    }
+    const int expected[6] = {0, 1, 2, 0, 1, 2};
+    TEST_ASSERT_EQUAL_MEMORY(expected, order, sizeof(expected));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_connects_up_to_the_session_limit);
+    RUN_TEST(test_locks_with_work_connect_first);
+    RUN_TEST(test_retry_time_and_disabled_locks_are_respected);
+    RUN_TEST(test_on_demand_locks_wait_for_work);
+    RUN_TEST(test_idle_session_released_for_urgent_work);
+    RUN_TEST(test_sessions_rotate_after_the_slice);
+    RUN_TEST(test_round_robin_between_waiting_locks);
+    return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <string.h>
+#include <unity.h>
+#include "device_table.h"
+
+static DeviceTable table;
+static uint32_t seed;
+
+static uint64_t randomAddress() {
+    uint64_t address = 0;
+    for (int i = 0; i < 3; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        address = (address << 16) | (seed >> 16);
+    }
+    return address & 0xFFFFFFFFFFFFULL;
+}
+
+void setUp(void) {
+    table = DeviceTable();
+    seed = 7;
+}
+
+void tearDown(void) {}
+
+void test_insert_and_find(void) {
+    bool created;
+    DeviceEntry* entry = table.insert(0xA4C138000001ULL, created);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_TRUE(created);
+    TEST_ASSERT_EQUAL_PTR(entry, table.insert(0xA4C138000001ULL, created));
+    TEST_ASSERT_FALSE(created);
+    TEST_ASSERT_EQUAL_PTR(entry, table.find(0xA4C138000001ULL));
+    TEST_ASSERT_NULL(table.find(0xA4C138000002ULL));
+    TEST_ASSERT_EQUAL(1, table.size());
+}
+
+void test_full_table_refuses_new_devices(void) {
+    bool created;
+    for (size_t i = 0; i < DEVICE_TABLE_MAX_DEVICES; i++) {
+        TEST_ASSERT_NOT_NULL(table.insert(i + 1, created));
+    }
+    TEST_ASSERT_NULL(table.insert(DEVICE_TABLE_MAX_DEVICES + 1, created));
+    // Known devices are still found and updated
+    TEST_ASSERT_NOT_NULL(table.insert(1, created));
+    TEST_ASSERT_FALSE(created);
+    TEST_ASSERT_EQUAL(DEVICE_TABLE_MAX_DEVICES, table.size());
+}
+
+void test_removal_keeps_probe_runs_intact(void) {
+    static uint64_t addresses[DEVICE_TABLE_MAX_DEVICES];
+    bool created;
+    for (uint64_t& address : addresses) {
+        address = randomAddress();
+        TEST_ASSERT_NOT_NULL(table.insert(address, created));
+    }
+    // Remove every other device; the rest must still be reachable
+    for (size_t i = 0; i < DEVICE_TABLE_MAX_DEVICES; i += 2) {
+        DeviceEntry* entry = table.find(addresses[i]);
+        TEST_ASSERT_NOT_NULL(entry);
+        table.remove(static_cast<size_t>(entry - &table.at(0)));
+    }
+    TEST_ASSERT_EQUAL(DEVICE_TABLE_MAX_DEVICES / 2, table.size());
+    for (size_t i = 0; i < DEVICE_TABLE_MAX_DEVICES; i++) {
+        DeviceEntry* entry = table.find(addresses[i]);
+        if (i % 2 == 0) {
+            TEST_ASSERT_NULL(entry);
+        } else {
+            TEST_ASSERT_NOT_NULL(entry);
+            TEST_ASSERT_TRUE(entry->address == addresses[i]);
+        }
+    }
+}
+
+void test_aging_reports_and_drops_quiet_devices(void) {
+    static const uint8_t payload[] = {0x02, 0x01, 0x06};
+    bool created;
+    for (uint64_t i = 0; i < 100; i++) {
+        DeviceEntry* entry = table.insert(randomAddress(), created);
+        // Even devices last heard at 0, odd ones at 20000
+        updateDevice(*entry, payload, sizeof(payload), 0, -60, (i % 2) * 20000);
+    }
+
+    size_t reported = 0;
+    size_t removed = table.age(30000, 30000, [&reported](DeviceEntry& entry) {
+        TEST_ASSERT_EQUAL_UINT32(0, entry.lastSeenMs);
+        reported++;
+    });
+    TEST_ASSERT_EQUAL(50, removed);
+    TEST_ASSERT_EQUAL(50, reported);
+    TEST_ASSERT_EQUAL(50, table.size());
+    TEST_ASSERT_EQUAL(0, table.age(30000, 30000, [](DeviceEntry&) {}));
+}
+
+void test_rssi_average_follows_samples(void) {
+    static const uint8_t payload[] = {0x02, 0x01, 0x06};
+    DeviceEntry entry = {};
+    updateDevice(entry, payload, sizeof(payload), 0, -80, 0);
+    TEST_ASSERT_EQUAL_INT16(-80 * (1 << DEVICE_RSSI_SHIFT), entry.rssiAvg);
+    for (uint32_t i = 1; i <= 40; i++) {
+        updateDevice(entry, payload, sizeof(payload), 0, -60, i);
+    }
+    TEST_ASSERT_INT_WITHIN(1 << DEVICE_RSSI_SHIFT, -60 * (1 << DEVICE_RSSI_SHIFT), entry.rssiAvg);
+    TEST_ASSERT_EQUAL_INT8(-60, entry.lastRssi);
+    TEST_ASSERT_EQUAL_UINT32(41, entry.count);
+    TEST_ASSERT_EQUAL_UINT32(0, entry.firstSeenMs);
+    TEST_ASSERT_EQUAL_UINT32(40, entry.lastSeenMs);
+}
+
+void test_sesame_advert_is_recognised(void) {
+    static const uint8_t payload[] = {
+        0x02, 0x01, 0x06,
+        0x03, 0x02, 0x81, 0xFD,
+        0x08, 0xFF, 0x5A, 0x05, 0x05, 0x00, 0x01, 0x3C, 0x81,
+    };
+    DeviceEntry entry = {};
+    updateDevice(entry, payload, sizeof(payload), 1, -70, 0);
+    TEST_ASSERT_TRUE(entry.sesame);
+    TEST_ASSERT_EQUAL_UINT8(5, entry.model);
+    TEST_ASSERT_EQUAL_UINT8(7, entry.manufacturerLength);
+    TEST_ASSERT_EQUAL_UINT8(0x5A, entry.manufacturer[0]);
+}
+
+void test_name_and_manufacturer_data_are_truncated(void) {
+    uint8_t payload[64];
+    size_t n = 0;
+    payload[n++] = 26;
+    payload[n++] = 0x09;
+    for (int i = 0; i < 25; i++) payload[n++] = static_cast<uint8_t>('a' + i);
+    payload[n++] = 31;
+    payload[n++] = 0xFF;
+    for (int i = 0; i < 30; i++) payload[n++] = static_cast<uint8_t>(i);
+
+    DeviceEntry entry = {};
+    updateDevice(entry, payload, n, 0, -50, 0);
+    TEST_ASSERT_EQUAL_STRING("abcdefghijklmnopqrst", entry.name);
+    TEST_ASSERT_EQUAL_UINT8(DEVICE_MANUFACTURER_MAX, entry.manufacturerLength);
+    TEST_ASSERT_FALSE(entry.sesame);
+}
+
+void test_malformed_payload_keeps_earlier_fields(void) {
+    static const uint8_t payload[] = {0x04, 0x09, 'a', 'b', 'c', 0x10, 0xFF, 0x5A};
+    DeviceEntry entry = {};
+    updateDevice(entry, payload, sizeof(payload), 0, -50, 0);
+    TEST_ASSERT_EQUAL_STRING("abc", entry.name);
+    TEST_ASSERT_EQUAL_UINT8(0, entry.manufacturerLength);
+    TEST_ASSERT_EQUAL_UINT32(1, entry.count);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_insert_and_find);
+    RUN_TEST(test_full_table_refuses_new_devices);
+    RUN_TEST(test_removal_keeps_probe_runs_intact);
+    RUN_TEST(test_aging_reports_and_drops_quiet_devices);
+    RUN_TEST(test_rssi_average_follows_samples);
+    RUN_TEST(test_sesame_advert_is_recognised);
+    RUN_TEST(test_name_and_manufacturer_data_are_truncated);
+    RUN_TEST(test_malformed_payload_keeps_earlier_fields);
+    return UNITY_END();
+}
@@ -0,0 +1,99 @@
+#include <string.h>
+#include <unity.h>
+#include "command.h"
+#include "command_queue.h"
+
+// MQTT payload -> parseCommandPayload -> CommandQueue -> "BLE write", the
+// path the sesame task runs for every lock/unlock it receives
+
+static const uint32_t DEDUP_MS = 2000;
+static const uint32_t CONFIRM_MS = 5000;
+static const uint32_t MAX_QUEUED_MS = 30000;
+
+static SesameCommand parse(const char* payload) {
+    SesameCommand command;
+    memset(&command, 0, sizeof(command));
+    TEST_ASSERT_EQUAL(CommandParseResult::ok, parseCommandPayload(payload, strlen(payload), command));
+    command.source = CommandSource::mqtt;
+    return command;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_command_reaches_the_lock_with_its_timestamps(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+    SesameCommand command = parse("{\"action\":\"unlock\",\"request_id\":\"r1\"}");
+    command.ingressUs = 1000;
+
+    TEST_ASSERT_TRUE(queue.push(command, 10));
+
+    SesameCommand sent;
+    TEST_ASSERT_TRUE(queue.next(12, 2500, sent));
+    TEST_ASSERT_EQUAL(CommandAction::unlock, sent.action);
+    TEST_ASSERT_EQUAL_STRING("r1", sent.requestId);
+    TEST_ASSERT_EQUAL_UINT32(1000, sent.ingressUs);
+    TEST_ASSERT_EQUAL_UINT32(2500, sent.dispatchUs);
+
+    queue.statusUpdate(false, true, 400, 90000);
+    CommandResult result;
+    TEST_ASSERT_TRUE(queue.takeResult(result));
+    TEST_ASSERT_EQUAL(CommandOutcome::confirmed, result.outcome);
+    TEST_ASSERT_EQUAL_UINT32(390, result.elapsedMs);
+    TEST_ASSERT_EQUAL_UINT32(90000, result.confirmUs);
+    TEST_ASSERT_EQUAL_STRING("r1", result.command.requestId);
+}
+
+void test_one_write_in_flight_while_commands_keep_arriving(void) {
+    CommandQueue queue(DEDUP_MS, CONFIRM_MS, MAX_QUEUED_MS);
+    SesameCommand sent;
+
+    queue.push(parse("{\"action\":\"lock\"}"), 0);
+    TEST_ASSERT_TRUE(queue.next(0, 0, sent));
+
+    // A burst while the lock is still moving: nothing else is written
+    const char* burst[] = {"{\"action\":\"unlock\"}", "{\"action\":\"lock\"}", "{\"action\":\"unlock\"}"};
+    for (uint32_t i = 0; i < 30; i++) {
+        queue.push(parse(burst[i % 3]), i);
+        TEST_ASSERT_FALSE(queue.next(i, i, sent));
+        TEST_ASSERT_LESS_OR_EQUAL(2, queue.depth());
+    }
+
+    // The lock confirms; the newest waiting command goes out next
+    queue.statusUpdate(true, false, 100, 100);
+    TEST_ASSERT_TRUE(queue.next(101, 101, sent));
+    TEST_ASSERT_EQUAL(CommandAction::unlock, sent.action);
+    TEST_ASSERT_FALSE(queue.hasQueued());
+}
+
+void test_rejected_payloads_never_reach_the_queue(void) {
+    const char* payloads[] = {
+        "",
+        "{",
+        "{\"target\":\"front\"}",
+        "{\"action\":\"open\"}",
+        "{\"action\":\"lock\",\"delay_s\":-1}",
+        "{\"action\":\"lock\",\"request_id\":\"0123456789012345678901234567890123456789\"}",
+    };
+    const CommandParseResult expected[] = {
+        CommandParseResult::malformed,
+        CommandParseResult::malformed,
+        CommandParseResult::missingAction,
+        CommandParseResult::unknownAction,
+        CommandParseResult::invalidValue,
+        CommandParseResult::fieldTooLong,
+    };
+
+    for (size_t i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++) {
+        SesameCommand command;
+        TEST_ASSERT_EQUAL(expected[i], parseCommandPayload(payloads[i], strlen(payloads[i]), command));
+    }
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_command_reaches_the_lock_with_its_timestamps);
+    RUN_TEST(test_one_write_in_flight_while_commands_keep_arriving);
+    RUN_TEST(test_rejected_payloads_never_reach_the_queue);
+    return UNITY_END();
+}
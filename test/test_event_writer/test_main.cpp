@@ -0,0 +1,213 @@
+#include <string.h>
+#include <unity.h>
+#include "cbor_reader.h"
+#include "event_writer.h"
+
+static uint8_t buffer[256];
+
+void setUp(void) { memset(buffer, 0xEE, sizeof(buffer)); }
+void tearDown(void) {}
+
+void test_json_event(void) {
+    EventWriter event(PayloadFormat::json, buffer, sizeof(buffer));
+    event.add(FieldId::lock, "door");
+    event.add(FieldId::locked, true);
+    event.add(FieldId::batteryPct, static_cast<uint8_t>(87));
+    event.add(FieldId::rssi, static_cast<int8_t>(-71));
+    event.add(FieldId::voltage, 6.1);
+    TEST_ASSERT_TRUE(event.finish());
+    TEST_ASSERT_EQUAL_STRING("{\"lock\":\"door\",\"locked\":true,\"battery_pct\":87,\"rssi\":-71,\"voltage\":6.1}",
+                             reinterpret_cast<const char*>(buffer));
+    TEST_ASSERT_EQUAL(strlen(reinterpret_cast<const char*>(buffer)), event.length());
+}
+
+void test_json_nesting_and_escaping(void) {
+    EventWriter event(PayloadFormat::json, buffer, sizeof(buffer));
+    event.add(FieldId::tag, "a\"b\\c\n");
+    event.add(FieldId::requestId, static_cast<const char*>(nullptr));
+    event.beginArray(FieldId::entries);
+    event.beginArrayObject();
+    event.add(FieldId::time, 1u);
+    event.endObject();
+    event.beginArrayObject();
+    event.add(FieldId::time, 2u);
+    event.endObject();
+    event.endArray();
+    event.beginObject(FieldId::queue);
+    event.endObject();
+    TEST_ASSERT_TRUE(event.finish());
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"tag\":\"a\\\"b\\\\c\\u000a\",\"request_id\":null,\"entries\":[{\"time\":1},{\"time\":2}],\"queue\":{}}",
+        reinterpret_cast<const char*>(buffer));
+}
+
+void test_cbor_event(void) {
+    EventWriter event(PayloadFormat::cbor, buffer, sizeof(buffer));
+    event.add(FieldId::lock, "door");
+    event.add(FieldId::locked, true);
+    event.add(FieldId::rssi, static_cast<int8_t>(-71));
+    event.add(FieldId::timestamp, 1000u);
+    TEST_ASSERT_TRUE(event.finish());
+
+    static const uint8_t expected[] = {
+        0xBF,
+        0x01, 0x64, 'd', 'o', 'o', 'r',   // lock: "door"
+        0x0B, 0xF5,                       // locked: true
+        0x0D, 0x38, 0x46,                 // rssi: -71
+        0x16, 0x19, 0x03, 0xE8,           // timestamp: 1000
+        0xFF,
+    };
+    TEST_ASSERT_EQUAL(sizeof(expected), event.length());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buffer, sizeof(expected));
+}
+
+void test_cbor_round_trip(void) {
+    EventWriter event(PayloadFormat::cbor, buffer, sizeof(buffer));
+    event.add(FieldId::lock, "door");
+    event.add(FieldId::unlocked, false);
+    event.add(FieldId::position, static_cast<int16_t>(-300));
+    event.add(FieldId::timestamp, static_cast<uint64_t>(0x100000000ULL));
+    event.beginArray(FieldId::entries);
+    event.beginArrayObject();
+    event.add(FieldId::time, 5u);
+    event.endObject();
+    event.endArray();
+    event.add(FieldId::voltage, 6.5);
+    TEST_ASSERT_TRUE(event.finish());
+
+    CborMapScanner scanner(buffer, event.length());
+    CborField field;
+    char text[8];
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::lock));
+    TEST_ASSERT_TRUE(field.copyText(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("door", text);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::unlocked));
+    TEST_ASSERT_EQUAL(CborValueType::simple, field.type);
+    TEST_ASSERT_EQUAL_UINT32(20, field.number);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::position));
+    TEST_ASSERT_EQUAL(CborValueType::negativeInt, field.type);
+    TEST_ASSERT_EQUAL_UINT32(299, field.number);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::timestamp));
+    TEST_ASSERT_TRUE(field.number == 0x100000000ULL);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::entries));
+    TEST_ASSERT_EQUAL(CborValueType::array, field.type);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::voltage));
+    TEST_ASSERT_EQUAL(CborValueType::floating, field.type);
+
+    TEST_ASSERT_FALSE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.failed());
+}
+
+void test_overflow_is_reported(void) {
+    EventWriter event(PayloadFormat::json, buffer, 16);
+    event.add(FieldId::lock, "a-rather-long-lock-id");
+    TEST_ASSERT_FALSE(event.finish());
+    TEST_ASSERT_TRUE(event.overflowed());
+    TEST_ASSERT_TRUE(event.length() <= 16);
+    TEST_ASSERT_EQUAL_HEX8(0xEE, buffer[16]);
+
+    // Exactly full: JSON needs one more byte for the terminator
+    EventWriter exact(PayloadFormat::json, buffer, 2);
+    TEST_ASSERT_FALSE(exact.finish());
+    EventWriter fits(PayloadFormat::json, buffer, 3);
+    TEST_ASSERT_TRUE(fits.finish());
+    TEST_ASSERT_EQUAL_STRING("{}", reinterpret_cast<const char*>(buffer));
+}
+
+void test_unbalanced_nesting_fails(void) {
+    EventWriter open(PayloadFormat::cbor, buffer, sizeof(buffer));
+    open.beginArray(FieldId::entries);
+    TEST_ASSERT_FALSE(open.finish());
+
+    EventWriter closed(PayloadFormat::json, buffer, sizeof(buffer));
+    closed.endObject();
+    TEST_ASSERT_FALSE(closed.finish());
+
+    EventWriter deep(PayloadFormat::json, buffer, sizeof(buffer));
+    for (int i = 0; i <= EVENT_WRITER_MAX_DEPTH; i++) {
+        deep.beginObject(FieldId::queue);
+    }
+    TEST_ASSERT_TRUE(deep.overflowed());
+}
+
+void test_detect_payload_format(void) {
+    static const uint8_t cbor[] = {0xA1, 0x12, 0x01};
+    static const uint8_t cborIndefinite[] = {0xBF, 0xFF};
+    static const uint8_t json[] = "{\"action\":\"lock\"}";
+    TEST_ASSERT_EQUAL(PayloadFormat::cbor, detectPayloadFormat(cbor, sizeof(cbor)));
+    TEST_ASSERT_EQUAL(PayloadFormat::cbor, detectPayloadFormat(cborIndefinite, sizeof(cborIndefinite)));
+    TEST_ASSERT_EQUAL(PayloadFormat::json, detectPayloadFormat(json, sizeof(json) - 1));
+    TEST_ASSERT_EQUAL(PayloadFormat::json, detectPayloadFormat(json, 0));
+}
+
+void test_append_age_ms_json(void) {
+    strcpy(reinterpret_cast<char*>(buffer), "{\"lock\":\"door\"}");
+    size_t length = appendAgeMs(buffer, 15, sizeof(buffer), 1234);
+    TEST_ASSERT_EQUAL_STRING("{\"lock\":\"door\",\"age_ms\":1234}", reinterpret_cast<const char*>(buffer));
+    TEST_ASSERT_EQUAL(strlen(reinterpret_cast<const char*>(buffer)), length);
+
+    strcpy(reinterpret_cast<char*>(buffer), "{}");
+    length = appendAgeMs(buffer, 2, sizeof(buffer), 5);
+    TEST_ASSERT_EQUAL_STRING("{\"age_ms\":5}", reinterpret_cast<const char*>(buffer));
+
+    // No room: left as it was
+    strcpy(reinterpret_cast<char*>(buffer), "{}");
+    TEST_ASSERT_EQUAL(2, appendAgeMs(buffer, 2, 8, 5));
+    TEST_ASSERT_EQUAL_STRING("{}", reinterpret_cast<const char*>(buffer));
+}
+
+void test_append_age_ms_cbor(void) {
+    EventWriter event(PayloadFormat::cbor, buffer, sizeof(buffer));
+    event.add(FieldId::lock, "door");
+    event.finish();
+    size_t length = appendAgeMs(buffer, event.length(), sizeof(buffer), 1000);
+
+    CborMapScanner scanner(buffer, length);
+    CborField field;
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::lock));
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals(FieldId::ageMs));
+    TEST_ASSERT_EQUAL_UINT32(1000, field.number);
+    TEST_ASSERT_FALSE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.failed());
+
+    // Definite-length maps cannot grow in place
+    static const uint8_t definite[] = {0xA1, 0x01, 0x61, 'x'};
+    memcpy(buffer, definite, sizeof(definite));
+    TEST_ASSERT_EQUAL(sizeof(definite), appendAgeMs(buffer, sizeof(definite), sizeof(buffer), 1000));
+}
+
+void test_field_names_match_ids(void) {
+    TEST_ASSERT_EQUAL_STRING("lock", fieldName(FieldId::lock));
+    TEST_ASSERT_EQUAL_STRING("battery_pct", fieldName(FieldId::batteryPct));
+    TEST_ASSERT_EQUAL_STRING("skipped", fieldName(FieldId::skipped));
+    TEST_ASSERT_EQUAL_STRING("", fieldName(FieldId::last));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_json_event);
+    RUN_TEST(test_json_nesting_and_escaping);
+    RUN_TEST(test_cbor_event);
+    RUN_TEST(test_cbor_round_trip);
+    RUN_TEST(test_overflow_is_reported);
+    RUN_TEST(test_unbalanced_nesting_fails);
+    RUN_TEST(test_detect_payload_format);
+    RUN_TEST(test_append_age_ms_json);
+    RUN_TEST(test_append_age_ms_cbor);
+    RUN_TEST(test_field_names_match_ids);
+    return UNITY_END();
+}
@@ -0,0 +1,121 @@
+#include <string.h>
+#include <unity.h>
+#include "history_log.h"
+
+static HistoryLog history;
+
+static HistoryEntry entry(uint8_t lock, uint32_t time, uint8_t type = 1, uint8_t published = 0) {
+    HistoryEntry e = {};
+    e.time = time;
+    e.lock = lock;
+    e.type = type;
+    e.published = published;
+    strncpy(e.tag, "tag", sizeof(e.tag) - 1);
+    return e;
+}
+
+void setUp(void) { history = HistoryLog(); }
+void tearDown(void) {}
+
+void test_duplicates_are_dropped(void) {
+    TEST_ASSERT_TRUE(history.add(entry(0, 100, 1)));
+    TEST_ASSERT_FALSE(history.add(entry(0, 100, 1)));
+    // Same time, other type or other lock: distinct records
+    TEST_ASSERT_TRUE(history.add(entry(0, 100, 2)));
+    TEST_ASSERT_TRUE(history.add(entry(1, 100, 1)));
+    TEST_ASSERT_EQUAL(3, history.size());
+    TEST_ASSERT_EQUAL(3, history.unpublished());
+    TEST_ASSERT_TRUE(history.contains(1, 100, 1));
+    TEST_ASSERT_FALSE(history.contains(1, 100, 2));
+}
+
+void test_newest_time_is_per_lock(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, history.newestTime(0));
+    history.add(entry(0, 300));
+    history.add(entry(0, 200));
+    history.add(entry(1, 500));
+    TEST_ASSERT_EQUAL_UINT32(300, history.newestTime(0));
+    TEST_ASSERT_EQUAL_UINT32(500, history.newestTime(1));
+    TEST_ASSERT_EQUAL_UINT32(0, history.newestTime(2));
+}
+
+void test_full_log_overwrites_oldest(void) {
+    for (uint32_t i = 0; i < HISTORY_LOG_SLOTS + 3; i++) {
+        TEST_ASSERT_TRUE(history.add(entry(0, 1000 + i)));
+    }
+    TEST_ASSERT_EQUAL(HISTORY_LOG_SLOTS, history.size());
+    TEST_ASSERT_EQUAL(HISTORY_LOG_SLOTS, history.unpublished());
+    TEST_ASSERT_EQUAL_UINT32(1003, history.at(0).time);
+    TEST_ASSERT_EQUAL_UINT32(1000 + HISTORY_LOG_SLOTS + 2, history.at(HISTORY_LOG_SLOTS - 1).time);
+    TEST_ASSERT_FALSE(history.contains(0, 1000, 1));
+}
+
+void test_overwriting_published_entries_keeps_unpublished_count(void) {
+    for (uint32_t i = 0; i < HISTORY_LOG_SLOTS; i++) {
+        history.add(entry(0, i + 1, 1, 1));   // reloaded from flash, already sent
+    }
+    TEST_ASSERT_EQUAL(0, history.unpublished());
+    history.add(entry(0, 1000));
+    TEST_ASSERT_EQUAL(1, history.unpublished());
+    TEST_ASSERT_EQUAL(HISTORY_LOG_SLOTS, history.size());
+}
+
+void test_batches_are_one_lock_oldest_first(void) {
+    history.add(entry(1, 10));
+    history.add(entry(0, 20));
+    history.add(entry(1, 30));
+    history.add(entry(0, 40));
+    history.add(entry(1, 50));
+
+    HistoryEntry batch[8];
+    size_t n = history.takeUnpublished(batch, 8);
+    TEST_ASSERT_EQUAL(3, n);
+    TEST_ASSERT_EQUAL(1, batch[0].lock);
+    TEST_ASSERT_EQUAL_UINT32(10, batch[0].time);
+    TEST_ASSERT_EQUAL_UINT32(30, batch[1].time);
+    TEST_ASSERT_EQUAL_UINT32(50, batch[2].time);
+    TEST_ASSERT_EQUAL(2, history.unpublished());
+
+    n = history.takeUnpublished(batch, 8);
+    TEST_ASSERT_EQUAL(2, n);
+    TEST_ASSERT_EQUAL(0, batch[0].lock);
+    TEST_ASSERT_EQUAL_UINT32(20, batch[0].time);
+    TEST_ASSERT_EQUAL(0, history.takeUnpublished(batch, 8));
+    TEST_ASSERT_EQUAL(0, history.unpublished());
+}
+
+void test_batch_size_is_capped(void) {
+    for (uint32_t i = 0; i < 10; i++) {
+        history.add(entry(0, i + 1));
+    }
+    HistoryEntry batch[4];
+    TEST_ASSERT_EQUAL(4, history.takeUnpublished(batch, 4));
+    TEST_ASSERT_EQUAL_UINT32(1, batch[0].time);
+    TEST_ASSERT_EQUAL(6, history.unpublished());
+    TEST_ASSERT_EQUAL(4, history.takeUnpublished(batch, 4));
+    TEST_ASSERT_EQUAL_UINT32(5, batch[0].time);
+    TEST_ASSERT_EQUAL(2, history.takeUnpublished(batch, 4));
+    TEST_ASSERT_EQUAL(0, history.unpublished());
+}
+
+void test_published_entries_still_dedup(void) {
+    history.add(entry(0, 100));
+    HistoryEntry batch[1];
+    history.takeUnpublished(batch, 1);
+    TEST_ASSERT_TRUE(history.at(0).published);
+    // Fetching the same record again after a reconnect must not resend it
+    TEST_ASSERT_FALSE(history.add(entry(0, 100)));
+    TEST_ASSERT_EQUAL(0, history.unpublished());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_duplicates_are_dropped);
+    RUN_TEST(test_newest_time_is_per_lock);
+    RUN_TEST(test_full_log_overwrites_oldest);
+    RUN_TEST(test_overwriting_published_entries_keeps_unpublished_count);
+    RUN_TEST(test_batches_are_one_lock_oldest_first);
+    RUN_TEST(test_batch_size_is_capped);
+    RUN_TEST(test_published_entries_still_dedup);
+    return UNITY_END();
+}
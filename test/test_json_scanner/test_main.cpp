@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "json_scanner.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static JsonObjectScanner scannerFor(const char* text) {
+    return JsonObjectScanner(text, strlen(text));
+}
+
+void test_fields_point_into_the_payload(void) {
+    const char* text = " { \"action\" : \"lock\", \"delay_s\":30 ,\"quiet\":true,\"tag\":null}";
+    JsonObjectScanner scanner = scannerFor(text);
+    JsonField field;
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals("action"));
+    TEST_ASSERT_EQUAL(JsonValueType::string, field.type);
+    TEST_ASSERT_TRUE(field.valueEquals("lock"));
+    TEST_ASSERT_TRUE(field.value > text && field.value < text + strlen(text));
+
+    long seconds = 0;
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals("delay_s"));
+    TEST_ASSERT_TRUE(field.toLong(seconds));
+    TEST_ASSERT_EQUAL(30, seconds);
+
+    bool quiet = false;
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.toBool(quiet));
+    TEST_ASSERT_TRUE(quiet);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_EQUAL(JsonValueType::null, field.type);
+
+    TEST_ASSERT_FALSE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.failed());
+}
+
+void test_empty_object(void) {
+    JsonObjectScanner scanner = scannerFor("{}");
+    JsonField field;
+    TEST_ASSERT_FALSE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.failed());
+}
+
+void test_nested_values_are_skipped_whole(void) {
+    const char* nested = "{\"a\":[1,\"}]\",{}]}";
+    char text[64];
+    snprintf(text, sizeof(text), "{\"meta\":%s,\"action\":\"unlock\"}", nested);
+    JsonObjectScanner scanner = scannerFor(text);
+    JsonField field;
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_EQUAL(JsonValueType::object, field.type);
+    TEST_ASSERT_EQUAL(strlen(nested), field.valueLength);
+    TEST_ASSERT_EQUAL_MEMORY(nested, field.value, field.valueLength);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.keyEquals("action"));
+    TEST_ASSERT_TRUE(field.valueEquals("unlock"));
+    TEST_ASSERT_FALSE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.failed());
+}
+
+void test_escapes_are_decoded_on_copy(void) {
+    JsonObjectScanner scanner = scannerFor("{\"id\":\"a\\\"b\\\\c\\u00e9\\u20ac\"}");
+    JsonField field;
+    char out[16];
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.copyString(out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("a\"b\\c\xC3\xA9\xE2\x82\xAC", out);
+}
+
+void test_copy_rejects_truncation_and_bad_escapes(void) {
+    JsonObjectScanner scanner = scannerFor("{\"id\":\"abcdef\",\"bad\":\"\\x\",\"u\":\"\\u12G4\"}");
+    JsonField field;
+    char small[6];
+    char out[7];
+
+    // "abcdef" needs 7 bytes with its terminator
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(field.copyString(small, sizeof(small)));
+    TEST_ASSERT_TRUE(field.copyString(out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("abcdef", out);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(field.copyString(out, sizeof(out)));
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(field.copyString(out, sizeof(out)));
+}
+
+void test_number_conversion_is_strict(void) {
+    JsonObjectScanner scanner = scannerFor("{\"a\":-12,\"b\":1.5,\"c\":\"7\"}");
+    JsonField field;
+    long value = 0;
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_TRUE(field.toLong(value));
+    TEST_ASSERT_EQUAL(-12, value);
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(field.toLong(value));
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(field.toLong(value));
+}
+
+void test_malformed_input_fails(void) {
+    const char* inputs[] = {
+        "",
+        "[]",
+        "{\"a\"}",
+        "{\"a\":}",
+        "{\"a\":1 \"b\":2}",
+        "{\"a\":\"unterminated}",
+        "{\"a\":{\"b\":1}",
+        "{\"a\":bogus}",
+        "{\"a\":1,",
+    };
+
+    for (const char* input : inputs) {
+        JsonObjectScanner scanner = scannerFor(input);
+        JsonField field;
+        while (scanner.next(field)) {}
+        TEST_ASSERT_TRUE_MESSAGE(scanner.failed(), input);
+    }
+}
+
+void test_length_bounds_the_scan(void) {
+    // Only the first 15 bytes belong to the payload; the rest is not read
+    const char* text = "{\"action\":\"on\"}garbage";
+    JsonObjectScanner scanner(text, 15);
+    JsonField field;
+
+    TEST_ASSERT_TRUE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.next(field));
+    TEST_ASSERT_FALSE(scanner.failed());
+
+    JsonObjectScanner cut(text, 12);
+    TEST_ASSERT_FALSE(cut.next(field));
+    TEST_ASSERT_TRUE(cut.failed());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fields_point_into_the_payload);
+    RUN_TEST(test_empty_object);
+    RUN_TEST(test_nested_values_are_skipped_whole);
+    RUN_TEST(test_escapes_are_decoded_on_copy);
+    RUN_TEST(test_copy_rejects_truncation_and_bad_escapes);
+    RUN_TEST(test_number_conversion_is_strict);
+    RUN_TEST(test_malformed_input_fails);
+    RUN_TEST(test_length_bounds_the_scan);
+    return UNITY_END();
+}
@@ -0,0 +1,129 @@
+#include <string.h>
+#include <unity.h>
+#include "lan_client.h"
+#include "lan_frame.h"
+
+static const char* KEY = "test-lan-key-0123456789";
+static uint8_t frame[LanClient::FRAME_MAX];
+
+void setUp(void) { memset(frame, 0xEE, sizeof(frame)); }
+void tearDown(void) {}
+
+void test_frame_round_trip(void) {
+    const char* body = "{\"action\":\"lock\"}";
+    size_t length = lanBuildFrame(KEY, frame, LanFrameType::command, 0x0102030405060708ull, 0xA0B0C0D0u,
+                                  reinterpret_cast<const uint8_t*>(body), strlen(body));
+    TEST_ASSERT_EQUAL(LAN_FRAME_HEADER_SIZE + strlen(body) + LAN_FRAME_MAC_SIZE, length);
+    TEST_ASSERT_EQUAL_HEX8(LAN_FRAME_MAGIC, frame[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x08, frame[2]);   // little endian
+    TEST_ASSERT_EQUAL_HEX8(0xD0, frame[10]);
+
+    LanFrame parsed;
+    TEST_ASSERT_TRUE(lanParseFrame(frame, length, parsed));
+    TEST_ASSERT_EQUAL(LanFrameType::command, parsed.type);
+    TEST_ASSERT_EQUAL_UINT64(0x0102030405060708ull, parsed.nonce);
+    TEST_ASSERT_EQUAL_UINT32(0xA0B0C0D0u, parsed.seq);
+    TEST_ASSERT_EQUAL(strlen(body), parsed.bodyLength);
+    TEST_ASSERT_EQUAL_MEMORY(body, parsed.body, parsed.bodyLength);
+    TEST_ASSERT_TRUE(lanFrameAuthentic(KEY, frame, length));
+}
+
+void test_known_mac(void) {
+    // RFC 4231 test case 2: HMAC-SHA256("Jefe", "what do ya want for nothing?")
+    static const uint8_t expected[] = {0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24,
+                                       0x26, 0x08, 0x95, 0x75, 0xc7, 0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27,
+                                       0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43};
+    const char* data = "what do ya want for nothing?";
+    uint8_t mac[LAN_FRAME_MAC_SIZE];
+    TEST_ASSERT_TRUE(lanMac("Jefe", reinterpret_cast<const uint8_t*>(data), strlen(data), mac));
+    TEST_ASSERT_EQUAL_MEMORY(expected, mac, sizeof(expected));
+}
+
+void test_tampered_or_wrong_key_rejected(void) {
+    size_t length = lanBuildFrame(KEY, frame, LanFrameType::hello, 0, 0, nullptr, 0);
+    TEST_ASSERT_TRUE(lanFrameAuthentic(KEY, frame, length));
+    TEST_ASSERT_FALSE(lanFrameAuthentic("another-key-0123456789", frame, length));
+
+    frame[5] ^= 0x01;
+    TEST_ASSERT_FALSE(lanFrameAuthentic(KEY, frame, length));
+    frame[5] ^= 0x01;
+    frame[length - 1] ^= 0x80;
+    TEST_ASSERT_FALSE(lanFrameAuthentic(KEY, frame, length));
+}
+
+void test_short_or_foreign_datagram_not_parsed(void) {
+    size_t length = lanBuildFrame(KEY, frame, LanFrameType::hello, 0, 0, nullptr, 0);
+    LanFrame parsed;
+    TEST_ASSERT_FALSE(lanParseFrame(frame, length - 1, parsed));
+    frame[0] = 0x54;
+    TEST_ASSERT_FALSE(lanParseFrame(frame, length, parsed));
+}
+
+// The firmware's side of the handshake, played by hand
+void test_client_handshake(void) {
+    LanClient client(KEY, 41);
+    size_t length = client.hello(frame);
+    LanFrame hello;
+    TEST_ASSERT_TRUE(lanParseFrame(frame, length, hello));
+    TEST_ASSERT_EQUAL(LanFrameType::hello, hello.type);
+    TEST_ASSERT_EQUAL(LAN_CLIENT_NONCE_SIZE, hello.bodyLength);
+    TEST_ASSERT_EQUAL_UINT64(42, lanGetLe(hello.body, LAN_CLIENT_NONCE_SIZE));
+
+    uint8_t body[LAN_CLIENT_NONCE_SIZE + LAN_COOKIE_SIZE];
+    lanPutLe(body, 42, LAN_CLIENT_NONCE_SIZE);
+    memset(body + LAN_CLIENT_NONCE_SIZE, 0xC0, LAN_COOKIE_SIZE);
+    uint8_t datagram[LanClient::FRAME_MAX];
+    length = lanBuildFrame(KEY, datagram, LanFrameType::challenge, 0, 0, body, sizeof(body));
+
+    // The second hello echoes nonce and cookie
+    size_t replyLength = client.receive(datagram, length, frame);
+    TEST_ASSERT_EQUAL(LAN_FRAME_HEADER_SIZE + sizeof(body) + LAN_FRAME_MAC_SIZE, replyLength);
+    TEST_ASSERT_EQUAL_MEMORY(body, frame + LAN_FRAME_HEADER_SIZE, sizeof(body));
+    TEST_ASSERT_FALSE(client.open());
+    TEST_ASSERT_EQUAL(0, client.command("{\"action\":\"lock\"}", frame));
+
+    length = lanBuildFrame(KEY, datagram, LanFrameType::welcome, 0x5E55105E55105E55ull, 0, body,
+                           LAN_CLIENT_NONCE_SIZE);
+    TEST_ASSERT_EQUAL(0, client.receive(datagram, length, frame));
+    TEST_ASSERT_TRUE(client.open());
+
+    LanFrame command;
+    for (uint32_t seq = 1; seq <= 3; seq++) {
+        length = client.command("{\"action\":\"lock\"}", frame);
+        TEST_ASSERT_TRUE(lanParseFrame(frame, length, command));
+        TEST_ASSERT_EQUAL(LanFrameType::command, command.type);
+        TEST_ASSERT_EQUAL_UINT64(0x5E55105E55105E55ull, command.nonce);
+        TEST_ASSERT_EQUAL_UINT32(seq, command.seq);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, client.rejected);
+}
+
+void test_client_rejects_forged_and_foreign_frames(void) {
+    LanClient client(KEY, 7);
+    client.hello(frame);
+
+    uint8_t body[LAN_CLIENT_NONCE_SIZE + LAN_COOKIE_SIZE] = {};
+    lanPutLe(body, 8, LAN_CLIENT_NONCE_SIZE);
+    uint8_t datagram[LanClient::FRAME_MAX];
+    size_t length = lanBuildFrame("wrong-key-0123456789", datagram, LanFrameType::challenge, 0, 0, body,
+                                  sizeof(body));
+    TEST_ASSERT_EQUAL(0, client.receive(datagram, length, frame));
+
+    // A challenge for another client's hello
+    lanPutLe(body, 99, LAN_CLIENT_NONCE_SIZE);
+    length = lanBuildFrame(KEY, datagram, LanFrameType::challenge, 0, 0, body, sizeof(body));
+    TEST_ASSERT_EQUAL(0, client.receive(datagram, length, frame));
+    TEST_ASSERT_EQUAL_UINT32(2, client.rejected);
+    TEST_ASSERT_FALSE(client.open());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_round_trip);
+    RUN_TEST(test_known_mac);
+    RUN_TEST(test_tampered_or_wrong_key_rejected);
+    RUN_TEST(test_short_or_foreign_datagram_not_parsed);
+    RUN_TEST(test_client_handshake);
+    RUN_TEST(test_client_rejects_forged_and_foreign_frames);
+    return UNITY_END();
+}
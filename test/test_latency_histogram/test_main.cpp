@@ -0,0 +1,84 @@
+#include <unity.h>
+#include "latency_histogram.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_histogram_reports_zero(void) {
+    LatencyHistogram histogram;
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.count());
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.percentileUs(50));
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.percentileUs(99));
+}
+
+void test_bounds_are_increasing(void) {
+    for (size_t i = 1; i < LATENCY_BUCKET_COUNT; i++) {
+        TEST_ASSERT_GREATER_THAN_UINT32(LatencyHistogram::bucketBoundUs(i - 1), LatencyHistogram::bucketBoundUs(i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, LatencyHistogram::bucketBoundUs(LATENCY_BUCKET_COUNT));
+}
+
+void test_percentiles_are_bucket_upper_bounds(void) {
+    LatencyHistogram histogram;
+    // 90 fast samples (150 us -> 200 us bucket), 10 slow ones (40 ms -> 50 ms bucket)
+    for (int i = 0; i < 90; i++) histogram.record(150);
+    for (int i = 0; i < 9; i++) histogram.record(40000);
+    histogram.record(45000);
+
+    TEST_ASSERT_EQUAL_UINT32(100, histogram.count());
+    TEST_ASSERT_EQUAL_UINT32(200, histogram.percentileUs(50));
+    TEST_ASSERT_EQUAL_UINT32(200, histogram.percentileUs(90));
+    // Capped at the observed maximum rather than the 50 ms bound
+    TEST_ASSERT_EQUAL_UINT32(45000, histogram.percentileUs(91));
+    TEST_ASSERT_EQUAL_UINT32(45000, histogram.percentileUs(100));
+    TEST_ASSERT_EQUAL_UINT32(45000, histogram.maxUs());
+}
+
+void test_values_on_a_bound_stay_in_that_bucket(void) {
+    LatencyHistogram histogram;
+    histogram.record(500);
+    histogram.record(501);
+    TEST_ASSERT_EQUAL_UINT32(500, histogram.percentileUs(50));
+    TEST_ASSERT_EQUAL_UINT32(501, histogram.percentileUs(100));
+}
+
+void test_percentile_never_underestimates(void) {
+    LatencyHistogram histogram;
+    uint32_t seed = 17;
+    uint32_t values[1000];
+    for (uint32_t& value : values) {
+        seed = seed * 1664525u + 1013904223u;
+        value = (seed >> 8) % 3000000;
+        histogram.record(value);
+    }
+
+    // The reported p95 is at least the true p95
+    uint32_t p95 = histogram.percentileUs(95);
+    size_t atOrBelow = 0;
+    for (uint32_t value : values) {
+        if (value <= p95) atOrBelow++;
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(950, atOrBelow);
+}
+
+void test_overflow_bucket_and_reset(void) {
+    LatencyHistogram histogram;
+    histogram.record(UINT32_MAX - 1);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX - 1, histogram.percentileUs(50));
+
+    histogram.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.count());
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.maxUs());
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.percentileUs(50));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_histogram_reports_zero);
+    RUN_TEST(test_bounds_are_increasing);
+    RUN_TEST(test_percentiles_are_bucket_upper_bounds);
+    RUN_TEST(test_values_on_a_bound_stay_in_that_bucket);
+    RUN_TEST(test_percentile_never_underestimates);
+    RUN_TEST(test_overflow_bucket_and_reset);
+    return UNITY_END();
+}
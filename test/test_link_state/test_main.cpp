@@ -0,0 +1,97 @@
+#include <unity.h>
+#include "link_state.h"
+
+static const uint32_t TIMEOUT_MS = 2000;
+static const uint32_t RETRY_MIN_MS = 1000;
+static const uint32_t RETRY_MAX_MS = 8000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_first_attempt_is_due_at_once(void) {
+    LinkState link(TIMEOUT_MS, RETRY_MIN_MS, RETRY_MAX_MS, 0);
+    TEST_ASSERT_EQUAL(LinkPhase::down, link.phase());
+    TEST_ASSERT_TRUE(link.attemptDue(0));
+    TEST_ASSERT_EQUAL_UINT32(0, link.msUntilNextAction(0));
+}
+
+void test_attempt_times_out(void) {
+    LinkState link(TIMEOUT_MS, RETRY_MIN_MS, RETRY_MAX_MS, 0);
+    link.attemptStarted(100);
+    TEST_ASSERT_FALSE(link.attemptDue(100));
+    TEST_ASSERT_FALSE(link.attemptTimedOut(100 + TIMEOUT_MS - 1));
+    TEST_ASSERT_EQUAL_UINT32(1, link.msUntilNextAction(100 + TIMEOUT_MS - 1));
+    TEST_ASSERT_TRUE(link.attemptTimedOut(100 + TIMEOUT_MS));
+}
+
+void test_failures_back_off_until_connected(void) {
+    LinkState link(TIMEOUT_MS, RETRY_MIN_MS, RETRY_MAX_MS, 0);
+    uint32_t now = 0;
+    const uint32_t delays[] = {1000, 2000, 4000, 8000, 8000};
+
+    for (uint32_t delay : delays) {
+        TEST_ASSERT_TRUE(link.attemptDue(now));
+        link.attemptStarted(now);
+        link.attemptFailed(now, 0);
+        TEST_ASSERT_EQUAL_UINT32(delay, link.lastRetryDelayMs());
+        TEST_ASSERT_FALSE(link.attemptDue(now + delay - 1));
+        TEST_ASSERT_EQUAL_UINT32(delay, link.msUntilNextAction(now));
+        now += delay;
+    }
+    TEST_ASSERT_EQUAL(5, link.failures());
+
+    link.attemptStarted(now);
+    link.connected(now);
+    TEST_ASSERT_EQUAL(LinkPhase::up, link.phase());
+    TEST_ASSERT_EQUAL(0, link.failures());
+    TEST_ASSERT_FALSE(link.attemptDue(now + 100000));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, link.msUntilNextAction(now));
+}
+
+void test_lost_link_retries_quickly(void) {
+    LinkState link(TIMEOUT_MS, RETRY_MIN_MS, RETRY_MAX_MS, 0);
+    for (int i = 0; i < 4; i++) {
+        link.attemptStarted(0);
+        link.attemptFailed(0, 0);
+    }
+    link.attemptStarted(0);
+    link.connected(0);
+
+    link.lost(50000, 0);
+    TEST_ASSERT_EQUAL(LinkPhase::down, link.phase());
+    TEST_ASSERT_EQUAL_UINT32(RETRY_MIN_MS, link.lastRetryDelayMs());
+}
+
+void test_reset_makes_an_attempt_due(void) {
+    LinkState link(TIMEOUT_MS, RETRY_MIN_MS, RETRY_MAX_MS, 0);
+    link.attemptStarted(0);
+    link.attemptFailed(0, 0);
+    link.attemptStarted(1000);
+    link.attemptFailed(1000, 0);
+
+    link.reset(1500);
+    TEST_ASSERT_TRUE(link.attemptDue(1500));
+    TEST_ASSERT_EQUAL(0, link.failures());
+}
+
+void test_retry_time_survives_millis_wrap(void) {
+    LinkState link(TIMEOUT_MS, RETRY_MIN_MS, RETRY_MAX_MS, 0);
+    uint32_t now = UINT32_MAX - 500;
+    link.attemptStarted(now);
+    link.attemptFailed(now, 0);
+
+    TEST_ASSERT_FALSE(link.attemptDue(now + 999));
+    TEST_ASSERT_EQUAL_UINT32(1, link.msUntilNextAction(now + 999));
+    TEST_ASSERT_TRUE(link.attemptDue(now + 1000));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_attempt_is_due_at_once);
+    RUN_TEST(test_attempt_times_out);
+    RUN_TEST(test_failures_back_off_until_connected);
+    RUN_TEST(test_lost_link_retries_quickly);
+    RUN_TEST(test_reset_makes_an_attempt_due);
+    RUN_TEST(test_retry_time_survives_millis_wrap);
+    return UNITY_END();
+}
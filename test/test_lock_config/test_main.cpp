@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "lock_config.h"
+
+// The parsers are constexpr so SESAME_LOCKS is checked by the compiler. The
+// static_asserts pin down what the build accepts; the tests run the same
+// functions at runtime over the edge cases and the configured locks.
+
+static_assert(isHexKey("", 0), "an empty key of size 0");
+static_assert(!isHexKey("0", 1) && !isHexKey("000", 1), "wrong length");
+static_assert(isHexKey("AbCdEf09", 4) && !isHexKey("AbCdEf0 ", 4) && !isHexKey("AbCdEf0:", 4), "digits");
+static_assert(parseHexKey<2>("0a0B")[0] == std::byte{0x0A} && parseHexKey<2>("0a0B")[1] == std::byte{0x0B},
+              "parseHexKey, either case");
+static_assert(!isMacAddress("01:23:45:67:89:ab:") && !isMacAddress("0123:45:67:89:ab:c") &&
+                  !isMacAddress(""),
+              "isMacAddress separators and length");
+static_assert(parseMacAddress("ff:ee:dd:cc:bb:aa") == 0xFFEEDDCCBBAAULL, "parseMacAddress, top octet");
+
+static void hexOf(const std::byte* bytes, size_t size, char* out) {
+    for (size_t i = 0; i < size; i++) {
+        snprintf(out + i * 2, 3, "%02x", static_cast<unsigned>(bytes[i]));
+    }
+}
+
+// Case-insensitive, as the keys may come in either case from the app
+static bool sameHex(const char* a, const char* b) {
+    size_t n = strlen(a);
+    if (n != strlen(b)) return false;
+    for (size_t i = 0; i < n; i++) {
+        char x = a[i] >= 'A' && a[i] <= 'F' ? a[i] - 'A' + 'a' : a[i];
+        char y = b[i] >= 'A' && b[i] <= 'F' ? b[i] - 'A' + 'a' : b[i];
+        if (x != y) return false;
+    }
+    return true;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_hex_keys_at_runtime(void) {
+    char key[] = "00112233445566778899aabbccddeeff";
+    TEST_ASSERT_TRUE(isHexKey(key, 16));
+    TEST_ASSERT_FALSE(isHexKey(key, 15));
+    key[31] = 'g';
+    TEST_ASSERT_FALSE(isHexKey(key, 16));
+    key[31] = 'F';
+    TEST_ASSERT_TRUE(isHexKey(key, 16));
+
+    std::array<std::byte, 16> parsed = parseHexKey<16>(key);
+    for (size_t i = 0; i < 16; i++) {
+        TEST_ASSERT_EQUAL_HEX8(i * 0x11, static_cast<uint8_t>(parsed[i]));
+    }
+}
+
+void test_mac_addresses_at_runtime(void) {
+    TEST_ASSERT_TRUE(isMacAddress("a0:b1:c2:d3:e4:f5"));
+    TEST_ASSERT_TRUE(isMacAddress("A0:B1:C2:D3:E4:F5"));
+    TEST_ASSERT_FALSE(isMacAddress("a0:b1:c2:d3:e4:f"));
+    TEST_ASSERT_FALSE(isMacAddress("a0:b1:c2:d3:e4:f5:"));
+    TEST_ASSERT_FALSE(isMacAddress("a0b1:c2:d3:e4:f5:6"));
+    TEST_ASSERT_FALSE(isMacAddress("a0:b1:c2:d3:e4:fz"));
+    TEST_ASSERT_TRUE(parseMacAddress("a0:b1:c2:d3:e4:f5") == 0xA0B1C2D3E4F5ULL);
+    TEST_ASSERT_TRUE(parseMacAddress("00:00:00:00:00:01") == 1);
+}
+
+void test_secrets_match_the_configured_text(void) {
+    char hex[LOCK_PUBLIC_KEY_SIZE * 2 + 1];
+    for (size_t i = 0; i < lockCount; i++) {
+        TEST_ASSERT_TRUE(lockSecrets[i].address == parseMacAddress(lockConfigs[i].address));
+        hexOf(lockSecrets[i].secret.data(), LOCK_SECRET_SIZE, hex);
+        TEST_ASSERT_TRUE(sameHex(lockConfigs[i].secret, hex));
+        hexOf(lockSecrets[i].publicKey.data(), LOCK_PUBLIC_KEY_SIZE, hex);
+        TEST_ASSERT_TRUE(sameHex(lockConfigs[i].publicKey, hex));
+    }
+}
+
+void test_topics_are_composed_per_lock(void) {
+    char expected[LOCK_TOPIC_SIZE];
+    for (size_t i = 0; i < lockCount; i++) {
+        snprintf(expected, sizeof(expected), "%s/%s/%s", MQTT_TOPIC_PREFIX, lockConfigs[i].id, MQTT_LOCK_TOPIC_COMMAND);
+        TEST_ASSERT_EQUAL_STRING(expected, lockTopics[i].command);
+        snprintf(expected, sizeof(expected), "%s/%s/%s", MQTT_TOPIC_PREFIX, lockConfigs[i].id, MQTT_LOCK_TOPIC_STATUS);
+        TEST_ASSERT_EQUAL_STRING(expected, lockTopics[i].status);
+        snprintf(expected, sizeof(expected), "%s/%s/%s", MQTT_TOPIC_PREFIX, lockConfigs[i].id, MQTT_LOCK_TOPIC_STATUS_REPLY);
+        TEST_ASSERT_EQUAL_STRING(expected, lockTopics[i].statusReply);
+        snprintf(expected, sizeof(expected), "%s/%s/%s", MQTT_TOPIC_PREFIX, lockConfigs[i].id, MQTT_LOCK_TOPIC_RESULT);
+        TEST_ASSERT_EQUAL_STRING(expected, lockTopics[i].result);
+        snprintf(expected, sizeof(expected), "%s/%s/%s", MQTT_TOPIC_PREFIX, lockConfigs[i].id, MQTT_LOCK_TOPIC_HISTORY);
+        TEST_ASSERT_EQUAL_STRING(expected, lockTopics[i].history);
+    }
+}
+
+void test_find_lock_index(void) {
+    TEST_ASSERT_EQUAL(0, findLockIndex(""));
+    for (size_t i = 0; i < lockCount; i++) {
+        TEST_ASSERT_EQUAL(static_cast<int>(i), findLockIndex(lockConfigs[i].id));
+    }
+    TEST_ASSERT_EQUAL(-1, findLockIndex("no-such-lock"));
+
+    // Length-bounded lookups match whole ids only
+    char padded[COMMAND_TARGET_SIZE + 4];
+    snprintf(padded, sizeof(padded), "%sx", lockConfigs[0].id);
+    size_t idLength = strlen(lockConfigs[0].id);
+    TEST_ASSERT_EQUAL(0, findLockIndex(padded, idLength));
+    TEST_ASSERT_EQUAL(-1, findLockIndex(padded, idLength + 1));
+}
+
+void test_match_lock_command_topic(void) {
+    for (size_t i = 0; i < lockCount; i++) {
+        TEST_ASSERT_EQUAL(static_cast<int>(i), matchLockCommandTopic(lockTopics[i].command));
+        TEST_ASSERT_EQUAL(-1, matchLockCommandTopic(lockTopics[i].status));
+    }
+    TEST_ASSERT_EQUAL(-1, matchLockCommandTopic(MQTT_TOPIC_PREFIX "/" MQTT_LOCK_TOPIC_COMMAND));
+    TEST_ASSERT_EQUAL(-1, matchLockCommandTopic(""));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hex_keys_at_runtime);
+    RUN_TEST(test_mac_addresses_at_runtime);
+    RUN_TEST(test_secrets_match_the_configured_text);
+    RUN_TEST(test_topics_are_composed_per_lock);
+    RUN_TEST(test_find_lock_index);
+    RUN_TEST(test_match_lock_command_topic);
+    return UNITY_END();
+}
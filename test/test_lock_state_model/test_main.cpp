@@ -0,0 +1,187 @@
+#include <unity.h>
+#include "lock_state_model.h"
+
+// Thumbturn end positions for the tests; the model learns them from status
+static const int16_t LOCKED_AT = 300;
+static const int16_t UNLOCKED_AT = -100;
+
+static void settle(LockStateModel& model, bool locked, int16_t position) {
+    model.observed(locked, !locked, position, true);
+}
+
+// Both ends learned, then left settled in the given state
+static LockStateModel learned(bool locked) {
+    LockStateModel model;
+    settle(model, !locked, locked ? UNLOCKED_AT : LOCKED_AT);
+    settle(model, locked, locked ? LOCKED_AT : UNLOCKED_AT);
+    return model;
+}
+
+// A status from between the ends: neither locked nor unlocked
+static void turning(LockStateModel& model, int16_t position) {
+    model.observed(false, false, position, true);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_unknown_until_the_lock_reports(void) {
+    LockStateModel model;
+    TEST_ASSERT_EQUAL(LockState::unknown, model.predicted());
+    TEST_ASSERT_EQUAL(CommandAction::unlock, model.toggleAction());
+}
+
+void test_settled_status_is_the_prediction(void) {
+    LockStateModel model;
+    model.observed(true, false, 0, false);
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+    TEST_ASSERT_EQUAL(CommandAction::unlock, model.toggleAction());
+
+    model.observed(false, true, 0, false);
+    TEST_ASSERT_EQUAL(LockState::unlocked, model.predicted());
+    TEST_ASSERT_EQUAL(CommandAction::lock, model.toggleAction());
+}
+
+void test_pending_command_wins_over_the_reported_state(void) {
+    LockStateModel model = learned(true);
+    model.commanded(CommandAction::unlock);
+    TEST_ASSERT_EQUAL(LockState::unlocked, model.predicted());
+
+    // Still locked on the next status: the unlock has not happened yet
+    settle(model, true, LOCKED_AT);
+    TEST_ASSERT_EQUAL(LockState::unlocked, model.predicted());
+
+    settle(model, false, UNLOCKED_AT);
+    TEST_ASSERT_EQUAL(LockState::unlocked, model.predicted());
+    TEST_ASSERT_FALSE(model.finished(CommandAction::unlock, CommandOutcome::confirmed));
+    TEST_ASSERT_EQUAL(LockState::unlocked, model.predicted());
+}
+
+void test_rapid_toggles_alternate_without_a_status(void) {
+    LockStateModel model = learned(true);
+    CommandAction expected[] = {CommandAction::unlock, CommandAction::lock, CommandAction::unlock, CommandAction::lock};
+
+    for (CommandAction action : expected) {
+        TEST_ASSERT_EQUAL(action, model.toggleAction());
+        model.commanded(model.toggleAction());
+    }
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+}
+
+void test_only_lock_and_unlock_set_a_target(void) {
+    LockStateModel model = learned(true);
+    model.commanded(CommandAction::toggle);
+    model.commanded(CommandAction::none);
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+}
+
+void test_timeout_against_the_settled_state_is_a_mismatch(void) {
+    LockStateModel model = learned(true);
+    model.commanded(CommandAction::unlock);
+
+    // Jammed: the lock stays locked and the unlock times out
+    settle(model, true, LOCKED_AT);
+    TEST_ASSERT_TRUE(model.finished(CommandAction::unlock, CommandOutcome::timeout));
+    TEST_ASSERT_EQUAL(1, model.mismatches());
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+    TEST_ASSERT_EQUAL(CommandAction::unlock, model.toggleAction());
+}
+
+void test_timeout_is_not_a_mismatch_when_the_lock_got_there(void) {
+    LockStateModel model = learned(true);
+    model.commanded(CommandAction::unlock);
+    settle(model, false, UNLOCKED_AT);
+    TEST_ASSERT_FALSE(model.finished(CommandAction::unlock, CommandOutcome::timeout));
+    TEST_ASSERT_EQUAL(0, model.mismatches());
+}
+
+void test_timeout_is_not_a_mismatch_while_unsettled(void) {
+    LockStateModel model = learned(true);
+    model.commanded(CommandAction::unlock);
+    turning(model, 200);
+    TEST_ASSERT_FALSE(model.finished(CommandAction::unlock, CommandOutcome::timeout));
+    TEST_ASSERT_EQUAL(0, model.mismatches());
+}
+
+void test_superseded_and_stale_results_keep_the_newer_target(void) {
+    LockStateModel model = learned(true);
+    model.commanded(CommandAction::unlock);
+    model.commanded(CommandAction::lock);
+
+    // The unlock was replaced; its result says nothing about the lock
+    TEST_ASSERT_FALSE(model.finished(CommandAction::unlock, CommandOutcome::superseded));
+    TEST_ASSERT_FALSE(model.finished(CommandAction::unlock, CommandOutcome::timeout));
+    TEST_ASSERT_FALSE(model.finished(CommandAction::lock, CommandOutcome::duplicate));
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+    TEST_ASSERT_EQUAL(CommandAction::unlock, model.toggleAction());
+    TEST_ASSERT_EQUAL(0, model.mismatches());
+}
+
+void test_expired_command_clears_the_target(void) {
+    LockStateModel model = learned(true);
+    model.commanded(CommandAction::unlock);
+    TEST_ASSERT_FALSE(model.finished(CommandAction::unlock, CommandOutcome::expired));
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+}
+
+void test_moving_thumbturn_predicts_the_end_it_heads_for(void) {
+    LockStateModel model = learned(true);
+
+    // Turned by hand from locked towards unlocked
+    turning(model, 250);
+    turning(model, 150);
+    TEST_ASSERT_EQUAL(LockState::unlocked, model.predicted());
+    TEST_ASSERT_EQUAL(CommandAction::lock, model.toggleAction());
+
+    // And back again
+    turning(model, 200);
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+}
+
+void test_stopped_thumbturn_predicts_the_nearer_end(void) {
+    LockStateModel model = learned(false);
+    turning(model, 250);
+    turning(model, 250);
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+
+    turning(model, -50);
+    turning(model, -50);
+    TEST_ASSERT_EQUAL(LockState::unlocked, model.predicted());
+}
+
+void test_unsettled_without_learned_ends_keeps_the_last_report(void) {
+    LockStateModel model;
+    settle(model, true, LOCKED_AT);
+    turning(model, 100);
+    turning(model, 0);
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+
+    // No position at all, as from an advert
+    model.observed(false, false, 0, false);
+    TEST_ASSERT_EQUAL(LockState::locked, model.predicted());
+}
+
+void test_state_names(void) {
+    TEST_ASSERT_EQUAL_STRING("locked", lockStateName(LockState::locked));
+    TEST_ASSERT_EQUAL_STRING("unlocked", lockStateName(LockState::unlocked));
+    TEST_ASSERT_EQUAL_STRING("unknown", lockStateName(LockState::unknown));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unknown_until_the_lock_reports);
+    RUN_TEST(test_settled_status_is_the_prediction);
+    RUN_TEST(test_pending_command_wins_over_the_reported_state);
+    RUN_TEST(test_rapid_toggles_alternate_without_a_status);
+    RUN_TEST(test_only_lock_and_unlock_set_a_target);
+    RUN_TEST(test_timeout_against_the_settled_state_is_a_mismatch);
+    RUN_TEST(test_timeout_is_not_a_mismatch_when_the_lock_got_there);
+    RUN_TEST(test_timeout_is_not_a_mismatch_while_unsettled);
+    RUN_TEST(test_superseded_and_stale_results_keep_the_newer_target);
+    RUN_TEST(test_expired_command_clears_the_target);
+    RUN_TEST(test_moving_thumbturn_predicts_the_end_it_heads_for);
+    RUN_TEST(test_stopped_thumbturn_predicts_the_nearer_end);
+    RUN_TEST(test_unsettled_without_learned_ends_keeps_the_last_report);
+    RUN_TEST(test_state_names);
+    return UNITY_END();
+}
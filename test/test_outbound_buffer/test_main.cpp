@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "outbound_buffer.h"
+
+// In-memory stand-in for LittleFsSpill
+class FakeSpill : public OutboundSpill {
+public:
+    static const size_t SLOTS = 16;
+
+    explicit FakeSpill(size_t maxBytes) : maxBytes(maxBytes), first(0), count(0), used(0), corruptFront(false) {}
+
+    bool append(const uint8_t* data, size_t length) override {
+        if (count == SLOTS || used + length > maxBytes) return false;
+        Slot& slot = slots[(first + count) % SLOTS];
+        memcpy(slot.data, data, length);
+        slot.length = length;
+        count++;
+        used += length;
+        return true;
+    }
+
+    bool readFront(uint8_t* data, size_t capacity, size_t& length) override {
+        if (count == 0 || corruptFront) return false;
+        const Slot& slot = slots[first];
+        if (slot.length > capacity) return false;
+        memcpy(data, slot.data, slot.length);
+        length = slot.length;
+        return true;
+    }
+
+    void popFront() override {
+        if (count == 0) return;
+        used -= slots[first].length;
+        first = (first + 1) % SLOTS;
+        count--;
+        corruptFront = false;
+    }
+
+    size_t records() const override { return count; }
+    size_t bytes() const override { return used; }
+
+    size_t maxBytes;
+    size_t first;
+    size_t count;
+    size_t used;
+    bool corruptFront;
+
+private:
+    struct Slot {
+        uint8_t data[OUTBOUND_RECORD_MAX];
+        size_t length;
+    };
+    Slot slots[SLOTS];
+};
+
+static uint8_t storage[256];
+
+static bool pushText(OutboundBuffer& buffer, const char* topic, const char* payload, uint32_t queuedMs = 0) {
+    return buffer.push(topic, reinterpret_cast<const uint8_t*>(payload), strlen(payload), queuedMs);
+}
+
+// Peek and pop the oldest message; its payload as text
+static const char* popText(OutboundBuffer& buffer) {
+    static char topic[OUTBOUND_TOPIC_SIZE];
+    static uint8_t payload[OUTBOUND_PAYLOAD_SIZE + 1];
+    size_t length;
+    uint32_t queuedMs;
+    if (!buffer.peek(topic, sizeof(topic), payload, sizeof(payload), length, queuedMs)) {
+        return nullptr;
+    }
+    buffer.pop();
+    return reinterpret_cast<const char*>(payload);
+}
+
+void setUp(void) {
+    memset(storage, 0, sizeof(storage));
+}
+
+void tearDown(void) {}
+
+void test_messages_come_back_in_order_with_their_fields(void) {
+    OutboundBuffer buffer(storage, sizeof(storage), nullptr);
+    TEST_ASSERT_TRUE(pushText(buffer, "sesame/door/status", "{\"locked\":true}", 1234));
+
+    char topic[OUTBOUND_TOPIC_SIZE];
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE + 1];
+    size_t length;
+    uint32_t queuedMs;
+    TEST_ASSERT_TRUE(buffer.peek(topic, sizeof(topic), payload, sizeof(payload), length, queuedMs));
+    TEST_ASSERT_EQUAL_STRING("sesame/door/status", topic);
+    TEST_ASSERT_EQUAL_STRING("{\"locked\":true}", reinterpret_cast<const char*>(payload));
+    TEST_ASSERT_EQUAL(15, length);
+    TEST_ASSERT_EQUAL_UINT32(1234, queuedMs);
+
+    // Peek leaves the message in place for a retry
+    TEST_ASSERT_EQUAL(1, buffer.count());
+    buffer.pop();
+    TEST_ASSERT_TRUE(buffer.empty());
+}
+
+void test_ring_wraps_without_reordering(void) {
+    OutboundBuffer buffer(storage, sizeof(storage), nullptr);
+    char payload[32];
+    int next = 0;
+
+    for (int round = 0; round < 50; round++) {
+        while (true) {
+            snprintf(payload, sizeof(payload), "message-%d", next);
+            if (!pushText(buffer, "t", payload)) break;
+            next++;
+        }
+        // Drain half, so the next round wraps around the end of the storage
+        size_t drain = buffer.count() / 2 + 1;
+        for (size_t i = 0; i < drain; i++) popText(buffer);
+    }
+
+    int expected = next - static_cast<int>(buffer.count());
+    while (!buffer.empty()) {
+        snprintf(payload, sizeof(payload), "message-%d", expected++);
+        TEST_ASSERT_EQUAL_STRING(payload, popText(buffer));
+    }
+}
+
+void test_overflow_goes_to_the_spill_and_keeps_order(void) {
+    FakeSpill spill(4096);
+    OutboundBuffer buffer(storage, sizeof(storage), &spill);
+    char payload[64];
+
+    int pushed = 0;
+    while (spill.records() < 3) {
+        snprintf(payload, sizeof(payload), "{\"n\":%d,\"pad\":\"................\"}", pushed++);
+        TEST_ASSERT_TRUE(pushText(buffer, "sesame/x", payload));
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, buffer.stats().spilled);
+
+    // RAM frees up, but newer messages still queue behind the spilled ones
+    popText(buffer);
+    snprintf(payload, sizeof(payload), "{\"n\":%d,\"pad\":\"................\"}", pushed++);
+    pushText(buffer, "sesame/x", payload);
+    TEST_ASSERT_EQUAL_UINT32(4, buffer.stats().spilled);
+
+    for (int n = 1; n < pushed; n++) {
+        snprintf(payload, sizeof(payload), "{\"n\":%d,\"pad\":\"................\"}", n);
+        TEST_ASSERT_EQUAL_STRING(payload, popText(buffer));
+    }
+    TEST_ASSERT_TRUE(buffer.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, buffer.stats().dropped);
+}
+
+void test_full_buffer_and_oversized_messages_are_dropped(void) {
+    FakeSpill spill(200);
+    OutboundBuffer buffer(storage, sizeof(storage), &spill);
+
+    static char large[OUTBOUND_PAYLOAD_SIZE + 1];
+    memset(large, 'x', OUTBOUND_PAYLOAD_SIZE);
+    large[OUTBOUND_PAYLOAD_SIZE] = '\0';
+    TEST_ASSERT_FALSE(pushText(buffer, "t", large));
+
+    char topic[OUTBOUND_TOPIC_SIZE + 1];
+    memset(topic, 't', OUTBOUND_TOPIC_SIZE);
+    topic[OUTBOUND_TOPIC_SIZE] = '\0';
+    TEST_ASSERT_FALSE(pushText(buffer, topic, "{}"));
+    TEST_ASSERT_EQUAL_UINT32(2, buffer.stats().dropped);
+
+    int accepted = 0;
+    while (pushText(buffer, "t", "{\"pad\":\"............................\"}")) accepted++;
+    TEST_ASSERT_GREATER_THAN(0, accepted);
+    TEST_ASSERT_EQUAL_UINT32(3, buffer.stats().dropped);
+    TEST_ASSERT_EQUAL_UINT32(accepted, buffer.stats().buffered);
+}
+
+void test_corrupt_spill_record_is_skipped(void) {
+    FakeSpill spill(4096);
+    OutboundBuffer buffer(nullptr, 0, &spill);
+    pushText(buffer, "t", "first");
+    pushText(buffer, "t", "second");
+
+    spill.corruptFront = true;
+    TEST_ASSERT_NULL(popText(buffer));
+    TEST_ASSERT_EQUAL_UINT32(1, buffer.stats().dropped);
+    TEST_ASSERT_EQUAL_STRING("second", popText(buffer));
+}
+
+void test_refused_message_is_skipped_after_max_attempts(void) {
+    OutboundBuffer buffer(storage, sizeof(storage), nullptr);
+    pushText(buffer, "t", "poison");
+    pushText(buffer, "t", "next");
+
+    TEST_ASSERT_FALSE(buffer.frontFailed(3));
+    TEST_ASSERT_FALSE(buffer.frontFailed(3));
+    TEST_ASSERT_EQUAL(2, buffer.count());
+    TEST_ASSERT_TRUE(buffer.frontFailed(3));
+    TEST_ASSERT_EQUAL(1, buffer.count());
+    TEST_ASSERT_EQUAL_UINT32(1, buffer.stats().skipped);
+
+    // The next message starts with a clean slate
+    TEST_ASSERT_FALSE(buffer.frontFailed(3));
+    TEST_ASSERT_FALSE(buffer.frontFailed(3));
+    TEST_ASSERT_EQUAL_STRING("next", popText(buffer));
+    TEST_ASSERT_FALSE(buffer.frontFailed(3));
+    TEST_ASSERT_EQUAL_UINT32(1, buffer.stats().skipped);
+}
+
+void test_successful_publish_resets_the_attempts(void) {
+    OutboundBuffer buffer(storage, sizeof(storage), nullptr);
+    pushText(buffer, "t", "a");
+    pushText(buffer, "t", "b");
+
+    buffer.frontFailed(3);
+    buffer.frontFailed(3);
+    popText(buffer);
+    TEST_ASSERT_FALSE(buffer.frontFailed(3));
+    TEST_ASSERT_EQUAL(1, buffer.count());
+}
+
+void test_high_water_marks(void) {
+    FakeSpill spill(4096);
+    OutboundBuffer buffer(storage, sizeof(storage), &spill);
+    while (spill.records() == 0) pushText(buffer, "t", "{\"pad\":\"..........\"}");
+
+    TEST_ASSERT_GREATER_THAN(sizeof(storage) / 2, buffer.stats().ramHighWater);
+    TEST_ASSERT_EQUAL(spill.bytes(), buffer.stats().spillHighWater);
+
+    while (!buffer.empty()) popText(buffer);
+    buffer.resetHighWater();
+    TEST_ASSERT_EQUAL(0, buffer.stats().ramHighWater);
+    TEST_ASSERT_EQUAL(0, buffer.stats().spillHighWater);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_messages_come_back_in_order_with_their_fields);
+    RUN_TEST(test_ring_wraps_without_reordering);
+    RUN_TEST(test_overflow_goes_to_the_spill_and_keeps_order);
+    RUN_TEST(test_full_buffer_and_oversized_messages_are_dropped);
+    RUN_TEST(test_corrupt_spill_record_is_skipped);
+    RUN_TEST(test_refused_message_is_skipped_after_max_attempts);
+    RUN_TEST(test_successful_publish_resets_the_attempts);
+    RUN_TEST(test_high_water_marks);
+    return UNITY_END();
+}
@@ -0,0 +1,181 @@
+#include <unity.h>
+#include "power_policy.h"
+
+static PowerPolicyConfig makeConfig(PowerProfile profile, uint32_t budgetMs = 300) {
+    PowerPolicyConfig config;
+    config.profile = profile;
+    config.latencyBudgetMs = budgetMs;
+    config.activeHoldMs = 30000;
+    config.rssiTarget = -70;
+    config.scanIntervalMs = 100;
+    config.scanWindowMs = 30;
+    config.wifiMustSleep = false;
+    return config;
+}
+
+static PowerInputs idle(uint32_t msSinceActivity = 60000) {
+    PowerInputs inputs;
+    inputs.msSinceActivity = msSinceActivity;
+    inputs.rssiKnown = false;
+    inputs.weakestRssi = 0;
+    return inputs;
+}
+
+static PowerInputs heardAt(int8_t rssi) {
+    PowerInputs inputs = idle();
+    inputs.rssiKnown = true;
+    inputs.weakestRssi = rssi;
+    return inputs;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_performance_keeps_everything_on(void) {
+    PowerPolicyConfig config = makeConfig(PowerProfile::performance);
+    PowerSettings settings = choosePowerSettings(config, heardAt(-40));
+    TEST_ASSERT_EQUAL(WifiSleep::none, settings.wifiSleep);
+    TEST_ASSERT_FALSE(settings.lightSleep);
+    TEST_ASSERT_EQUAL(POWER_MQTT_POLL_MIN_MS, settings.mqttPollMs);
+    TEST_ASSERT_EQUAL(POWER_BLE_TX_MAX_DBM, settings.bleTxDbm);
+    TEST_ASSERT_EQUAL(100, settings.scanIntervalMs);
+    TEST_ASSERT_EQUAL(POWER_MQTT_POLL_MIN_MS, settings.worstLatencyMs);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, msUntilPowerChange(config, idle(0)));
+}
+
+void test_coexistence_keeps_modem_sleep_even_for_performance(void) {
+    PowerPolicyConfig config = makeConfig(PowerProfile::performance);
+    config.wifiMustSleep = true;
+    PowerSettings settings = choosePowerSettings(config, idle());
+    TEST_ASSERT_EQUAL(WifiSleep::minModem, settings.wifiSleep);
+    TEST_ASSERT_EQUAL(POWER_BEACON_INTERVAL_MS + POWER_MQTT_POLL_MIN_MS, settings.worstLatencyMs);
+}
+
+void test_balanced_idle_saves_within_the_budget(void) {
+    PowerSettings settings = choosePowerSettings(makeConfig(PowerProfile::balanced), idle());
+    TEST_ASSERT_EQUAL(WifiSleep::minModem, settings.wifiSleep);
+    TEST_ASSERT_TRUE(settings.lightSleep);
+    TEST_ASSERT_EQUAL(POWER_MQTT_POLL_MAX_MS / 2, settings.mqttPollMs);
+    TEST_ASSERT_EQUAL(300, settings.scanIntervalMs);
+    TEST_ASSERT_EQUAL(30, settings.scanWindowMs);
+    TEST_ASSERT_EQUAL(POWER_BEACON_INTERVAL_MS + POWER_MQTT_POLL_MAX_MS / 2, settings.worstLatencyMs);
+}
+
+void test_low_power_gives_back_poll_time_before_sleep_depth(void) {
+    // max modem (309 ms) + 200 ms poll does not fit 400 ms: the poll shrinks first
+    PowerSettings settings = choosePowerSettings(makeConfig(PowerProfile::lowPower, 400), idle());
+    TEST_ASSERT_EQUAL(WifiSleep::maxModem, settings.wifiSleep);
+    TEST_ASSERT_EQUAL(400 - POWER_BEACON_INTERVAL_MS * POWER_LISTEN_INTERVAL_BEACONS, settings.mqttPollMs);
+    TEST_ASSERT_EQUAL(400, settings.worstLatencyMs);
+    TEST_ASSERT_EQUAL(1000, settings.scanIntervalMs);
+
+    // Below max modem plus the shortest poll it drops to min modem
+    settings = choosePowerSettings(makeConfig(PowerProfile::lowPower, 300), idle());
+    TEST_ASSERT_EQUAL(WifiSleep::minModem, settings.wifiSleep);
+    TEST_ASSERT_EQUAL(300 - POWER_BEACON_INTERVAL_MS, settings.mqttPollMs);
+    TEST_ASSERT_TRUE(settings.lightSleep);
+}
+
+void test_tight_budget_turns_the_network_savings_off(void) {
+    PowerSettings settings = choosePowerSettings(makeConfig(PowerProfile::lowPower, 0), idle());
+    TEST_ASSERT_EQUAL(WifiSleep::none, settings.wifiSleep);
+    TEST_ASSERT_EQUAL(POWER_MQTT_POLL_MIN_MS, settings.mqttPollMs);
+    // The light sleep wake is shorter than the fastest poll, so it costs nothing
+    TEST_ASSERT_TRUE(settings.lightSleep);
+    TEST_ASSERT_EQUAL(POWER_MQTT_POLL_MIN_MS, settings.worstLatencyMs);
+}
+
+void test_budget_always_holds(void) {
+    PowerProfile profiles[] = {PowerProfile::balanced, PowerProfile::lowPower};
+    for (PowerProfile profile : profiles) {
+        for (int mustSleep = 0; mustSleep < 2; mustSleep++) {
+            for (uint32_t budget = 0; budget <= 600; budget += 7) {
+                for (uint32_t since = 0; since <= 60000; since += 15000) {
+                    PowerPolicyConfig config = makeConfig(profile, budget);
+                    config.wifiMustSleep = mustSleep != 0;
+                    PowerSettings settings = choosePowerSettings(config, idle(since));
+                    uint32_t floor = mustSleep ? POWER_BEACON_INTERVAL_MS + POWER_MQTT_POLL_MIN_MS : POWER_MQTT_POLL_MIN_MS;
+                    uint32_t limit = budget > floor ? budget : floor;
+                    TEST_ASSERT_EQUAL(powerLatencyMs(settings), settings.worstLatencyMs);
+                    TEST_ASSERT_TRUE(settings.worstLatencyMs <= limit);
+                    TEST_ASSERT_TRUE(settings.mqttPollMs >= POWER_MQTT_POLL_MIN_MS);
+                }
+            }
+        }
+    }
+}
+
+void test_tx_power_steps_down_with_margin(void) {
+    PowerPolicyConfig config = makeConfig(PowerProfile::balanced);
+    TEST_ASSERT_EQUAL(POWER_BLE_TX_MAX_DBM, choosePowerSettings(config, idle()).bleTxDbm);
+    TEST_ASSERT_EQUAL(POWER_BLE_TX_MAX_DBM, choosePowerSettings(config, heardAt(-80)).bleTxDbm);
+    TEST_ASSERT_EQUAL(POWER_BLE_TX_MAX_DBM, choosePowerSettings(config, heardAt(-68)).bleTxDbm);
+    TEST_ASSERT_EQUAL(POWER_BLE_TX_MAX_DBM - 3, choosePowerSettings(config, heardAt(-67)).bleTxDbm);
+    TEST_ASSERT_EQUAL(POWER_BLE_TX_MAX_DBM - 6, choosePowerSettings(config, heardAt(-62)).bleTxDbm);
+    TEST_ASSERT_EQUAL(POWER_BLE_TX_MIN_DBM, choosePowerSettings(config, heardAt(-20)).bleTxDbm);
+}
+
+// Walk a day of simulated time, jumping between activity and the end of the
+// hold the way the power task does with msUntilPowerChange
+void test_simulated_clock_follows_activity(void) {
+    PowerPolicyConfig config = makeConfig(PowerProfile::balanced);
+    const uint32_t activityMs[] = {1000, 5000, 50000, 50100, 3600000};
+    const size_t activityCount = sizeof(activityMs) / sizeof(activityMs[0]);
+
+    uint32_t now = 0;
+    uint32_t lastActivity = 0;
+    size_t next = 0;
+    uint32_t wakeups = 0;
+    uint32_t idleMs = 0;
+    while (now < 86400000UL) {
+        PowerInputs inputs = idle(now - lastActivity);
+        PowerSettings settings = choosePowerSettings(config, inputs);
+        bool holding = inputs.msSinceActivity < config.activeHoldMs;
+
+        // Full speed polling only during the hold
+        TEST_ASSERT_EQUAL(holding ? POWER_MQTT_POLL_MIN_MS : POWER_MQTT_POLL_MAX_MS / 2, settings.mqttPollMs);
+        TEST_ASSERT_TRUE(settings.worstLatencyMs <= config.latencyBudgetMs);
+
+        uint32_t change = msUntilPowerChange(config, inputs);
+        TEST_ASSERT_EQUAL_UINT32(holding ? config.activeHoldMs - inputs.msSinceActivity : UINT32_MAX, change);
+
+        uint32_t untilActivity = next < activityCount ? activityMs[next] - now : 86400000UL - now;
+        uint32_t step = change < untilActivity ? change : untilActivity;
+        if (!holding) {
+            idleMs += step;
+        }
+        now += step;
+        if (next < activityCount && now == activityMs[next]) {
+            lastActivity = now;
+            next++;
+        }
+        wakeups++;
+    }
+
+    // One evaluation per activity and per end of hold, the hold restarting on
+    // activity that arrives during it
+    TEST_ASSERT_EQUAL(next, activityCount);
+    TEST_ASSERT_TRUE(wakeups <= 2 * activityCount + 2);
+    // Idle between the holds: 35 s to 50 s, 80.1 s to 1 h, 1 h 30 s to the end
+    TEST_ASSERT_EQUAL_UINT32((50000 - 35000) + (3600000 - 80100) + (86400000UL - 3630000), idleMs);
+}
+
+void test_profile_names(void) {
+    TEST_ASSERT_EQUAL_STRING("performance", powerProfileName(PowerProfile::performance));
+    TEST_ASSERT_EQUAL_STRING("balanced", powerProfileName(PowerProfile::balanced));
+    TEST_ASSERT_EQUAL_STRING("low_power", powerProfileName(PowerProfile::lowPower));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_performance_keeps_everything_on);
+    RUN_TEST(test_coexistence_keeps_modem_sleep_even_for_performance);
+    RUN_TEST(test_balanced_idle_saves_within_the_budget);
+    RUN_TEST(test_low_power_gives_back_poll_time_before_sleep_depth);
+    RUN_TEST(test_tight_budget_turns_the_network_savings_off);
+    RUN_TEST(test_budget_always_holds);
+    RUN_TEST(test_tx_power_steps_down_with_margin);
+    RUN_TEST(test_simulated_clock_follows_activity);
+    RUN_TEST(test_profile_names);
+    return UNITY_END();
+}
@@ -0,0 +1,235 @@
+#include <unity.h>
+#include "rf_decoder.h"
+
+// Edge traces are synthesized from the EV1527/PT2262 timing (see
+// rf_decoder.h), with per-edge jitter from a fixed-seed generator so a
+// failing case replays exactly.
+
+static const uint32_t MIN_PULSE_US = 100;
+static const uint8_t TOLERANCE_PCT = 35;
+
+struct Trace {
+    uint32_t nowUs;
+    uint32_t seed;
+    uint32_t jitterUs;
+    RfDecoder* decoder;
+    RfCode last;
+    int codes;
+
+    void edgeAfter(uint32_t durationUs) {
+        if (jitterUs > 0) {
+            seed = seed * 1664525u + 1013904223u;
+            int32_t span = static_cast<int32_t>(jitterUs);
+            int32_t offset = static_cast<int32_t>((seed >> 8) % (2 * span + 1)) - span;
+            durationUs = static_cast<uint32_t>(static_cast<int32_t>(durationUs) + offset);
+        }
+        nowUs += durationUs;
+        if (decoder->feedEdge(nowUs, last)) {
+            codes++;
+        }
+    }
+
+    // One frame: data bits MSB first, then the sync high and low
+    void frame(uint32_t code, uint8_t bits, uint32_t pulseUs, uint8_t syncLow = 31) {
+        for (int bit = bits - 1; bit >= 0; bit--) {
+            bool one = (code >> bit) & 1;
+            edgeAfter((one ? 3 : 1) * pulseUs);
+            edgeAfter((one ? 1 : 3) * pulseUs);
+        }
+        edgeAfter(pulseUs);
+        edgeAfter(syncLow * pulseUs);
+    }
+
+    // A press: the leading sync, then the frame repeated
+    void press(uint32_t code, uint8_t bits, uint32_t pulseUs, int frames, uint8_t syncLow = 31) {
+        edgeAfter(syncLow * pulseUs);
+        for (int i = 0; i < frames; i++) {
+            frame(code, bits, pulseUs, syncLow);
+        }
+    }
+};
+
+static Trace traceFor(RfDecoder& decoder, uint32_t jitterUs = 0) {
+    Trace trace = {};
+    trace.nowUs = 1000;
+    trace.seed = 12345;
+    trace.jitterUs = jitterUs;
+    trace.decoder = &decoder;
+    RfCode first;
+    decoder.feedEdge(trace.nowUs, first);
+    return trace;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_clean_press_decodes_once(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    trace.press(0xA5C3F1, 24, 350, 6);
+
+    TEST_ASSERT_EQUAL(1, trace.codes);
+    TEST_ASSERT_EQUAL_HEX32(0xA5C3F1, trace.last.code);
+    TEST_ASSERT_EQUAL(24, trace.last.bits);
+    TEST_ASSERT_EQUAL(1, trace.last.protocol);
+    TEST_ASSERT_UINT32_WITHIN(5, 350, trace.last.pulseUs);
+    TEST_ASSERT_EQUAL(6, decoder.stats().frames);
+    TEST_ASSERT_EQUAL(0, decoder.stats().rejected);
+}
+
+void test_single_frame_is_not_enough(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    trace.press(0x123456, 24, 350, 1);
+    TEST_ASSERT_EQUAL(0, trace.codes);
+
+    // The same code as a separate press much later still needs its own repeats
+    trace.nowUs += RF_REPEAT_WINDOW_US * 2;
+    trace.press(0x123456, 24, 350, 1);
+    TEST_ASSERT_EQUAL(0, trace.codes);
+}
+
+void test_jitter_and_oscillator_drift(void) {
+    const uint32_t pulses[] = {250, 350, 480};
+    for (uint32_t pulseUs : pulses) {
+        RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+        Trace trace = traceFor(decoder, 60);
+        trace.press(0x5A5A51, 24, pulseUs, 4);
+        TEST_ASSERT_EQUAL(1, trace.codes);
+        TEST_ASSERT_EQUAL_HEX32(0x5A5A51, trace.last.code);
+    }
+}
+
+void test_short_sync_protocol(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    trace.press(0x0F0F, 16, 400, 3, 10);
+
+    TEST_ASSERT_EQUAL(1, trace.codes);
+    TEST_ASSERT_EQUAL_HEX32(0x0F0F, trace.last.code);
+    TEST_ASSERT_EQUAL(16, trace.last.bits);
+    TEST_ASSERT_EQUAL(2, trace.last.protocol);
+}
+
+void test_glitch_drops_only_its_frame(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    trace.edgeAfter(31 * 350);
+    trace.frame(0xABCDEF, 24, 350);
+    // A 40 us spike in the middle of the second frame
+    trace.edgeAfter(350);
+    trace.edgeAfter(40);
+    trace.edgeAfter(1010);
+    for (int i = 0; i < 22; i++) trace.edgeAfter(700);
+    trace.edgeAfter(31 * 350);
+    TEST_ASSERT_EQUAL(0, trace.codes);
+    TEST_ASSERT_EQUAL(1, decoder.stats().rejected);
+
+    trace.frame(0xABCDEF, 24, 350);
+    TEST_ASSERT_EQUAL(1, trace.codes);
+}
+
+void test_different_codes_do_not_confirm_each_other(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    trace.edgeAfter(31 * 350);
+    trace.frame(0x111111, 24, 350);
+    trace.frame(0x222222, 24, 350);
+    trace.frame(0x111111, 24, 350);
+    TEST_ASSERT_EQUAL(0, trace.codes);
+}
+
+void test_noise_is_rejected(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    uint32_t seed = 99;
+    for (int i = 0; i < 50000; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        // Mostly short pulses with the occasional gap long enough to close a "frame"
+        trace.edgeAfter((seed >> 24) < 8 ? 5000 + (seed & 0x3FFF) : 50 + ((seed >> 8) & 0x7FF));
+    }
+
+    TEST_ASSERT_EQUAL(0, trace.codes);
+    TEST_ASSERT_GREATER_THAN(0, decoder.stats().rejected);
+}
+
+void test_reset_clears_partial_state(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    trace.press(0x777777, 24, 350, 1);
+    decoder.reset();
+    TEST_ASSERT_EQUAL(0, decoder.stats().edges);
+
+    RfCode code;
+    decoder.feedEdge(trace.nowUs, code);
+    trace.frame(0x777777, 24, 350);
+    TEST_ASSERT_EQUAL(0, trace.codes);
+}
+
+// The whitelist matches on code, bits and protocol: the same number sent
+// with the other sync length or frame length must not look alike
+void test_same_number_differs_by_protocol_and_bits(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    trace.press(0x0F0F, 24, 400, 3);
+    RfCode longSync = trace.last;
+    trace.edgeAfter(RF_REPEAT_WINDOW_US);
+    trace.press(0x0F0F, 24, 400, 3, 10);
+    RfCode shortSync = trace.last;
+    trace.edgeAfter(RF_REPEAT_WINDOW_US);
+    trace.press(0x0F0F, 16, 400, 3);
+    RfCode shortFrame = trace.last;
+
+    TEST_ASSERT_EQUAL(3, trace.codes);
+    TEST_ASSERT_EQUAL_HEX32(longSync.code, shortSync.code);
+    TEST_ASSERT_EQUAL_HEX32(longSync.code, shortFrame.code);
+    TEST_ASSERT_EQUAL(rfProtocolId("EV1527/PT2262"), longSync.protocol);
+    TEST_ASSERT_EQUAL(rfProtocolId("PT2262-10T"), shortSync.protocol);
+    TEST_ASSERT_EQUAL(24, longSync.bits);
+    TEST_ASSERT_EQUAL(16, shortFrame.bits);
+}
+
+// Frames of one number in two protocols do not confirm each other
+void test_protocol_change_restarts_repeats(void) {
+    RfDecoder decoder(MIN_PULSE_US, TOLERANCE_PCT, 2);
+    Trace trace = traceFor(decoder);
+
+    trace.press(0x0F0F, 24, 400, 1);
+    trace.frame(0x0F0F, 24, 400, 10);
+    TEST_ASSERT_EQUAL(0, trace.codes);
+
+    trace.frame(0x0F0F, 24, 400, 10);
+    TEST_ASSERT_EQUAL(1, trace.codes);
+    TEST_ASSERT_EQUAL(2, trace.last.protocol);
+}
+
+void test_protocol_names_round_trip(void) {
+    TEST_ASSERT_EQUAL(1, rfProtocolId(rfProtocolName(1)));
+    TEST_ASSERT_EQUAL(2, rfProtocolId(rfProtocolName(2)));
+    TEST_ASSERT_EQUAL(0, rfProtocolId("unknown"));
+    TEST_ASSERT_EQUAL(0, rfProtocolId(""));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_press_decodes_once);
+    RUN_TEST(test_single_frame_is_not_enough);
+    RUN_TEST(test_jitter_and_oscillator_drift);
+    RUN_TEST(test_short_sync_protocol);
+    RUN_TEST(test_glitch_drops_only_its_frame);
+    RUN_TEST(test_different_codes_do_not_confirm_each_other);
+    RUN_TEST(test_noise_is_rejected);
+    RUN_TEST(test_reset_clears_partial_state);
+    RUN_TEST(test_same_number_differs_by_protocol_and_bits);
+    RUN_TEST(test_protocol_change_restarts_repeats);
+    RUN_TEST(test_protocol_names_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,75 @@
+#include <string.h>
+#include <unity.h>
+#include "rtc_section.h"
+
+static const uint32_t MAGIC = 0x53455301;
+
+struct Sample {
+    bool valid;
+    bool locked;
+    uint8_t batteryPct;
+    int16_t position;
+};
+
+static RtcSection<Sample[4]> section;
+
+void setUp(void) { memset(&section, 0, sizeof(section)); }
+void tearDown(void) {}
+
+void test_checksum_is_fnv1a(void) {
+    TEST_ASSERT_EQUAL_HEX32(0x811C9DC5, sectionChecksum("", 0));
+    TEST_ASSERT_EQUAL_HEX32(0xE40C292C, sectionChecksum("a", 1));
+    TEST_ASSERT_EQUAL_HEX32(0xBF9CF968, sectionChecksum("foobar", 6));
+}
+
+void test_sealed_section_is_valid(void) {
+    TEST_ASSERT_FALSE(section.valid(MAGIC));
+    section.data[2].valid = true;
+    section.data[2].locked = true;
+    section.seal(MAGIC);
+    TEST_ASSERT_TRUE(section.valid(MAGIC));
+}
+
+void test_power_on_garbage_is_rejected(void) {
+    // RTC memory after power loss: random contents, magic included
+    uint32_t seed = 12345;
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&section);
+    for (int round = 0; round < 1000; round++) {
+        for (size_t i = 0; i < sizeof(section); i++) {
+            seed = seed * 1664525u + 1013904223u;
+            bytes[i] = static_cast<uint8_t>(seed >> 24);
+        }
+        section.magic = MAGIC;
+        TEST_ASSERT_FALSE(section.valid(MAGIC));
+    }
+}
+
+void test_change_without_seal_is_rejected(void) {
+    section.seal(MAGIC);
+    section.data[0].batteryPct = 50;
+    TEST_ASSERT_FALSE(section.valid(MAGIC));
+    section.seal(MAGIC);
+    TEST_ASSERT_TRUE(section.valid(MAGIC));
+}
+
+void test_other_layout_version_is_rejected(void) {
+    section.seal(MAGIC);
+    TEST_ASSERT_FALSE(section.valid(MAGIC + 1));
+}
+
+void test_invalidate(void) {
+    section.seal(MAGIC);
+    section.invalidate();
+    TEST_ASSERT_FALSE(section.valid(MAGIC));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_checksum_is_fnv1a);
+    RUN_TEST(test_sealed_section_is_valid);
+    RUN_TEST(test_power_on_garbage_is_rejected);
+    RUN_TEST(test_change_without_seal_is_rejected);
+    RUN_TEST(test_other_layout_version_is_rejected);
+    RUN_TEST(test_invalidate);
+    return UNITY_END();
+}
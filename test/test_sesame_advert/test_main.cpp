@@ -0,0 +1,101 @@
+#include <unity.h>
+#include "sesame_advert.h"
+
+// Advertisement payloads in the layout a lock sends: flags, a 16-bit service
+// UUID, then the CANDY HOUSE manufacturer data
+static const uint8_t REGISTERED[] = {
+    0x02, 0x01, 0x06,
+    0x03, 0x02, 0x56, 0xFD,
+    0x0E, 0xFF, 0x5A, 0x05, 0x05, 0x00, 0x01, 0x3C, 0x81, 0x11, 0x07, 0xA2, 0x44, 0x90, 0x2E,
+};
+
+static const uint8_t UNREGISTERED[] = {
+    0x02, 0x01, 0x06,
+    0x0E, 0xFF, 0x5A, 0x05, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_registered_lock(void) {
+    SesameAdvert advert;
+    TEST_ASSERT_TRUE(decodeSesameAdvert(REGISTERED, sizeof(REGISTERED), advert));
+    TEST_ASSERT_EQUAL_UINT8(5, advert.model);
+    TEST_ASSERT_TRUE(advert.registered);
+}
+
+void test_unregistered_lock(void) {
+    SesameAdvert advert;
+    TEST_ASSERT_TRUE(decodeSesameAdvert(UNREGISTERED, sizeof(UNREGISTERED), advert));
+    TEST_ASSERT_EQUAL_UINT8(4, advert.model);
+    TEST_ASSERT_FALSE(advert.registered);
+}
+
+void test_undocumented_bytes_are_ignored(void) {
+    // Only the identity part: still a valid Sesame advert
+    static const uint8_t minimal[] = {0x06, 0xFF, 0x5A, 0x05, 0x05, 0x00, 0x01};
+    uint8_t altered[sizeof(REGISTERED)];
+    for (size_t i = 0; i < sizeof(REGISTERED); i++) {
+        altered[i] = REGISTERED[i];
+    }
+    for (size_t i = 14; i < sizeof(altered); i++) {
+        altered[i] ^= 0xFF;
+    }
+
+    SesameAdvert a;
+    SesameAdvert b;
+    SesameAdvert c;
+    TEST_ASSERT_TRUE(decodeSesameAdvert(REGISTERED, sizeof(REGISTERED), a));
+    TEST_ASSERT_TRUE(decodeSesameAdvert(altered, sizeof(altered), b));
+    TEST_ASSERT_TRUE(decodeSesameAdvert(minimal, sizeof(minimal), c));
+    TEST_ASSERT_EQUAL_UINT8(a.model, b.model);
+    TEST_ASSERT_EQUAL(a.registered, b.registered);
+    TEST_ASSERT_EQUAL_UINT8(a.model, c.model);
+    TEST_ASSERT_EQUAL(a.registered, c.registered);
+}
+
+void test_other_company_is_not_sesame(void) {
+    static const uint8_t apple[] = {0x02, 0x01, 0x06, 0x07, 0xFF, 0x4C, 0x00, 0x10, 0x02, 0x0B, 0x00};
+    SesameAdvert advert;
+    TEST_ASSERT_FALSE(decodeSesameAdvert(apple, sizeof(apple), advert));
+}
+
+void test_short_manufacturer_data_is_rejected(void) {
+    static const uint8_t shortData[] = {0x05, 0xFF, 0x5A, 0x05, 0x05, 0x00};
+    SesameAdvert advert;
+    TEST_ASSERT_FALSE(decodeSesameAdvert(shortData, sizeof(shortData), advert));
+}
+
+void test_malformed_payloads_are_rejected(void) {
+    // AD structure longer than the payload
+    static const uint8_t overrun[] = {0x02, 0x01, 0x06, 0x0E, 0xFF, 0x5A, 0x05, 0x05, 0x00, 0x01};
+    SesameAdvert advert;
+    TEST_ASSERT_FALSE(decodeSesameAdvert(overrun, sizeof(overrun), advert));
+    TEST_ASSERT_FALSE(decodeSesameAdvert(REGISTERED, 0, advert));
+    // Truncated inside the flags structure
+    TEST_ASSERT_FALSE(decodeSesameAdvert(REGISTERED, 2, advert));
+}
+
+void test_zero_padding_ends_the_payload(void) {
+    static const uint8_t padded[] = {
+        0x06, 0xFF, 0x5A, 0x05, 0x05, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    };
+    static const uint8_t afterPadding[] = {
+        0x02, 0x01, 0x06, 0x00, 0x06, 0xFF, 0x5A, 0x05, 0x05, 0x00, 0x01,
+    };
+    SesameAdvert advert;
+    TEST_ASSERT_TRUE(decodeSesameAdvert(padded, sizeof(padded), advert));
+    TEST_ASSERT_FALSE(decodeSesameAdvert(afterPadding, sizeof(afterPadding), advert));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_registered_lock);
+    RUN_TEST(test_unregistered_lock);
+    RUN_TEST(test_undocumented_bytes_are_ignored);
+    RUN_TEST(test_other_company_is_not_sesame);
+    RUN_TEST(test_short_manufacturer_data_is_rejected);
+    RUN_TEST(test_malformed_payloads_are_rejected);
+    RUN_TEST(test_zero_padding_ends_the_payload);
+    return UNITY_END();
+}
@@ -0,0 +1,453 @@
+#include <chrono>
+#include <map>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "config.h"
+#include "sim.h"
+
+// Soak: the whole firmware in the simulator (test/support/sim) under the
+// conditions a door sees over months, compressed into a few seconds of wall
+// time: an RF storm, an MQTT flood, a flapping broker and locks that drop
+// the session in the middle of a command, then hours of idle. The cases run
+// in order on one boot and each reports throughput, dropped and duplicated
+// actions and heap growth.
+//
+// The accounting: every command published to the broker ends in exactly
+// one result, unless the broker lost the command on its way to the device
+// or the result on its way back (both counted by the simulated broker). The
+// locks never receive more writes than there were dispatched commands
+// (confirmed or timed out). A press of a remote is acted on once however
+// long the button is held, and the same code again inside
+// RXB6_SIGNAL_TIMEOUT is ignored.
+
+static const uint32_t DOOR_REMOTE = 0x3A9C51;   // toggle, first lock (sim_config.h)
+static const uint32_t GATE_REMOTE = 0x3A9C52;   // lock, "gate"
+static const uint32_t STRANGER = 0x5A5A5A;      // not whitelisted
+static const uint32_t RF_PULSE_US = 350;
+static const uint32_t SETTLE_MS = 30000;        // past the confirm timeout and a reconnect
+
+static sim::Lock* door = nullptr;
+static sim::Lock* gate = nullptr;
+static sim::RfBand band(RXB6_DATA_PIN);
+
+struct Result {
+    std::string lock;
+    std::string source;
+    std::string requestId;
+    std::string outcome;
+};
+
+struct Signal {
+    uint32_t code;
+    bool accepted;
+    uint32_t timestampMs;   // the firmware's millis() when it acted on the press
+};
+
+static std::vector<Result> results;
+static std::vector<Signal> signals;
+static std::set<std::string> lostResults;     // request_ids of results the broker lost
+static std::map<std::string, std::string> lastStatus;
+static sim::HeapStats baselineHeap;
+static uint32_t seq = 0;
+
+// Value of "key" in a flat JSON object: the string without its quotes, or
+// the literal as written
+static std::string field(const std::string& json, const char* key) {
+    std::string needle = std::string("\"") + key + "\":";
+    size_t at = json.find(needle);
+    if (at == std::string::npos) return std::string();
+    at += needle.size();
+    if (at < json.size() && json[at] == '"') {
+        size_t end = json.find('"', at + 1);
+        return json.substr(at + 1, end - at - 1);
+    }
+    size_t end = json.find_first_of(",}", at);
+    return json.substr(at, end - at);
+}
+
+// "sesame/<id>/..." -> "<id>"
+static std::string lockOf(const std::string& topic) {
+    size_t start = topic.find('/') + 1;
+    return topic.substr(start, topic.find('/', start) - start);
+}
+
+static uint32_t lcg(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ---- One scenario's window onto the counters
+
+struct Window {
+    const char* name;
+    uint64_t startUs;
+    size_t firstResult;
+    size_t firstSignal;
+    size_t doorWrites;
+    size_t gateWrites;
+    sim::Broker::Stats broker;
+    std::chrono::steady_clock::time_point wallStart;
+    std::vector<std::string> sent;   // request_ids the broker took
+    uint32_t unrouted;               // of those, sent while the device had no session
+};
+
+struct Tally {
+    uint32_t results;
+    uint32_t duplicated;     // request_ids with more than one result
+    uint32_t dropped;        // sent, not lost by the broker, and never answered
+    uint32_t lostUplink;
+    uint32_t lostDownlink;   // queued for the device when its connection went, or no session
+    uint32_t writes;
+    uint32_t dispatched;     // confirmed + timeout, every source
+    std::map<std::string, uint32_t> outcomes;
+};
+
+static Window begin(const char* name) {
+    Window window = {};
+    window.name = name;
+    window.startUs = sim::nowUs();
+    window.firstResult = results.size();
+    window.firstSignal = signals.size();
+    window.doorWrites = door->commands().size();
+    window.gateWrites = gate->commands().size();
+    window.broker = sim::broker().stats();
+    window.wallStart = std::chrono::steady_clock::now();
+    return window;
+}
+
+static bool sendCommand(Window& window, const char* lock, const char* action) {
+    char requestId[24];
+    snprintf(requestId, sizeof(requestId), "soak-%u", static_cast<unsigned>(seq++));
+    char payload[96];
+    snprintf(payload, sizeof(payload), "{\"action\":\"%s\",\"request_id\":\"%s\"}", action, requestId);
+    std::string topic = std::string(MQTT_TOPIC_PREFIX "/") + lock + "/" MQTT_LOCK_TOPIC_COMMAND;
+    // QoS 0: with the device between sessions nobody receives it
+    bool routed = false;
+    for (const sim::Broker::Session& session : sim::broker().sessions) {
+        for (const std::string& filter : session.filters) {
+            routed = routed || sim::topicMatches(filter, topic);
+        }
+    }
+    if (!sim::broker().publish(topic, payload)) {
+        return false;
+    }
+    window.sent.push_back(requestId);
+    window.unrouted += routed ? 0 : 1;
+    return true;
+}
+
+// Lets the last commands finish and the outbound buffer drain, then counts
+static Tally finish(const Window& window) {
+    sim::runUntil([] { return sim::broker().running() && !sim::broker().blackholed &&
+                              sim::accessPoint().stationConnected(); }, 600000);
+    sim::runFor(SETTLE_MS);
+
+    Tally tally = {};
+    std::map<std::string, uint32_t> answered;
+    for (size_t i = window.firstResult; i < results.size(); i++) {
+        const Result& result = results[i];
+        tally.results++;
+        tally.outcomes[result.outcome]++;
+        if (result.outcome == "confirmed" || result.outcome == "timeout") {
+            tally.dispatched++;
+        }
+        if (result.source == "mqtt") {
+            answered[result.requestId]++;
+        }
+    }
+    for (const auto& entry : answered) {
+        tally.duplicated += entry.second > 1 ? 1 : 0;
+    }
+
+    const sim::Broker::Stats& now = sim::broker().stats();
+    tally.lostDownlink = static_cast<uint32_t>(now.lostDownlink - window.broker.lostDownlink +
+                                               now.inboxOverflows - window.broker.inboxOverflows) +
+                         window.unrouted;
+    uint32_t unanswered = 0;
+    for (const std::string& requestId : window.sent) {
+        if (answered.count(requestId) > 0) continue;
+        if (lostResults.count(requestId) > 0) {
+            tally.lostUplink++;
+        } else {
+            unanswered++;
+        }
+    }
+    // A command lost on the way in has no id the broker could report
+    tally.dropped = unanswered > tally.lostDownlink ? unanswered - tally.lostDownlink : 0;
+    tally.writes = static_cast<uint32_t>(door->commands().size() - window.doorWrites +
+                                         gate->commands().size() - window.gateWrites);
+    return tally;
+}
+
+static void report(const Window& window, const Tally& tally) {
+    double simulatedS = (sim::nowUs() - window.startUs) / 1e6;
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - window.wallStart).count();
+    sim::HeapStats heap = sim::heapStats();
+    char line[320];
+    snprintf(line, sizeof(line),
+             "%s: %.0f min simulated in %.1f s (%.0fx), %zu commands (%.1f/min), %u results, "
+             "%u duplicated, %u dropped, %u lost uplink, %u lost downlink, %u writes / %u dispatched, "
+             "heap %+ld bytes since boot",
+             window.name, simulatedS / 60, wallS, wallS > 0 ? simulatedS / wallS : 0.0, window.sent.size(),
+             window.sent.size() * 60 / simulatedS, tally.results, tally.duplicated, tally.dropped,
+             tally.lostUplink, tally.lostDownlink, tally.writes, tally.dispatched,
+             static_cast<long>(heap.liveBytes) - static_cast<long>(baselineHeap.liveBytes));
+    TEST_MESSAGE(line);
+
+    std::string outcomes = "  outcomes:";
+    for (const auto& entry : tally.outcomes) {
+        outcomes += " " + entry.first + "=" + std::to_string(entry.second);
+    }
+    TEST_MESSAGE(outcomes.c_str());
+}
+
+static void checkAccounting(const Tally& tally) {
+    TEST_ASSERT_EQUAL_UINT32(0, tally.duplicated);
+    TEST_ASSERT_EQUAL_UINT32(0, tally.dropped);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(tally.dispatched, tally.writes);
+    TEST_ASSERT_EQUAL_UINT32(0, sim::kernelStats().watchdogTrips);
+}
+
+// ---- Scenarios, in order on one boot
+
+void test_boot_and_settle(void) {
+    door = &sim::addLock("c0:5e:5a:00:00:01");
+    gate = &sim::addLock("c0:5e:5a:00:00:02");
+    sim::broker().subscribe(MQTT_TOPIC_PREFIX "/+/" MQTT_LOCK_TOPIC_RESULT, [](const sim::Message& message) {
+        results.push_back(Result{lockOf(message.topic), field(message.payload, "source"),
+                                 field(message.payload, "request_id"), field(message.payload, "result")});
+    });
+    sim::broker().subscribe(MQTT_TOPIC_RXB6, [](const sim::Message& message) {
+        signals.push_back(Signal{static_cast<uint32_t>(strtoul(field(message.payload, "code").c_str(), nullptr, 16)),
+                                 field(message.payload, "accepted") == "true",
+                                 static_cast<uint32_t>(strtoul(field(message.payload, "timestamp").c_str(), nullptr, 10))});
+    });
+    sim::broker().subscribe(MQTT_TOPIC_PREFIX "/+/" MQTT_LOCK_TOPIC_STATUS, [](const sim::Message& message) {
+        lastStatus[lockOf(message.topic)] = message.payload;
+    });
+    sim::broker().onLost([](const sim::Message& message) {
+        std::string requestId = field(message.payload, "request_id");
+        if (!requestId.empty()) {
+            lostResults.insert(requestId);
+        }
+    });
+    sim::boot();
+
+    // Sessions, the auto-test and its relock
+    sim::runFor(60000);
+    baselineHeap = sim::heapStats();
+    TEST_ASSERT_TRUE(door->sessionActive() || door->stats().connects > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, sim::kernelStats().watchdogTrips);
+}
+
+// Ten minutes of ~2900 noise edges/s with presses of every kind in it: a
+// single press, a bounce right behind it, a second press a second later, a
+// held button, a stranger's remote and the gate's remote
+void test_rf_storm(void) {
+    static const int CYCLES = 150;
+    static const uint32_t CYCLE_MS = 4000;
+    Window window = begin("rf storm");
+    uint32_t expected = 0;
+    uint32_t expectedAccepted = 0;
+
+    for (int i = 0; i < CYCLES; i++) {
+        uint64_t cycleUs = window.startUs + static_cast<uint64_t>(i) * CYCLE_MS * 1000;
+        uint64_t cycleEndUs = cycleUs + CYCLE_MS * 1000ull;
+        uint64_t pressUs = cycleUs + 500000;
+        uint64_t quietUs = pressUs;   // end of the presses
+        band.noise(cycleUs, pressUs - 5000, 100, 600, 0x50A40000u + static_cast<uint32_t>(i));
+
+        switch (i % 6) {
+            case 0:
+                quietUs = band.press(pressUs, DOOR_REMOTE, 24, RF_PULSE_US);
+                expected += 1;
+                expectedAccepted += 1;
+                break;
+            case 1: {
+                // Contact bounce: a second burst past the decoder's repeat
+                // window, still inside the debounce
+                uint64_t endUs = band.press(pressUs, DOOR_REMOTE, 24, RF_PULSE_US);
+                quietUs = band.press(endUs + 250000, DOOR_REMOTE, 24, RF_PULSE_US);
+                expected += 1;
+                expectedAccepted += 1;
+                break;
+            }
+            case 2:
+                band.press(pressUs, DOOR_REMOTE, 24, RF_PULSE_US);
+                quietUs = band.press(pressUs + 1000000, DOOR_REMOTE, 24, RF_PULSE_US);
+                expected += 2;
+                expectedAccepted += 2;
+                break;
+            case 3:
+                // Held for ~1.35 s: one burst, one action
+                quietUs = band.press(pressUs, DOOR_REMOTE, 24, RF_PULSE_US, 30);
+                expected += 1;
+                expectedAccepted += 1;
+                break;
+            case 4:
+                quietUs = band.press(pressUs, STRANGER, 24, RF_PULSE_US);
+                expected += 1;
+                break;
+            default:
+                quietUs = band.press(pressUs, GATE_REMOTE, 24, RF_PULSE_US);
+                expected += 1;
+                expectedAccepted += 1;
+                break;
+        }
+        band.noise(quietUs + 5000, cycleEndUs - 5000, 100, 600, 0x50A50000u + static_cast<uint32_t>(i));
+        sim::runUntilUs(cycleEndUs);
+    }
+
+    Tally tally = finish(window);
+    report(window, tally);
+
+    uint32_t accepted = 0;
+    uint32_t rfResults = 0;
+    uint32_t bounced = 0;   // the same code acted on again inside the debounce window
+    for (size_t i = window.firstSignal; i < signals.size(); i++) {
+        accepted += signals[i].accepted ? 1 : 0;
+        if (i > window.firstSignal && signals[i].code == signals[i - 1].code &&
+            signals[i].timestampMs - signals[i - 1].timestampMs < RXB6_SIGNAL_TIMEOUT) {
+            bounced++;
+        }
+    }
+    for (size_t i = window.firstResult; i < results.size(); i++) {
+        rfResults += results[i].source == "rxb6" ? 1 : 0;
+    }
+    char line[200];
+    snprintf(line, sizeof(line), "  %llu edges, %zu presses acted on (expected %u), %u accepted, %u debounce violations",
+             static_cast<unsigned long long>(band.edges()), signals.size() - window.firstSignal,
+             static_cast<unsigned>(expected), static_cast<unsigned>(accepted), static_cast<unsigned>(bounced));
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_UINT32(expected, signals.size() - window.firstSignal);
+    TEST_ASSERT_EQUAL_UINT32(expectedAccepted, accepted);
+    TEST_ASSERT_EQUAL_UINT32(0, bounced);
+    // Every accepted press is one command with one result
+    TEST_ASSERT_EQUAL_UINT32(accepted, rfResults);
+    checkAccounting(tally);
+}
+
+// Five minutes of 20 commands/s to both locks, in random directions
+void test_mqtt_flood(void) {
+    Window window = begin("mqtt flood");
+    uint32_t random = 0xF100D000u;
+    for (int i = 0; i < 5 * 60 * 20; i++) {
+        uint32_t pick = lcg(random);
+        sendCommand(window, (pick & 1) ? "gate" : "door", (pick & 2) ? "lock" : "unlock");
+        sim::runFor(50);
+    }
+
+    Tally tally = finish(window);
+    report(window, tally);
+    TEST_ASSERT_EQUAL_UINT32(window.sent.size(), tally.results);
+    checkAccounting(tally);
+}
+
+// Twenty minutes of a command every 2 s while the broker restarts every
+// minute and, twice, stops answering for a while
+void test_broker_flap(void) {
+    Window window = begin("broker flap");
+    uint32_t random = 0xF1A90000u;
+    uint32_t restarts = 0;
+    for (int i = 0; i < 600; i++) {
+        uint32_t pick = lcg(random);
+        if (i % 30 == 10 && !sim::broker().blackholed) {
+            sim::broker().restart(1000 + pick % 20000);
+            restarts++;
+        }
+        if (i % 300 == 150) {
+            sim::broker().setBlackhole(true);
+            sim::after((30000 + pick % 60000) * 1000ull, [] { sim::broker().setBlackhole(false); });
+        }
+        sendCommand(window, (i & 1) ? "gate" : "door", (pick & 4) ? "lock" : "unlock");
+        sim::runFor(2000);
+    }
+
+    Tally tally = finish(window);
+    report(window, tally);
+    char line[160];
+    snprintf(line, sizeof(line), "  %u restarts, %llu broker connects, %u publishes refused while down",
+             static_cast<unsigned>(restarts),
+             static_cast<unsigned long long>(sim::broker().stats().connects - window.broker.connects),
+             static_cast<unsigned>(600 - window.sent.size()));
+    TEST_MESSAGE(line);
+    checkAccounting(tally);
+}
+
+// Ten minutes of a real move every 5 s on the door while the lock loses the
+// write, drops the session before or after the bolt moves, or is dropped by
+// the radio in the middle of the move
+void test_mid_command_disconnect(void) {
+    static const sim::Lock::Fault faults[] = {sim::Lock::Fault::none, sim::Lock::Fault::ignored,
+                                              sim::Lock::Fault::dropBeforeMoving,
+                                              sim::Lock::Fault::dropAfterMoving};
+    Window window = begin("mid-command disconnect");
+    for (int i = 0; i < 120; i++) {
+        door->failNext(faults[i % 4]);
+        if (i % 5 == 4) {
+            sim::after(700000, [] { door->dropSession(); });
+        }
+        sendCommand(window, "door", door->locked() ? "unlock" : "lock");
+        sim::runFor(5000);
+    }
+
+    Tally tally = finish(window);
+    report(window, tally);
+    TEST_ASSERT_EQUAL_UINT32(window.sent.size(), tally.results);
+    checkAccounting(tally);
+
+    // Whatever happened on the way, the state the firmware reports is the
+    // lock's own
+    lastStatus.erase("door");
+    sim::broker().publish(MQTT_TOPIC_PREFIX "/door/" MQTT_LOCK_TOPIC_COMMAND, "{\"action\":\"status\"}");
+    TEST_ASSERT_TRUE(sim::runUntil([] { return lastStatus.count("door") > 0; }, 10000));
+    TEST_ASSERT_EQUAL_STRING(door->locked() ? "true" : "false", field(lastStatus["door"], "locked").c_str());
+}
+
+// Two hours with a command every ten minutes, across the wrap of micros():
+// the heap ends where it started after the first minute
+void test_long_idle(void) {
+    Window window = begin("long idle");
+    for (int i = 0; i < 12; i++) {
+        sendCommand(window, (i & 1) ? "gate" : "door", (i & 2) ? "lock" : "unlock");
+        sim::runFor(10 * 60000);
+    }
+
+    Tally tally = finish(window);
+    report(window, tally);
+    TEST_ASSERT_EQUAL_UINT32(window.sent.size(), tally.results);
+    checkAccounting(tally);
+
+    sim::HeapStats heap = sim::heapStats();
+    sim::KernelStats kernel = sim::kernelStats();
+    sim::StorageStats storage = sim::storageStats();
+    char line[240];
+    snprintf(line, sizeof(line),
+             "simulated %.1f h: %llu context switches, %llu events, %u watchdog trips, heap %zu -> %zu bytes "
+             "(peak %zu), %llu NVS writes, %zu bytes of flash in use",
+             sim::nowUs() / 3.6e9, static_cast<unsigned long long>(kernel.contextSwitches),
+             static_cast<unsigned long long>(kernel.events), static_cast<unsigned>(kernel.watchdogTrips),
+             baselineHeap.liveBytes, heap.liveBytes, heap.peakBytes,
+             static_cast<unsigned long long>(storage.nvsWrites), storage.flashUsed);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(baselineHeap.liveBytes, heap.liveBytes);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_boot_and_settle);
+    RUN_TEST(test_rf_storm);
+    RUN_TEST(test_mqtt_flood);
+    RUN_TEST(test_broker_flap);
+    RUN_TEST(test_mid_command_disconnect);
+    RUN_TEST(test_long_idle);
+    return UNITY_END();
+}
@@ -0,0 +1,96 @@
+#include <string.h>
+#include <unity.h>
+#include "status_requests.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_one_answer_completes_every_waiter(void) {
+    StatusRequestTracker tracker;
+    TEST_ASSERT_TRUE(tracker.add("a", CommandSource::mqtt, 0, 5000));
+    TEST_ASSERT_TRUE(tracker.add("b", CommandSource::lan, 10, 5000));
+    TEST_ASSERT_TRUE(tracker.add("", CommandSource::mqtt, 20, 5000));
+    TEST_ASSERT_EQUAL(3, tracker.size());
+
+    PendingStatusRequest request;
+    bool seenA = false;
+    bool seenB = false;
+    size_t answered = 0;
+    while (tracker.takeAny(request)) {
+        answered++;
+        seenA |= strcmp(request.requestId, "a") == 0;
+        if (strcmp(request.requestId, "b") == 0) {
+            seenB = true;
+            TEST_ASSERT_EQUAL(CommandSource::lan, request.source);
+            TEST_ASSERT_EQUAL_UINT32(10, request.startedMs);
+        }
+    }
+    TEST_ASSERT_EQUAL(3, answered);
+    TEST_ASSERT_TRUE(seenA && seenB);
+    TEST_ASSERT_TRUE(tracker.empty());
+}
+
+void test_table_is_bounded(void) {
+    StatusRequestTracker tracker;
+    for (int i = 0; i < STATUS_REQUEST_SLOTS; i++) {
+        TEST_ASSERT_TRUE(tracker.add("x", CommandSource::mqtt, 0, 1000));
+    }
+    TEST_ASSERT_FALSE(tracker.add("overflow", CommandSource::mqtt, 0, 1000));
+    TEST_ASSERT_EQUAL(STATUS_REQUEST_SLOTS, tracker.size());
+
+    PendingStatusRequest request;
+    TEST_ASSERT_TRUE(tracker.takeAny(request));
+    TEST_ASSERT_TRUE(tracker.add("again", CommandSource::mqtt, 0, 1000));
+}
+
+void test_requests_expire_individually(void) {
+    StatusRequestTracker tracker;
+    tracker.add("short", CommandSource::mqtt, 100, 1000);
+    tracker.add("long", CommandSource::mqtt, 100, 3000);
+
+    PendingStatusRequest request;
+    TEST_ASSERT_EQUAL_UINT32(1000, tracker.msUntilNextDeadline(100));
+    TEST_ASSERT_FALSE(tracker.takeExpired(1099, request));
+
+    TEST_ASSERT_TRUE(tracker.takeExpired(1100, request));
+    TEST_ASSERT_EQUAL_STRING("short", request.requestId);
+    TEST_ASSERT_FALSE(tracker.takeExpired(1100, request));
+    TEST_ASSERT_EQUAL_UINT32(2000, tracker.msUntilNextDeadline(1100));
+
+    TEST_ASSERT_TRUE(tracker.takeExpired(5000, request));
+    TEST_ASSERT_EQUAL_STRING("long", request.requestId);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, tracker.msUntilNextDeadline(5000));
+}
+
+void test_deadlines_survive_millis_wrap(void) {
+    StatusRequestTracker tracker;
+    uint32_t start = UINT32_MAX - 200;
+    tracker.add("wrap", CommandSource::mqtt, start, 1000);
+
+    PendingStatusRequest request;
+    TEST_ASSERT_FALSE(tracker.takeExpired(start + 500, request));
+    TEST_ASSERT_EQUAL_UINT32(500, tracker.msUntilNextDeadline(start + 500));
+    TEST_ASSERT_TRUE(tracker.takeExpired(start + 1000, request));
+}
+
+void test_long_request_ids_are_truncated(void) {
+    StatusRequestTracker tracker;
+    char id[COMMAND_REQUEST_ID_SIZE + 8];
+    memset(id, 'r', sizeof(id) - 1);
+    id[sizeof(id) - 1] = '\0';
+    tracker.add(id, CommandSource::mqtt, 0, 1000);
+
+    PendingStatusRequest request;
+    TEST_ASSERT_TRUE(tracker.takeAny(request));
+    TEST_ASSERT_EQUAL(COMMAND_REQUEST_ID_SIZE - 1, strlen(request.requestId));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_answer_completes_every_waiter);
+    RUN_TEST(test_table_is_bounded);
+    RUN_TEST(test_requests_expire_individually);
+    RUN_TEST(test_deadlines_survive_millis_wrap);
+    RUN_TEST(test_long_request_ids_are_truncated);
+    return UNITY_END();
+}
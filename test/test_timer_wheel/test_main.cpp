@@ -0,0 +1,214 @@
+#include <unity.h>
+#include "timer_wheel.h"
+
+static TimerWheel wheel;
+
+static TimerEntry timer(uint8_t lock, TimerKind kind, uint32_t dueMs) {
+    TimerEntry entry = {};
+    entry.lock = lock;
+    entry.kind = kind;
+    entry.dueMs = dueMs;
+    return entry;
+}
+
+void setUp(void) { wheel = TimerWheel(); }
+void tearDown(void) {}
+
+void test_fires_at_due_time_not_before(void) {
+    TEST_ASSERT_NOT_EQUAL(0, wheel.schedule(timer(0, TimerKind::relock, 1000), 0));
+    TimerEntry out;
+    TEST_ASSERT_FALSE(wheel.takeDue(999, out));
+    TEST_ASSERT_TRUE(wheel.takeDue(1000, out));
+    TEST_ASSERT_EQUAL_UINT32(1000, out.dueMs);
+    TEST_ASSERT_EQUAL(0, wheel.size());
+    TEST_ASSERT_FALSE(wheel.takeDue(1000, out));
+}
+
+void test_due_timers_fire_in_order_across_buckets(void) {
+    wheel.schedule(timer(0, TimerKind::relock, 3000), 0);
+    wheel.schedule(timer(1, TimerKind::relock, 1000), 0);
+    wheel.schedule(timer(2, TimerKind::relock, 2000), 0);
+
+    TimerEntry out;
+    TEST_ASSERT_TRUE(wheel.takeDue(5000, out));
+    TEST_ASSERT_EQUAL_UINT32(1000, out.dueMs);
+    TEST_ASSERT_TRUE(wheel.takeDue(5000, out));
+    TEST_ASSERT_EQUAL_UINT32(2000, out.dueMs);
+    TEST_ASSERT_TRUE(wheel.takeDue(5000, out));
+    TEST_ASSERT_EQUAL_UINT32(3000, out.dueMs);
+    TEST_ASSERT_FALSE(wheel.takeDue(5000, out));
+}
+
+void test_past_due_timer_fires_at_once(void) {
+    TimerEntry out;
+    wheel.schedule(timer(0, TimerKind::command, 0), 0);
+    wheel.takeDue(10000, out);
+    wheel.schedule(timer(0, TimerKind::command, 12000), 10000);
+    wheel.schedule(timer(1, TimerKind::command, 9000), 10000);
+    TEST_ASSERT_TRUE(wheel.takeDue(10000, out));
+    TEST_ASSERT_EQUAL(1, out.lock);
+}
+
+void test_timers_beyond_one_revolution(void) {
+    const uint32_t revolution = TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK_MS;
+    wheel.schedule(timer(0, TimerKind::relock, 3 * revolution + 100), 0);
+    wheel.schedule(timer(1, TimerKind::relock, 100), 0);
+
+    TimerEntry out;
+    for (uint32_t now = 0; now < 3 * revolution + 100; now += 50) {
+        if (wheel.takeDue(now, out)) {
+            TEST_ASSERT_EQUAL(1, out.lock);
+            TEST_ASSERT_TRUE(now >= 100);
+        }
+    }
+    TEST_ASSERT_EQUAL(1, wheel.size());
+    TEST_ASSERT_TRUE(wheel.takeDue(3 * revolution + 100, out));
+    TEST_ASSERT_EQUAL(0, out.lock);
+}
+
+void test_long_sleep_catches_up(void) {
+    wheel.schedule(timer(0, TimerKind::relock, 500), 0);
+    wheel.schedule(timer(1, TimerKind::relock, 40000), 0);
+    TimerEntry out;
+    TEST_ASSERT_TRUE(wheel.takeDue(100000, out));
+    TEST_ASSERT_TRUE(wheel.takeDue(100000, out));
+    TEST_ASSERT_EQUAL(0, wheel.size());
+}
+
+void test_cancel_and_stale_handles(void) {
+    uint16_t handle = wheel.schedule(timer(0, TimerKind::relock, 1000), 0);
+    TEST_ASSERT_TRUE(wheel.cancel(handle));
+    TEST_ASSERT_FALSE(wheel.cancel(handle));
+    TEST_ASSERT_EQUAL(0, wheel.size());
+
+    // The node is reused: the old handle must not cancel the new timer
+    uint16_t reused = wheel.schedule(timer(1, TimerKind::relock, 2000), 0);
+    TEST_ASSERT_NOT_EQUAL(handle, reused);
+    TEST_ASSERT_FALSE(wheel.cancel(handle));
+    TEST_ASSERT_EQUAL(1, wheel.size());
+    TEST_ASSERT_FALSE(wheel.cancel(0));
+    TEST_ASSERT_FALSE(wheel.cancel(0x00FF));
+}
+
+void test_cancel_by_lock_and_kind(void) {
+    wheel.schedule(timer(0, TimerKind::relock, 1000), 0);
+    wheel.schedule(timer(0, TimerKind::command, 1000), 0);
+    wheel.schedule(timer(0, TimerKind::command, 5000), 0);
+    wheel.schedule(timer(1, TimerKind::command, 1000), 0);
+
+    TEST_ASSERT_EQUAL(2, wheel.cancelLock(0, TimerKind::command));
+    TEST_ASSERT_EQUAL(2, wheel.size());
+    TEST_ASSERT_EQUAL(1, wheel.cancelLock(0));
+    TEST_ASSERT_EQUAL(0, wheel.cancelLock(0));
+    TimerEntry out;
+    TEST_ASSERT_TRUE(wheel.takeDue(1000, out));
+    TEST_ASSERT_EQUAL(1, out.lock);
+}
+
+void test_pool_full(void) {
+    for (size_t i = 0; i < TIMER_WHEEL_CAPACITY; i++) {
+        TEST_ASSERT_NOT_EQUAL(0, wheel.schedule(timer(0, TimerKind::command, 1000 + i), 0));
+    }
+    TEST_ASSERT_EQUAL(0, wheel.schedule(timer(0, TimerKind::command, 1000), 0));
+    TimerEntry out;
+    TEST_ASSERT_TRUE(wheel.takeDue(1000, out));
+    TEST_ASSERT_NOT_EQUAL(0, wheel.schedule(timer(0, TimerKind::command, 1000), 0));
+}
+
+void test_ms_until_next(void) {
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, wheel.msUntilNext(0));
+    wheel.schedule(timer(0, TimerKind::relock, 3000), 0);
+    wheel.schedule(timer(1, TimerKind::command, 2000), 0);
+    TEST_ASSERT_EQUAL_UINT32(1500, wheel.msUntilNext(500));
+    TEST_ASSERT_EQUAL_UINT32(2500, wheel.msUntilNext(0, TimerKind::relock, 500));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, wheel.msUntilNext(1, TimerKind::relock, 500));
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.msUntilNext(2500));
+}
+
+void test_millis_wrap(void) {
+    const uint32_t start = UINT32_MAX - 700;
+    TimerEntry out;
+    wheel.takeDue(start, out);
+    wheel.schedule(timer(0, TimerKind::relock, start + 1000), start);   // wraps to 299
+    wheel.schedule(timer(1, TimerKind::relock, start + 500), start);
+    TEST_ASSERT_EQUAL_UINT32(500, wheel.msUntilNext(start));
+
+    TEST_ASSERT_FALSE(wheel.takeDue(start + 499, out));
+    TEST_ASSERT_TRUE(wheel.takeDue(start + 500, out));
+    TEST_ASSERT_EQUAL(1, out.lock);
+    TEST_ASSERT_FALSE(wheel.takeDue(start + 999, out));
+    TEST_ASSERT_TRUE(wheel.takeDue(start + 1000, out));
+    TEST_ASSERT_EQUAL(0, out.lock);
+}
+
+// Random schedule/cancel/poll against a plain list of due times
+void test_matches_reference_model(void) {
+    struct Reference {
+        bool active;
+        uint16_t handle;
+        uint32_t dueMs;
+    } reference[TIMER_WHEEL_CAPACITY] = {};
+    uint32_t seed = 99;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    };
+
+    // Starts just before the wrap so it is crossed on the way
+    uint32_t now = UINT32_MAX - 200000;
+    TimerEntry out;
+    wheel.takeDue(now, out);
+    for (int step = 0; step < 200000; step++) {
+        now += random() % 300;
+        uint32_t op = random() % 10;
+        if (op < 3) {
+            uint32_t due = now + random() % 60000;
+            uint16_t handle = wheel.schedule(timer(0, TimerKind::command, due), now);
+            bool free = false;
+            for (auto& r : reference) {
+                if (!r.active) {
+                    r = {true, handle, due};
+                    free = true;
+                    break;
+                }
+            }
+            TEST_ASSERT_EQUAL(free, handle != 0);
+        } else if (op < 4) {
+            auto& r = reference[random() % TIMER_WHEEL_CAPACITY];
+            TEST_ASSERT_EQUAL(r.active, wheel.cancel(r.handle));
+            r.active = false;
+        }
+
+        while (wheel.takeDue(now, out)) {
+            bool found = false;
+            for (auto& r : reference) {
+                if (r.active && r.dueMs == out.dueMs && static_cast<int32_t>(now - r.dueMs) >= 0) {
+                    r.active = false;
+                    found = true;
+                    break;
+                }
+            }
+            TEST_ASSERT_TRUE(found);
+        }
+        for (const auto& r : reference) {
+            // Nothing due may be left behind
+            TEST_ASSERT_FALSE(r.active && static_cast<int32_t>(now - r.dueMs) >= 0);
+        }
+    }
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fires_at_due_time_not_before);
+    RUN_TEST(test_due_timers_fire_in_order_across_buckets);
+    RUN_TEST(test_past_due_timer_fires_at_once);
+    RUN_TEST(test_timers_beyond_one_revolution);
+    RUN_TEST(test_long_sleep_catches_up);
+    RUN_TEST(test_cancel_and_stale_handles);
+    RUN_TEST(test_cancel_by_lock_and_kind);
+    RUN_TEST(test_pool_full);
+    RUN_TEST(test_ms_until_next);
+    RUN_TEST(test_millis_wrap);
+    RUN_TEST(test_matches_reference_model);
+    return UNITY_END();
+}
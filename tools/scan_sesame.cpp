@@ -1,244 +1,262 @@
 /*
- * ESP32 Simple BLE Scanner for Sesame Devices
- * Tìm kiếm tất cả thiết bị BLE có thể là Sesame
+ * ESP32 continuous BLE scanner for Sesame devices
+ *
+ * Scans without pause and streams one record per device as soon as it is
+ * heard, then again every REPORT_INTERVAL_MS while it stays in range, plus
+ * a "lost" record when it ages out. Records are JSON lines by default or
+ * compact binary frames (OUTPUT_BINARY) for surveys with hundreds of
+ * devices.
+ *
+ * The scan callback copies each advertisement into a fixed-size queue slot;
+ * the loop task owns the device table (include/device_table.h, open
+ * addressing keyed by the 48-bit address) and the output. Nothing is
+ * allocated per advertisement.
+ *
+ * Built in place of src/main.cpp by scripts/build.sh scan.
  */
 
 #include <Arduino.h>
-#include <BLEDevice.h>
-#include <BLEScan.h>
-#include <BLEAdvertisedDevice.h>
-#include <BLEAddress.h>
-
-// Cấu hình scanner
-const int SCAN_TIME = 10; // seconds
-const int MAX_DEVICES = 20;
-unsigned long lastScan = 0;
-const unsigned long SCAN_INTERVAL = 15000; // 15 seconds
-
-// Lưu trữ devices tìm thấy
-struct BLEDeviceInfo {
-    String address;
-    String name;
-    int rssi;
-    bool hasSesameUUID;
-    bool hasManufacturerData;
-    String manufacturerData;
-    unsigned long lastSeen;
-};
+#include <NimBLEDevice.h>
+#include "device_table.h"
+
+// Scanner configuration
+const uint32_t SCAN_BAUD = 115200;
+const uint16_t SCAN_INTERVAL_MS = 100;
+const uint16_t SCAN_WINDOW_MS = 99;
+const bool OUTPUT_BINARY = false;          // false: JSON lines, true: binary frames
+const bool ONLY_SESAME = false;            // report every device, or Sesame candidates only
+const uint32_t REPORT_INTERVAL_MS = 5000;  // repeat records per device at most this often
+const uint32_t DEVICE_MAX_AGE_MS = 30000;  // devices not heard for this long are dropped
+const uint32_t STATS_INTERVAL_MS = 10000;
 
-BLEDeviceInfo foundDevices[MAX_DEVICES];
-int deviceCount = 0;
-int scanNumber = 0;
+const size_t ADVERT_QUEUE_LENGTH = 64;
+const size_t ADVERT_PAYLOAD_MAX = 62;      // advertisement + scan response
 
-// UUID của Sesame (một số UUID thường thấy)
-const char* SESAME_SERVICE_UUIDS[] = {
-    "16860000-a5ae-9856-b6d6-a87a2e2cb400",  // Sesame service UUID
-    "0000fd81-0000-1000-8000-00805f9b34fb",  // Sesame service UUID alternative
-    "0000180f-0000-1000-8000-00805f9b34fb"   // Battery service
+// One advertisement, copied out of the BLE host task
+struct AdvertRecord {
+    uint64_t address;
+    uint8_t addressType;
+    int8_t rssi;
+    uint8_t length;
+    uint8_t payload[ADVERT_PAYLOAD_MAX];
 };
 
-class MyAdvertisedDeviceCallbacks: public BLEAdvertisedDeviceCallbacks {
-    void onResult(BLEAdvertisedDevice advertisedDevice) {
-        String address = advertisedDevice.getAddress().toString().c_str();
-        String name = advertisedDevice.getName().c_str();
-        int rssi = advertisedDevice.getRSSI();
-        bool hasSesameUUID = false;
-        bool hasManufData = false;
-        String manufacData = "";
-        
-        // Check for Sesame service UUIDs
-        if (advertisedDevice.haveServiceUUID()) {
-            for (int i = 0; i < 3; i++) {
-                if (advertisedDevice.isAdvertisingService(BLEUUID(SESAME_SERVICE_UUIDS[i]))) {
-                    hasSesameUUID = true;
-                    break;
-                }
-            }
-        }
-        
-        // Check manufacturer data
-        if (advertisedDevice.haveManufacturerData()) {
-            hasManufData = true;
-            std::string data = advertisedDevice.getManufacturerData();
-            for (size_t i = 0; i < data.length(); i++) {
-                if (i > 0) manufacData += ":";
-                manufacData += String(data[i], HEX);
-            }
-        }
-        
-        // Lọc thiết bị có thể là Sesame
-        bool couldBeSesame = false;
-        
-        // Điều kiện 1: Có Sesame UUID
-        if (hasSesameUUID) {
-            couldBeSesame = true;
-        }
-        
-        // Điều kiện 2: Tên chứa "sesame", "candy" hoặc MAC có pattern phù hợp
-        String nameLower = name;
-        nameLower.toLowerCase();
-        if (nameLower.indexOf("sesame") >= 0 || 
-            nameLower.indexOf("candy") >= 0 ||
-            nameLower.indexOf("ss3") >= 0) {
-            couldBeSesame = true;
-        }
-        
-        // Điều kiện 3: Thiết bị BLE không tên nhưng có manufacturer data
-        if (name.length() == 0 && hasManufData && rssi > -80) {
-            couldBeSesame = true;
-        }
-        
-        // Chỉ lưu thiết bị có khả năng là Sesame
-        if (couldBeSesame) {
-            addOrUpdateDevice(address, name, rssi, hasSesameUUID, hasManufData, manufacData);
+static DeviceTable devices;
+static QueueHandle_t advertQueue = nullptr;
+
+// Counters for the periodic stats line
+static volatile uint32_t advertsQueued = 0;
+static volatile uint32_t advertsDropped = 0;
+static uint32_t advertsHandled = 0;
+static uint32_t tableFull = 0;
+static uint32_t devicesLost = 0;
+static uint32_t lastStatsMs = 0;
+static uint32_t lastAgingMs = 0;
+
+class ScanCallbacks : public NimBLEScanCallbacks {
+    void onResult(const NimBLEAdvertisedDevice* device) override {
+        AdvertRecord record;
+        const uint8_t* address = device->getAddress().getVal();
+        record.address = 0;
+        for (int i = 5; i >= 0; i--) {
+            record.address = (record.address << 8) | address[i];
         }
-        
-        // In thông tin realtime cho thiết bị tiềm năng
-        if (couldBeSesame) {
-            Serial.print("🔍 Found: ");
-            Serial.print(address);
-            if (name.length() > 0) {
-                Serial.print(" (");
-                Serial.print(name);
-                Serial.print(")");
-            }
-            Serial.print(" RSSI: ");
-            Serial.print(rssi);
-            if (hasSesameUUID) Serial.print(" [SESAME UUID]");
-            Serial.println();
+        record.addressType = device->getAddress().getType();
+        record.rssi = static_cast<int8_t>(device->getRSSI());
+
+        const std::vector<uint8_t>& payload = device->getPayload();
+        record.length = static_cast<uint8_t>(payload.size() < ADVERT_PAYLOAD_MAX ? payload.size() : ADVERT_PAYLOAD_MAX);
+        memcpy(record.payload, payload.data(), record.length);
+
+        if (xQueueSend(advertQueue, &record, 0) == pdTRUE) {
+            advertsQueued++;
+        } else {
+            advertsDropped++;
         }
     }
 };
 
-void addOrUpdateDevice(String address, String name, int rssi, bool hasUUID, bool hasManuf, String manufacData) {
-    // Tìm device đã tồn tại
-    for (int i = 0; i < deviceCount; i++) {
-        if (foundDevices[i].address.equalsIgnoreCase(address)) {
-            // Cập nhật thông tin
-            foundDevices[i].rssi = rssi;
-            foundDevices[i].lastSeen = millis();
-            if (name.length() > 0 && foundDevices[i].name.length() == 0) {
-                foundDevices[i].name = name;
-            }
-            return;
+static ScanCallbacks scanCallbacks;
+
+static void formatAddress(char* out, uint64_t address) {
+    snprintf(out, 18, "%02x:%02x:%02x:%02x:%02x:%02x",
+             static_cast<unsigned>(address >> 40) & 0xFF, static_cast<unsigned>(address >> 32) & 0xFF,
+             static_cast<unsigned>(address >> 24) & 0xFF, static_cast<unsigned>(address >> 16) & 0xFF,
+             static_cast<unsigned>(address >> 8) & 0xFF, static_cast<unsigned>(address) & 0xFF);
+}
+
+// JSON line: {"ev":"seen","addr":"..","type":1,"rssi":-70,"avg":-68.5,"n":12,...}
+static void writeJson(const char* event, const DeviceEntry& entry, uint32_t now) {
+    char line[256];
+    char address[18];
+    formatAddress(address, entry.address);
+
+    int length = snprintf(line, sizeof(line),
+                          "{\"ev\":\"%s\",\"t\":%lu,\"addr\":\"%s\",\"type\":%u,\"rssi\":%d,\"avg\":%.1f,\"n\":%lu,\"age_ms\":%lu",
+                          event, static_cast<unsigned long>(now), address, entry.addressType, entry.lastRssi,
+                          entry.rssiAvg / static_cast<float>(1 << DEVICE_RSSI_SHIFT), static_cast<unsigned long>(entry.count),
+                          static_cast<unsigned long>(now - entry.lastSeenMs));
+
+    if (entry.name[0] != '\0' && length < static_cast<int>(sizeof(line))) {
+        // Names are printed as-is apart from characters JSON needs escaped
+        length += snprintf(line + length, sizeof(line) - length, ",\"name\":\"");
+        for (const char* c = entry.name; *c != '\0' && length < static_cast<int>(sizeof(line)) - 8; c++) {
+            line[length++] = (*c == '"' || *c == '\\' || static_cast<uint8_t>(*c) < 0x20) ? '?' : *c;
         }
+        line[length++] = '"';
+        line[length] = '\0';
+    }
+    if (entry.manufacturerLength > 0 && length < static_cast<int>(sizeof(line))) {
+        length += snprintf(line + length, sizeof(line) - length, ",\"mfg\":\"");
+        for (size_t i = 0; i < entry.manufacturerLength && length < static_cast<int>(sizeof(line)) - 8; i++) {
+            length += snprintf(line + length, sizeof(line) - length, "%02x", entry.manufacturer[i]);
+        }
+        line[length++] = '"';
+        line[length] = '\0';
+    }
+    if (entry.sesame && length < static_cast<int>(sizeof(line))) {
+        length += snprintf(line + length, sizeof(line) - length, ",\"sesame\":true,\"model\":%u", entry.model);
+    }
+    if (length < static_cast<int>(sizeof(line)) - 2) {
+        line[length++] = '}';
+        line[length++] = '\n';
+        Serial.write(reinterpret_cast<const uint8_t*>(line), length);
     }
-    
-    // Thêm device mới
-    if (deviceCount < MAX_DEVICES) {
-        foundDevices[deviceCount].address = address;
-        foundDevices[deviceCount].name = name;
-        foundDevices[deviceCount].rssi = rssi;
-        foundDevices[deviceCount].hasSesameUUID = hasUUID;
-        foundDevices[deviceCount].hasManufacturerData = hasManuf;
-        foundDevices[deviceCount].manufacturerData = manufacData;
-        foundDevices[deviceCount].lastSeen = millis();
-        deviceCount++;
+}
+
+// Binary frame, little endian:
+//   0xA5, length (bytes after this one), event (0 seen, 1 update, 2 lost),
+//   address[6], address type, rssi, average rssi (dBm << 4, int16),
+//   count (u32), flags (bit 0 sesame), model, name length, name,
+//   manufacturer length, manufacturer data
+static void writeBinary(uint8_t event, const DeviceEntry& entry) {
+    uint8_t frame[2 + 20 + DEVICE_NAME_MAX + 1 + DEVICE_MANUFACTURER_MAX];
+    size_t n = 2;
+    frame[n++] = event;
+    for (int shift = 0; shift < 48; shift += 8) {
+        frame[n++] = static_cast<uint8_t>(entry.address >> shift);
+    }
+    frame[n++] = entry.addressType;
+    frame[n++] = static_cast<uint8_t>(entry.lastRssi);
+    frame[n++] = static_cast<uint8_t>(entry.rssiAvg);
+    frame[n++] = static_cast<uint8_t>(entry.rssiAvg >> 8);
+    for (int shift = 0; shift < 32; shift += 8) {
+        frame[n++] = static_cast<uint8_t>(entry.count >> shift);
+    }
+    frame[n++] = entry.sesame ? 0x01 : 0x00;
+    frame[n++] = entry.model;
+
+    size_t nameLength = strlen(entry.name);
+    frame[n++] = static_cast<uint8_t>(nameLength);
+    memcpy(frame + n, entry.name, nameLength);
+    n += nameLength;
+    frame[n++] = entry.manufacturerLength;
+    memcpy(frame + n, entry.manufacturer, entry.manufacturerLength);
+    n += entry.manufacturerLength;
+
+    frame[0] = 0xA5;
+    frame[1] = static_cast<uint8_t>(n - 2);
+    Serial.write(frame, n);
+}
+
+static void report(uint8_t event, DeviceEntry& entry, uint32_t now) {
+    static const char* const names[] = {"seen", "update", "lost"};
+    entry.reportedMs = now;
+    if (ONLY_SESAME && !entry.sesame) return;
+
+    if (OUTPUT_BINARY) {
+        writeBinary(event, entry);
+    } else {
+        writeJson(names[event], entry, now);
     }
 }
 
-void printResults() {
-    Serial.println("\n" + String(60, '='));
-    Serial.println("📡 BLE DEVICE SCANNER RESULTS");
-    Serial.println(String(60, '='));
-    
-    if (deviceCount == 0) {
-        Serial.println("❌ No potential Sesame devices found!");
-        Serial.println("\n🔍 Troubleshooting:");
-        Serial.println("1. Make sure Sesame is powered on (LED blinking)");
-        Serial.println("2. Move ESP32 closer to Sesame (< 5m)");
-        Serial.println("3. Close SESAME app on phone");
-        Serial.println("4. Try pressing button on Sesame to wake it up");
+static void handleAdvert(const AdvertRecord& record, uint32_t now) {
+    advertsHandled++;
+
+    bool created;
+    DeviceEntry* entry = devices.insert(record.address, created);
+    if (entry == nullptr) {
+        tableFull++;
         return;
     }
-    
-    Serial.printf("✅ Found %d potential Sesame device(s):\n\n", deviceCount);
-    
-    for (int i = 0; i < deviceCount; i++) {
-        Serial.println("📱 Device #" + String(i + 1));
-        Serial.println("   📍 MAC Address: " + foundDevices[i].address);
-        
-        if (foundDevices[i].name.length() > 0) {
-            Serial.println("   🏷️  Name: " + foundDevices[i].name);
-        } else {
-            Serial.println("   🏷️  Name: (No name)");
-        }
-        
-        Serial.println("   📶 RSSI: " + String(foundDevices[i].rssi) + " dBm");
-        
-        if (foundDevices[i].hasSesameUUID) {
-            Serial.println("   ✅ Has Sesame UUID: YES");
-        } else {
-            Serial.println("   ⚠️  Has Sesame UUID: NO");
-        }
-        
-        if (foundDevices[i].hasManufacturerData) {
-            Serial.println("   📊 Manufacturer Data: " + foundDevices[i].manufacturerData);
-        }
-        
-        // Hiển thị cấu hình
-        Serial.println("   ⚙️  Config for this device:");
-        Serial.println("       #define SESAME_ADDRESS \"" + foundDevices[i].address + "\"");
-        
-        Serial.println();
+
+    updateDevice(*entry, record.payload, record.length, record.addressType, record.rssi, now);
+    if (created) {
+        report(0, *entry, now);
+    } else if (now - entry->reportedMs >= REPORT_INTERVAL_MS) {
+        report(1, *entry, now);
     }
-    
-    Serial.println("🎯 NEXT STEPS:");
-    Serial.println("1. Try each MAC address above in your config");
-    Serial.println("2. Get SECRET key from SESAME app QR code:");
-    Serial.println("   https://sesame-qr-reader.vercel.app/");
-    Serial.println("3. Update include/config.h with MAC and SECRET");
-    Serial.println("4. Restore main.cpp and test connection");
-    Serial.println();
-    Serial.println("📝 Note: Device with 'Has Sesame UUID: YES' is most likely your Sesame");
+}
+
+// Drop devices that have gone quiet, reporting each one
+static void ageDevices(uint32_t now) {
+    devicesLost += devices.age(now, DEVICE_MAX_AGE_MS, [now](DeviceEntry& entry) { report(2, entry, now); });
+}
+
+static void printStats(uint32_t now) {
+    if (OUTPUT_BINARY) return;
+
+    uint32_t window = now - lastStatsMs;
+    Serial.printf("{\"ev\":\"stats\",\"t\":%lu,\"devices\":%u,\"adverts\":%lu,\"per_s\":%lu,\"dropped\":%lu,"
+                  "\"table_full\":%lu,\"lost\":%lu}\n",
+                  static_cast<unsigned long>(now), static_cast<unsigned>(devices.size()),
+                  static_cast<unsigned long>(advertsHandled),
+                  static_cast<unsigned long>(window > 0 ? advertsHandled * 1000UL / window : 0),
+                  static_cast<unsigned long>(advertsDropped), static_cast<unsigned long>(tableFull),
+                  static_cast<unsigned long>(devicesLost));
+    advertsHandled = 0;
+}
+
+static void startScan() {
+    NimBLEScan* scan = NimBLEDevice::getScan();
+    scan->setScanCallbacks(&scanCallbacks, true);
+    scan->setActiveScan(true);
+    scan->setInterval(SCAN_INTERVAL_MS);
+    scan->setWindow(SCAN_WINDOW_MS);
+    scan->setMaxResults(0);
+    scan->start(0, false, false);
 }
 
 void setup() {
-    Serial.begin(115200);
+    Serial.begin(SCAN_BAUD);
     while (!Serial) delay(10);
-    
-    Serial.println("🚀 ESP32 BLE SCANNER FOR SESAME DEVICES");
-    Serial.println("======================================");
-    Serial.println("🔍 Scanning for BLE devices that could be Sesame...");
-    Serial.println("📱 Make sure to close SESAME app on your phone");
-    Serial.println("⏱️  Each scan takes 10 seconds, will run multiple scans");
-    Serial.println();
-    
-    BLEDevice::init("ESP32-Sesame-Scanner");
+
+    if (!OUTPUT_BINARY) {
+        Serial.println("🚀 ESP32 BLE SCANNER FOR SESAME DEVICES");
+        Serial.println("📱 Close the SESAME app on your phone; records follow as JSON lines");
+        Serial.println("💡 Sesame candidates carry \"sesame\":true - use their \"addr\" in SESAME_LOCKS");
+    }
+
+    advertQueue = xQueueCreate(ADVERT_QUEUE_LENGTH, sizeof(AdvertRecord));
+    NimBLEDevice::init("ESP32-Sesame-Scanner");
+    startScan();
+
+    lastStatsMs = millis();
+    lastAgingMs = lastStatsMs;
 }
 
 void loop() {
-    if (millis() - lastScan > SCAN_INTERVAL) {
-        lastScan = millis();
-        scanNumber++;
-        
-        Serial.println("🔄 Scan #" + String(scanNumber) + " starting...");
-        
-        BLEScan* pBLEScan = BLEDevice::getScan();
-        pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks());
-        pBLEScan->setActiveScan(true);
-        pBLEScan->setInterval(100);
-        pBLEScan->setWindow(99);
-        
-        BLEScanResults foundDevicesThisScan = pBLEScan->start(SCAN_TIME, false);
-        
-        Serial.printf("   Scan completed. Found %d devices in this scan\n", foundDevicesThisScan.getCount());
-        Serial.printf("   Total potential Sesame devices: %d\n", deviceCount);
-        
-        pBLEScan->clearResults();
-        
-        // Hiển thị kết quả sau scan thứ 2 hoặc nếu tìm thấy devices
-        if (scanNumber >= 2 || deviceCount > 0) {
-            printResults();
-            
-            if (deviceCount > 0) {
-                Serial.println("⏹️  Scanner will continue running...");
-                Serial.println("   Press RESET to restart or upload main project");
-            }
+    AdvertRecord record;
+    if (xQueueReceive(advertQueue, &record, pdMS_TO_TICKS(100)) == pdTRUE) {
+        handleAdvert(record, millis());
+        while (xQueueReceive(advertQueue, &record, 0) == pdTRUE) {
+            handleAdvert(record, millis());
         }
-        
-        Serial.println("⏳ Waiting " + String(SCAN_INTERVAL/1000) + " seconds before next scan...\n");
     }
-    
-    delay(1000);
-} 
\ No newline at end of file
+
+    uint32_t now = millis();
+    if (now - lastAgingMs >= 1000) {
+        lastAgingMs = now;
+        ageDevices(now);
+    }
+    if (now - lastStatsMs >= STATS_INTERVAL_MS) {
+        printStats(now);
+        lastStatsMs = now;
+    }
+
+    // The controller can end a scan on its own; keep it running
+    if (!NimBLEDevice::getScan()->isScanning()) {
+        startScan();
+    }
+}